@@ -38,19 +38,31 @@ set(JSI_SOURCES
 
 # Sandbox sources (C++) - same as native!
 set(SANDBOX_SOURCES
+    ${SRC_DIR}/Bootstrap.cpp
+    ${SRC_DIR}/BoundaryStats.cpp
+    ${SRC_DIR}/BundleCompiler.cpp
+    ${SRC_DIR}/HostEventQueue.cpp
     ${SRC_DIR}/HostProxy.cpp
     ${SRC_DIR}/JSIValueConverter.cpp
+    ${SRC_DIR}/MappedFile.cpp
+    ${SRC_DIR}/MessageRing.cpp
+    ${SRC_DIR}/NodeTreeStore.cpp
+    ${SRC_DIR}/OperationArena.cpp
+    ${SRC_DIR}/OperationCoalescer.cpp
     ${SRC_DIR}/QuickJSInstrumentation.cpp
     ${SRC_DIR}/QuickJSPointerValue.cpp
     ${SRC_DIR}/QuickJSRuntime.cpp
     ${SRC_DIR}/QuickJSRuntimeFactory.cpp
     ${SRC_DIR}/QuickJSSandboxJSI.cpp
+    ${SRC_DIR}/StaticHostObject.cpp
+    ${SRC_DIR}/TraceBuffer.cpp
 )
 
 # QuickJS compile definitions
 set(QUICKJS_DEFINITIONS
     CONFIG_VERSION="2024-01-13"
     CONFIG_BIGNUM
+    CONFIG_APP_ATOMS
     _GNU_SOURCE
 )
 
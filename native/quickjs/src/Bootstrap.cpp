@@ -0,0 +1,85 @@
+#include "Bootstrap.h"
+#include <atomic>
+#include <cstring>
+
+#ifdef QUICKJS_SANDBOX_BOOTSTRAP_BYTECODE
+// Generated by tools/compile_bootstrap.cpp: kBootstrapScripts[] and
+// kBootstrapScriptCount
+#include "BootstrapBytecode.h"
+#endif
+
+namespace quickjs_sandbox {
+
+#ifndef QUICKJS_SANDBOX_BOOTSTRAP_BYTECODE
+static constexpr const BootstrapScript *kBootstrapScripts = nullptr;
+static constexpr size_t kBootstrapScriptCount = 0;
+#endif
+
+static std::atomic<uint64_t>
+    g_bootstrapUses[kBootstrapScriptCount ? kBootstrapScriptCount : 1];
+
+const BootstrapScript *bootstrapScripts(size_t *count) {
+  *count = kBootstrapScriptCount;
+  return kBootstrapScripts;
+}
+
+const BootstrapScript *findBootstrapScript(const char *name) {
+  for (size_t i = 0; i < kBootstrapScriptCount; i++) {
+    if (std::strcmp(kBootstrapScripts[i].name, name) == 0) {
+      return &kBootstrapScripts[i];
+    }
+  }
+  return nullptr;
+}
+
+const BootstrapScript *findBootstrapScriptForSource(const char *source,
+                                                    size_t length) {
+  uint64_t hash = 0;
+  bool hashed = false;
+  for (size_t i = 0; i < kBootstrapScriptCount; i++) {
+    const BootstrapScript &script = kBootstrapScripts[i];
+    if (script.sourceLength != length) {
+      continue;
+    }
+    // Only hash sources that could match
+    if (!hashed) {
+      hash = hashBootstrapSource(source, length);
+      hashed = true;
+    }
+    if (script.sourceHash == hash) {
+      return &script;
+    }
+  }
+  return nullptr;
+}
+
+uint64_t bootstrapScriptUses(const BootstrapScript &script) {
+  return g_bootstrapUses[&script - kBootstrapScripts].load(
+      std::memory_order_relaxed);
+}
+
+bool loadBootstrapScript(JSContext *ctx, const BootstrapScript &script,
+                         JSValue *function) {
+  JSValue loaded = JS_ReadObject(ctx, script.bytecode, script.bytecodeSize,
+                                 JS_READ_OBJ_BYTECODE);
+  if (JS_IsException(loaded)) {
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    return false;
+  }
+  g_bootstrapUses[&script - kBootstrapScripts].fetch_add(
+      1, std::memory_order_relaxed);
+  *function = loaded;
+  return true;
+}
+
+bool evalBootstrapScript(JSContext *ctx, const BootstrapScript &script,
+                         JSValue *result) {
+  JSValue function;
+  if (!loadBootstrapScript(ctx, script, &function)) {
+    return false;
+  }
+  *result = JS_EvalFunction(ctx, function);
+  return true;
+}
+
+} // namespace quickjs_sandbox
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <quickjs.h>
+
+namespace quickjs_sandbox {
+
+/**
+ * Bootstrap scripts precompiled to QuickJS bytecode at build time
+ *
+ * tools/compile_bootstrap.cpp compiles the console shim and the scripts the
+ * host evaluates into every context (guest bundle, DevTools shim) and
+ * writes them to a generated BootstrapBytecode.h, which is embedded when
+ * the library is built with QUICKJS_SANDBOX_BOOTSTRAP_BYTECODE. Without it
+ * the table is empty and everything is parsed from source as before.
+ *
+ * A script is matched by the length and hash of its source, so a host
+ * shipping a different bundle than the library was built with still gets
+ * its own code.
+ */
+struct BootstrapScript {
+  const char *name;
+  const uint8_t *bytecode;
+  size_t bytecodeSize;
+  size_t sourceLength;
+  uint64_t sourceHash;
+};
+
+// FNV-1a; also used by the build tool
+inline uint64_t hashBootstrapSource(const char *data, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+const BootstrapScript *findBootstrapScript(const char *name);
+const BootstrapScript *findBootstrapScriptForSource(const char *source,
+                                                    size_t length);
+
+// All embedded scripts, for diagnostics
+const BootstrapScript *bootstrapScripts(size_t *count);
+// Times a script's bytecode was evaluated in this process
+uint64_t bootstrapScriptUses(const BootstrapScript &script);
+
+/**
+ * Evaluate a script's bytecode as a global script in `ctx`. Returns false,
+ * without a pending exception, when the bytecode cannot be loaded (e.g. a
+ * QuickJS built with different options); the caller then evaluates the
+ * source instead. Otherwise *result receives the completion value or
+ * JS_EXCEPTION.
+ */
+bool evalBootstrapScript(JSContext *ctx, const BootstrapScript &script,
+                         JSValue *result);
+
+// Like evalBootstrapScript(), but only loads the script: *function
+// receives the function to run with JS_EvalFunction
+bool loadBootstrapScript(JSContext *ctx, const BootstrapScript &script,
+                         JSValue *function);
+
+} // namespace quickjs_sandbox
@@ -0,0 +1,51 @@
+#include "BoundaryStats.h"
+#include <algorithm>
+#include <cmath>
+
+namespace quickjs_sandbox {
+
+size_t LatencyHistogram::bucketOf(uint64_t ns) {
+  if (ns < (uint64_t)kSubBuckets) {
+    return (size_t)ns;
+  }
+  int bit = 63 - __builtin_clzll(ns);
+  if (bit > kMaxBit) {
+    return kBuckets - 1;
+  }
+  int shift = bit - kSubBits;
+  size_t sub = (size_t)(ns >> shift) & (kSubBuckets - 1);
+  return (size_t)(bit - kSubBits + 1) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketLimit(size_t bucket) {
+  if (bucket < (size_t)kSubBuckets) {
+    return bucket;
+  }
+  int bit = (int)(bucket / kSubBuckets) + kSubBits - 1;
+  uint64_t sub = bucket % kSubBuckets;
+  int shift = bit - kSubBits;
+  // Largest value with this leading bit and sub-bucket
+  return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::percentileNs(double p) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)std::ceil(p / 100.0 * (double)count_);
+  rank = std::min(std::max(rank, (uint64_t)1), count_);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < (size_t)kBuckets; i++) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(bucketLimit(i), maxNs_);
+    }
+  }
+  return maxNs_;
+}
+
+void LatencyHistogram::clear() { *this = LatencyHistogram(); }
+
+void BoundaryStats::clear() { *this = BoundaryStats(); }
+
+} // namespace quickjs_sandbox
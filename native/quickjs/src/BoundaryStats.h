@@ -0,0 +1,138 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace quickjs_sandbox {
+
+/**
+ * LatencyHistogram - Log-linear histogram of durations (HDR-style)
+ *
+ * Values below 8 ns get a bucket each; above that every power of two is
+ * split into 8 sub-buckets, so a percentile is reported within 12.5% of
+ * the recorded value. Durations past ~18 minutes share the last bucket.
+ * Recording is a count and a few bit operations.
+ */
+class LatencyHistogram {
+public:
+  void record(uint64_t ns) {
+    counts_[bucketOf(ns)]++;
+    count_++;
+    totalNs_ += ns;
+    if (ns > maxNs_) {
+      maxNs_ = ns;
+    }
+  }
+
+  uint64_t count() const { return count_; }
+  uint64_t totalNs() const { return totalNs_; }
+  uint64_t maxNs() const { return maxNs_; }
+
+  // Upper bound of the bucket holding the p-th percentile (0 < p <= 100),
+  // capped at the maximum; 0 when nothing was recorded
+  uint64_t percentileNs(double p) const;
+
+  void clear();
+
+private:
+  static constexpr int kSubBits = 3;
+  static constexpr int kSubBuckets = 1 << kSubBits;
+  static constexpr int kMaxBit = 40;
+  static constexpr int kBuckets = (kMaxBit - kSubBits + 2) * kSubBuckets;
+
+  static size_t bucketOf(uint64_t ns);
+  static uint64_t bucketLimit(size_t bucket);
+
+  uint64_t counts_[kBuckets] = {};
+  uint64_t count_ = 0;
+  uint64_t totalNs_ = 0;
+  uint64_t maxNs_ = 0;
+};
+
+/**
+ * BoundaryStats - Traffic across one sandbox context's host boundary
+ *
+ * A crossing is one value converted at the top level (a call argument, a
+ * return value, a setGlobal()/getGlobal() value); values, objects, strings
+ * and functions count everything nested in it as well. Bytes are the UTF-8
+ * length of converted string values. Conversion time is recorded once per
+ * crossing.
+ *
+ * Host functions handed to the guest are wrapped (toGuest.functions) and
+ * released when the guest collects the wrapper; guest functions handed to
+ * the host are counted in toHost.functions.
+ */
+struct BoundaryStats {
+  struct Direction {
+    uint64_t crossings = 0;
+    uint64_t values = 0;
+    uint64_t objects = 0; // objects and arrays
+    uint64_t strings = 0;
+    uint64_t bytes = 0;
+    uint64_t functions = 0;
+    LatencyHistogram conversion;
+  };
+
+  Direction toGuest; // jsiToQJS
+  Direction toHost;  // qjsToJSI
+  uint64_t functionsReleased = 0;
+  LatencyHistogram hostCalls;  // guest -> host callbacks, with conversions
+  LatencyHistogram guestCalls; // host -> guest function calls, likewise
+
+  void clear();
+
+  static uint64_t nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /**
+   * Counts a value entering a conversion. The outermost scope of a nested
+   * conversion counts the crossing and records its duration.
+   */
+  class ConversionScope {
+  public:
+    ConversionScope(Direction &direction, int &depth)
+        : direction_(direction), depth_(depth),
+          start_(depth == 0 ? nowNs() : 0) {
+      depth_++;
+      direction_.values++;
+    }
+    ~ConversionScope() {
+      if (--depth_ == 0) {
+        direction_.crossings++;
+        direction_.conversion.record(nowNs() - start_);
+      }
+    }
+
+    ConversionScope(const ConversionScope &) = delete;
+    ConversionScope &operator=(const ConversionScope &) = delete;
+
+  private:
+    Direction &direction_;
+    int &depth_;
+    uint64_t start_;
+  };
+
+  /**
+   * Records the duration of a boundary call on scope exit, including
+   * exits by exception
+   */
+  class CallScope {
+  public:
+    explicit CallScope(LatencyHistogram &histogram)
+        : histogram_(histogram), start_(nowNs()) {}
+    ~CallScope() { histogram_.record(nowNs() - start_); }
+
+    CallScope(const CallScope &) = delete;
+    CallScope &operator=(const CallScope &) = delete;
+
+  private:
+    LatencyHistogram &histogram_;
+    uint64_t start_;
+  };
+};
+
+} // namespace quickjs_sandbox
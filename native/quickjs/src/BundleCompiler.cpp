@@ -0,0 +1,281 @@
+#include "BundleCompiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+
+namespace quickjs_sandbox {
+
+// Larger expected lengths are not trusted for the buffer size
+static constexpr size_t kMaxCapacity = 64 * 1024 * 1024;
+
+// Parser recursion limit on the worker, whose stack may be small (512 KB
+// for secondary threads on iOS). Deeper code fails to compile there and is
+// compiled by the JS thread instead.
+static constexpr size_t kWorkerStackBytes = 384 * 1024;
+
+static double nowMs() {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+BundleCompiler::BundleCompiler(std::string sourceURL, size_t expectedBytes)
+    : sourceURL_(std::move(sourceURL)),
+      capacity_(expectedBytes ? std::min(expectedBytes, kMaxCapacity)
+                              : kDefaultCapacity),
+      buffer_(new char[capacity_ + 1]) {
+  buffer_[0] = '\0';
+  try {
+    worker_ = std::thread(&BundleCompiler::run, this);
+  } catch (const std::system_error &) {
+    // No threads (e.g. a WASM build without pthreads): wait() hands the
+    // source to the JS thread
+  }
+}
+
+BundleCompiler::~BundleCompiler() {
+  cancel();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void BundleCompiler::append(const char *data, size_t length) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (finished_ || cancelled_) {
+    return;
+  }
+  pending_.append(data, length);
+  stats_.bytes += length;
+  stats_.chunks++;
+  changed_.notify_all();
+}
+
+void BundleCompiler::finish() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  finished_ = true;
+  changed_.notify_all();
+}
+
+void BundleCompiler::cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  changed_.notify_all();
+}
+
+bool BundleCompiler::finished() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return finished_;
+}
+
+bool BundleCompiler::cancelled() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cancelled_;
+}
+
+BundleCompiler::Stats BundleCompiler::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+bool BundleCompiler::wait(std::vector<uint8_t> *bytecode) {
+  double start = nowMs();
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!worker_.joinable()) {
+    changed_.wait(lock, [this] { return finished_ || cancelled_; });
+    if (!done_) {
+      source_ = takeSource();
+      done_ = true;
+    }
+  }
+  changed_.wait(lock, [this] { return done_; });
+  stats_.waitMs = nowMs() - start;
+  if (!compiled_) {
+    return false;
+  }
+  *bytecode = std::move(bytecode_);
+  compiled_ = false;
+  return true;
+}
+
+bool BundleCompiler::exposeInput() {
+  if (!pending_.empty() && !overflow_) {
+    if (pending_.size() > capacity_ - size_) {
+      overflow_ = true;
+    } else {
+      std::memcpy(buffer_.get() + size_, pending_.data(), pending_.size());
+      size_ += pending_.size();
+      pending_.clear();
+      // The terminator at the end of the exposed input may have been
+      // overwritten
+      if (!hiding_ && exposed_ < size_) {
+        hiddenByte_ = buffer_[exposed_];
+        buffer_[exposed_] = '\0';
+        hiding_ = true;
+      }
+    }
+  }
+  if (overflow_) {
+    return false;
+  }
+
+  size_t end = exposed_;
+  if (finished_) {
+    end = size_;
+  } else {
+    for (size_t i = size_; i > exposed_; i--) {
+      char c = buffer_[i - 1];
+      if (c == '\n' || c == ';' || c == ',') {
+        end = i;
+        break;
+      }
+    }
+  }
+  if (end == exposed_) {
+    return false;
+  }
+
+  // The parser expects a terminator at the end of its input. It replaces
+  // the first byte not exposed yet, which is put back on the next call.
+  if (hiding_) {
+    buffer_[exposed_] = hiddenByte_;
+  }
+  hiding_ = end < size_;
+  if (hiding_) {
+    hiddenByte_ = buffer_[end];
+  }
+  buffer_[end] = '\0';
+  exposed_ = end;
+  return true;
+}
+
+const char *BundleCompiler::moreInput(void *opaque, const char *inputEnd) {
+  auto *self = static_cast<BundleCompiler *>(opaque);
+  double start = nowMs();
+  std::unique_lock<std::mutex> lock(self->mutex_);
+  self->changed_.wait(lock, [self] {
+    return self->exposeInput() || self->cancelled_ || self->overflow_ ||
+           (self->finished_ && self->exposed_ == self->size_);
+  });
+  self->inputWaitMs_ += nowMs() - start;
+  // Unchanged (the end of the input) when cancelled or out of room
+  return self->overflow_ || self->cancelled_ ? inputEnd
+                                             : self->buffer_.get() +
+                                                   self->exposed_;
+}
+
+std::string BundleCompiler::takeSource() {
+  if (hiding_) {
+    buffer_[exposed_] = hiddenByte_;
+    hiding_ = false;
+  }
+  std::string source(buffer_.get(), size_);
+  source.append(pending_);
+  pending_.clear();
+  return source;
+}
+
+static void freeResult(JSContext *ctx, JSValue value) {
+  if (JS_IsException(value)) {
+    JS_FreeValue(ctx, JS_GetException(ctx));
+  } else {
+    JS_FreeValue(ctx, value);
+  }
+}
+
+void BundleCompiler::compile(JSContext *ctx) {
+  bool streaming;
+  {
+    // Wait for the first part of the input
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] {
+      return exposeInput() || exposed_ > 0 || cancelled_ || overflow_ ||
+             finished_;
+    });
+    if (cancelled_) {
+      return;
+    }
+    streaming = !overflow_;
+  }
+
+  const int flags = JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY;
+  double start = nowMs();
+  JSValue function = JS_EXCEPTION;
+  if (streaming) {
+    function = JS_EvalStream(ctx, buffer_.get(), exposed_, sourceURL_.c_str(),
+                             flags, moreInput, this);
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (overflow_) {
+      // The partial parse is useless: compile the complete source once it
+      // is here
+      if (streaming) {
+        freeResult(ctx, function);
+        streaming = false;
+      }
+      changed_.wait(lock, [this] { return finished_ || cancelled_; });
+      source_ = takeSource();
+    }
+    if (cancelled_) {
+      if (streaming) {
+        freeResult(ctx, function);
+      }
+      return;
+    }
+  }
+  if (!streaming) {
+    start = nowMs();
+    inputWaitMs_ = 0;
+    function = JS_Eval(ctx, source_.c_str(), source_.size(),
+                       sourceURL_.c_str(), flags);
+  }
+  double compileMs = nowMs() - start - inputWaitMs_;
+
+  std::vector<uint8_t> bytecode;
+  if (!JS_IsException(function)) {
+    size_t size = 0;
+    uint8_t *data = JS_WriteObject(ctx, &size, function, JS_WRITE_OBJ_BYTECODE);
+    if (data) {
+      bytecode.assign(data, data + size);
+      js_free(ctx, data);
+    } else {
+      JS_FreeValue(ctx, JS_GetException(ctx));
+    }
+  }
+  // A failure is reported by the JS thread, which evaluates the source
+  freeResult(ctx, function);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.compileMs = compileMs;
+  stats_.streamed = streaming && !bytecode.empty();
+  compiled_ = !bytecode.empty();
+  bytecode_ = std::move(bytecode);
+}
+
+void BundleCompiler::run() {
+  JSRuntime *rt = JS_NewRuntime();
+  JSContext *ctx = rt ? JS_NewContext(rt) : nullptr;
+  if (ctx) {
+    JS_SetMaxStackSize(rt, kWorkerStackBytes);
+    compile(ctx);
+    JS_FreeContext(ctx);
+  }
+  if (rt) {
+    JS_FreeRuntime(rt);
+  }
+
+  // A compile that stopped early (failure, cancel) still leaves the
+  // complete source for the JS thread
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this] { return finished_ || cancelled_; });
+  if (source_.empty()) {
+    source_ = takeSource();
+  }
+  done_ = true;
+  changed_.notify_all();
+}
+
+} // namespace quickjs_sandbox
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <quickjs.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quickjs_sandbox {
+
+/**
+ * BundleCompiler - Compiles a guest bundle while it downloads
+ *
+ * The host append()s source chunks as they arrive and calls finish() after
+ * the last one. A worker thread parses and compiles the source on a
+ * scratch JSRuntime of its own as it comes in (JS_EvalStream with
+ * JS_EVAL_FLAG_COMPILE_ONLY) and serializes the function with
+ * JS_WriteObject, so the JS thread only has to JS_ReadObject and run it
+ * (see QuickJSSandboxContext::evalBundle).
+ *
+ * The parser is given the source up to the last line terminator, ';' or
+ * ',' received, so identifiers, numbers and operators are never split
+ * between chunks (minified bundles are mostly one line); strings,
+ * templates, regexps and comments spanning chunks wait for more input in
+ * the parser. Since the parser keeps pointers into the source, the buffer
+ * is sized once from expectedBytes: a bundle that outgrows it (or a
+ * failed compile, e.g. a syntax error) is left to the JS thread, which
+ * evaluates the complete source().
+ *
+ * append(), finish() and cancel() may be called from any thread; wait()
+ * and source() from the thread that evaluates the result.
+ */
+class BundleCompiler {
+public:
+  struct Stats {
+    uint64_t bytes = 0;
+    uint64_t chunks = 0;
+    // Worker time parsing and compiling, not counting waits for input
+    double compileMs = 0;
+    // Time wait() blocked for the input and compile to complete
+    double waitMs = 0;
+    // Compiled while the source arrived; false if it had to wait for the
+    // complete source or failed
+    bool streamed = false;
+  };
+
+  // Buffer size when the length is not known up front
+  static constexpr size_t kDefaultCapacity = 4 * 1024 * 1024;
+
+  BundleCompiler(std::string sourceURL, size_t expectedBytes = 0);
+  // Cancels a compile in progress
+  ~BundleCompiler();
+
+  BundleCompiler(const BundleCompiler &) = delete;
+  BundleCompiler &operator=(const BundleCompiler &) = delete;
+
+  // Ignored after finish() or cancel()
+  void append(const char *data, size_t length);
+  void finish();
+  // Stop the worker; wait() then returns false
+  void cancel();
+
+  /**
+   * Block until finish() or cancel() and the worker is done. Returns true
+   * with the bytecode in *bytecode (moved out, so only once), or false if
+   * the source has to be evaluated instead (see above).
+   */
+  bool wait(std::vector<uint8_t> *bytecode);
+
+  // The complete source, once wait() returned
+  const std::string &source() const { return source_; }
+  const std::string &sourceURL() const { return sourceURL_; }
+  bool finished() const;
+  bool cancelled() const;
+  Stats stats() const;
+
+private:
+  static const char *moreInput(void *opaque, const char *inputEnd);
+
+  void run();
+  // Worker, with mutex_ held: move pending input into buffer_ and expose
+  // it to the parser up to the last line terminator, ';' or ',' (everything
+  // once the input is complete). Returns true if the exposed length grew.
+  bool exposeInput();
+  // Worker, with mutex_ held: everything received, as one string
+  std::string takeSource();
+  void compile(JSContext *ctx);
+
+  const std::string sourceURL_;
+  std::thread worker_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::string pending_; // appended, not yet taken by the worker
+  bool finished_ = false;
+  bool cancelled_ = false;
+  bool done_ = false;
+  Stats stats_;
+
+  // Worker only, until done_
+  size_t capacity_;
+  std::unique_ptr<char[]> buffer_; // capacity_ + 1 for the terminator
+  size_t size_ = 0;                // bytes received
+  size_t exposed_ = 0;             // bytes the parser may read
+  char hiddenByte_ = 0;            // replaced by the terminator
+  bool hiding_ = false;            // hiddenByte_ belongs at exposed_
+  bool overflow_ = false;
+  double inputWaitMs_ = 0;
+
+  // Results, read after done_
+  std::vector<uint8_t> bytecode_;
+  bool compiled_ = false;
+  std::string source_;
+};
+
+} // namespace quickjs_sandbox
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace quickjs_sandbox {
+
+/**
+ * Source of the console installed into every sandbox context. Compiled to
+ * bytecode at build time (see tools/compile_bootstrap.cpp); evaluated from
+ * source when the library was built without embedded bytecode.
+ * Expects the native `__qjs_print` global. console.time()/timeLog()/
+ * timeEnd() are native and added afterwards (see installPerformance()).
+ */
+inline constexpr char kConsoleShimSource[] = R"(
+        var console = {
+            log: function() {
+                var args = Array.prototype.slice.call(arguments);
+                __qjs_print(args.map(function(a) {
+                    if (typeof a === 'object') return JSON.stringify(a);
+                    return String(a);
+                }).join(' '));
+            },
+            warn: function() { console.log('[WARN]', ...arguments); },
+            error: function() { console.log('[ERROR]', ...arguments); },
+            info: function() { console.log('[INFO]', ...arguments); },
+            debug: function() { console.log('[DEBUG]', ...arguments); },
+            assert: function(cond) { if (!cond) console.log('[ASSERT]', ...Array.prototype.slice.call(arguments, 1)); },
+            trace: function() {},
+            group: function() {},
+            groupEnd: function() {}
+        };
+    )";
+
+} // namespace quickjs_sandbox
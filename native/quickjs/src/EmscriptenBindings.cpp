@@ -6,11 +6,14 @@
 
 #include <emscripten/bind.h>
 #include <emscripten/val.h>
+#include <cmath>
 #include <cstring>
+#include <stdexcept>
 #include <vector>
 #include "QuickJSSandboxJSI.h"
 #include "QuickJSRuntimeFactory.h"
 #include "jsi/jsi.h"
+#include "wasm_value.h"
 
 using namespace emscripten;
 using namespace facebook::jsi;
@@ -18,16 +21,22 @@ using namespace facebook::jsi;
 /**
  * WASM-compatible wrapper for QuickJS Runtime
  *
- * Bridges the JSI C++ API to JavaScript via Emscripten
+ * Bridges the JSI C++ API to JavaScript via Emscripten. Values cross as
+ * JSON strings (eval, setGlobal, getGlobal) or in the binary encoding of
+ * wasm_value.h (evalValue, setGlobalValue, getGlobalValue), which returns
+ * a view of a result buffer reused across calls and reads input from
+ * inputBuffer().
  */
 class QuickJSWASMRuntime {
 private:
     std::shared_ptr<Runtime> runtime_;
+    std::vector<uint8_t> input_;
+    std::vector<uint8_t> result_;
 
 public:
     QuickJSWASMRuntime() {
         // Create QuickJS runtime using the existing factory
-        runtime_ = rill::createQuickJSRuntime();
+        runtime_ = qjs::createQuickJSRuntime("");
     }
 
     ~QuickJSWASMRuntime() {
@@ -50,9 +59,84 @@ public:
             // Convert JSI Value to JSON string
             return valueToJSON(result);
         } catch (const JSError& e) {
-            return std::string("{\"error\":\"") + e.getMessage() + "\"}";
+            return std::string("{\"error\":\"") + escapeJSON(e.getMessage()) + "\"}";
         } catch (const std::exception& e) {
-            return std::string("{\"error\":\"") + e.what() + "\"}";
+            return std::string("{\"error\":\"") + escapeJSON(e.what()) + "\"}";
+        }
+    }
+
+    /**
+     * Evaluate JavaScript code
+     *
+     * @param code JavaScript code string
+     * @return Uint8Array view of the encoded result (an ERROR if the code
+     *         threw), valid until the next call
+     */
+    val evalValue(const std::string& code) {
+        try {
+            auto result = runtime_->evaluateJavaScript(
+                std::make_shared<StringBuffer>(code),
+                "eval"
+            );
+            return encodeResult(result);
+        } catch (const JSError& e) {
+            return encodeError(e.getMessage());
+        } catch (const std::exception& e) {
+            return encodeError(e.what());
+        }
+    }
+
+    /**
+     * Input buffer for setGlobalValue
+     *
+     * @param size Bytes the caller will write
+     * @return Uint8Array view of the buffer, valid until the next call
+     */
+    val inputBuffer(size_t size) {
+        // resize() keeps the capacity, so the buffer is only reallocated to grow
+        input_.resize(size);
+        return val(typed_memory_view(input_.size(), input_.data()));
+    }
+
+    /**
+     * Set a global variable from an encoded value
+     *
+     * @param name Variable name
+     * @param length Length of the value written to inputBuffer()
+     * @return false if the encoding is malformed
+     */
+    bool setGlobalValue(const std::string& name, size_t length) {
+        try {
+            if (length > input_.size()) {
+                throw std::runtime_error("value is longer than the input buffer");
+            }
+            const uint8_t* pos = input_.data();
+            const uint8_t* end = pos + length;
+            Value value = decodeValue(pos, end, 0);
+            if (pos != end) {
+                throw std::runtime_error("malformed binary value");
+            }
+            runtime_->global().setProperty(*runtime_, name.c_str(), value);
+            return true;
+        } catch (const std::exception& e) {
+            fprintf(stderr, "setGlobalValue failed: %s\n", e.what());
+            return false;
+        }
+    }
+
+    /**
+     * Get a global variable
+     *
+     * @param name Variable name
+     * @return Uint8Array view of the encoded value, valid until the next call
+     */
+    val getGlobalValue(const std::string& name) {
+        try {
+            return encodeResult(runtime_->global().getProperty(*runtime_, name.c_str()));
+        } catch (const JSError& e) {
+            return encodeError(e.getMessage());
+        } catch (const std::exception& e) {
+            return encodeError(e.what());
         }
     }
 
@@ -121,7 +205,7 @@ public:
             );
 
             // Create ArrayBuffer
-            auto arrayBuffer = runtime_->createArrayBuffer(buffer);
+            ArrayBuffer arrayBuffer(*runtime_, buffer);
 
             // Set as global
             runtime_->global().setProperty(*runtime_, name.c_str(), std::move(arrayBuffer));
@@ -199,6 +283,214 @@ public:
     }
 
 private:
+    // Binary values (wasm_value.h)
+
+    val resultView() {
+        return val(typed_memory_view(result_.size(), result_.data()));
+    }
+
+    val encodeResult(const Value& value) {
+        result_.clear();
+        try {
+            encodeValue(value, 0);
+        } catch (const JSError& e) {
+            return encodeError(e.getMessage());
+        } catch (const std::exception& e) {
+            return encodeError(e.what());
+        }
+        return resultView();
+    }
+
+    val encodeError(const std::string& message) {
+        result_.clear();
+        result_.push_back(WASM_VALUE_ERROR);
+        putBytes(message.data(), message.size());
+        return resultView();
+    }
+
+    void putScalar(uint8_t tag, const void* payload, size_t size) {
+        // WASM is little endian, so payloads are copied as they are in memory
+        result_.push_back(tag);
+        const uint8_t* bytes = static_cast<const uint8_t*>(payload);
+        result_.insert(result_.end(), bytes, bytes + size);
+    }
+
+    void putUvar(uint32_t value) {
+        while (value >= 0x80) {
+            result_.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        result_.push_back(static_cast<uint8_t>(value));
+    }
+
+    void putBytes(const void* data, size_t length) {
+        putUvar(static_cast<uint32_t>(length));
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        result_.insert(result_.end(), bytes, bytes + length);
+    }
+
+    void encodeValue(const Value& value, int depth) {
+        if (depth > WASM_VALUE_MAX_DEPTH) {
+            throw std::runtime_error("value is nested too deeply (cyclic?)");
+        }
+        if (value.isNull()) {
+            result_.push_back(WASM_VALUE_NULL);
+        } else if (value.isBool()) {
+            result_.push_back(value.getBool() ? WASM_VALUE_TRUE : WASM_VALUE_FALSE);
+        } else if (value.isNumber()) {
+            double number = value.getNumber();
+            int32_t integer = static_cast<int32_t>(number);
+            if (number == integer && !(integer == 0 && std::signbit(number))) {
+                putScalar(WASM_VALUE_INT32, &integer, 4);
+            } else {
+                putScalar(WASM_VALUE_FLOAT64, &number, 8);
+            }
+        } else if (value.isString()) {
+            std::string str = value.getString(*runtime_).utf8(*runtime_);
+            result_.push_back(WASM_VALUE_STRING);
+            putBytes(str.data(), str.size());
+        } else if (value.isObject()) {
+            encodeObject(value.getObject(*runtime_), depth);
+        } else {
+            // undefined, symbols, big integers
+            result_.push_back(WASM_VALUE_UNDEFINED);
+        }
+    }
+
+    void encodeObject(const Object& obj, int depth) {
+        Runtime& rt = *runtime_;
+        if (obj.isFunction(rt)) {
+            result_.push_back(WASM_VALUE_UNDEFINED);
+            return;
+        }
+        if (obj.isArrayBuffer(rt)) {
+            ArrayBuffer buffer = obj.getArrayBuffer(rt);
+            result_.push_back(WASM_VALUE_BYTES);
+            putBytes(buffer.data(rt), buffer.size(rt));
+            return;
+        }
+        Value toJSON = obj.getProperty(rt, "toJSON");
+        if (toJSON.isObject() && toJSON.getObject(rt).isFunction(rt)) {
+            Value json = toJSON.getObject(rt).getFunction(rt).callWithThis(rt, obj);
+            encodeValue(json, depth + 1);
+            return;
+        }
+        if (obj.isArray(rt)) {
+            Array array = obj.getArray(rt);
+            size_t length = array.size(rt);
+            result_.push_back(WASM_VALUE_ARRAY);
+            putUvar(static_cast<uint32_t>(length));
+            for (size_t i = 0; i < length; i++) {
+                encodeValue(array.getValueAtIndex(rt, i), depth + 1);
+            }
+            return;
+        }
+        // Own enumerable string keys, like JSON.stringify
+        Array names = obj.getPropertyNames(rt);
+        size_t count = names.size(rt);
+        result_.push_back(WASM_VALUE_OBJECT);
+        putUvar(static_cast<uint32_t>(count));
+        for (size_t i = 0; i < count; i++) {
+            String name = names.getValueAtIndex(rt, i).getString(rt);
+            std::string key = name.utf8(rt);
+            putBytes(key.data(), key.size());
+            encodeValue(obj.getProperty(rt, name), depth + 1);
+        }
+    }
+
+    static uint32_t readUvar(const uint8_t*& pos, const uint8_t* end) {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 35 && pos < end; shift += 7) {
+            uint8_t byte = *pos++;
+            result |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return result;
+            }
+        }
+        throw std::runtime_error("malformed binary value");
+    }
+
+    // Length-prefixed bytes, returned in place
+    static const uint8_t* readBytes(const uint8_t*& pos, const uint8_t* end, size_t& length) {
+        length = readUvar(pos, end);
+        if (static_cast<size_t>(end - pos) < length) {
+            throw std::runtime_error("malformed binary value");
+        }
+        const uint8_t* bytes = pos;
+        pos += length;
+        return bytes;
+    }
+
+    Value decodeValue(const uint8_t*& pos, const uint8_t* end, int depth) {
+        Runtime& rt = *runtime_;
+        if (pos >= end || depth > WASM_VALUE_MAX_DEPTH) {
+            throw std::runtime_error("malformed binary value");
+        }
+        size_t length;
+        const uint8_t* bytes;
+        switch (*pos++) {
+            case WASM_VALUE_UNDEFINED: return Value::undefined();
+            case WASM_VALUE_NULL: return Value::null();
+            case WASM_VALUE_FALSE: return Value(false);
+            case WASM_VALUE_TRUE: return Value(true);
+            case WASM_VALUE_INT32: {
+                int32_t integer;
+                if (end - pos < 4) break;
+                std::memcpy(&integer, pos, 4);
+                pos += 4;
+                return Value(integer);
+            }
+            case WASM_VALUE_FLOAT64: {
+                double number;
+                if (end - pos < 8) break;
+                std::memcpy(&number, pos, 8);
+                pos += 8;
+                return Value(number);
+            }
+            case WASM_VALUE_STRING:
+                bytes = readBytes(pos, end, length);
+                return String::createFromUtf8(rt, bytes, length);
+            case WASM_VALUE_BYTES: {
+                bytes = readBytes(pos, end, length);
+                // Same copy as setGlobalArrayBuffer
+                std::vector<uint8_t> data(bytes, bytes + length);
+                class VectorBuffer : public MutableBuffer {
+                public:
+                    explicit VectorBuffer(std::vector<uint8_t> data) : data_(std::move(data)) {}
+                    size_t size() const override { return data_.size(); }
+                    uint8_t* data() override { return data_.data(); }
+
+                private:
+                    std::vector<uint8_t> data_;
+                };
+                return ArrayBuffer(rt, std::make_shared<VectorBuffer>(std::move(data)));
+            }
+            case WASM_VALUE_ARRAY: {
+                length = readUvar(pos, end);
+                // Each element takes at least a byte
+                if (static_cast<size_t>(end - pos) < length) break;
+                Array array(rt, length);
+                for (size_t i = 0; i < length; i++) {
+                    array.setValueAtIndex(rt, i, decodeValue(pos, end, depth + 1));
+                }
+                return array;
+            }
+            case WASM_VALUE_OBJECT: {
+                size_t count = readUvar(pos, end);
+                // Each entry takes at least two bytes
+                if (static_cast<size_t>(end - pos) / 2 < count) break;
+                Object obj(rt);
+                for (size_t i = 0; i < count; i++) {
+                    bytes = readBytes(pos, end, length);
+                    PropNameID key = PropNameID::forUtf8(rt, bytes, length);
+                    obj.setProperty(rt, key, decodeValue(pos, end, depth + 1));
+                }
+                return obj;
+            }
+        }
+        throw std::runtime_error("malformed binary value");
+    }
+
     /**
      * Convert JSI Value to JSON string
      */
@@ -213,7 +505,15 @@ private:
             return value.getBool() ? "true" : "false";
         }
         if (value.isNumber()) {
-            return std::to_string(value.getNumber());
+            // 17 significant digits round-trip every double; JSON has no
+            // NaN or Infinity
+            double number = value.getNumber();
+            if (!std::isfinite(number)) {
+                return "null";
+            }
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.17g", number);
+            return buffer;
         }
         if (value.isString()) {
             // Escape string
@@ -267,6 +567,10 @@ EMSCRIPTEN_BINDINGS(quickjs_sandbox) {
     class_<QuickJSWASMRuntime>("QuickJSRuntime")
         .constructor<>()
         .function("eval", &QuickJSWASMRuntime::eval)
+        .function("evalValue", &QuickJSWASMRuntime::evalValue)
+        .function("inputBuffer", &QuickJSWASMRuntime::inputBuffer)
+        .function("setGlobalValue", &QuickJSWASMRuntime::setGlobalValue)
+        .function("getGlobalValue", &QuickJSWASMRuntime::getGlobalValue)
         .function("setGlobal", &QuickJSWASMRuntime::setGlobal)
         .function("getGlobal", &QuickJSWASMRuntime::getGlobal)
         .function("setGlobalArrayBuffer", &QuickJSWASMRuntime::setGlobalArrayBuffer)
@@ -0,0 +1,651 @@
+#include "HeadlessHost.h"
+#include "NodeTreeStore.h"
+#include "QuickJSRuntimeFactory.h"
+#include "QuickJSSandboxJSI.h"
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+
+namespace rill {
+
+using namespace facebook;
+using quickjs_sandbox::BootstrapScript;
+using quickjs_sandbox::BundleCompiler;
+using quickjs_sandbox::NodeTreeStore;
+using quickjs_sandbox::QuickJSSandboxContext;
+using quickjs_sandbox::QuickJSSandboxRuntime;
+
+// Globals the Engine would otherwise provide: console sinks, CommonJS and
+// require() for externals, virtual-clock timers and the render entry point.
+// Evaluated before the guest runtime.
+static const char kHeadlessPrelude[] = R"(
+(function () {
+  var g = globalThis;
+
+  var log = g.__rillHeadlessLog;
+  function format(args) {
+    return Array.prototype.map.call(args, function (a) {
+      if (typeof a === 'object' && a !== null) {
+        try { return JSON.stringify(a); } catch (e) { return String(a); }
+      }
+      return String(a);
+    }).join(' ');
+  }
+  ['log', 'warn', 'error', 'debug', 'info'].forEach(function (level) {
+    g['__console_' + level] = typeof log === 'function'
+      ? function () { log(level, format(arguments)); }
+      : function () {};
+  });
+
+  g.module = { exports: {} };
+  g.exports = g.module.exports;
+  var modules = {
+    'react': 'React',
+    'react/jsx-runtime': 'ReactJSXRuntime',
+    'react/jsx-dev-runtime': 'ReactJSXDevRuntime',
+    'react-native': 'ReactNative',
+    'rill/sdk': 'RillSDK',
+    'rill/reconciler': 'RillReconciler'
+  };
+  g.require = function (name) {
+    if (Object.prototype.hasOwnProperty.call(modules, name) && g[modules[name]]) {
+      return g[modules[name]];
+    }
+    throw new Error('[rill] Unsupported require("' + name + '")');
+  };
+  g.__sendEventToHost = function () {};
+  g.__getConfig = function () { return g.__config || {}; };
+
+  var timers = [];
+  var nextTimerId = 1;
+  var clock = 0;
+  var settleUntil = 0;
+  function addTimer(fn, delay, args, repeat) {
+    if (typeof fn !== 'function') return 0;
+    delay = Math.max(0, Number(delay) || 0);
+    var id = nextTimerId++;
+    timers.push({ id: id, at: clock + delay, fn: fn, args: args, repeat: repeat ? Math.max(1, delay) : 0 });
+    return id;
+  }
+  function clearTimer(id) {
+    for (var i = 0; i < timers.length; i++) {
+      if (timers[i].id === id) {
+        timers.splice(i, 1);
+        return;
+      }
+    }
+  }
+  g.setTimeout = function (fn, delay) {
+    return addTimer(fn, delay, Array.prototype.slice.call(arguments, 2), false);
+  };
+  g.setInterval = function (fn, delay) {
+    return addTimer(fn, delay, Array.prototype.slice.call(arguments, 2), true);
+  };
+  g.clearTimeout = clearTimer;
+  g.clearInterval = clearTimer;
+  g.queueMicrotask = function (fn) { Promise.resolve().then(fn); };
+
+  // Run the earliest timer due before the settle horizon, advancing the
+  // clock to it; false when there is none
+  g.__rillHeadlessRunTimer = function () {
+    var next = -1;
+    for (var i = 0; i < timers.length; i++) {
+      if (next === -1 || timers[i].at < timers[next].at) next = i;
+    }
+    if (next === -1 || timers[next].at > settleUntil) return false;
+    var timer = timers[next];
+    if (timer.at > clock) clock = timer.at;
+    if (timer.repeat) {
+      timer.at = clock + timer.repeat;
+    } else {
+      timers.splice(next, 1);
+    }
+    try {
+      timer.fn.apply(undefined, timer.args);
+    } catch (e) {
+      g.__console_error('[rill] Timer error:', e && e.stack ? e.stack : String(e));
+    }
+    return true;
+  };
+
+  var mounted = false;
+  g.__rillHeadlessRender = function (propsJson, keepState, settleMs) {
+    var exported = g.__RillGuest;
+    var component = exported && typeof exported === 'object' ? exported.default || exported : exported;
+    if (typeof component !== 'function') {
+      throw new Error('[rill] Guest bundle has no component export');
+    }
+    var props = JSON.parse(propsJson);
+    g.__config = props;
+    settleUntil = clock + settleMs;
+    if (mounted && !keepState) {
+      g.RillReconciler.unmount(g.__sendToHost);
+    }
+    mounted = true;
+    g.RillReconciler.render(g.React.createElement(component, props), g.__sendToHost);
+  };
+})();
+)";
+
+// Serializes construction: QuickJS allocates class ids process-wide
+// without locking on first use
+static std::mutex g_constructionMutex;
+
+static double nowMs() {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct HeadlessHost::Impl {
+  struct Node {
+    std::string type;
+    std::string json; // props object, or the quoted text of a text node
+    bool text;
+  };
+
+  HeadlessOptions options;
+  std::unique_ptr<jsi::Runtime> runtime;
+  std::unique_ptr<jsi::Function> stringify;
+
+  // Per loaded bundle. The context's host object stays referenced until the
+  // sandbox runtime has dropped its own reference (see unload())
+  std::shared_ptr<QuickJSSandboxRuntime> sandbox;
+  std::unique_ptr<jsi::Object> contextObject;
+  std::shared_ptr<QuickJSSandboxContext> context;
+  std::unique_ptr<jsi::Function> renderFn;
+  std::unique_ptr<jsi::Function> runTimerFn;
+  std::string bundle;
+  bool loaded = false;
+
+  NodeTreeStore tree;
+  std::unordered_map<int64_t, Node> nodes;
+  RenderResult *current = nullptr;
+
+  void unload();
+  // Sandbox, prelude and guest runtime; the bundle is evaluated after it,
+  // then complete()
+  void prepare();
+  void load(const std::string &code);
+  void load(BundleCompiler &compiler);
+  void complete(const std::string &code);
+  void applyBatch(const jsi::Value &batch);
+  void storeProps(int64_t id, const jsi::Object &op, const char *key,
+                  bool text);
+  void writeNode(int64_t id, std::string &out) const;
+};
+
+void HeadlessHost::Impl::unload() {
+  // Guest function proxies point into the context; release them first
+  renderFn.reset();
+  runTimerFn.reset();
+  context.reset();
+  if (sandbox) {
+    sandbox->dispose();
+  }
+  contextObject.reset();
+  sandbox.reset();
+  bundle.clear();
+  loaded = false;
+  tree.clear();
+  nodes.clear();
+}
+
+void HeadlessHost::Impl::prepare() {
+  jsi::Runtime &rt = *runtime;
+  // No timeout: QuickJSSandboxRuntime does not enforce one
+  sandbox = std::make_shared<QuickJSSandboxRuntime>(rt, 0);
+  contextObject =
+      std::make_unique<jsi::Object>(sandbox->createContext(rt).getObject(rt));
+  context = contextObject->getHostObject<QuickJSSandboxContext>(rt);
+
+  if (options.onLog) {
+    auto onLog = options.onLog;
+    context->setGlobal(
+        rt, "__rillHeadlessLog",
+        jsi::Function::createFromHostFunction(
+            rt, jsi::PropNameID::forAscii(rt, "__rillHeadlessLog"), 2,
+            [onLog](jsi::Runtime &rt, const jsi::Value &,
+                    const jsi::Value *args, size_t count) -> jsi::Value {
+              if (count >= 2 && args[0].isString() && args[1].isString()) {
+                onLog(args[0].getString(rt).utf8(rt),
+                      args[1].getString(rt).utf8(rt));
+              }
+              return jsi::Value::undefined();
+            }));
+  }
+  context->eval(rt, kHeadlessPrelude);
+
+  if (!options.guestRuntimeSource.empty()) {
+    context->eval(rt, options.guestRuntimeSource);
+  } else {
+    const BootstrapScript *script =
+        quickjs_sandbox::findBootstrapScript("guest-bundle");
+    if (!script) {
+      throw HeadlessError("Guest runtime is not embedded in this build; set "
+                          "HeadlessOptions::guestRuntimeSource");
+    }
+    context->evalBootstrap(rt, *script);
+  }
+
+}
+
+void HeadlessHost::Impl::load(const std::string &code) {
+  prepare();
+  context->eval(*runtime, code);
+  complete(code);
+}
+
+void HeadlessHost::Impl::load(BundleCompiler &compiler) {
+  prepare();
+  context->evalBundle(*runtime, compiler);
+  complete(compiler.source());
+}
+
+void HeadlessHost::Impl::complete(const std::string &code) {
+  jsi::Runtime &rt = *runtime;
+  // __sendToHost is defined after the bundle so its auto-render footer
+  // stays idle
+  context->setOperationSink(
+      rt, "__sendToHost",
+      jsi::Function::createFromHostFunction(
+          rt, jsi::PropNameID::forAscii(rt, "__sendToHost"), 1,
+          [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *args,
+                 size_t count) -> jsi::Value {
+            if (count > 0) {
+              applyBatch(args[0]);
+            }
+            return jsi::Value::undefined();
+          }));
+
+  renderFn = std::make_unique<jsi::Function>(
+      context->getGlobal(rt, "__rillHeadlessRender")
+          .getObject(rt)
+          .getFunction(rt));
+  runTimerFn = std::make_unique<jsi::Function>(
+      context->getGlobal(rt, "__rillHeadlessRunTimer")
+          .getObject(rt)
+          .getFunction(rt));
+  bundle = code;
+  loaded = true;
+}
+
+void HeadlessHost::Impl::storeProps(int64_t id, const jsi::Object &op,
+                                    const char *key, bool text) {
+  jsi::Runtime &rt = *runtime;
+  jsi::Value value = op.getProperty(rt, key);
+  jsi::Value json = stringify->call(rt, value);
+  Node &node = nodes[id];
+  node.text = text;
+  node.json = json.isString() ? json.getString(rt).utf8(rt)
+                              : std::string(text ? "\"\"" : "{}");
+}
+
+void HeadlessHost::Impl::applyBatch(const jsi::Value &batch) {
+  jsi::Runtime &rt = *runtime;
+  if (!batch.isObject()) {
+    return;
+  }
+  jsi::Value operationsValue =
+      batch.getObject(rt).getProperty(rt, "operations");
+  if (!operationsValue.isObject() ||
+      !operationsValue.getObject(rt).isArray(rt)) {
+    return;
+  }
+  jsi::Array operations = operationsValue.getObject(rt).getArray(rt);
+  size_t count = operations.size(rt);
+
+  // Node data first; NodeTreeStore below applies the structure
+  for (size_t i = 0; i < count; i++) {
+    jsi::Value opValue = operations.getValueAtIndex(rt, i);
+    if (!opValue.isObject()) {
+      continue;
+    }
+    jsi::Object op = opValue.getObject(rt);
+    jsi::Value kind = op.getProperty(rt, "op");
+    jsi::Value idValue = op.getProperty(rt, "id");
+    if (!kind.isString() || !idValue.isNumber()) {
+      continue;
+    }
+    std::string name = kind.getString(rt).utf8(rt);
+    int64_t id = (int64_t)idValue.getNumber();
+    if (name == "CREATE") {
+      jsi::Value type = op.getProperty(rt, "type");
+      std::string typeName = type.isString() ? type.getString(rt).utf8(rt) : "";
+      bool text = typeName == "__TEXT__";
+      if (text) {
+        jsi::Value props = op.getProperty(rt, "props");
+        if (props.isObject()) {
+          storeProps(id, props.getObject(rt), "text", true);
+        }
+      } else {
+        storeProps(id, op, "props", false);
+      }
+      nodes[id].type = std::move(typeName);
+    } else if (name == "UPDATE") {
+      auto it = nodes.find(id);
+      if (it == nodes.end()) {
+        continue;
+      }
+      // UPDATE carries the complete new props
+      if (it->second.text) {
+        jsi::Value props = op.getProperty(rt, "props");
+        if (props.isObject()) {
+          storeProps(id, props.getObject(rt), "text", true);
+        }
+      } else {
+        storeProps(id, op, "props", false);
+      }
+    } else if (name == "TEXT") {
+      if (nodes.count(id)) {
+        storeProps(id, op, "text", true);
+      }
+    }
+  }
+
+  NodeTreeStore::BatchResult result;
+  tree.applyBatch(rt, operations, count, result);
+  for (int64_t id : result.deleted) {
+    nodes.erase(id);
+  }
+  if (current) {
+    current->batches++;
+    current->operations += (uint32_t)count;
+  }
+}
+
+static void appendJsonString(std::string &out, const std::string &text) {
+  out += '"';
+  for (char c : text) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    default:
+      if ((unsigned char)c < 0x20) {
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)c);
+        out += escaped;
+      } else {
+        out += c;
+      }
+    }
+  }
+  out += '"';
+}
+
+void HeadlessHost::Impl::writeNode(int64_t id, std::string &out) const {
+  auto it = nodes.find(id);
+  if (it == nodes.end()) {
+    out += "null";
+    return;
+  }
+  const Node &node = it->second;
+  if (node.text) {
+    out += node.json;
+    return;
+  }
+  out += '[';
+  appendJsonString(out, node.type);
+  out += ',';
+  out += node.json;
+  for (int64_t child : tree.children(id)) {
+    out += ',';
+    writeNode(child, out);
+  }
+  out += ']';
+}
+
+HeadlessHost::HeadlessHost(HeadlessOptions options)
+    : impl_(std::make_unique<Impl>()) {
+  std::lock_guard<std::mutex> lock(g_constructionMutex);
+  impl_->options = std::move(options);
+  impl_->runtime = qjs::createQuickJSRuntime("");
+  jsi::Runtime &rt = *impl_->runtime;
+  impl_->stringify = std::make_unique<jsi::Function>(
+      rt.global().getPropertyAsObject(rt, "JSON").getPropertyAsFunction(
+          rt, "stringify"));
+  // Touch every class the sandbox registers (host objects, host functions,
+  // sandbox trampolines) while holding the lock
+  {
+    auto warmup = std::make_shared<QuickJSSandboxRuntime>(rt, 0);
+    jsi::Value context = warmup->createContext(rt);
+    context.getObject(rt).getHostObject<QuickJSSandboxContext>(rt)->setGlobal(
+        rt, "__warmup",
+        jsi::Function::createFromHostFunction(
+            rt, jsi::PropNameID::forAscii(rt, "__warmup"), 0,
+            [](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value { return jsi::Value::undefined(); }));
+    warmup->dispose();
+  }
+}
+
+HeadlessHost::~HeadlessHost() {
+  impl_->unload();
+  impl_->stringify.reset();
+}
+
+bool HeadlessHost::hasBundle() const { return impl_->loaded; }
+
+void HeadlessHost::loadBundle(const std::string &bundle) {
+  if (impl_->loaded && impl_->bundle == bundle) {
+    return;
+  }
+  impl_->unload();
+  try {
+    impl_->load(bundle);
+  } catch (const jsi::JSIException &e) {
+    impl_->unload();
+    throw HeadlessError(e.what());
+  } catch (...) {
+    impl_->unload();
+    throw;
+  }
+}
+
+void HeadlessHost::loadBundle(BundleCompiler &compiler) {
+  impl_->unload();
+  try {
+    impl_->load(compiler);
+  } catch (const jsi::JSIException &e) {
+    impl_->unload();
+    throw HeadlessError(e.what());
+  } catch (...) {
+    impl_->unload();
+    throw;
+  }
+}
+
+RenderResult HeadlessHost::render(const std::string &propsJson,
+                                  bool keepState) {
+  if (!impl_->loaded) {
+    throw HeadlessError("No guest bundle loaded");
+  }
+  jsi::Runtime &rt = *impl_->runtime;
+  RenderResult result;
+  double start = nowMs();
+  impl_->current = &result;
+
+  try {
+    if (!keepState) {
+      impl_->tree.clear();
+      impl_->nodes.clear();
+    }
+    impl_->renderFn->call(rt, jsi::String::createFromUtf8(rt, propsJson),
+                          jsi::Value(keepState),
+                          jsi::Value(impl_->options.settleMs));
+
+    // Settle: promise jobs, then the next due timer, until neither is left
+    QuickJSSandboxContext &context = *impl_->context;
+    for (;;) {
+      context.runPendingJobs(rt);
+      if (result.timers >= impl_->options.maxTimerTurns) {
+        break;
+      }
+      if (!impl_->runTimerFn->call(rt).getBool()) {
+        break;
+      }
+      result.timers++;
+    }
+  } catch (const jsi::JSIException &e) {
+    impl_->current = nullptr;
+    throw HeadlessError(e.what());
+  }
+  impl_->current = nullptr;
+
+  std::vector<int64_t> roots = impl_->tree.children(0);
+  result.tree.reserve(impl_->nodes.size() * 32);
+  result.tree += '[';
+  for (size_t i = 0; i < roots.size(); i++) {
+    if (i > 0) {
+      result.tree += ',';
+    }
+    impl_->writeNode(roots[i], result.tree);
+  }
+  result.tree += ']';
+  result.nodes = (uint32_t)impl_->tree.size();
+  result.renderMs = nowMs() - start;
+  return result;
+}
+
+std::string HeadlessHost::opcodeStats(size_t maxPairs) {
+  if (!impl_->sandbox) {
+    throw HeadlessError("No guest bundle loaded");
+  }
+  jsi::Runtime &rt = *impl_->runtime;
+  return impl_->sandbox->dumpOpcodeStats(rt, maxPairs).asString(rt).utf8(rt);
+}
+
+void HeadlessHost::resetOpcodeStats() {
+  if (impl_->sandbox) {
+    impl_->sandbox->resetOpcodeStats();
+  }
+}
+
+void HeadlessHost::setFunctionProfiling(bool enabled) {
+  if (!impl_->sandbox) {
+    throw HeadlessError("No guest bundle loaded");
+  }
+  impl_->sandbox->setFunctionProfiling(*impl_->runtime, enabled);
+}
+
+void HeadlessHost::resetFunctionProfile() {
+  if (impl_->sandbox) {
+    impl_->sandbox->resetFunctionProfile();
+  }
+}
+
+HeapStats HeadlessHost::heapStats() const {
+  HeapStats stats;
+  if (impl_->sandbox) {
+    JSMallocStats malloc = impl_->sandbox->mallocStats();
+    stats.heapBytes = (size_t)malloc.malloc_size;
+    stats.peakHeapBytes = (size_t)malloc.peak_malloc_size;
+    stats.allocations = (uint64_t)malloc.allocations;
+  }
+  return stats;
+}
+
+void HeadlessHost::resetHeapStats() {
+  if (impl_->sandbox) {
+    impl_->sandbox->resetMallocStats();
+  }
+}
+
+std::string HeadlessHost::functionProfile(size_t maxFunctions) {
+  if (!impl_->sandbox) {
+    throw HeadlessError("No guest bundle loaded");
+  }
+  return impl_->sandbox->dumpFunctionProfile(maxFunctions);
+}
+
+// MARK: - HeadlessHostPool
+
+HeadlessHostPool::HeadlessHostPool(size_t threads, HeadlessOptions options)
+    : options_(std::move(options)) {
+  if (threads == 0) {
+    threads = 1;
+  }
+  workers_.reserve(threads);
+  for (size_t i = 0; i < threads; i++) {
+    workers_.emplace_back([this] { run(); });
+  }
+}
+
+HeadlessHostPool::~HeadlessHostPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  available_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+std::future<RenderResult>
+HeadlessHostPool::submit(std::shared_ptr<const std::string> bundle,
+                         std::string propsJson) {
+  std::future<RenderResult> future;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      throw HeadlessError("HeadlessHostPool is shutting down");
+    }
+    jobs_.push_back(Job{std::move(bundle), std::move(propsJson), {}});
+    future = jobs_.back().result.get_future();
+  }
+  available_.notify_one();
+  return future;
+}
+
+void HeadlessHostPool::run() {
+  std::unique_ptr<HeadlessHost> host;
+  std::exception_ptr startupError;
+  try {
+    host = std::make_unique<HeadlessHost>(options_);
+  } catch (...) {
+    startupError = std::current_exception();
+  }
+  // Held so the address cannot be reused by a different bundle
+  std::shared_ptr<const std::string> lastBundle;
+
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      available_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+
+    try {
+      if (startupError) {
+        std::rethrow_exception(startupError);
+      }
+      if (!job.bundle) {
+        throw HeadlessError("No guest bundle");
+      }
+      // Same bundle object: skip comparing the source
+      if (job.bundle != lastBundle || !host->hasBundle()) {
+        lastBundle.reset();
+        host->loadBundle(*job.bundle);
+        lastBundle = job.bundle;
+      }
+      job.result.set_value(host->render(job.propsJson));
+    } catch (...) {
+      job.result.set_exception(std::current_exception());
+    }
+  }
+}
+
+} // namespace rill
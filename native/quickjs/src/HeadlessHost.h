@@ -0,0 +1,168 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quickjs_sandbox {
+class BundleCompiler;
+}
+
+namespace rill {
+
+/**
+ * HeadlessError - Thrown for guest errors and misuse of the headless API
+ */
+class HeadlessError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+struct HeadlessOptions {
+  // Virtual time timers may advance while a render settles. 0 only runs
+  // timers that are due immediately (React's scheduler uses setTimeout(0))
+  double settleMs = 0;
+  // Timer callbacks per render, against timers that keep re-arming
+  size_t maxTimerTurns = 10000;
+  // GUEST_BUNDLE_CODE (src/guest/build/bundle.ts); empty uses the
+  // "guest-bundle" bytecode embedded at build time (see Bootstrap.h)
+  std::string guestRuntimeSource;
+  // Guest console output; dropped when unset
+  std::function<void(const std::string &level, const std::string &message)>
+      onLog;
+};
+
+struct RenderResult {
+  // Committed tree as compact JSON: an array of the root's children, where
+  // an element is ["Type", {props}, ...children] and a text node is its
+  // string. Guest functions in props appear as {"__type":"function",...}.
+  std::string tree;
+  uint32_t batches = 0;    // operation batches committed by the guest
+  uint32_t operations = 0; // operations after native coalescing
+  uint32_t nodes = 0;      // nodes in the tree
+  uint32_t timers = 0;     // timer callbacks run while settling
+  double renderMs = 0;     // render and settle, excluding the bundle load
+};
+
+// Guest runtime allocator, as counted by QuickJS (host-side conversions and
+// the native tree are not included)
+struct HeapStats {
+  size_t heapBytes = 0;     // currently allocated
+  size_t peakHeapBytes = 0; // since the bundle was loaded or the last reset
+  uint64_t allocations = 0; // likewise
+};
+
+/**
+ * HeadlessHost - Renders Rill guest bundles without a React Native host
+ *
+ * Owns a host QuickJSRuntime and a sandbox context running the guest
+ * runtime (React and the Rill reconciler) plus one guest bundle, as built
+ * by `rill build`. render() mounts the bundle's default export with the
+ * given props, runs React until it is idle and returns the committed tree,
+ * assembled natively from the operation batches.
+ *
+ * Timers run on a virtual clock: nothing waits for real time, and timers
+ * further out than HeadlessOptions::settleMs are left pending. Promise
+ * jobs run between timers. The bundle's auto-render footer is skipped;
+ * the host renders the root component itself.
+ *
+ * A HeadlessHost is not thread-safe; use one per thread, or
+ * HeadlessHostPool.
+ */
+class HeadlessHost {
+public:
+  explicit HeadlessHost(HeadlessOptions options = {});
+  ~HeadlessHost();
+
+  HeadlessHost(const HeadlessHost &) = delete;
+  HeadlessHost &operator=(const HeadlessHost &) = delete;
+
+  // Load a guest bundle into a fresh context. Loading the bundle that is
+  // already loaded is a no-op.
+  void loadBundle(const std::string &bundle);
+  // Load a bundle that is still arriving: the guest runtime is set up
+  // while `compiler` compiles it, then its result is evaluated (see
+  // QuickJSSandboxContext::evalBundle). Call compiler.finish() from the
+  // thread feeding it; this blocks until then. Always reloads.
+  void loadBundle(quickjs_sandbox::BundleCompiler &compiler);
+  bool hasBundle() const;
+
+  /**
+   * Render the loaded bundle with `propsJson` (a JSON object), passed to
+   * the root component as props and returned by useConfig(). Mounts a
+   * fresh tree unless `keepState`, which re-renders the current one so
+   * component state survives and only the difference is committed.
+   * Module-level state of the bundle persists across renders either way.
+   */
+  RenderResult render(const std::string &propsJson = "{}",
+                      bool keepState = false);
+
+  // Opcode histogram of the guest runtime since the bundle was loaded or
+  // the last reset (builds with QUICKJS_OPCODE_STATS, see
+  // QuickJSInstrumentation::writeOpcodeStats)
+  std::string opcodeStats(size_t maxPairs = 40);
+  void resetOpcodeStats();
+
+  // Per-function calls, self and inclusive time of the guest runtime while
+  // profiling is enabled, accumulated until reset (see
+  // QuickJSInstrumentation::writeFunctionProfile)
+  void setFunctionProfiling(bool enabled);
+  void resetFunctionProfile();
+  std::string functionProfile(size_t maxFunctions = 200);
+
+  HeapStats heapStats() const;
+  void resetHeapStats();
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * HeadlessHostPool - Renders on a fixed set of worker threads
+ *
+ * Each worker owns a HeadlessHost and keeps the last bundle it rendered
+ * loaded, so consecutive jobs with the same bundle skip the load. Jobs are
+ * taken in submission order; errors are delivered through the future.
+ * The destructor finishes queued jobs before joining.
+ */
+class HeadlessHostPool {
+public:
+  explicit HeadlessHostPool(size_t threads, HeadlessOptions options = {});
+  ~HeadlessHostPool();
+
+  HeadlessHostPool(const HeadlessHostPool &) = delete;
+  HeadlessHostPool &operator=(const HeadlessHostPool &) = delete;
+
+  std::future<RenderResult> submit(std::shared_ptr<const std::string> bundle,
+                                   std::string propsJson = "{}");
+
+  size_t threads() const { return workers_.size(); }
+
+private:
+  struct Job {
+    std::shared_ptr<const std::string> bundle;
+    std::string propsJson;
+    std::promise<RenderResult> result;
+  };
+
+  void run();
+
+  HeadlessOptions options_;
+  std::vector<std::thread> workers_;
+  std::deque<Job> jobs_;
+  std::mutex mutex_;
+  std::condition_variable available_;
+  bool stopping_ = false;
+};
+
+} // namespace rill
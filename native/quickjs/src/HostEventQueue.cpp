@@ -0,0 +1,153 @@
+#include "HostEventQueue.h"
+#include <algorithm>
+#include <chrono>
+
+namespace quickjs_sandbox {
+
+double HostEventQueue::nowMs() {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool HostEventQueue::parsePolicy(const std::string &text, Policy *policy) {
+  if (text == "all") {
+    *policy = Policy::KeepAll;
+  } else if (text == "latest") {
+    *policy = Policy::LatestWins;
+  } else if (text == "accumulate") {
+    *policy = Policy::Accumulate;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void HostEventQueue::setPolicy(const std::string &name, Policy policy) {
+  if (policy == Policy::KeepAll) {
+    policies_.erase(name);
+  } else {
+    policies_[name] = policy;
+  }
+  // The pending event (if any) keeps the policy it was queued with
+  pendingSlot_.erase(name);
+}
+
+void HostEventQueue::accumulate(
+    jsi::Runtime &rt, const jsi::Value &payload,
+    std::vector<std::pair<std::string, double>> &sums) {
+  if (!payload.isObject()) {
+    return;
+  }
+  jsi::Object object = payload.getObject(rt);
+  if (object.isArray(rt) || object.isFunction(rt)) {
+    return;
+  }
+  jsi::Array names = object.getPropertyNames(rt);
+  size_t count = names.size(rt);
+  for (size_t i = 0; i < count; i++) {
+    jsi::Value nameValue = names.getValueAtIndex(rt, i);
+    if (!nameValue.isString()) {
+      continue;
+    }
+    jsi::String name = nameValue.getString(rt);
+    jsi::Value value = object.getProperty(rt, name);
+    if (!value.isNumber()) {
+      continue;
+    }
+    std::string key = name.utf8(rt);
+    auto it = std::find_if(sums.begin(), sums.end(),
+                           [&key](const std::pair<std::string, double> &sum) {
+                             return sum.first == key;
+                           });
+    if (it == sums.end()) {
+      sums.emplace_back(std::move(key), value.getNumber());
+    } else {
+      it->second += value.getNumber();
+    }
+  }
+}
+
+size_t HostEventQueue::push(jsi::Runtime &rt, const std::string &name,
+                            const jsi::Value &payload) {
+  stats_.queued++;
+
+  auto policyIt = policies_.find(name);
+  Policy policy =
+      policyIt == policies_.end() ? Policy::KeepAll : policyIt->second;
+
+  Event event{name, jsi::Value(rt, payload), {}, nowMs(), 0};
+  if (policy != Policy::KeepAll) {
+    auto slotIt = pendingSlot_.find(name);
+    if (slotIt != pendingSlot_.end()) {
+      // Absorb the pending event and take its place at the tail
+      Event &previous = events_[slotIt->second];
+      event.queuedAt = previous.queuedAt;
+      event.merged = previous.merged + 1;
+      if (policy == Policy::Accumulate) {
+        event.sums = std::move(previous.sums);
+      }
+      previous.name.clear();
+      previous.payload = jsi::Value::undefined();
+      pending_--;
+      stats_.coalesced++;
+    }
+    if (policy == Policy::Accumulate) {
+      accumulate(rt, event.payload, event.sums);
+    }
+    pendingSlot_[name] = events_.size();
+  }
+
+  events_.push_back(std::move(event));
+  pending_++;
+  stats_.maxPending = std::max<uint64_t>(stats_.maxPending, pending_);
+  return pending_;
+}
+
+void HostEventQueue::take(std::vector<Event> &out, size_t maxEvents) {
+  out.clear();
+  while (head_ < events_.size() && out.size() < maxEvents) {
+    Event &event = events_[head_++];
+    if (event.name.empty()) {
+      continue;
+    }
+    auto slotIt = pendingSlot_.find(event.name);
+    if (slotIt != pendingSlot_.end() && slotIt->second == head_ - 1) {
+      pendingSlot_.erase(slotIt);
+    }
+    out.push_back(std::move(event));
+    pending_--;
+  }
+
+  // Compact once everything queued so far has been taken
+  if (head_ == events_.size()) {
+    events_.clear();
+    head_ = 0;
+  } else if (head_ > 64 && head_ * 2 > events_.size()) {
+    events_.erase(events_.begin(), events_.begin() + head_);
+    for (auto &slot : pendingSlot_) {
+      slot.second -= head_;
+    }
+    head_ = 0;
+  }
+}
+
+void HostEventQueue::recordDelivery(const std::vector<Event> &events) {
+  stats_.flushes++;
+  stats_.delivered += events.size();
+  double now = nowMs();
+  for (const Event &event : events) {
+    double wait = now - event.queuedAt;
+    stats_.totalWaitMs += wait;
+    stats_.maxWaitMs = std::max(stats_.maxWaitMs, wait);
+  }
+}
+
+void HostEventQueue::clear() {
+  events_.clear();
+  head_ = 0;
+  pending_ = 0;
+  pendingSlot_.clear();
+}
+
+} // namespace quickjs_sandbox
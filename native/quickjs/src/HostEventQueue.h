@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <jsi/jsi.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace quickjs_sandbox {
+
+using namespace facebook;
+
+/**
+ * HostEventQueue - Pending host -> guest events of one context
+ *
+ * Events are queued as host values and coalesced per event name before
+ * they are converted for the guest:
+ * - KeepAll: every event is delivered (the default)
+ * - LatestWins: a pending event is replaced by the newer one
+ * - Accumulate: numeric own properties of object payloads are summed into
+ *   the pending event (e.g. scroll deltas); other properties take the
+ *   newer value
+ *
+ * A coalesced event moves to the position of the newest event it absorbed,
+ * so it is still delivered after everything queued before that, and keeps
+ * the queue time of the oldest one for latency accounting.
+ *
+ * Holds jsi::Values; use it from the host JS thread only.
+ */
+class HostEventQueue {
+public:
+  enum class Policy : uint8_t { KeepAll, LatestWins, Accumulate };
+
+  struct Event {
+    std::string name;
+    jsi::Value payload;
+    // Accumulate: running sums of the numeric payload properties
+    std::vector<std::pair<std::string, double>> sums;
+    double queuedAt; // ms, steady clock
+    uint32_t merged; // events folded into this one
+  };
+
+  struct Stats {
+    uint64_t queued = 0;
+    uint64_t coalesced = 0;
+    uint64_t delivered = 0;
+    uint64_t flushes = 0;
+    uint64_t maxPending = 0;
+    double totalWaitMs = 0; // summed over delivered events
+    double maxWaitMs = 0;
+  };
+
+  HostEventQueue() = default;
+
+  HostEventQueue(const HostEventQueue &) = delete;
+  HostEventQueue &operator=(const HostEventQueue &) = delete;
+
+  // Policies apply to events queued after the call
+  void setPolicy(const std::string &name, Policy policy);
+  static bool parsePolicy(const std::string &text, Policy *policy);
+
+  // Returns the number of pending events
+  size_t push(jsi::Runtime &rt, const std::string &name,
+              const jsi::Value &payload);
+
+  // Move up to maxEvents pending events, oldest first, into `out`
+  void take(std::vector<Event> &out, size_t maxEvents);
+
+  // Account events handed to the guest by the last take()
+  void recordDelivery(const std::vector<Event> &events);
+
+  size_t pending() const { return pending_; }
+  const Stats &stats() const { return stats_; }
+  void clear();
+
+  static double nowMs();
+
+private:
+  // Slots of events that were coalesced away are left empty
+  // (name.empty()) and skipped by take()
+  std::vector<Event> events_;
+  size_t head_ = 0; // first slot not taken yet
+  size_t pending_ = 0;
+  std::unordered_map<std::string, Policy> policies_;
+  // Slot of the pending event per coalesced event name
+  std::unordered_map<std::string, size_t> pendingSlot_;
+  Stats stats_;
+
+  static void accumulate(jsi::Runtime &rt, const jsi::Value &payload,
+                         std::vector<std::pair<std::string, double>> &sums);
+};
+
+} // namespace quickjs_sandbox
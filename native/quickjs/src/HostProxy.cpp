@@ -3,6 +3,7 @@
 #include <memory>
 
 #include "JSIValueConverter.h"
+#include "StaticHostObject.h"
 
 namespace qjs {
 
@@ -11,6 +12,7 @@ JSClassID HostObjectProxy::kJSClassID = 0;
 JSClassDef HostObjectProxy::kJSClassDef = {
     .class_name = "HostObjectProxy",
     .finalizer = &HostObjectProxy::Finalizer,
+    .gc_mark = &HostObjectProxy::GCMark,
 };
 
 void *OpaqueData::GetHostData(JSValueConst this_val) {
@@ -31,9 +33,13 @@ const JSCFunctionListEntry HostObjectProxy::kTemplateInterceptor[] = {
 };
 
 HostObjectProxy::HostObjectProxy(QuickJSRuntime &runtime,
-                                 std::shared_ptr<jsi::HostObject> hostObject)
-    : runtime_(runtime), hostObject_(hostObject) {
+                                 std::shared_ptr<jsi::HostObject> hostObject,
+                                 const HostObjectShape *shape)
+    : runtime_(runtime), hostObject_(hostObject), shape_(shape) {
   opaqueData_.hostData_ = this;
+  if (shape_) {
+    methods_.assign(shape_->atoms.size(), JS_UNDEFINED);
+  }
 }
 
 std::shared_ptr<jsi::HostObject> HostObjectProxy::GetHostObject() {
@@ -56,6 +62,10 @@ JSValue HostObjectProxy::Getter(JSContext *ctx, JSValueConst this_val,
 
   assert(hostObjectProxy);
 
+  if (hostObjectProxy->shape_) {
+    return hostObjectProxy->GetSlot(ctx, name);
+  }
+
   QuickJSRuntime &runtime = hostObjectProxy->runtime_;
   jsi::PropNameID sym = JSIValueConverter::ToJSIPropNameID(runtime, name);
   JS_FreeAtom(ctx, name);
@@ -75,6 +85,38 @@ JSValue HostObjectProxy::Getter(JSContext *ctx, JSValueConst this_val,
   return JSIValueConverter::ToJSValue(runtime, ret);
 }
 
+JSValue HostObjectProxy::GetSlot(JSContext *ctx, JSAtom name) {
+  auto it = shape_->slots.find(name);
+  JS_FreeAtom(ctx, name);
+  if (it == shape_->slots.end()) {
+    return JS_UNDEFINED;
+  }
+  uint32_t slot = it->second;
+  if (!JS_IsUndefined(methods_[slot])) {
+    return JS_DupValue(ctx, methods_[slot]);
+  }
+
+  jsi::Value ret;
+  try {
+    ret = static_cast<StaticHostObject *>(hostObject_.get())
+              ->getSlot(runtime_, slot);
+  } catch (const jsi::JSError &error) {
+    JS_Throw(ctx, JSIValueConverter::ToJSValue(runtime_, error.value()));
+    return JS_EXCEPTION;
+  } catch (const std::exception &ex) {
+    JS_ThrowInternalError(ctx, "%s", ex.what());
+    return JS_EXCEPTION;
+  } catch (...) {
+    JS_ThrowInternalError(ctx, "Unknown error in HostObject getter");
+    return JS_EXCEPTION;
+  }
+  JSValue value = JSIValueConverter::ToJSValue(runtime_, ret);
+  if (shape_->methods[slot]) {
+    methods_[slot] = JS_DupValue(ctx, value);
+  }
+  return value;
+}
+
 JSValue HostObjectProxy::Setter(JSContext *ctx, JSValueConst this_val,
                                 JSAtom name, JSValue val) {
   HostObjectProxy *hostObjectProxy =
@@ -105,6 +147,19 @@ JSValue HostObjectProxy::Enumerator(JSContext *ctx, JSValueConst this_val) {
       reinterpret_cast<HostObjectProxy *>(OpaqueData::GetHostData(this_val));
   assert(hostObjectProxy);
 
+  if (const HostObjectShape *shape = hostObjectProxy->shape_) {
+    JSValue result =
+        JS_NewArrayFrom(ctx, (uint32_t)shape->atoms.size(), nullptr);
+    JSValue *values;
+    uint32_t count;
+    if (JS_GetFastArray(ctx, result, &values, &count)) {
+      for (uint32_t i = 0; i < count; i++) {
+        values[i] = JS_AtomToString(ctx, shape->atoms[i]);
+      }
+    }
+    return result;
+  }
+
   QuickJSRuntime &runtime = hostObjectProxy->runtime_;
   auto names = hostObjectProxy->hostObject_->getPropertyNames(runtime);
 
@@ -117,14 +172,32 @@ JSValue HostObjectProxy::Enumerator(JSContext *ctx, JSValueConst this_val) {
   return result;
 }
 
-void HostObjectProxy::Finalizer(JSRuntime *, JSValue val) {
+void HostObjectProxy::Finalizer(JSRuntime *rt, JSValue val) {
   auto hostObjectProxy =
       reinterpret_cast<HostObjectProxy *>(OpaqueData::GetHostData(val));
-  assert(hostObjectProxy->hostObject_.use_count() == 1);
+  // Only the JS reference is released here: the HostObject may have other
+  // C++ owners (e.g. a sandbox runtime's list of its contexts)
+  for (JSValue method : hostObjectProxy->methods_) {
+    JS_FreeValueRT(rt, method);
+  }
   hostObjectProxy->opaqueData_.nativeState_ = nullptr;
   delete hostObjectProxy;
 }
 
+// The cached methods may reference the object (e.g. a property set on
+// one), so the cycle collector has to see them
+void HostObjectProxy::GCMark(JSRuntime *rt, JSValueConst val,
+                             JS_MarkFunc *mark_func) {
+  auto hostObjectProxy =
+      reinterpret_cast<HostObjectProxy *>(OpaqueData::GetHostData(val));
+  if (!hostObjectProxy) {
+    return; // not set up yet
+  }
+  for (JSValue method : hostObjectProxy->methods_) {
+    JS_MarkValue(rt, method, mark_func);
+  }
+}
+
 JSClassID HostFunctionProxy::kJSClassID = 0;
 
 JSClassDef HostFunctionProxy::kJSClassDef = {
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <jsi/jsi.h>
+#include <unordered_map>
+#include <vector>
 #include "QuickJSRuntime.h"
 
 namespace qjs {
@@ -18,10 +20,20 @@ public:
   virtual OpaqueData *GetOpaqueData() = 0;
 };
 
+// Property atoms of a StaticHostObject class in one runtime, and the
+// slots they map to
+struct HostObjectShape {
+  std::unordered_map<JSAtom, uint32_t> slots;
+  std::vector<JSAtom> atoms;  // by slot
+  std::vector<bool> methods;  // by slot
+};
+
 class HostObjectProxy : public OpaqueOwner {
 public:
+  // With a shape, hostObject is a StaticHostObject of that shape
   HostObjectProxy(QuickJSRuntime &runtime,
-                  std::shared_ptr<jsi::HostObject> hostObject);
+                  std::shared_ptr<jsi::HostObject> hostObject,
+                  const HostObjectShape *shape = nullptr);
 
   std::shared_ptr<jsi::HostObject> GetHostObject();
 
@@ -38,13 +50,20 @@ public:
 
   static void Finalizer(JSRuntime *rt, JSValue val);
 
+  static void GCMark(JSRuntime *rt, JSValueConst val, JS_MarkFunc *mark_func);
+
   static JSClassDef kJSClassDef;
   static const JSCFunctionListEntry kTemplateInterceptor[];
 
 private:
+  // Getter of a StaticHostObject: atom -> slot, methods created once
+  JSValue GetSlot(JSContext *ctx, JSAtom name);
+
   QuickJSRuntime &runtime_;
   std::shared_ptr<jsi::HostObject> hostObject_;
   OpaqueData opaqueData_;
+  const HostObjectShape *shape_;
+  std::vector<JSValue> methods_; // by slot, JS_UNDEFINED until first get
 
   static JSClassID kJSClassID;
 };
@@ -59,13 +59,13 @@ JSValue JSIValueConverter::ToJSValue(const QuickJSRuntime &constRuntime,
     return JS_NewBool(context, value.getBool());
   } else if (value.isNumber()) {
     return JS_NewFloat64(context, value.getNumber());
-  } else if (value.isString()) {
-    auto str = value.getString(runtime).utf8(runtime);
-    return JS_NewStringLen(context, str.c_str(), str.size());
-  } else if (value.isObject()) {
-    return ToJSObject(runtime, value.getObject(runtime));
-  } else if (value.isBigInt()) {
-    return ToJSBigInt(runtime, value.getBigInt(runtime));
+  } else if (value.isString() || value.isObject() || value.isSymbol() ||
+             value.isBigInt()) {
+    // Share the engine value: no handle clone, and no UTF-8 round trip
+    // for strings
+    const QuickJSPointerValue *quickJSPointerValue =
+        static_cast<const QuickJSPointerValue *>(runtime.getPointerValue(value));
+    return quickJSPointerValue->Get(context);
   } else {
     // What are you?
     std::abort();
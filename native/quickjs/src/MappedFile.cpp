@@ -0,0 +1,98 @@
+#include "MappedFile.h"
+#include <cerrno>
+#include <cstring>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define QUICKJS_SANDBOX_HAVE_MMAP 1
+#else
+#include <fstream>
+#include <sstream>
+#endif
+
+namespace quickjs_sandbox {
+
+#ifdef QUICKJS_SANDBOX_HAVE_MMAP
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string &path,
+                                             std::string *error) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = "Cannot open " + path + ": " + std::strerror(errno);
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    *error = "Not a regular file: " + path;
+    ::close(fd);
+    return nullptr;
+  }
+
+  // Reserve zero pages for the file plus its terminator, then map the file
+  // over the start of the reservation. The rest of the file's last page is
+  // zero-filled by the kernel; a file ending on a page boundary is followed
+  // by the next reserved page.
+  size_t size = static_cast<size_t>(st.st_size);
+  size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t mapLength = (size / pageSize + 1) * pageSize;
+  void *reserved = mmap(nullptr, mapLength, PROT_READ,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserved == MAP_FAILED) {
+    *error = "Cannot map " + path + ": " + std::strerror(errno);
+    ::close(fd);
+    return nullptr;
+  }
+  if (size > 0) {
+    void *mapped = mmap(reserved, size, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+                        fd, 0);
+    if (mapped == MAP_FAILED) {
+      *error = "Cannot map " + path + ": " + std::strerror(errno);
+      munmap(reserved, mapLength);
+      ::close(fd);
+      return nullptr;
+    }
+    // The parser reads it once, front to back
+    madvise(mapped, size, MADV_SEQUENTIAL);
+  }
+  ::close(fd);
+
+  std::unique_ptr<MappedFile> file(new MappedFile());
+  file->data_ = static_cast<const char *>(reserved);
+  file->size_ = size;
+  file->mapLength_ = mapLength;
+  return file;
+}
+
+MappedFile::~MappedFile() {
+  if (mapLength_ > 0) {
+    munmap(const_cast<char *>(data_), mapLength_);
+  }
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string &path,
+                                             std::string *error) {
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream.is_open()) {
+    *error = "Cannot open " + path;
+    return nullptr;
+  }
+  std::stringstream buffer;
+  buffer << stream.rdbuf();
+
+  std::unique_ptr<MappedFile> file(new MappedFile());
+  file->contents_ = buffer.str();
+  file->data_ = file->contents_.c_str();
+  file->size_ = file->contents_.size();
+  return file;
+}
+
+MappedFile::~MappedFile() = default;
+
+#endif
+
+} // namespace quickjs_sandbox
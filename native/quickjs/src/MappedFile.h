@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace quickjs_sandbox {
+
+/**
+ * MappedFile - A read-only file mapped into memory for parsing
+ *
+ * Maps the whole file with mmap, so evaluating a bundle from disk does not
+ * copy it into the heap: the parser reads the page cache directly and the
+ * pages can be dropped again under memory pressure. The mapping is placed
+ * over a zero-filled reservation one byte (rounded to a page) larger than
+ * the file, so data()[size()] is always '\0', as JS_Eval requires.
+ *
+ * Where mmap is not available (WASM, non-POSIX hosts) the file is read
+ * into memory instead; data() is still terminated.
+ *
+ * The file must not be truncated while it is mapped (reading the missing
+ * pages would fault).
+ */
+class MappedFile {
+public:
+  // Returns null, with a description in *error, when the file cannot be
+  // opened or mapped
+  static std::unique_ptr<MappedFile> open(const std::string &path,
+                                          std::string *error);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+  // False when the file was read into memory instead
+  bool mapped() const { return mapLength_ > 0; }
+
+private:
+  MappedFile() = default;
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  size_t mapLength_ = 0; // reservation to unmap, 0 when read
+  std::string contents_; // the file when read
+};
+
+} // namespace quickjs_sandbox
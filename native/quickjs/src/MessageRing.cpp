@@ -0,0 +1,75 @@
+#include "MessageRing.h"
+
+namespace quickjs_sandbox {
+
+static size_t roundCapacity(size_t capacityBytes) {
+  size_t capacity = MessageRing::kMinCapacity;
+  while (capacity < capacityBytes && capacity < MessageRing::kMaxCapacity) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+MessageRing::MessageRing(size_t capacityBytes)
+    : head_(0), cachedTail_(0), written_(0), rejected_(0), highWater_(0),
+      tail_(0), drained_(0), capacity_(roundCapacity(capacityBytes)),
+      mask_(capacity_ - 1), buffer_(new uint8_t[capacity_]) {}
+
+bool MessageRing::write(const void *data, size_t length) {
+  if (length > maxMessageBytes()) {
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  const uint64_t head = head_.load(std::memory_order_relaxed);
+  size_t offset = size_t(head & mask_);
+  size_t record = recordBytes(length);
+  size_t toEnd = capacity_ - offset;
+  size_t padding = toEnd < record ? toEnd : 0;
+  size_t needed = padding + record;
+
+  // Only look at the consumer's index when the cached one is not enough
+  if (capacity_ - (head - cachedTail_) < needed) {
+    cachedTail_ = tail_.load(std::memory_order_acquire);
+    if (capacity_ - (head - cachedTail_) < needed) {
+      rejected_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+
+  if (padding) {
+    std::memcpy(buffer_.get() + offset, &kWrapMarker, kHeaderBytes);
+    offset = 0;
+  }
+  uint32_t length32 = uint32_t(length);
+  std::memcpy(buffer_.get() + offset, &length32, kHeaderBytes);
+  std::memcpy(buffer_.get() + offset + kHeaderBytes, data, length);
+
+  const uint64_t newHead = head + needed;
+  head_.store(newHead, std::memory_order_release);
+  written_.fetch_add(1, std::memory_order_relaxed);
+  // cachedTail_ may be stale; refresh it before raising the mark
+  uint64_t highWater = highWater_.load(std::memory_order_relaxed);
+  if (newHead - cachedTail_ > highWater) {
+    cachedTail_ = tail_.load(std::memory_order_acquire);
+    if (newHead - cachedTail_ > highWater) {
+      highWater_.store(newHead - cachedTail_, std::memory_order_relaxed);
+    }
+  }
+  return true;
+}
+
+MessageRing::Stats MessageRing::stats() const {
+  Stats stats;
+  uint64_t tail = tail_.load(std::memory_order_acquire);
+  uint64_t head = head_.load(std::memory_order_acquire);
+  stats.capacity = capacity_;
+  stats.usedBytes = head >= tail ? head - tail : 0;
+  stats.highWaterBytes = highWater_.load(std::memory_order_relaxed);
+  stats.written = written_.load(std::memory_order_relaxed);
+  stats.drained = drained_.load(std::memory_order_relaxed);
+  stats.rejected = rejected_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace quickjs_sandbox
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace quickjs_sandbox {
+
+/**
+ * MessageRing - Lock-free single-producer/single-consumer byte ring
+ *
+ * Carries variable-length messages from the guest (producer) to the host
+ * (consumer) without taking the context lock or calling into the host
+ * runtime per message. The producer appends records with write(); the
+ * consumer takes everything published so far with drain(), typically once
+ * per frame.
+ *
+ * Records are a 4-byte length followed by the payload, padded to 8 bytes.
+ * A record that does not fit before the end of the buffer is preceded by a
+ * wrap marker and starts at offset 0. head_ and tail_ are free-running
+ * byte positions on separate cache lines; each side only writes its own
+ * index, publishing it with a release store, so the producer and consumer
+ * may run on different threads.
+ *
+ * When the ring is full write() fails instead of blocking or growing, and
+ * the caller decides whether to drop, retry later or fall back to a
+ * synchronous call.
+ */
+class MessageRing {
+public:
+  struct Stats {
+    uint64_t capacity = 0;
+    uint64_t usedBytes = 0;
+    uint64_t highWaterBytes = 0;
+    uint64_t written = 0;
+    uint64_t drained = 0;
+    uint64_t rejected = 0;
+  };
+
+  static constexpr size_t kMinCapacity = 1024;
+  static constexpr size_t kMaxCapacity = size_t(1) << 30;
+
+  // capacityBytes is rounded up to a power of two within the limits above
+  explicit MessageRing(size_t capacityBytes);
+
+  MessageRing(const MessageRing &) = delete;
+  MessageRing &operator=(const MessageRing &) = delete;
+
+  // Producer: append one message. Returns false when it does not fit.
+  bool write(const void *data, size_t length);
+
+  /**
+   * Consumer: call fn(const uint8_t *data, uint32_t length) for up to
+   * maxMessages published messages, oldest first, then release their
+   * space. `data` is only valid during the call. Returns the count.
+   */
+  template <typename Fn> size_t drain(Fn &&fn, size_t maxMessages = SIZE_MAX);
+
+  // Largest payload write() can ever accept
+  size_t maxMessageBytes() const { return capacity_ - kHeaderBytes; }
+  size_t capacity() const { return capacity_; }
+
+  // Safe to call from either side
+  Stats stats() const;
+
+private:
+  static constexpr size_t kCacheLine = 64;
+  static constexpr size_t kHeaderBytes = sizeof(uint32_t);
+  static constexpr uint32_t kWrapMarker = UINT32_MAX;
+
+  static size_t recordBytes(size_t length) {
+    return (kHeaderBytes + length + 7) & ~size_t(7);
+  }
+
+  // Producer side
+  alignas(kCacheLine) std::atomic<uint64_t> head_;
+  uint64_t cachedTail_; // last tail_ the producer observed
+  std::atomic<uint64_t> written_;
+  std::atomic<uint64_t> rejected_;
+  std::atomic<uint64_t> highWater_;
+
+  // Consumer side
+  alignas(kCacheLine) std::atomic<uint64_t> tail_;
+  std::atomic<uint64_t> drained_;
+
+  // Immutable after construction
+  alignas(kCacheLine) size_t capacity_;
+  size_t mask_;
+  std::unique_ptr<uint8_t[]> buffer_;
+};
+
+template <typename Fn> size_t MessageRing::drain(Fn &&fn, size_t maxMessages) {
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  size_t count = 0;
+
+  while (tail != head && count < maxMessages) {
+    size_t offset = size_t(tail & mask_);
+    uint32_t length;
+    std::memcpy(&length, buffer_.get() + offset, kHeaderBytes);
+    if (length == kWrapMarker) {
+      tail += capacity_ - offset;
+      continue;
+    }
+    fn(buffer_.get() + offset + kHeaderBytes, length);
+    tail += recordBytes(length);
+    count++;
+  }
+
+  tail_.store(tail, std::memory_order_release);
+  drained_.fetch_add(count, std::memory_order_relaxed);
+  return count;
+}
+
+} // namespace quickjs_sandbox
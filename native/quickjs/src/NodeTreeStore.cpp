@@ -0,0 +1,640 @@
+#include "NodeTreeStore.h"
+#include "QuickJSRuntimeFactory.h"
+#include <algorithm>
+#include <cstring>
+
+namespace quickjs_sandbox {
+
+static uint64_t hashNodeId(int64_t id) {
+  uint64_t x = (uint64_t)id;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return x;
+}
+
+enum TreeOpKind { kOpOther, kOpCreate, kOpUpdate, kOpText, kOpDelete,
+                  kOpAppend, kOpInsert, kOpRemove, kOpReorder };
+
+static TreeOpKind treeOpKind(const std::string &op) {
+  switch (op.size()) {
+  case 4:
+    return op == "TEXT" ? kOpText : kOpOther;
+  case 6:
+    if (op == "CREATE")
+      return kOpCreate;
+    if (op == "UPDATE")
+      return kOpUpdate;
+    if (op == "DELETE")
+      return kOpDelete;
+    if (op == "APPEND")
+      return kOpAppend;
+    if (op == "INSERT")
+      return kOpInsert;
+    if (op == "REMOVE")
+      return kOpRemove;
+    return kOpOther;
+  case 7:
+    return op == "REORDER" ? kOpReorder : kOpOther;
+  default:
+    return kOpOther;
+  }
+}
+
+static bool readNodeId(jsi::Runtime &rt, const jsi::Object &op,
+                       const jsi::PropNameID &name, int64_t *id) {
+  jsi::Value value = op.getProperty(rt, name);
+  if (!value.isNumber()) {
+    return false;
+  }
+  *id = (int64_t)value.getNumber();
+  return true;
+}
+
+static jsi::Array idsToJSI(jsi::Runtime &rt, const std::vector<int64_t> &ids) {
+  std::vector<jsi::Value> values;
+  values.reserve(ids.size());
+  for (int64_t id : ids) {
+    values.emplace_back((double)id);
+  }
+  return qjs::createArrayFromValues(rt, values.data(), values.size());
+}
+
+NodeTreeStore::NodeTreeStore() : liveCount_(0), batch_(0) { clear(); }
+
+void NodeTreeStore::clear() {
+  ids_.assign(1, 0);
+  parent_.assign(1, kNone);
+  firstChild_.assign(1, kNone);
+  lastChild_.assign(1, kNone);
+  nextSibling_.assign(1, kNone);
+  prevSibling_.assign(1, kNone);
+  childCount_.assign(1, 0);
+  alive_.assign(1, 1);
+  dirtyMark_.assign(1, 0);
+  changedMark_.assign(1, 0);
+  freeSlots_.clear();
+  index_.assign(64, IndexEntry{0, kNone});
+  liveCount_ = 0;
+  batch_ = 0;
+  indexInsert(0, 0);
+}
+
+// ---------------------------------------------------------------------------
+// id -> slot index (linear probing, backward-shift deletion)
+// ---------------------------------------------------------------------------
+
+uint32_t NodeTreeStore::lookup(int64_t id) const {
+  size_t mask = index_.size() - 1;
+  for (size_t i = hashNodeId(id) & mask;; i = (i + 1) & mask) {
+    const IndexEntry &entry = index_[i];
+    if (entry.slot == kNone) {
+      return kNone;
+    }
+    if (entry.id == id) {
+      return entry.slot;
+    }
+  }
+}
+
+void NodeTreeStore::indexGrow() {
+  std::vector<IndexEntry> old;
+  old.swap(index_);
+  index_.assign(old.size() * 2, IndexEntry{0, kNone});
+  for (const IndexEntry &entry : old) {
+    if (entry.slot != kNone) {
+      indexInsert(entry.id, entry.slot);
+    }
+  }
+}
+
+void NodeTreeStore::indexInsert(int64_t id, uint32_t slot) {
+  // liveCount_ excludes the root; keep the load factor at or below 1/2
+  if ((liveCount_ + 2) * 2 > index_.size()) {
+    indexGrow();
+  }
+  size_t mask = index_.size() - 1;
+  size_t i = hashNodeId(id) & mask;
+  while (index_[i].slot != kNone && index_[i].id != id) {
+    i = (i + 1) & mask;
+  }
+  index_[i] = IndexEntry{id, slot};
+}
+
+void NodeTreeStore::indexErase(int64_t id) {
+  size_t mask = index_.size() - 1;
+  size_t i = hashNodeId(id) & mask;
+  while (index_[i].id != id) {
+    if (index_[i].slot == kNone) {
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+  // Shift back later entries of the probe sequence into the hole
+  for (size_t j = (i + 1) & mask; index_[j].slot != kNone;
+       j = (j + 1) & mask) {
+    size_t home = hashNodeId(index_[j].id) & mask;
+    bool movable = i <= j ? (home <= i || home > j) : (home <= i && home > j);
+    if (movable) {
+      index_[i] = index_[j];
+      i = j;
+    }
+  }
+  index_[i].slot = kNone;
+}
+
+// ---------------------------------------------------------------------------
+// Slots
+// ---------------------------------------------------------------------------
+
+uint32_t NodeTreeStore::allocate(int64_t id) {
+  uint32_t slot;
+  if (!freeSlots_.empty()) {
+    slot = freeSlots_.back();
+    freeSlots_.pop_back();
+  } else {
+    slot = (uint32_t)ids_.size();
+    ids_.push_back(0);
+    parent_.push_back(kNone);
+    firstChild_.push_back(kNone);
+    lastChild_.push_back(kNone);
+    nextSibling_.push_back(kNone);
+    prevSibling_.push_back(kNone);
+    childCount_.push_back(0);
+    alive_.push_back(0);
+    dirtyMark_.push_back(0);
+    changedMark_.push_back(0);
+  }
+  ids_[slot] = id;
+  parent_[slot] = kNone;
+  firstChild_[slot] = lastChild_[slot] = kNone;
+  nextSibling_[slot] = prevSibling_[slot] = kNone;
+  childCount_[slot] = 0;
+  alive_[slot] = 1;
+  indexInsert(id, slot);
+  liveCount_++;
+  return slot;
+}
+
+void NodeTreeStore::release(uint32_t slot) {
+  indexErase(ids_[slot]);
+  alive_[slot] = 0;
+  liveCount_--;
+  freeSlots_.push_back(slot);
+}
+
+// ---------------------------------------------------------------------------
+// Intrusive child lists
+// ---------------------------------------------------------------------------
+
+void NodeTreeStore::detach(uint32_t slot) {
+  uint32_t parent = parent_[slot];
+  if (parent == kNone) {
+    return;
+  }
+  uint32_t prev = prevSibling_[slot];
+  uint32_t next = nextSibling_[slot];
+  if (prev != kNone) {
+    nextSibling_[prev] = next;
+  } else {
+    firstChild_[parent] = next;
+  }
+  if (next != kNone) {
+    prevSibling_[next] = prev;
+  } else {
+    lastChild_[parent] = prev;
+  }
+  parent_[slot] = prevSibling_[slot] = nextSibling_[slot] = kNone;
+  childCount_[parent]--;
+  markChanged(parent);
+}
+
+// Link a detached slot under `parent` before `before` (kNone appends)
+void NodeTreeStore::linkBefore(uint32_t parent, uint32_t slot,
+                               uint32_t before) {
+  uint32_t prev = before == kNone ? lastChild_[parent] : prevSibling_[before];
+  parent_[slot] = parent;
+  prevSibling_[slot] = prev;
+  nextSibling_[slot] = before;
+  if (prev != kNone) {
+    nextSibling_[prev] = slot;
+  } else {
+    firstChild_[parent] = slot;
+  }
+  if (before != kNone) {
+    prevSibling_[before] = slot;
+  } else {
+    lastChild_[parent] = slot;
+  }
+  childCount_[parent]++;
+  markChanged(parent);
+}
+
+// Child currently at `index` (Array.prototype.splice clamping), kNone past
+// the end; walks from whichever end is nearer
+uint32_t NodeTreeStore::childAt(uint32_t parent, int64_t index) const {
+  int64_t count = childCount_[parent];
+  if (index < 0) {
+    index = std::max<int64_t>(count + index, 0);
+  }
+  if (index >= count) {
+    return kNone;
+  }
+  uint32_t slot;
+  if (index <= count / 2) {
+    slot = firstChild_[parent];
+    for (int64_t i = 0; i < index; i++) {
+      slot = nextSibling_[slot];
+    }
+  } else {
+    slot = lastChild_[parent];
+    for (int64_t i = count - 1; i > index; i--) {
+      slot = prevSibling_[slot];
+    }
+  }
+  return slot;
+}
+
+// True if attaching `slot` under `parent` would make it its own ancestor
+bool NodeTreeStore::wouldCycle(uint32_t parent, uint32_t slot) const {
+  if (slot == parent) {
+    return true;
+  }
+  if (firstChild_[slot] == kNone) {
+    return false; // a leaf cannot be an ancestor
+  }
+  for (uint32_t p = parent_[parent]; p != kNone; p = parent_[p]) {
+    if (p == slot) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void NodeTreeStore::deleteSubtree(uint32_t slot) {
+  detach(slot);
+  stack_.clear();
+  stack_.push_back(slot);
+  while (!stack_.empty()) {
+    uint32_t current = stack_.back();
+    stack_.pop_back();
+    for (uint32_t child = firstChild_[current]; child != kNone;
+         child = nextSibling_[child]) {
+      stack_.push_back(child);
+    }
+    deletedIds_.push_back(ids_[current]);
+    release(current);
+  }
+}
+
+void NodeTreeStore::markDirty(uint32_t slot) {
+  if (dirtyMark_[slot] != batch_) {
+    dirtyMark_[slot] = batch_;
+    dirtySlots_.push_back(slot);
+  }
+}
+
+void NodeTreeStore::markChanged(uint32_t slot) {
+  if (changedMark_[slot] != batch_) {
+    changedMark_[slot] = batch_;
+    changedSlots_.push_back(slot);
+  }
+  markDirty(slot);
+}
+
+// ---------------------------------------------------------------------------
+// Batches
+// ---------------------------------------------------------------------------
+
+void NodeTreeStore::applyBatch(jsi::Runtime &rt, const jsi::Array &operations,
+                               size_t count, BatchResult &result) {
+  if (++batch_ == 0) {
+    std::fill(dirtyMark_.begin(), dirtyMark_.end(), 0);
+    std::fill(changedMark_.begin(), changedMark_.end(), 0);
+    batch_ = 1;
+  }
+  dirtySlots_.clear();
+  changedSlots_.clear();
+  deletedIds_.clear();
+
+  auto opName = jsi::PropNameID::forAscii(rt, "op");
+  auto idName = jsi::PropNameID::forAscii(rt, "id");
+  auto parentIdName = jsi::PropNameID::forAscii(rt, "parentId");
+  auto childIdName = jsi::PropNameID::forAscii(rt, "childId");
+  auto childIdsName = jsi::PropNameID::forAscii(rt, "childIds");
+  auto indexName = jsi::PropNameID::forAscii(rt, "index");
+
+  count = std::min(count, operations.size(rt));
+  for (size_t i = 0; i < count; i++) {
+    jsi::Value opValue = operations.getValueAtIndex(rt, i);
+    if (!opValue.isObject()) {
+      continue;
+    }
+    jsi::Object op = opValue.getObject(rt);
+    jsi::Value kindValue = op.getProperty(rt, opName);
+    if (!kindValue.isString()) {
+      continue;
+    }
+    TreeOpKind kind = treeOpKind(kindValue.getString(rt).utf8(rt));
+    if (kind == kOpOther) {
+      continue;
+    }
+
+    bool ok = false;
+    int64_t id, parentId, childId;
+    switch (kind) {
+    case kOpCreate:
+      if (readNodeId(rt, op, idName, &id) && id != 0) {
+        uint32_t slot = lookup(id);
+        if (slot != kNone) {
+          // Re-created: the old node leaves its parent and takes its
+          // subtree with it, as the new one starts detached and empty
+          deleteSubtree(slot);
+        }
+        slot = allocate(id);
+        markDirty(slot);
+        ok = true;
+      }
+      break;
+
+    case kOpUpdate:
+    case kOpText:
+      if (readNodeId(rt, op, idName, &id)) {
+        uint32_t slot = lookup(id);
+        if (slot != kNone && slot != 0) {
+          markDirty(slot);
+          ok = true;
+        }
+      }
+      break;
+
+    case kOpDelete:
+      if (readNodeId(rt, op, idName, &id)) {
+        uint32_t slot = lookup(id);
+        if (slot != kNone && slot != 0) {
+          deleteSubtree(slot);
+          ok = true;
+        }
+      }
+      break;
+
+    case kOpAppend:
+    case kOpInsert:
+    case kOpRemove: {
+      if (!readNodeId(rt, op, parentIdName, &parentId) ||
+          !readNodeId(rt, op, childIdName, &childId)) {
+        break;
+      }
+      uint32_t parent = lookup(parentId);
+      uint32_t child = lookup(childId);
+      if (parent == kNone || child == kNone || child == 0) {
+        break;
+      }
+      if (kind == kOpRemove) {
+        if (parent_[child] == parent) {
+          detach(child);
+        }
+        ok = true;
+        break;
+      }
+      if (kind == kOpAppend && parent_[child] == parent) {
+        ok = true; // already a child: keep its position
+        break;
+      }
+      if (wouldCycle(parent, child)) {
+        break;
+      }
+      detach(child);
+      uint32_t before = kNone;
+      if (kind == kOpInsert) {
+        jsi::Value indexValue = op.getProperty(rt, indexName);
+        int64_t index = indexValue.isNumber()
+                            ? (int64_t)indexValue.getNumber()
+                            : (int64_t)childCount_[parent];
+        before = childAt(parent, index);
+      }
+      linkBefore(parent, child, before);
+      ok = true;
+      break;
+    }
+
+    case kOpReorder: {
+      if (!readNodeId(rt, op, parentIdName, &parentId)) {
+        break;
+      }
+      uint32_t parent = lookup(parentId);
+      jsi::Value childIdsValue = op.getProperty(rt, childIdsName);
+      if (parent == kNone || !childIdsValue.isObject() ||
+          !childIdsValue.getObject(rt).isArray(rt)) {
+        break;
+      }
+      jsi::Array childIds = childIdsValue.getObject(rt).getArray(rt);
+      // Unlink the current children, then relink in the new order
+      for (uint32_t child = firstChild_[parent]; child != kNone;) {
+        uint32_t next = nextSibling_[child];
+        parent_[child] = prevSibling_[child] = nextSibling_[child] = kNone;
+        child = next;
+      }
+      firstChild_[parent] = lastChild_[parent] = kNone;
+      childCount_[parent] = 0;
+      markChanged(parent);
+      std::vector<jsi::Value> childValues = qjs::getArrayValues(rt, childIds);
+      for (const jsi::Value &childValue : childValues) {
+        if (!childValue.isNumber()) {
+          continue;
+        }
+        uint32_t child = lookup((int64_t)childValue.getNumber());
+        if (child == kNone || child == 0 || parent_[child] == parent ||
+            wouldCycle(parent, child)) {
+          continue; // unknown, duplicate or an ancestor
+        }
+        detach(child);
+        linkBefore(parent, child, kNone);
+      }
+      ok = true;
+      break;
+    }
+
+    default:
+      break;
+    }
+
+    if (kind == kOpCreate || kind == kOpUpdate || kind == kOpText) {
+      continue; // only tracked for dirtiness; the Receiver applies these
+    }
+    if (ok) {
+      result.applied++;
+    } else {
+      result.ignored++;
+    }
+  }
+
+  for (uint32_t slot : dirtySlots_) {
+    if (alive_[slot]) {
+      result.dirty.push_back(ids_[slot]);
+    }
+  }
+  for (uint32_t slot : changedSlots_) {
+    if (alive_[slot]) {
+      result.childrenChanged.push_back(ids_[slot]);
+    }
+  }
+  std::sort(deletedIds_.begin(), deletedIds_.end());
+  deletedIds_.erase(std::unique(deletedIds_.begin(), deletedIds_.end()),
+                    deletedIds_.end());
+  for (int64_t deletedId : deletedIds_) {
+    if (lookup(deletedId) == kNone) {
+      result.deleted.push_back(deletedId);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+// ---------------------------------------------------------------------------
+
+bool NodeTreeStore::has(int64_t id) const {
+  return id != 0 && lookup(id) != kNone;
+}
+
+std::vector<int64_t> NodeTreeStore::children(int64_t id) const {
+  std::vector<int64_t> out;
+  uint32_t slot = lookup(id);
+  if (slot == kNone) {
+    return out;
+  }
+  out.reserve(childCount_[slot]);
+  for (uint32_t child = firstChild_[slot]; child != kNone;
+       child = nextSibling_[child]) {
+    out.push_back(ids_[child]);
+  }
+  return out;
+}
+
+bool NodeTreeStore::parentOf(int64_t id, int64_t *parentId) const {
+  uint32_t slot = lookup(id);
+  if (slot == kNone || parent_[slot] == kNone) {
+    return false;
+  }
+  *parentId = ids_[parent_[slot]];
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// HostObject
+// ---------------------------------------------------------------------------
+
+// TreeStoreSlot indexes these
+static const qjs::StaticHostObject::PropertyList kTreeStoreProperties = {
+    {"applyBatch", true},
+    {"getChildren", true},
+    {"getParent", true},
+    {"has", true},
+    {"size", false},
+    {"clear", true},
+};
+
+enum class TreeStoreSlot : size_t {
+  ApplyBatch,
+  GetChildren,
+  GetParent,
+  Has,
+  Size,
+  Clear,
+};
+
+const qjs::StaticHostObject::PropertyList &
+NodeTreeStore::properties() const {
+  return kTreeStoreProperties;
+}
+
+jsi::Value NodeTreeStore::getSlot(jsi::Runtime &rt, size_t slot) {
+  switch (static_cast<TreeStoreSlot>(slot)) {
+  case TreeStoreSlot::ApplyBatch: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 2,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (count < 1 || !args[0].isObject() ||
+              !args[0].getObject(rt).isArray(rt)) {
+            throw jsi::JSError(rt, "applyBatch requires an operations array");
+          }
+          jsi::Array operations = args[0].getObject(rt).getArray(rt);
+          size_t limit = operations.size(rt);
+          if (count > 1 && args[1].isNumber()) {
+            limit = (size_t)std::max(0.0, args[1].getNumber());
+          }
+
+          BatchResult result;
+          applyBatch(rt, operations, limit, result);
+
+          jsi::Object out(rt);
+          out.setProperty(rt, "dirty", idsToJSI(rt, result.dirty));
+          out.setProperty(rt, "childrenChanged",
+                          idsToJSI(rt, result.childrenChanged));
+          out.setProperty(rt, "deleted", idsToJSI(rt, result.deleted));
+          out.setProperty(rt, "applied", (double)result.applied);
+          out.setProperty(rt, "ignored", (double)result.ignored);
+          return out;
+        });
+  }
+
+  case TreeStoreSlot::GetChildren: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (count < 1 || !args[0].isNumber()) {
+            return jsi::Array(rt, 0);
+          }
+          return idsToJSI(rt, children((int64_t)args[0].getNumber()));
+        });
+  }
+
+  case TreeStoreSlot::GetParent: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          int64_t parentId;
+          if (count < 1 || !args[0].isNumber() ||
+              !parentOf((int64_t)args[0].getNumber(), &parentId)) {
+            return jsi::Value::undefined();
+          }
+          return jsi::Value((double)parentId);
+        });
+  }
+
+  case TreeStoreSlot::Has: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          return jsi::Value(count > 0 && args[0].isNumber() &&
+                            has((int64_t)args[0].getNumber()));
+        });
+  }
+
+  case TreeStoreSlot::Size: {
+    return jsi::Value((double)liveCount_);
+  }
+
+  case TreeStoreSlot::Clear: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value {
+          clear();
+          return jsi::Value::undefined();
+        });
+  }
+  }
+  return jsi::Value::undefined();
+}
+
+void NodeTreeStore::set(jsi::Runtime &, const jsi::PropNameID &,
+                        const jsi::Value &) {
+  // Read-only
+}
+
+} // namespace quickjs_sandbox
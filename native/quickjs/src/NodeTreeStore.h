@@ -0,0 +1,114 @@
+#pragma once
+
+#include "StaticHostObject.h"
+#include <cstdint>
+#include <jsi/jsi.h>
+#include <vector>
+
+namespace quickjs_sandbox {
+
+using namespace facebook;
+
+/**
+ * NodeTreeStore - Native node tree for the host Receiver
+ *
+ * Keeps the parent/child structure of the rendered tree in flat
+ * struct-of-arrays storage indexed by slot, with children in intrusive
+ * doubly linked lists, so APPEND/INSERT/REMOVE/REORDER/DELETE run without
+ * allocating JS arrays or Sets. Node ids map to slots through an
+ * open-addressed table; slot 0 is the root container (id 0).
+ *
+ * Exposed to JS as a HostObject (see QuickJSSandboxModule::createTreeStore):
+ * - applyBatch(operations: Operation[], count?: number):
+ *     { dirty, childrenChanged, deleted, applied, ignored }
+ * - getChildren(id: number): number[]
+ * - getParent(id: number): number | undefined
+ * - has(id: number): boolean
+ * - size: number (nodes, excluding the root)
+ * - clear(): void
+ *
+ * Only structure and dirtiness are tracked; props stay in the Receiver.
+ * Operations on unknown nodes are ignored; `applied` and `ignored` count
+ * the structure operations only. Unlike the JS handlers a node
+ * always has a single parent: attaching it elsewhere detaches it first.
+ * CREATE of an existing id deletes the old node and its subtree.
+ * Not thread-safe; use it from the host JS thread only.
+ */
+class NodeTreeStore : public qjs::StaticHostObject {
+public:
+  struct BatchResult {
+    std::vector<int64_t> dirty;           // created/updated nodes and
+                                          // parents whose children changed
+    std::vector<int64_t> childrenChanged; // 0 is the root
+    std::vector<int64_t> deleted;         // still deleted at the end
+    uint32_t applied = 0;                 // structure operations only
+    uint32_t ignored = 0;
+  };
+
+  NodeTreeStore();
+
+  const PropertyList &properties() const override;
+  jsi::Value getSlot(jsi::Runtime &rt, size_t slot) override;
+  void set(jsi::Runtime &rt, const jsi::PropNameID &name,
+           const jsi::Value &value) override;
+
+  // Apply the first `count` operations of `operations`
+  void applyBatch(jsi::Runtime &rt, const jsi::Array &operations,
+                  size_t count, BatchResult &result);
+
+  bool has(int64_t id) const;
+  std::vector<int64_t> children(int64_t id) const;
+  bool parentOf(int64_t id, int64_t *parentId) const;
+  size_t size() const { return liveCount_; }
+  void clear();
+
+private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  struct IndexEntry {
+    int64_t id;
+    uint32_t slot; // kNone when empty
+  };
+
+  // Per-slot columns
+  std::vector<int64_t> ids_;
+  std::vector<uint32_t> parent_;
+  std::vector<uint32_t> firstChild_;
+  std::vector<uint32_t> lastChild_;
+  std::vector<uint32_t> nextSibling_;
+  std::vector<uint32_t> prevSibling_;
+  std::vector<uint32_t> childCount_;
+  std::vector<uint8_t> alive_;
+  std::vector<uint32_t> dirtyMark_;   // == batch_ when queued in dirtySlots_
+  std::vector<uint32_t> changedMark_; // == batch_ when queued in changedSlots_
+
+  std::vector<uint32_t> freeSlots_;
+  std::vector<IndexEntry> index_;
+  size_t liveCount_;
+
+  // Per-batch scratch
+  uint32_t batch_;
+  std::vector<uint32_t> dirtySlots_;
+  std::vector<uint32_t> changedSlots_;
+  std::vector<int64_t> deletedIds_;
+  std::vector<uint32_t> stack_;
+
+  uint32_t lookup(int64_t id) const;
+  void indexInsert(int64_t id, uint32_t slot);
+  void indexErase(int64_t id);
+  void indexGrow();
+
+  uint32_t allocate(int64_t id);
+  void release(uint32_t slot);
+
+  void detach(uint32_t slot);
+  void linkBefore(uint32_t parent, uint32_t slot, uint32_t before);
+  uint32_t childAt(uint32_t parent, int64_t index) const;
+  bool wouldCycle(uint32_t parent, uint32_t slot) const;
+  void deleteSubtree(uint32_t slot);
+
+  void markDirty(uint32_t slot);
+  void markChanged(uint32_t slot);
+};
+
+} // namespace quickjs_sandbox
@@ -0,0 +1,159 @@
+#include "OperationArena.h"
+#include <cstdint>
+
+namespace quickjs_sandbox {
+
+// Node ids and indices are integers; keep them int-tagged in the guest
+static JSValue newNumber(JSContext *ctx, double value) {
+  if (value >= INT32_MIN && value <= INT32_MAX && value == (int32_t)value) {
+    return JS_NewInt32(ctx, (int32_t)value);
+  }
+  return JS_NewFloat64(ctx, value);
+}
+
+OperationArena::OperationArena(JSContext *ctx) : ctx_(ctx) {}
+
+OperationArena::~OperationArena() { clear(); }
+
+uint32_t OperationArena::retain(JSValueConst value) {
+  values_.push_back(JS_DupValue(ctx_, value));
+  return (uint32_t)(values_.size() - 1);
+}
+
+void OperationArena::create(double id, JSValueConst type, JSValueConst props) {
+  uint32_t value = retain(type);
+  retain(props);
+  ops_.push_back(Op{Kind::Create, value, id, 0, 0});
+}
+
+void OperationArena::update(double id, JSValueConst props,
+                            JSValueConst removedProps) {
+  uint32_t value = retain(props);
+  retain(removedProps);
+  ops_.push_back(Op{Kind::Update, value, id, 0, 0});
+}
+
+void OperationArena::deleteNode(double id) {
+  ops_.push_back(Op{Kind::Delete, 0, id, 0, 0});
+}
+
+void OperationArena::link(Kind kind, double parentId, double childId,
+                          double index) {
+  ops_.push_back(Op{kind, 0, childId, parentId, index});
+}
+
+void OperationArena::push(JSValueConst op) {
+  ops_.push_back(Op{Kind::Other, retain(op), 0, 0, 0});
+}
+
+const char *OperationArena::kindName(Kind kind) {
+  switch (kind) {
+  case Kind::Create:
+    return "CREATE";
+  case Kind::Update:
+    return "UPDATE";
+  case Kind::Delete:
+    return "DELETE";
+  case Kind::Append:
+    return "APPEND";
+  case Kind::Insert:
+    return "INSERT";
+  case Kind::Remove:
+    return "REMOVE";
+  case Kind::Other:
+    break;
+  }
+  return nullptr;
+}
+
+JSValue OperationArena::counts() {
+  uint32_t counts[kKindCount] = {};
+  JSValue result = JS_NewObject(ctx_);
+  for (const Op &op : ops_) {
+    if (op.kind != Kind::Other) {
+      counts[(size_t)op.kind]++;
+      continue;
+    }
+    // Keyed by its `op`, as the JS collector counts it
+    JSValue name = JS_GetPropertyStr(ctx_, values_[op.value], "op");
+    JSAtom atom = JS_ValueToAtom(ctx_, name);
+    JS_FreeValue(ctx_, name);
+    if (atom == JS_ATOM_NULL) {
+      JS_FreeValue(ctx_, JS_GetException(ctx_));
+      continue;
+    }
+    JSValue count = JS_GetProperty(ctx_, result, atom);
+    int32_t previous = 0;
+    JS_ToInt32(ctx_, &previous, count);
+    JS_FreeValue(ctx_, count);
+    JS_SetProperty(ctx_, result, atom, JS_NewInt32(ctx_, previous + 1));
+    JS_FreeAtom(ctx_, atom);
+  }
+  for (size_t i = 0; i < kKindCount; i++) {
+    if (counts[i] > 0) {
+      JS_SetPropertyStr(ctx_, result, kindName((Kind)i),
+                        JS_NewUint32(ctx_, counts[i]));
+    }
+  }
+  return result;
+}
+
+JSValue OperationArena::buildBatch(double version, double batchId) {
+  JSValue list = JS_NewArray(ctx_);
+  uint32_t i = 0;
+  for (const Op &op : ops_) {
+    if (op.kind == Kind::Other) {
+      JS_SetPropertyUint32(ctx_, list, i++,
+                           JS_DupValue(ctx_, values_[op.value]));
+      continue;
+    }
+    JSValue item = JS_NewObject(ctx_);
+    JS_SetPropertyStr(ctx_, item, "op", JS_NewString(ctx_, kindName(op.kind)));
+    JS_SetPropertyStr(ctx_, item, "id", newNumber(ctx_, op.id));
+    switch (op.kind) {
+    case Kind::Create:
+      JS_SetPropertyStr(ctx_, item, "type",
+                        JS_DupValue(ctx_, values_[op.value]));
+      JS_SetPropertyStr(ctx_, item, "props",
+                        JS_DupValue(ctx_, values_[op.value + 1]));
+      break;
+    case Kind::Update:
+      JS_SetPropertyStr(ctx_, item, "props",
+                        JS_DupValue(ctx_, values_[op.value]));
+      if (!JS_IsUndefined(values_[op.value + 1])) {
+        JS_SetPropertyStr(ctx_, item, "removedProps",
+                          JS_DupValue(ctx_, values_[op.value + 1]));
+      }
+      break;
+    case Kind::Append:
+    case Kind::Insert:
+    case Kind::Remove:
+      JS_SetPropertyStr(ctx_, item, "parentId",
+                        newNumber(ctx_, op.parentId));
+      JS_SetPropertyStr(ctx_, item, "childId", newNumber(ctx_, op.id));
+      if (op.kind == Kind::Insert) {
+        JS_SetPropertyStr(ctx_, item, "index", newNumber(ctx_, op.index));
+      }
+      break;
+    default:
+      break;
+    }
+    JS_SetPropertyUint32(ctx_, list, i++, item);
+  }
+
+  JSValue batch = JS_NewObject(ctx_);
+  JS_SetPropertyStr(ctx_, batch, "version", newNumber(ctx_, version));
+  JS_SetPropertyStr(ctx_, batch, "batchId", newNumber(ctx_, batchId));
+  JS_SetPropertyStr(ctx_, batch, "operations", list);
+  return batch;
+}
+
+void OperationArena::clear() {
+  for (JSValue value : values_) {
+    JS_FreeValue(ctx_, value);
+  }
+  values_.clear();
+  ops_.clear();
+}
+
+} // namespace quickjs_sandbox
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <quickjs.h>
+#include <vector>
+
+namespace quickjs_sandbox {
+
+/**
+ * OperationArena - The guest reconciler's pending operations, kept natively
+ *
+ * Backs the `__rill_op_*` intrinsics: the reconciler records each operation
+ * of a commit with one native call instead of allocating an op object, and
+ * the commit hands the whole batch to the host at once. An operation is a
+ * fixed-size record (kind and numeric fields); the only guest values kept
+ * are the ones the reconciler already allocated (element type, props,
+ * removedProps), retained until the batch is committed.
+ *
+ * APPEND/INSERT/REMOVE name the child by `id` (the batch carries it as both
+ * `id` and `childId`, like the JS collector). Operations without a record
+ * of their own (REORDER, TEXT, REF_CALL) are kept as their guest object.
+ *
+ * Not synchronized: the context calls it with its lock held.
+ */
+class OperationArena {
+public:
+  enum class Kind : uint8_t {
+    Create,
+    Update,
+    Delete,
+    Append,
+    Insert,
+    Remove,
+    Other,
+  };
+  static constexpr size_t kKindCount = 7;
+
+  struct Op {
+    Kind kind;
+    uint32_t value; // first retained value, see Kind
+    double id;
+    double parentId; // APPEND/INSERT/REMOVE
+    double index;    // INSERT
+  };
+
+  explicit OperationArena(JSContext *ctx);
+  ~OperationArena();
+
+  OperationArena(const OperationArena &) = delete;
+  OperationArena &operator=(const OperationArena &) = delete;
+
+  // Retained values: CREATE type and props, UPDATE props and removedProps,
+  // the guest object of an Other op
+  void create(double id, JSValueConst type, JSValueConst props);
+  void update(double id, JSValueConst props, JSValueConst removedProps);
+  void deleteNode(double id);
+  // APPEND, INSERT (at `index`) or REMOVE
+  void link(Kind kind, double parentId, double childId, double index = 0);
+  void push(JSValueConst op);
+
+  size_t size() const { return ops_.size(); }
+  const std::vector<Op> &ops() const { return ops_; }
+  JSValueConst value(uint32_t index) const { return values_[index]; }
+
+  static const char *kindName(Kind kind);
+
+  // { [op]: count } of the pending operations
+  JSValue counts();
+  // The pending operations as a guest batch { version, batchId, operations }
+  JSValue buildBatch(double version, double batchId);
+
+  // Release the pending operations (after they were committed)
+  void clear();
+
+private:
+  JSContext *ctx_;
+  std::vector<Op> ops_;
+  std::vector<JSValue> values_;
+
+  uint32_t retain(JSValueConst value);
+};
+
+} // namespace quickjs_sandbox
@@ -0,0 +1,400 @@
+#include "OperationCoalescer.h"
+#include <algorithm>
+
+namespace quickjs_sandbox {
+
+static uint64_t hashNodeId(int64_t id) {
+  uint64_t x = (uint64_t)id;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// Shallow copy of own enumerable string-keyed properties (like `{...src}`)
+static void copyOwnProperties(JSContext *ctx, JSValueConst dst,
+                              JSValueConst src) {
+  JSPropertyEnum *props;
+  uint32_t count;
+  if (JS_GetOwnPropertyNames(ctx, &props, &count, src,
+                             JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) != 0) {
+    return;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    JSValue val = JS_GetProperty(ctx, src, props[i].atom);
+    JS_DefinePropertyValue(ctx, dst, props[i].atom, val, JS_PROP_C_W_E);
+    JS_FreeAtom(ctx, props[i].atom);
+  }
+  js_free(ctx, props);
+}
+
+OperationCoalescer::OperationCoalescer(JSContext *ctx) : ctx_(ctx), gen_(0) {
+  atomOperations_ = JS_NewAtom(ctx_, "operations");
+  atomOp_ = JS_NewAtom(ctx_, "op");
+  atomId_ = JS_NewAtom(ctx_, "id");
+  atomChildId_ = JS_NewAtom(ctx_, "childId");
+  atomParentId_ = JS_NewAtom(ctx_, "parentId");
+  atomProps_ = JS_NewAtom(ctx_, "props");
+  atomRemovedProps_ = JS_NewAtom(ctx_, "removedProps");
+  atomCreate_ = JS_NewAtom(ctx_, "CREATE");
+  atomUpdate_ = JS_NewAtom(ctx_, "UPDATE");
+  atomDelete_ = JS_NewAtom(ctx_, "DELETE");
+  atomText_ = JS_NewAtom(ctx_, "TEXT");
+  atomAppend_ = JS_NewAtom(ctx_, "APPEND");
+  atomInsert_ = JS_NewAtom(ctx_, "INSERT");
+  atomRemove_ = JS_NewAtom(ctx_, "REMOVE");
+  atomReorder_ = JS_NewAtom(ctx_, "REORDER");
+}
+
+OperationCoalescer::~OperationCoalescer() {
+  clear();
+  for (JSAtom atom :
+       {atomOperations_, atomOp_, atomId_, atomChildId_, atomParentId_,
+        atomProps_, atomRemovedProps_, atomCreate_, atomUpdate_, atomDelete_,
+        atomText_, atomAppend_, atomInsert_, atomRemove_, atomReorder_}) {
+    JS_FreeAtom(ctx_, atom);
+  }
+}
+
+void OperationCoalescer::clear() {
+  for (auto &rec : ops_) {
+    JS_FreeValue(ctx_, rec.op);
+  }
+  ops_.clear();
+}
+
+void OperationCoalescer::resetTable(uint32_t opCount) {
+  // Each op names at most two nodes; keep the load factor at or below 1/2
+  size_t capacity = 16;
+  while (capacity < (size_t)opCount * 4) {
+    capacity <<= 1;
+  }
+  if (table_.size() < capacity) {
+    table_.assign(capacity, NodeSlot{});
+    gen_ = 0;
+  }
+  if (++gen_ == 0) {
+    std::fill(table_.begin(), table_.end(), NodeSlot{});
+    gen_ = 1;
+  }
+}
+
+OperationCoalescer::NodeSlot *OperationCoalescer::lookup(int64_t id) {
+  size_t mask = table_.size() - 1;
+  for (size_t i = hashNodeId(id) & mask;; i = (i + 1) & mask) {
+    NodeSlot &slot = table_[i];
+    if (slot.gen != gen_) {
+      slot = NodeSlot{id, gen_, -1, -1, -1, -1, -1, -1, -1, -1};
+      return &slot;
+    }
+    if (slot.id == id) {
+      return &slot;
+    }
+  }
+}
+
+OperationCoalescer::OpKind OperationCoalescer::kindOf(JSValueConst op) {
+  JSValue name = JS_GetProperty(ctx_, op, atomOp_);
+  OpKind kind = kOther;
+  if (JS_IsString(name)) {
+    JSAtom atom = JS_ValueToAtom(ctx_, name);
+    if (atom == atomUpdate_)
+      kind = kUpdate;
+    else if (atom == atomCreate_)
+      kind = kCreate;
+    else if (atom == atomDelete_)
+      kind = kDelete;
+    else if (atom == atomText_)
+      kind = kText;
+    else if (atom == atomAppend_)
+      kind = kAppend;
+    else if (atom == atomInsert_)
+      kind = kInsert;
+    else if (atom == atomRemove_)
+      kind = kRemove;
+    else if (atom == atomReorder_)
+      kind = kReorder;
+    JS_FreeAtom(ctx_, atom);
+  }
+  JS_FreeValue(ctx_, name);
+  return kind;
+}
+
+bool OperationCoalescer::readId(JSValueConst op, JSAtom atom, int64_t *id) {
+  JSValue val = JS_GetProperty(ctx_, op, atom);
+  bool ok = false;
+  if (JS_IsNumber(val)) {
+    double d;
+    JS_ToFloat64(ctx_, &d, val);
+    if (d >= -9007199254740991.0 && d <= 9007199254740991.0 &&
+        d == (double)(int64_t)d) {
+      *id = (int64_t)d;
+      ok = true;
+    }
+  }
+  JS_FreeValue(ctx_, val);
+  return ok;
+}
+
+JSValue OperationCoalescer::coalesce(JSValueConst batch, uint32_t *opsIn,
+                                     uint32_t *opsOut) {
+  *opsIn = *opsOut = 0;
+  if (!JS_IsObject(batch)) {
+    return JS_UNDEFINED;
+  }
+  JSValue list = JS_GetProperty(ctx_, batch, atomOperations_);
+  if (!JS_IsArray(ctx_, list)) {
+    JS_FreeValue(ctx_, list);
+    return JS_UNDEFINED;
+  }
+  JSValue lengthVal = JS_GetPropertyStr(ctx_, list, "length");
+  uint32_t length = 0;
+  JS_ToUint32(ctx_, &length, lengthVal);
+  JS_FreeValue(ctx_, lengthVal);
+  *opsIn = *opsOut = length;
+  if (length < 2) {
+    JS_FreeValue(ctx_, list);
+    return JS_UNDEFINED;
+  }
+
+  resetTable(length);
+  ops_.reserve(length);
+  int32_t globalBarrier = -1; // last op we could not classify
+  int32_t lastReorder = -1;
+  uint32_t removed = 0;
+
+  for (uint32_t i = 0; i < length; i++) {
+    JSValue op = JS_GetPropertyUint32(ctx_, list, i);
+    if (JS_IsException(op)) {
+      JS_FreeValue(ctx_, JS_GetException(ctx_));
+      JS_FreeValue(ctx_, list);
+      clear();
+      return JS_UNDEFINED;
+    }
+    int32_t idx = (int32_t)i;
+    OpKind kind = JS_IsObject(op) ? kindOf(op) : kOther;
+    ops_.push_back(OpRecord{op, kind, false, -1, -1, -1});
+    int64_t id, parentId;
+
+    switch (kind) {
+    case kCreate:
+    case kUpdate:
+    case kDelete:
+    case kText: {
+      if (!readId(op, atomId_, &id)) {
+        globalBarrier = idx;
+        break;
+      }
+      NodeSlot *node = lookup(id);
+      ops_[idx].prevRef = node->lastRef;
+      node->lastRef = idx;
+
+      if (kind == kUpdate) {
+        int32_t head = node->updateIdx;
+        if (head > node->lastIdOp && head > globalBarrier) {
+          OpRecord &first = ops_[head];
+          if (first.mergeLast < 0) {
+            first.mergeNext = idx;
+          } else {
+            ops_[first.mergeLast].mergeNext = idx;
+          }
+          first.mergeLast = idx;
+          ops_[idx].removed = true;
+          removed++;
+        } else {
+          node->updateIdx = idx;
+        }
+        break;
+      }
+
+      int32_t created = node->createIdx;
+      if (kind == kDelete && created >= 0 && created > globalBarrier &&
+          created > lastReorder && node->lastAsParent < created &&
+          node->lastAsChild < created) {
+        // Never attached anywhere: drop the node and its UPDATE/TEXT ops
+        for (int32_t r = idx; r >= created; r = ops_[r].prevRef) {
+          if (!ops_[r].removed) {
+            ops_[r].removed = true;
+            removed++;
+          }
+        }
+      }
+      node->createIdx = kind == kCreate ? idx : -1;
+      node->lastIdOp = idx;
+      break;
+    }
+
+    case kAppend:
+    case kInsert:
+    case kRemove: {
+      if (!readId(op, atomParentId_, &parentId) ||
+          !readId(op, atomChildId_, &id)) {
+        globalBarrier = idx;
+        break;
+      }
+      NodeSlot *child = lookup(id);
+      NodeSlot *parent = lookup(parentId);
+      ops_[idx].prevRef = child->lastRef;
+      child->lastRef = idx;
+
+      if (kind == kInsert) {
+        // The previous INSERT is dead if nothing touched the child or
+        // the parent's children since then
+        int32_t prev = child->insertIdx;
+        if (prev >= 0 && prev > globalBarrier && child->lastAsChild == prev &&
+            parent->lastAsParent == prev && child->lastIdOp < prev &&
+            parent->lastIdOp < prev) {
+          ops_[prev].removed = true;
+          removed++;
+        }
+        child->insertIdx = idx;
+      }
+      child->lastAsChild = idx;
+      parent->lastAsParent = idx;
+      break;
+    }
+
+    case kReorder: {
+      if (!readId(op, atomParentId_, &parentId)) {
+        globalBarrier = idx;
+        break;
+      }
+      NodeSlot *parent = lookup(parentId);
+      int32_t prev = parent->reorderIdx;
+      if (prev >= 0 && prev > globalBarrier && parent->lastAsParent == prev &&
+          parent->lastIdOp < prev) {
+        ops_[prev].removed = true;
+        removed++;
+      }
+      parent->reorderIdx = idx;
+      parent->lastAsParent = idx;
+      lastReorder = idx;
+      break;
+    }
+
+    default:
+      globalBarrier = idx;
+      break;
+    }
+  }
+  JS_FreeValue(ctx_, list);
+
+  JSValue result = JS_UNDEFINED;
+  if (removed > 0) {
+    *opsOut = length - removed;
+    result = buildBatch(batch);
+  }
+  clear();
+  return result;
+}
+
+JSValue OperationCoalescer::buildMergedUpdate(const OpRecord &head) {
+  JSValue merged = JS_NewObject(ctx_);
+  copyOwnProperties(ctx_, merged, head.op);
+
+  // Later props win and cancel earlier removals; later removals delete
+  // earlier props, so `props` and `removedProps` stay disjoint
+  JSValue props = JS_NewObject(ctx_);
+  std::vector<JSAtom> removedProps;
+  bool hasRemovedProps = false;
+
+  auto apply = [&](JSValueConst op) {
+    JSValue opProps = JS_GetProperty(ctx_, op, atomProps_);
+    if (JS_IsObject(opProps)) {
+      JSPropertyEnum *tab;
+      uint32_t count;
+      if (JS_GetOwnPropertyNames(ctx_, &tab, &count, opProps,
+                                 JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) == 0) {
+        for (uint32_t i = 0; i < count; i++) {
+          JSAtom key = tab[i].atom;
+          JS_DefinePropertyValue(ctx_, props, key,
+                                 JS_GetProperty(ctx_, opProps, key),
+                                 JS_PROP_C_W_E);
+          auto it = std::find(removedProps.begin(), removedProps.end(), key);
+          if (it != removedProps.end()) {
+            JS_FreeAtom(ctx_, *it);
+            removedProps.erase(it);
+          }
+          JS_FreeAtom(ctx_, key);
+        }
+        js_free(ctx_, tab);
+      }
+    }
+    JS_FreeValue(ctx_, opProps);
+
+    JSValue opRemoved = JS_GetProperty(ctx_, op, atomRemovedProps_);
+    if (JS_IsArray(ctx_, opRemoved)) {
+      hasRemovedProps = true;
+      JSValue lengthVal = JS_GetPropertyStr(ctx_, opRemoved, "length");
+      uint32_t count = 0;
+      JS_ToUint32(ctx_, &count, lengthVal);
+      JS_FreeValue(ctx_, lengthVal);
+      for (uint32_t i = 0; i < count; i++) {
+        JSValue keyVal = JS_GetPropertyUint32(ctx_, opRemoved, i);
+        JSAtom key = JS_ValueToAtom(ctx_, keyVal);
+        JS_FreeValue(ctx_, keyVal);
+        if (key == JS_ATOM_NULL) {
+          JS_FreeValue(ctx_, JS_GetException(ctx_));
+          continue;
+        }
+        JS_DeleteProperty(ctx_, props, key, 0);
+        if (std::find(removedProps.begin(), removedProps.end(), key) ==
+            removedProps.end()) {
+          removedProps.push_back(key);
+        } else {
+          JS_FreeAtom(ctx_, key);
+        }
+      }
+    }
+    JS_FreeValue(ctx_, opRemoved);
+  };
+  apply(head.op);
+  for (int32_t r = head.mergeNext; r >= 0; r = ops_[r].mergeNext) {
+    apply(ops_[r].op);
+  }
+
+  JS_DefinePropertyValue(ctx_, merged, atomProps_, props, JS_PROP_C_W_E);
+  if (hasRemovedProps) {
+    JSValue list = JS_NewArray(ctx_);
+    for (uint32_t i = 0; i < removedProps.size(); i++) {
+      JS_SetPropertyUint32(ctx_, list, i,
+                           JS_AtomToString(ctx_, removedProps[i]));
+      JS_FreeAtom(ctx_, removedProps[i]);
+    }
+    JS_DefinePropertyValue(ctx_, merged, atomRemovedProps_, list,
+                           JS_PROP_C_W_E);
+  }
+  return merged;
+}
+
+JSValue OperationCoalescer::buildBatch(JSValueConst batch) {
+  JSValue list = JS_NewArray(ctx_);
+  uint32_t out = 0;
+  for (const auto &rec : ops_) {
+    if (rec.removed) {
+      continue;
+    }
+    JSValue op = rec.mergeNext >= 0 ? buildMergedUpdate(rec)
+                                    : JS_DupValue(ctx_, rec.op);
+    JS_SetPropertyUint32(ctx_, list, out++, op);
+  }
+
+  JSValue result = JS_NewObject(ctx_);
+  copyOwnProperties(ctx_, result, batch);
+  JS_DefinePropertyValue(ctx_, result, atomOperations_, list, JS_PROP_C_W_E);
+  return result;
+}
+
+void OperationCoalescer::record(uint32_t opsIn, uint32_t opsOut,
+                                double coalesceMs, double conversionMs) {
+  stats_.batches++;
+  stats_.opsIn += opsIn;
+  stats_.opsOut += opsOut;
+  stats_.coalesceMs += coalesceMs;
+  stats_.conversionMs += conversionMs;
+  if (opsOut > 0 && opsIn > opsOut) {
+    stats_.estimatedSavedMs += conversionMs * (opsIn - opsOut) / opsOut;
+  }
+}
+
+} // namespace quickjs_sandbox
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <quickjs.h>
+#include <vector>
+
+namespace quickjs_sandbox {
+
+/**
+ * OperationCoalescer - Native counterpart of OperationMerger
+ * (src/host/performance.ts) for guest operation batches
+ *
+ * Runs over a batch while it is still a QuickJS value, so eliminated
+ * operations are never converted to JSI or transferred to the host:
+ * - repeated UPDATEs of a node merge into the first one
+ * - only the last REORDER of a parent survives
+ * - only the last INSERT of a child into the same parent survives
+ * - a node CREATEd and DELETEd in the same batch is dropped together with
+ *   its UPDATE/TEXT operations
+ *
+ * Unlike the JS merger the batch order is preserved, and an operation is
+ * only dropped when no operation between it and its replacement touches
+ * the same node or parent. Node ids are tracked in an open-addressed table
+ * that is reused between batches.
+ */
+class OperationCoalescer {
+public:
+  struct Stats {
+    uint64_t batches = 0;
+    uint64_t opsIn = 0;
+    uint64_t opsOut = 0;
+    double coalesceMs = 0;
+    double conversionMs = 0;
+    double estimatedSavedMs = 0; // conversion time of the eliminated ops
+  };
+
+  explicit OperationCoalescer(JSContext *ctx);
+  ~OperationCoalescer();
+
+  OperationCoalescer(const OperationCoalescer &) = delete;
+  OperationCoalescer &operator=(const OperationCoalescer &) = delete;
+
+  /**
+   * Coalesce `batch.operations`. Returns a new batch object, or JS_UNDEFINED
+   * when nothing could be eliminated (the original batch should be used).
+   * opsIn/opsOut receive the operation counts in either case.
+   */
+  JSValue coalesce(JSValueConst batch, uint32_t *opsIn, uint32_t *opsOut);
+
+  // Account one batch: counts from coalesce() and the measured times
+  void record(uint32_t opsIn, uint32_t opsOut, double coalesceMs,
+              double conversionMs);
+
+  const Stats &stats() const { return stats_; }
+
+private:
+  enum OpKind : uint8_t {
+    kOther,
+    kCreate,
+    kUpdate,
+    kDelete,
+    kText,
+    kAppend,
+    kInsert,
+    kRemove,
+    kReorder,
+  };
+
+  struct OpRecord {
+    JSValue op;
+    OpKind kind;
+    bool removed;
+    int32_t prevRef;   // previous op referencing the same node (id/childId)
+    int32_t mergeNext; // next UPDATE folded into this one
+    int32_t mergeLast;
+  };
+
+  // Per-node bookkeeping; all indices are op positions, -1 when unset
+  struct NodeSlot {
+    int64_t id;
+    uint32_t gen;
+    int32_t lastIdOp;     // last non-UPDATE op with `id` == node
+    int32_t lastAsParent; // last op with `parentId` == node
+    int32_t lastAsChild;  // last op with `childId` == node
+    int32_t lastRef;      // head of the prevRef chain
+    int32_t updateIdx;
+    int32_t insertIdx;
+    int32_t reorderIdx;
+    int32_t createIdx;
+  };
+
+  JSContext *ctx_;
+  JSAtom atomOperations_, atomOp_, atomId_, atomChildId_, atomParentId_;
+  JSAtom atomProps_, atomRemovedProps_;
+  JSAtom atomCreate_, atomUpdate_, atomDelete_, atomText_, atomAppend_,
+      atomInsert_, atomRemove_, atomReorder_;
+
+  std::vector<OpRecord> ops_;
+  std::vector<NodeSlot> table_;
+  uint32_t gen_;
+  Stats stats_;
+
+  NodeSlot *lookup(int64_t id);
+  void resetTable(uint32_t opCount);
+  OpKind kindOf(JSValueConst op);
+  bool readId(JSValueConst op, JSAtom atom, int64_t *id);
+  void clear();
+
+  JSValue buildMergedUpdate(const OpRecord &head);
+  JSValue buildBatch(JSValueConst batch);
+};
+
+} // namespace quickjs_sandbox
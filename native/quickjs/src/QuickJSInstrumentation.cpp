@@ -1,6 +1,14 @@
 #include "QuickJSInstrumentation.h"
 
 #include "QuickJSRuntime.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
 namespace qjs {
 QuickJSInstrumentation::QuickJSInstrumentation(QuickJSRuntime *runtime)
     : runtime_(runtime) {}
@@ -27,8 +35,170 @@ void QuickJSInstrumentation::createSnapshotToStream(
     std::ostream &, const jsi::Instrumentation::HeapSnapshotOptions &) {}
 
 void QuickJSInstrumentation::writeBasicBlockProfileTraceToFile(
-    const std::string &) const {}
+    const std::string &path) const {
+  std::ofstream file(path, std::ios::trunc);
+  writeFunctionProfile(runtime_->getJSRuntime(), file);
+}
 
 void QuickJSInstrumentation::dumpProfilerSymbolsToFile(
     const std::string &) const {}
+
+void QuickJSInstrumentation::dumpOpcodeStats(std::ostream &os) const {
+  writeOpcodeStats(runtime_->getJSRuntime(), os);
+}
+
+void QuickJSInstrumentation::resetOpcodeStats() {
+  JS_ResetOpcodeStats(runtime_->getJSRuntime());
+}
+
+void QuickJSInstrumentation::writeOpcodeStats(JSRuntime *rt, std::ostream &os,
+                                              size_t maxPairs) {
+  JSOpcodeStats stats;
+  if (!JS_GetOpcodeStats(rt, &stats)) {
+    os << "opcode stats unavailable (build with CONFIG_OPCODE_STATS)\n";
+    return;
+  }
+
+  std::vector<int> ops;
+  for (int op = 0; op < stats.op_count; op++) {
+    if (stats.count[op]) {
+      ops.push_back(op);
+    }
+  }
+  std::sort(ops.begin(), ops.end(), [&](int a, int b) {
+    return stats.count[a] > stats.count[b];
+  });
+
+  double total = stats.total ? (double)stats.total : 1;
+  char line[160];
+  os << "opcodes: " << stats.total << " executed, " << ops.size()
+     << " distinct, 1 in " << stats.sample_interval << " timed\n";
+  snprintf(line, sizeof(line), "%5s  %-24s %14s %7s %7s %12s\n", "rank",
+           "opcode", "count", "%", "cum%", "cycles/op");
+  os << line;
+  double cumulative = 0;
+  for (size_t i = 0; i < ops.size(); i++) {
+    int op = ops[i];
+    double share = stats.count[op] * 100.0 / total;
+    cumulative += share;
+    double cycles = stats.samples[op]
+                        ? (double)stats.cycles[op] / stats.samples[op]
+                        : 0;
+    snprintf(line, sizeof(line), "%5zu  %-24s %14llu %6.2f%% %6.2f%% %12.1f\n",
+             i + 1, JS_GetOpcodeName(op), (unsigned long long)stats.count[op],
+             share, cumulative, cycles);
+    os << line;
+  }
+
+  struct Pair {
+    uint32_t count;
+    int prev;
+    int op;
+  };
+  std::vector<Pair> pairs;
+  for (int prev = 0; prev < stats.op_count; prev++) {
+    for (int op = 0; op < stats.op_count; op++) {
+      uint32_t count = stats.pairs[prev * stats.op_count + op];
+      if (count) {
+        pairs.push_back({count, prev, op});
+      }
+    }
+  }
+  size_t shown = std::min(maxPairs, pairs.size());
+  std::partial_sort(
+      pairs.begin(), pairs.begin() + shown, pairs.end(),
+      [](const Pair &a, const Pair &b) { return a.count > b.count; });
+
+  os << "pairs: " << pairs.size() << " distinct\n";
+  snprintf(line, sizeof(line), "%5s  %-48s %14s %7s\n", "rank", "pair", "count",
+           "%");
+  os << line;
+  for (size_t i = 0; i < shown; i++) {
+    std::string name = std::string(JS_GetOpcodeName(pairs[i].prev)) + " -> " +
+                       JS_GetOpcodeName(pairs[i].op);
+    snprintf(line, sizeof(line), "%5zu  %-48s %14u %6.2f%%\n", i + 1,
+             name.c_str(), pairs[i].count, pairs[i].count * 100.0 / total);
+    os << line;
+  }
+}
+void QuickJSInstrumentation::setFunctionProfiling(bool enabled) {
+  JS_SetFunctionProfiling(runtime_->getJSRuntime(), enabled);
+}
+
+void QuickJSInstrumentation::resetFunctionProfile() {
+  JS_ResetFunctionProfile(runtime_->getJSRuntime());
+}
+
+std::vector<QuickJSInstrumentation::FunctionProfile>
+QuickJSInstrumentation::collectFunctionProfile(JSRuntime *rt) {
+  using Key = std::tuple<std::string, std::string, int, bool>;
+  std::map<Key, FunctionProfile> merged;
+  JS_GetFunctionProfile(
+      rt,
+      [](void *opaque, const JSFunctionProfileEntry *e) {
+        auto &merged = *static_cast<std::map<Key, FunctionProfile> *>(opaque);
+        std::string file = e->filename ? e->filename : "";
+        auto it = merged.find(Key(e->name, file, e->line, e->native));
+        if (it == merged.end()) {
+          merged.emplace(Key(e->name, file, e->line, e->native),
+                         FunctionProfile{e->name, file, e->line,
+                                         (bool)e->native, e->calls,
+                                         e->inclusive_ns, e->self_ns});
+        } else {
+          it->second.calls += e->calls;
+          it->second.inclusiveNs += e->inclusive_ns;
+          it->second.selfNs += e->self_ns;
+        }
+      },
+      &merged);
+
+  std::vector<FunctionProfile> functions;
+  functions.reserve(merged.size());
+  for (auto &entry : merged) {
+    functions.push_back(std::move(entry.second));
+  }
+  std::sort(functions.begin(), functions.end(),
+            [](const FunctionProfile &a, const FunctionProfile &b) {
+              return a.selfNs > b.selfNs;
+            });
+  return functions;
+}
+
+void QuickJSInstrumentation::writeFunctionProfile(JSRuntime *rt,
+                                                  std::ostream &os,
+                                                  size_t maxFunctions) {
+  std::vector<FunctionProfile> functions = collectFunctionProfile(rt);
+  int64_t totalCalls = 0;
+  int64_t totalSelfNs = 0;
+  for (const FunctionProfile &f : functions) {
+    totalCalls += f.calls;
+    totalSelfNs += f.selfNs;
+  }
+
+  char line[160];
+  snprintf(line, sizeof(line),
+           "functions: %zu profiled, %lld calls, %.3f ms self total\n",
+           functions.size(), (long long)totalCalls, totalSelfNs / 1e6);
+  os << line;
+  snprintf(line, sizeof(line), "%5s %11s %6s %11s %10s %13s  %s\n", "rank",
+           "self_ms", "self%", "incl_ms", "calls", "incl_us/call",
+           "function");
+  os << line;
+  double total = totalSelfNs ? (double)totalSelfNs : 1;
+  size_t shown = std::min(maxFunctions, functions.size());
+  for (size_t i = 0; i < shown; i++) {
+    const FunctionProfile &f = functions[i];
+    std::string label = f.name.empty() ? "(anonymous)" : f.name;
+    if (f.native) {
+      label += " [native]";
+    } else if (!f.file.empty()) {
+      label += " (" + f.file + ":" + std::to_string(f.line) + ")";
+    }
+    snprintf(line, sizeof(line), "%5zu %11.3f %5.1f%% %11.3f %10lld %13.2f  ",
+             i + 1, f.selfNs / 1e6, f.selfNs * 100.0 / total,
+             f.inclusiveNs / 1e6, (long long)f.calls,
+             f.calls ? f.inclusiveNs / 1e3 / f.calls : 0.0);
+    os << line << label << '\n';
+  }
+}
 } // namespace qjs
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <jsi/instrumentation.h>
+#include <string>
+#include <vector>
+
+struct JSRuntime;
 
 namespace jsi = facebook::jsi;
 
@@ -26,13 +31,43 @@ public:
       std::ostream &,
       const jsi::Instrumentation::HeapSnapshotOptions & = {false}) override;
 
-  void writeBasicBlockProfileTraceToFile(const std::string &) const override;
+  // Writes the function profile (see setFunctionProfiling) as text
+  void writeBasicBlockProfileTraceToFile(const std::string &path) const override;
 
   void dumpProfilerSymbolsToFile(const std::string &) const override;
 
   // NOTE: Some JSI versions include dumpOpcodeStats() in Instrumentation, others don't.
   // Keep it without `override` so this header compiles against both.
-  void dumpOpcodeStats(std::ostream &) const {}
+  // Needs a QuickJS built with CONFIG_OPCODE_STATS (QUICKJS_OPCODE_STATS).
+  void dumpOpcodeStats(std::ostream &os) const;
+
+  void resetOpcodeStats();
+
+  // Opcode histogram sorted by count, with the sampled cycles per
+  // execution, followed by the `maxPairs` most frequent opcode pairs
+  static void writeOpcodeStats(JSRuntime *rt, std::ostream &os,
+                               size_t maxPairs = 40);
+
+  // Instrumented per-function profile: entry counts, self and inclusive
+  // time of bytecode functions, native functions and host functions
+  void setFunctionProfiling(bool enabled);
+  void resetFunctionProfile();
+
+  struct FunctionProfile {
+    std::string name;
+    std::string file; // empty for native functions
+    int line;
+    bool native;
+    int64_t calls;
+    int64_t inclusiveNs;
+    int64_t selfNs;
+  };
+
+  // Functions with the same name and location (e.g. one bundle evaluated
+  // in several contexts) are merged; sorted by self time
+  static std::vector<FunctionProfile> collectFunctionProfile(JSRuntime *rt);
+  static void writeFunctionProfile(JSRuntime *rt, std::ostream &os,
+                                   size_t maxFunctions = 200);
 
   void startTrackingHeapObjectStackTraces(
       std::function<void(uint64_t lastSeenObjectID,
@@ -1,5 +1,6 @@
 #include "QuickJSRuntime.h"
 
+#include <algorithm>
 #include <iostream>
 #include <regex>
 #include <string.h>
@@ -10,9 +11,11 @@
 #include "JSIValueConverter.h"
 #include "QuickJSPointerValue.h"
 #include "ScopedJSValue.h"
+#include "StaticHostObject.h"
 #include <cutils.h>
 #include <set>
 #include <sstream>
+#include <vector>
 
 #include "QuickJSInstrumentation.h"
 
@@ -25,6 +28,10 @@
 
 namespace qjs {
 
+// Longer arrays from createArray(length) are sparse, so that a bogus
+// length cannot allocate (and fill) gigabytes
+static constexpr size_t kMaxPreallocatedArrayLength = 1 << 20;
+
 static void js_dump_obj(JSContext *ctx, JSValueConst val) {
   const char *str;
 
@@ -86,6 +93,13 @@ QuickJSRuntime::~QuickJSRuntime() {
     }
   }
 
+  for (auto &entry : hostObjectShapes_) {
+    for (JSAtom atom : entry.second->atoms) {
+      JS_FreeAtom(context_, atom);
+    }
+  }
+  hostObjectShapes_.clear();
+
   JS_FreeContext(context_);
   JS_FreeRuntime(runtime_);
 }
@@ -93,6 +107,8 @@ QuickJSRuntime::~QuickJSRuntime() {
 std::unordered_map<std::string, int64_t> QuickJSRuntime::getHeapInfo() {
   JSMemoryUsage memoryUsage;
   JS_ComputeMemoryUsage(runtime_, &memoryUsage);
+  JSRegExpCacheStats regexpCacheStats;
+  JS_GetRegExpCacheStats(runtime_, &regexpCacheStats);
   return {{"malloc_size", memoryUsage.malloc_size},
           {"memory_used_size", memoryUsage.memory_used_size},
           {"malloc_count", memoryUsage.malloc_count},
@@ -109,7 +125,12 @@ std::unordered_map<std::string, int64_t> QuickJSRuntime::getHeapInfo() {
           {"array_count", memoryUsage.array_count},
           {"fast_array_count", memoryUsage.fast_array_count},
           {"fast_array_elements", memoryUsage.fast_array_elements},
-          {"binary_object_size", memoryUsage.binary_object_size}};
+          {"binary_object_size", memoryUsage.binary_object_size},
+          {"regexp_cache_count", regexpCacheStats.count},
+          {"regexp_cache_size", regexpCacheStats.size},
+          {"regexp_cache_hits", regexpCacheStats.hits},
+          {"regexp_cache_misses", regexpCacheStats.misses},
+          {"regexp_cache_evictions", regexpCacheStats.evictions}};
 }
 
 void QuickJSRuntime::checkAndThrowException(JSContext *context) const {
@@ -508,6 +529,57 @@ std::string QuickJSRuntime::utf8(const jsi::PropNameID &sym) {
   return JSIValueConverter::ToSTLString(context_, jsValue);
 }
 
+// Pass the characters of a QuickJS string to a jsi string data callback:
+// ASCII runs and UTF-16 strings in place, other Latin-1 characters widened
+// through a small stack buffer. False when `value` is not a string.
+static bool stringDataChunks(JSContext *ctx, JSValueConst value,
+                             void *cbCtx,
+                             void (*cb)(void *ctx, bool ascii,
+                                        const void *data, size_t num)) {
+  size_t length;
+  JS_BOOL wide;
+  const void *data = JS_GetStringBuffer(ctx, value, &length, &wide);
+  if (!data) {
+    return false;
+  }
+  if (wide) {
+    cb(cbCtx, false, data, length);
+    return true;
+  }
+  const uint8_t *chars = static_cast<const uint8_t *>(data);
+  size_t i = 0;
+  while (i < length) {
+    size_t start = i;
+    while (i < length && chars[i] < 0x80) {
+      i++;
+    }
+    if (i > start) {
+      cb(cbCtx, true, chars + start, i - start);
+    }
+    char16_t widened[64];
+    size_t count = 0;
+    while (i < length && chars[i] >= 0x80 && count < 64) {
+      widened[count++] = chars[i++];
+    }
+    if (count > 0) {
+      cb(cbCtx, false, widened, count);
+    }
+  }
+  return true;
+}
+
+void QuickJSRuntime::getPropNameIdData(
+    const jsi::PropNameID &sym, void *ctx,
+    void (*cb)(void *ctx, bool ascii, const void *data, size_t num)) {
+  const QuickJSPointerValue *quickJSPointerValue =
+      static_cast<const QuickJSPointerValue *>(getPointerValue(sym));
+  JSValue jsValue = quickJSPointerValue->Get(context_);
+  ScopedJSValue scopedJsValue(context_, &jsValue);
+  if (!stringDataChunks(context_, jsValue, ctx, cb)) {
+    jsi::Runtime::getPropNameIdData(sym, ctx, cb);
+  }
+}
+
 bool QuickJSRuntime::compare(const jsi::PropNameID &a,
                              const jsi::PropNameID &b) {
   // TRACE_SCOPE("QuickJSRuntime", "misc");
@@ -561,6 +633,16 @@ std::string QuickJSRuntime::utf8(const jsi::String &str) {
   return JSIValueConverter::ToSTLString(context_, jsValue);
 }
 
+void QuickJSRuntime::getStringData(
+    const jsi::String &str, void *ctx,
+    void (*cb)(void *ctx, bool ascii, const void *data, size_t num)) {
+  const QuickJSPointerValue *quickJSPointerValue =
+      static_cast<const QuickJSPointerValue *>(getPointerValue(str));
+  JSValue jsValue = quickJSPointerValue->Get(context_);
+  ScopedJSValue scopedJsValue(context_, &jsValue);
+  stringDataChunks(context_, jsValue, ctx, cb);
+}
+
 jsi::Object QuickJSRuntime::createObject() {
   // TRACE_SCOPE("QuickJSRuntime", "object");
   JSValue jsValue = JS_NewObject(context_);
@@ -573,7 +655,13 @@ jsi::Object
 QuickJSRuntime::createObject(std::shared_ptr<jsi::HostObject> hostObject) {
   // TRACE_SCOPE("QuickJSRuntime", "object");
 
-  HostObjectProxy *hostObjectProxy = new HostObjectProxy(*this, hostObject);
+  const HostObjectShape *shape = nullptr;
+  if (auto *staticHostObject =
+          dynamic_cast<StaticHostObject *>(hostObject.get())) {
+    shape = getHostObjectShape(*staticHostObject);
+  }
+  HostObjectProxy *hostObjectProxy =
+      new HostObjectProxy(*this, hostObject, shape);
 
   JSClassID jsClassID = HostObjectProxy::GetClassID();
 
@@ -607,6 +695,22 @@ QuickJSRuntime::createObject(std::shared_ptr<jsi::HostObject> hostObject) {
   return make<jsi::Object>(new QuickJSPointerValue(runtime_, context_, object));
 }
 
+const HostObjectShape *
+QuickJSRuntime::getHostObjectShape(const StaticHostObject &object) {
+  const StaticHostObject::PropertyList &properties = object.properties();
+  std::unique_ptr<HostObjectShape> &shape = hostObjectShapes_[&properties];
+  if (!shape) {
+    shape = std::make_unique<HostObjectShape>();
+    for (size_t slot = 0; slot < properties.size(); slot++) {
+      JSAtom atom = JS_NewAtom(context_, properties[slot].name);
+      shape->slots.emplace(atom, (uint32_t)slot);
+      shape->atoms.push_back(atom);
+      shape->methods.push_back(properties[slot].method);
+    }
+  }
+  return shape.get();
+}
+
 std::shared_ptr<jsi::HostObject>
 QuickJSRuntime::getHostObject(const jsi::Object &object) {
   // TRACE_SCOPE("QuickJSRuntime", "object");
@@ -677,8 +781,10 @@ bool QuickJSRuntime::hasProperty(const jsi::Object &object,
   auto jsValue = JSIValueConverter::ToJSObject(*this, object);
   ScopedJSValue scopeValue(context_, &jsValue);
   auto jsName = JS_NewAtom(context_, name.utf8(*this).c_str());
+  bool result = JS_HasProperty(context_, jsValue, jsName) == TRUE;
+  JS_FreeAtom(context_, jsName);
 
-  return JS_HasProperty(context_, jsValue, jsName) == TRUE;
+  return result;
 }
 
 bool QuickJSRuntime::hasProperty(const jsi::Object &object,
@@ -687,8 +793,10 @@ bool QuickJSRuntime::hasProperty(const jsi::Object &object,
   auto jsValue = JSIValueConverter::ToJSObject(*this, object);
   ScopedJSValue scopeValue(context_, &jsValue);
   auto jsName = JS_NewAtom(context_, name.utf8(*this).c_str());
+  bool result = JS_HasProperty(context_, jsValue, jsName) == TRUE;
+  JS_FreeAtom(context_, jsName);
 
-  return JS_HasProperty(context_, jsValue, jsName) == TRUE;
+  return result;
 }
 
 void QuickJSRuntime::setPropertyValue(const jsi::Object &object,
@@ -770,13 +878,18 @@ jsi::Array QuickJSRuntime::getPropertyNames(const jsi::Object &object) {
                          JS_GPN_ENUM_ONLY | JS_GPN_STRING_MASK);
   checkAndThrowException(context_);
 
-  auto result = JS_NewArray(context_);
+  // Allocated once, then filled in place
+  auto result = JS_NewArrayFrom(context_, size, nullptr);
+  if (JS_IsException(result)) {
+    JS_FreeEnumArray(context_, names, size);
+    checkAndThrowException(context_);
+  }
   ScopedJSValue scopeResult(context_, &result);
+  JSValue *values;
+  uint32_t count;
+  JS_GetFastArray(context_, result, &values, &count);
   for (uint32_t i = 0; i < size; i++) {
-    JSValue prop = JS_AtomToValue(context_, names[i].atom);
-    // DO NOT FREE prop
-    JS_SetPropertyUint32(context_, result, i, prop);
-    checkAndThrowException(context_);
+    values[i] = JS_AtomToValue(context_, names[i].atom);
   }
 
   JS_FreeEnumArray(context_, names, size);
@@ -809,15 +922,82 @@ jsi::Value QuickJSRuntime::lockWeakObject(const jsi::WeakObject &weakObject) {
   }
 }
 
-jsi::Array QuickJSRuntime::createArray(size_t) {
+jsi::Array QuickJSRuntime::createArray(size_t length) {
   // TRACE_SCOPE("QuickJSRuntime", "array");
-  auto result = JS_NewArray(context_);
+  // The elements are preallocated (undefined) so setValueAtIndex stores in
+  // place; huge lengths only set the length
+  JSValue result;
+  if (length <= kMaxPreallocatedArrayLength) {
+    result = JS_NewArrayFrom(context_, (uint32_t)length, nullptr);
+    checkAndThrowException(context_);
+  } else {
+    result = JS_NewArray(context_);
+    checkAndThrowException(context_);
+    if (JS_SetPropertyStr(context_, result, "length",
+                          JS_NewFloat64(context_, (double)length)) < 0) {
+      JS_FreeValue(context_, result);
+      checkAndThrowException(context_);
+    }
+  }
   ScopedJSValue scopeResult(context_, &result);
 
   return make<jsi::Object>(new QuickJSPointerValue(runtime_, context_, result))
       .getArray(*this);
 }
 
+jsi::Array QuickJSRuntime::createArray(const jsi::Value *values,
+                                       size_t count) {
+  if (count > kMaxPreallocatedArrayLength) {
+    jsi::Array array = createArray(count);
+    for (size_t i = 0; i < count; i++) {
+      setValueAtIndexImpl(array, i, values[i]);
+    }
+    return array;
+  }
+
+  auto result = JS_NewArrayFrom(context_, (uint32_t)count, nullptr);
+  checkAndThrowException(context_);
+  ScopedJSValue scopeResult(context_, &result);
+  JSValue *elements;
+  uint32_t length;
+  JS_GetFastArray(context_, result, &elements, &length);
+  for (size_t i = 0; i < count; i++) {
+    // Replaces undefined, nothing to free
+    elements[i] = JSIValueConverter::ToJSValue(*this, values[i]);
+  }
+
+  return make<jsi::Object>(new QuickJSPointerValue(runtime_, context_, result))
+      .getArray(*this);
+}
+
+std::vector<jsi::Value> QuickJSRuntime::getValues(const jsi::Array &array) {
+  auto jsValue = JSIValueConverter::ToJSArray(*this, array);
+  ScopedJSValue scopeValue(context_, &jsValue);
+
+  std::vector<jsi::Value> result;
+  JSValue *elements;
+  uint32_t count;
+  if (JS_GetFastArray(context_, jsValue, &elements, &count)) {
+    // No JS runs while converting, so the storage stays put
+    result.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+      result.push_back(JSIValueConverter::ToJSIValue(*this, elements[i]));
+    }
+    return result;
+  }
+
+  // Sparse or with accessors: one property access per element
+  size_t length = size(array);
+  result.reserve(std::min(length, kMaxPreallocatedArrayLength));
+  for (size_t i = 0; i < length; i++) {
+    JSValue property = JS_GetPropertyUint32(context_, jsValue, (uint32_t)i);
+    ScopedJSValue scopeProperty(context_, &property);
+    checkAndThrowException(context_);
+    result.push_back(JSIValueConverter::ToJSIValue(*this, property));
+  }
+  return result;
+}
+
 size_t QuickJSRuntime::size(const jsi::Array &array) {
   // TRACE_SCOPE("QuickJSRuntime", "array");
   auto jsValue = JSIValueConverter::ToJSArray(*this, array);
@@ -865,6 +1045,12 @@ jsi::Value QuickJSRuntime::getValueAtIndex(const jsi::Array &array, size_t i) {
   auto jsValue = JSIValueConverter::ToJSArray(*this, array);
   ScopedJSValue scopeValue(context_, &jsValue);
 
+  JSValue *elements;
+  uint32_t count;
+  if (JS_GetFastArray(context_, jsValue, &elements, &count) && i < count) {
+    return JSIValueConverter::ToJSIValue(*this, elements[i]);
+  }
+
   JSValue property = JS_GetPropertyUint32(context_, jsValue, i);
   ScopedJSValue scopeProperty(context_, &property);
 
@@ -936,12 +1122,12 @@ jsi::Value QuickJSRuntime::call(const jsi::Function &function,
                       : JSIValueConverter::ToJSValue(*this, jsThis);
   ScopedJSValue scopedJsObject(context_, &jsObject);
 
-  JSValue *argv = new JSValue[count];
+  std::vector<JSValue> argv(count);
   for (size_t i = 0; i < count; i++) {
     argv[i] = JSIValueConverter::ToJSValue(*this, args[i]);
   }
 
-  auto result = JS_Call(context_, jsFunction, jsObject, count, argv);
+  auto result = JS_Call(context_, jsFunction, jsObject, count, argv.data());
   ScopedJSValue scopeResult(context_, &result);
 
   for (size_t i = 0; i < count; i++) {
@@ -960,12 +1146,12 @@ jsi::Value QuickJSRuntime::callAsConstructor(const jsi::Function &function,
   auto jsFunction = JSIValueConverter::ToJSFunction(*this, function);
   ScopedJSValue scopedJsFunction(context_, &jsFunction);
 
-  JSValue *argv = new JSValue[count];
+  std::vector<JSValue> argv(count);
   for (size_t i = 0; i < count; i++) {
     argv[i] = JSIValueConverter::ToJSValue(*this, args[i]);
   }
 
-  auto result = JS_CallConstructor(context_, jsFunction, count, argv);
+  auto result = JS_CallConstructor(context_, jsFunction, count, argv.data());
   ScopedJSValue scopeResult(context_, &result);
 
   for (size_t i = 0; i < count; i++) {
@@ -1090,6 +1276,7 @@ QuickJSRuntime::createArrayBuffer(std::shared_ptr<jsi::MutableBuffer> buffer) {
     delete bufferPtr; // Clean up on failure
     checkAndThrowException(context_);
   }
+  ScopedJSValue scopedJsValue(context_, &arrayBuffer);
 
   return make<jsi::ArrayBuffer>(
       new QuickJSPointerValue(runtime_, context_, arrayBuffer));
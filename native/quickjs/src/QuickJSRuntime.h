@@ -3,6 +3,7 @@
 #include <fstream>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <jsi/jsi.h>
 #include <quickjs.h>
@@ -13,6 +14,8 @@ namespace qjs {
 
 class QuickJSInstrumentation;
 class QuickJSPointerValue;
+class StaticHostObject;
+struct HostObjectShape;
 
 struct CodeCacheItem {
   enum Result { UNINITIALIZED, INITIALIZED, REQUEST_UPDATE, UPDATED };
@@ -29,8 +32,16 @@ public:
 
   std::unordered_map<std::string, int64_t> getHeapInfo();
 
+  // Bulk array access without a property access per element: an Array of
+  // `count` values allocated once in fast array storage, and all elements
+  // of an Array (read straight from its storage if it has fast storage)
+  jsi::Array createArray(const jsi::Value *values, size_t count);
+  std::vector<jsi::Value> getValues(const jsi::Array &array);
+
 private:
   void checkAndThrowException(JSContext *context) const;
+  // Atom -> slot table of a StaticHostObject class, built on first use
+  const HostObjectShape *getHostObjectShape(const StaticHostObject &object);
   void loadCodeCache(CodeCacheItem &codeCacheItem, const std::string &url,
                      const char *source, size_t size);
   void updateCodeCache(CodeCacheItem &codeCacheItem, const std::string &url,
@@ -84,6 +95,9 @@ protected:
                                            size_t length) override;
   jsi::PropNameID createPropNameIDFromString(const jsi::String &str) override;
   std::string utf8(const jsi::PropNameID &) override;
+  void getPropNameIdData(const jsi::PropNameID &, void *ctx,
+                         void (*cb)(void *ctx, bool ascii, const void *data,
+                                    size_t num)) override;
   bool compare(const jsi::PropNameID &, const jsi::PropNameID &) override;
 
   jsi::BigInt createBigIntFromInt64(int64_t) override;
@@ -94,6 +108,10 @@ protected:
   jsi::String createStringFromAscii(const char *str, size_t length) override;
   jsi::String createStringFromUtf8(const uint8_t *utf8, size_t length) override;
   std::string utf8(const jsi::String &) override;
+  // The string's own storage: no UTF-8 or UTF-16 copy is made
+  void getStringData(const jsi::String &, void *ctx,
+                     void (*cb)(void *ctx, bool ascii, const void *data,
+                                size_t num)) override;
 
   jsi::Object createObject() override;
   jsi::Object
@@ -165,6 +183,9 @@ private:
   std::string codeCacheDir_;
 
   std::unique_ptr<QuickJSInstrumentation> instrumentation_;
+  // By StaticHostObject::properties() list
+  std::unordered_map<const void *, std::unique_ptr<HostObjectShape>>
+      hostObjectShapes_;
 };
 
 } // namespace qjs
@@ -10,4 +10,30 @@ createQuickJSRuntime(const std::string &codeCacheDir) {
   return std::make_unique<QuickJSRuntime>(codeCacheDir);
 }
 
+jsi::Array createArrayFromValues(jsi::Runtime &rt, const jsi::Value *values,
+                                 size_t count) {
+  if (auto *quickJS = dynamic_cast<QuickJSRuntime *>(&rt)) {
+    return quickJS->createArray(values, count);
+  }
+  jsi::Array array(rt, count);
+  for (size_t i = 0; i < count; i++) {
+    array.setValueAtIndex(rt, i, values[i]);
+  }
+  return array;
+}
+
+std::vector<jsi::Value> getArrayValues(jsi::Runtime &rt,
+                                       const jsi::Array &array) {
+  if (auto *quickJS = dynamic_cast<QuickJSRuntime *>(&rt)) {
+    return quickJS->getValues(array);
+  }
+  size_t length = array.size(rt);
+  std::vector<jsi::Value> values;
+  values.reserve(length);
+  for (size_t i = 0; i < length; i++) {
+    values.push_back(array.getValueAtIndex(rt, i));
+  }
+  return values;
+}
+
 } // namespace qjs
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory.h>
+#include <vector>
 
 #include <jsi/jsi.h>
 
@@ -11,4 +12,12 @@ namespace qjs {
 std::unique_ptr<jsi::Runtime>
 createQuickJSRuntime(const std::string &codeCacheDir);
 
+// Build an Array from `count` values, and read all elements of an Array.
+// A runtime from createQuickJSRuntime does either in one step over fast
+// array storage; other runtimes go element by element.
+jsi::Array createArrayFromValues(jsi::Runtime &rt, const jsi::Value *values,
+                                 size_t count);
+std::vector<jsi::Value> getArrayValues(jsi::Runtime &rt,
+                                       const jsi::Array &array);
+
 } // namespace qjs
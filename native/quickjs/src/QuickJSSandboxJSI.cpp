@@ -1,12 +1,153 @@
 #include "QuickJSSandboxJSI.h"
+#include "ConsoleShim.h"
+#include "MappedFile.h"
+#include "NodeTreeStore.h"
+#include "QuickJSInstrumentation.h"
+#include "QuickJSRuntimeFactory.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <sstream>
 
 namespace quickjs_sandbox {
 
-// Static counter for sandbox functions
-static int g_sandboxFuncCounter = 0;
+// Static counter for sandbox functions; contexts on HeadlessHostPool
+// workers bump it concurrently
+static std::atomic<uint64_t> g_sandboxFuncCounter{0};
+
+// Default number of host objects kept by a context's conversion memo
+static constexpr size_t kDefaultConversionMemoSize = 1024;
+
+// Default size of a context's guest -> host message ring
+static constexpr size_t kDefaultMessageRingBytes = 256 * 1024;
+
+// Most elements reserved up front when converting a guest array; its
+// length may be set far beyond the elements it holds
+static constexpr uint32_t kMaxReservedElements = 64 * 1024;
+
+// MARK: - Size Estimation
+
+// Deeper values are treated like JSON.stringify cycles
+static constexpr int kMaxEstimateDepth = 256;
+
+// Length of a number as JSON.stringify prints it. Integers are exact;
+// other values assume a typical shortest round-trip form.
+static size_t estimateNumberBytes(double num) {
+  if (!std::isfinite(num)) {
+    return 4; // null
+  }
+  size_t sign = num < 0 ? 1 : 0;
+  double mag = std::fabs(num);
+  if (mag == std::floor(mag) && mag < 1e21) {
+    size_t digits = 1;
+    for (; mag >= 10; mag /= 10) {
+      digits++;
+    }
+    return sign + digits;
+  }
+  return sign + 18;
+}
+
+// Values JSON.stringify drops from objects (and writes as null in arrays)
+static bool isOmittedByJSON(JSContext *ctx, JSValueConst value) {
+  return JS_IsUndefined(value) || JS_IsSymbol(value) ||
+         JS_IsFunction(ctx, value);
+}
+
+static bool isOmittedByJSON(jsi::Runtime &rt, const jsi::Value &value) {
+  return value.isUndefined() || value.isSymbol() ||
+         (value.isObject() && value.getObject(rt).isFunction(rt));
+}
+
+// UTF-8 length of a host string, read in place through getStringData()
+// (a surrogate pair counts 4, a lone surrogate 2)
+static size_t utf8Length(jsi::Runtime &rt, const jsi::String &str) {
+  size_t bytes = 0;
+  auto count = [&bytes](bool ascii, const void *data, size_t num) {
+    if (ascii) {
+      bytes += num;
+      return;
+    }
+    const char16_t *units = static_cast<const char16_t *>(data);
+    for (size_t i = 0; i < num; i++) {
+      char16_t c = units[i];
+      bytes += c < 0x80 ? 1 : c < 0x800 || (c >= 0xd800 && c < 0xe000) ? 2 : 3;
+    }
+  };
+  str.getStringData(rt, count);
+  return bytes;
+}
+
+static void estimateValue(jsi::Runtime &rt, const jsi::Value &value,
+                          SizeEstimate &est, int depth) {
+  if (value.isNull()) {
+    est.bytes += 4;
+  } else if (value.isBool()) {
+    est.bytes += value.getBool() ? 4 : 5;
+  } else if (value.isNumber()) {
+    est.bytes += estimateNumberBytes(value.getNumber());
+  } else if (value.isString()) {
+    est.bytes += utf8Length(rt, value.getString(rt)) + 2;
+    est.strings++;
+  } else if (value.isObject()) {
+    if (depth >= kMaxEstimateDepth) {
+      throw jsi::JSError(rt, "estimateSize: value is nested too deeply");
+    }
+    jsi::Object obj = value.getObject(rt);
+    if (obj.isFunction(rt)) {
+      return;
+    }
+    est.objects++;
+    est.bytes += 2;
+    if (obj.isArray(rt)) {
+      jsi::Array arr = obj.getArray(rt);
+      size_t len = arr.size(rt);
+      for (size_t i = 0; i < len; i++) {
+        jsi::Value elem = arr.getValueAtIndex(rt, i);
+        if (isOmittedByJSON(rt, elem)) {
+          est.bytes += 4;
+        } else {
+          estimateValue(rt, elem, est, depth + 1);
+        }
+      }
+      est.bytes += len ? len - 1 : 0;
+      return;
+    }
+    jsi::Array names = obj.getPropertyNames(rt);
+    size_t len = names.size(rt);
+    size_t members = 0;
+    for (size_t i = 0; i < len; i++) {
+      jsi::String key = names.getValueAtIndex(rt, i).getString(rt);
+      jsi::Value prop = obj.getProperty(rt, key);
+      if (isOmittedByJSON(rt, prop)) {
+        continue;
+      }
+      est.bytes += utf8Length(rt, key) + 3; // "key":
+      estimateValue(rt, prop, est, depth + 1);
+      members++;
+    }
+    est.bytes += members ? members - 1 : 0;
+  }
+}
+
+SizeEstimate estimateSize(jsi::Runtime &rt, const jsi::Value &value) {
+  SizeEstimate est;
+  estimateValue(rt, value, est, 0);
+  return est;
+}
+
+static jsi::Value sizeEstimateToJSI(jsi::Runtime &rt,
+                                    const SizeEstimate &est) {
+  jsi::Object result(rt);
+  result.setProperty(rt, "bytes", (double)est.bytes);
+  result.setProperty(rt, "objects", (double)est.objects);
+  result.setProperty(rt, "strings", (double)est.strings);
+  return result;
+}
 
 // Static members for HostFunctionData class
 JSClassID QuickJSSandboxContext::hostFunctionDataClassID_ = 0;
@@ -20,6 +161,7 @@ void QuickJSSandboxContext::hostFunctionDataFinalizer(JSRuntime *rt,
     // Remove from callbacks map if context still exists
     if (data->self && !data->self->disposed_) {
       data->self->callbacks_.erase(data->callbackId);
+      data->self->boundary_.functionsReleased++;
     }
     delete data;
   }
@@ -45,21 +187,39 @@ void QuickJSSandboxContext::ensureClassRegistered() {
 
 // MARK: - QuickJSSandboxContext Implementation
 
+// Guest global telling whether frozen objects are memoized, so the SDK
+// only freezes styles when that makes them reusable
+static void defineMemoFlag(JSContext *ctx, bool enabled) {
+  JSValue global = JS_GetGlobalObject(ctx);
+  JS_DefinePropertyValueStr(ctx, global, "__rill_conversion_memo",
+                            JS_NewBool(ctx, enabled),
+                            JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE);
+  JS_FreeValue(ctx, global);
+}
+
 QuickJSSandboxContext::QuickJSSandboxContext(jsi::Runtime &hostRuntime,
                                              JSRuntime *qjsRuntime,
-                                             double /* timeout */)
+                                             double /* timeout */,
+                                             bool lazyIntrinsics)
     : qjsContext_(nullptr), qjsRuntime_(qjsRuntime), hostRuntime_(&hostRuntime),
-      disposed_(false), callbackCounter_(0) {
-  qjsContext_ = JS_NewContext(qjsRuntime_);
+      disposed_(false), callbackCounter_(0), operationSink_(JS_UNDEFINED),
+      memoCapacity_(kDefaultConversionMemoSize), mutableConversions_(0),
+      toGuestDepth_(0), toHostDepth_(0) {
+  qjsContext_ = lazyIntrinsics ? JS_NewContextLazy(qjsRuntime_)
+                               : JS_NewContext(qjsRuntime_);
   if (!qjsContext_) {
     throw jsi::JSError(hostRuntime, "Failed to create QuickJS context");
   }
+  JS_SetContextOpaque(qjsContext_, this);
 
   // Register the class for HostFunctionData
   ensureClassRegistered();
 
   // Install console
   installConsole();
+  installPerformance();
+  installOperations();
+  defineMemoFlag(qjsContext_, memoCapacity_ != 0);
 }
 
 QuickJSSandboxContext::~QuickJSSandboxContext() { dispose(); }
@@ -71,36 +231,22 @@ void QuickJSSandboxContext::dispose() {
   disposed_ = true;
 
   callbacks_.clear();
+  coalescer_.reset();
+  operations_.reset();
+  operationSinkFunc_.reset();
+  hostEvents_.clear();
+  eventScratch_.clear();
+  clearMemo();
 
   if (qjsContext_) {
+    JS_FreeValue(qjsContext_, operationSink_);
+    operationSink_ = JS_UNDEFINED;
     JS_FreeContext(qjsContext_);
     qjsContext_ = nullptr;
   }
 }
 
 void QuickJSSandboxContext::installConsole() {
-  const char *consoleScript = R"(
-        var console = {
-            log: function() {
-                var args = Array.prototype.slice.call(arguments);
-                __qjs_print(args.map(function(a) {
-                    if (typeof a === 'object') return JSON.stringify(a);
-                    return String(a);
-                }).join(' '));
-            },
-            warn: function() { console.log('[WARN]', ...arguments); },
-            error: function() { console.log('[ERROR]', ...arguments); },
-            info: function() { console.log('[INFO]', ...arguments); },
-            debug: function() { console.log('[DEBUG]', ...arguments); },
-            assert: function(cond) { if (!cond) console.log('[ASSERT]', ...Array.prototype.slice.call(arguments, 1)); },
-            trace: function() {},
-            time: function() {},
-            timeEnd: function() {},
-            group: function() {},
-            groupEnd: function() {}
-        };
-    )";
-
   // Install native print function
   JSValue global = JS_GetGlobalObject(qjsContext_);
 
@@ -121,12 +267,561 @@ void QuickJSSandboxContext::installConsole() {
 
   JS_FreeValue(qjsContext_, global);
 
-  // Run console setup script
-  JSValue result = JS_Eval(qjsContext_, consoleScript, strlen(consoleScript),
-                           "<console>", JS_EVAL_TYPE_GLOBAL);
+  // Run console setup script, precompiled when the build embedded it
+  JSValue result;
+  const BootstrapScript *script = findBootstrapScript("console");
+  if (!script || !evalBootstrapScript(qjsContext_, *script, &result)) {
+    result = JS_Eval(qjsContext_, kConsoleShimSource,
+                     sizeof(kConsoleShimSource) - 1, "<console>",
+                     JS_EVAL_TYPE_GLOBAL);
+  }
   JS_FreeValue(qjsContext_, result);
 }
 
+enum class GuestTiming : int {
+  Now,
+  Mark,
+  Measure,
+  ClearMarks,
+  Time,
+  TimeLog,
+  TimeEnd,
+};
+
+void QuickJSSandboxContext::installPerformance() {
+  struct TimingFunction {
+    const char *name;
+    int length;
+    GuestTiming timing;
+  };
+  static const TimingFunction kPerformance[] = {
+      {"now", 0, GuestTiming::Now},
+      {"mark", 1, GuestTiming::Mark},
+      {"measure", 1, GuestTiming::Measure},
+      {"clearMarks", 0, GuestTiming::ClearMarks},
+  };
+  static const TimingFunction kConsole[] = {
+      {"time", 0, GuestTiming::Time},
+      {"timeLog", 0, GuestTiming::TimeLog},
+      {"timeEnd", 0, GuestTiming::TimeEnd},
+  };
+  auto define = [this](JSValueConst target, const TimingFunction &fn) {
+    JS_SetPropertyStr(qjsContext_, target, fn.name,
+                      JS_NewCFunctionMagic(qjsContext_, guestTiming, fn.name,
+                                           fn.length, JS_CFUNC_generic_magic,
+                                           (int)fn.timing));
+  };
+
+  JSValue global = JS_GetGlobalObject(qjsContext_);
+  JSValue performance = JS_NewObject(qjsContext_);
+  for (const TimingFunction &fn : kPerformance) {
+    define(performance, fn);
+  }
+  JS_SetPropertyStr(qjsContext_, performance, "timeOrigin",
+                    JS_NewFloat64(qjsContext_, trace_.timeOrigin()));
+  JS_SetPropertyStr(qjsContext_, global, "performance", performance);
+
+  JSValue console = JS_GetPropertyStr(qjsContext_, global, "console");
+  if (JS_IsObject(console)) {
+    for (const TimingFunction &fn : kConsole) {
+      define(console, fn);
+    }
+  }
+  JS_FreeValue(qjsContext_, console);
+  JS_FreeValue(qjsContext_, global);
+}
+
+namespace {
+
+// A mark or timer name given by the guest, as UTF-8 for the call
+class TraceName {
+public:
+  explicit TraceName(JSContext *ctx) : ctx_(ctx) {}
+  ~TraceName() { JS_FreeCString(ctx_, text_); }
+
+  TraceName(const TraceName &) = delete;
+  TraceName &operator=(const TraceName &) = delete;
+
+  // `value` as a string, or `fallback` when it is undefined (none: a
+  // TypeError)
+  bool read(JSValueConst value, const char *fallback) {
+    if (JS_IsUndefined(value) && fallback) {
+      view_ = fallback;
+      return true;
+    }
+    if (JS_IsUndefined(value)) {
+      JS_ThrowTypeError(ctx_, "name is required");
+      return false;
+    }
+    size_t length;
+    text_ = JS_ToCStringLen(ctx_, &length, value);
+    if (!text_) {
+      return false;
+    }
+    view_ = std::string_view(text_, length);
+    return true;
+  }
+
+  std::string_view view() const { return view_; }
+
+private:
+  JSContext *ctx_;
+  const char *text_ = nullptr;
+  std::string_view view_;
+};
+
+// A measure() start or end: a timestamp, or the name of a mark
+bool traceTime(JSContext *ctx, TraceBuffer &trace, JSValueConst value,
+               double *time) {
+  if (JS_IsNumber(value)) {
+    return JS_ToFloat64(ctx, time, value) == 0;
+  }
+  TraceName name(ctx);
+  if (!name.read(value, nullptr)) {
+    return false;
+  }
+  // Looked up only: an unknown name is not kept
+  if (!trace.markTime(trace.find(name.view()), time)) {
+    JS_ThrowSyntaxError(ctx, "The mark '%.*s' does not exist",
+                        (int)name.view().size(), name.view().data());
+    return false;
+  }
+  return true;
+}
+
+// Optional property of an options object, freed by the caller
+JSValue traceOption(JSContext *ctx, JSValueConst options, const char *name) {
+  return JS_IsObject(options) ? JS_GetPropertyStr(ctx, options, name)
+                              : JS_UNDEFINED;
+}
+
+// Call console[method](message, ...rest) on `console` (the global console
+// when the timer function was called detached)
+JSValue consoleReport(JSContext *ctx, JSValueConst console, const char *method,
+                      const std::string &message, int restCount,
+                      JSValueConst *rest) {
+  JSValue target;
+  if (JS_IsObject(console)) {
+    target = JS_DupValue(ctx, console);
+  } else {
+    JSValue global = JS_GetGlobalObject(ctx);
+    target = JS_GetPropertyStr(ctx, global, "console");
+    JS_FreeValue(ctx, global);
+  }
+  JSValue fn = JS_GetPropertyStr(ctx, target, method);
+  JSValue result = JS_UNDEFINED;
+  if (JS_IsFunction(ctx, fn)) {
+    std::vector<JSValueConst> args;
+    args.reserve(restCount + 1);
+    JSValue text = JS_NewStringLen(ctx, message.data(), message.size());
+    args.push_back(text);
+    args.insert(args.end(), rest, rest + restCount);
+    result = JS_Call(ctx, fn, target, (int)args.size(), args.data());
+    JS_FreeValue(ctx, text);
+  }
+  JS_FreeValue(ctx, fn);
+  JS_FreeValue(ctx, target);
+  if (JS_IsException(result)) {
+    return result;
+  }
+  JS_FreeValue(ctx, result);
+  return JS_UNDEFINED;
+}
+
+} // namespace
+
+// Guest side of performance and the console timers: runs on the thread
+// evaluating guest code, which holds the context lock
+JSValue QuickJSSandboxContext::guestTiming(JSContext *ctx,
+                                           JSValueConst this_val, int argc,
+                                           JSValueConst *argv, int magic) {
+  auto *self = static_cast<QuickJSSandboxContext *>(JS_GetContextOpaque(ctx));
+  if (!self) {
+    return JS_ThrowInternalError(ctx, "Context has been disposed");
+  }
+  TraceBuffer &trace = self->trace_;
+  JSValueConst arg0 = argc > 0 ? argv[0] : JS_UNDEFINED;
+  JSValueConst arg1 = argc > 1 ? argv[1] : JS_UNDEFINED;
+  TraceName name(ctx);
+
+  switch (static_cast<GuestTiming>(magic)) {
+  case GuestTiming::Now:
+    return JS_NewFloat64(ctx, trace.now());
+
+  case GuestTiming::Mark: {
+    if (!name.read(arg0, nullptr)) {
+      return JS_EXCEPTION;
+    }
+    double startTime = trace.now();
+    JSValue option = traceOption(ctx, arg1, "startTime");
+    bool ok = JS_IsUndefined(option) ||
+              JS_ToFloat64(ctx, &startTime, option) == 0;
+    JS_FreeValue(ctx, option);
+    if (!ok) {
+      return JS_EXCEPTION;
+    }
+    trace.mark(trace.intern(name.view()), startTime);
+    return JS_UNDEFINED;
+  }
+
+  case GuestTiming::Measure: {
+    if (!name.read(arg0, nullptr)) {
+      return JS_EXCEPTION;
+    }
+    // measure(name, startMark?, endMark?) or
+    // measure(name, { start?, end?, duration? })
+    JSValue start, end, duration;
+    if (JS_IsObject(arg1)) {
+      start = traceOption(ctx, arg1, "start");
+      end = traceOption(ctx, arg1, "end");
+      duration = traceOption(ctx, arg1, "duration");
+    } else {
+      start = JS_DupValue(ctx, arg1);
+      end = argc > 2 ? JS_DupValue(ctx, argv[2]) : JS_UNDEFINED;
+      duration = JS_UNDEFINED;
+    }
+    double startTime = 0, endTime = 0, length = NAN;
+    bool ok = (JS_IsUndefined(start) ||
+               traceTime(ctx, trace, start, &startTime)) &&
+              (JS_IsUndefined(end) || traceTime(ctx, trace, end, &endTime)) &&
+              (JS_IsUndefined(duration) ||
+               JS_ToFloat64(ctx, &length, duration) == 0);
+    if (ok) {
+      if (JS_IsUndefined(end)) {
+        endTime = !JS_IsUndefined(start) && !std::isnan(length)
+                      ? startTime + length
+                      : trace.now();
+      }
+      if (JS_IsUndefined(start) && !std::isnan(length)) {
+        startTime = endTime - length;
+      }
+      trace.measure(trace.intern(name.view()), startTime, endTime);
+    }
+    JS_FreeValue(ctx, start);
+    JS_FreeValue(ctx, end);
+    JS_FreeValue(ctx, duration);
+    return ok ? JS_UNDEFINED : JS_EXCEPTION;
+  }
+
+  case GuestTiming::ClearMarks:
+    if (JS_IsUndefined(arg0)) {
+      trace.clearMarks();
+    } else if (name.read(arg0, nullptr)) {
+      trace.clearMark(trace.find(name.view()));
+    } else {
+      return JS_EXCEPTION;
+    }
+    return JS_UNDEFINED;
+
+  case GuestTiming::Time:
+  case GuestTiming::TimeLog:
+  case GuestTiming::TimeEnd: {
+    if (!name.read(arg0, "default")) {
+      return JS_EXCEPTION;
+    }
+    std::string label(name.view());
+    auto timing = static_cast<GuestTiming>(magic);
+    double ms = 0;
+    if (timing == GuestTiming::Time) {
+      if (trace.startTimer(trace.intern(label))) {
+        return JS_UNDEFINED;
+      }
+      return consoleReport(ctx, this_val, "warn",
+                           "Timer '" + label + "' already exists", 0,
+                           nullptr);
+    }
+    uint32_t timer = trace.find(label);
+    bool running = timing == GuestTiming::TimeLog
+                       ? trace.timerElapsed(timer, &ms)
+                       : trace.endTimer(timer, &ms);
+    if (!running) {
+      return consoleReport(ctx, this_val, "warn",
+                           "Timer '" + label + "' does not exist", 0,
+                           nullptr);
+    }
+    char elapsed[32];
+    std::snprintf(elapsed, sizeof(elapsed), ": %.3fms", ms);
+    // timeLog(label, ...data) passes the data along
+    int restCount = timing == GuestTiming::TimeLog && argc > 1 ? argc - 1 : 0;
+    return consoleReport(ctx, this_val, "log", label + elapsed, restCount,
+                         argv + 1);
+  }
+  }
+  return JS_UNDEFINED;
+}
+
+enum class GuestOperation : int {
+  Create,
+  Update,
+  Delete,
+  Append,
+  Insert,
+  Remove,
+  Push,
+  Pending,
+  Counts,
+  Commit,
+};
+
+void QuickJSSandboxContext::installOperations() {
+  struct OperationFunction {
+    const char *name;
+    int length;
+    GuestOperation operation;
+  };
+  static const OperationFunction kOperations[] = {
+      {"__rill_op_create", 3, GuestOperation::Create},
+      {"__rill_op_update", 3, GuestOperation::Update},
+      {"__rill_op_delete", 1, GuestOperation::Delete},
+      {"__rill_op_append", 2, GuestOperation::Append},
+      {"__rill_op_insert", 3, GuestOperation::Insert},
+      {"__rill_op_remove", 2, GuestOperation::Remove},
+      {"__rill_op_push", 1, GuestOperation::Push},
+      {"__rill_op_pending", 0, GuestOperation::Pending},
+      {"__rill_op_counts", 0, GuestOperation::Counts},
+      {"__rill_op_commit", 3, GuestOperation::Commit},
+  };
+  operations_ = std::make_unique<OperationArena>(qjsContext_);
+
+  JSValue global = JS_GetGlobalObject(qjsContext_);
+  for (const OperationFunction &fn : kOperations) {
+    JS_SetPropertyStr(qjsContext_, global, fn.name,
+                      JS_NewCFunctionMagic(qjsContext_, guestOperation,
+                                           fn.name, fn.length,
+                                           JS_CFUNC_generic_magic,
+                                           (int)fn.operation));
+  }
+  JS_FreeValue(qjsContext_, global);
+}
+
+// Guest side of the reconciler's operation arena; like guestTiming(), runs
+// with the context lock held
+JSValue QuickJSSandboxContext::guestOperation(JSContext *ctx,
+                                              JSValueConst this_val, int argc,
+                                              JSValueConst *argv, int magic) {
+  (void)this_val;
+  auto *self = static_cast<QuickJSSandboxContext *>(JS_GetContextOpaque(ctx));
+  if (!self || !self->operations_) {
+    return JS_ThrowInternalError(ctx, "Context has been disposed");
+  }
+  OperationArena &arena = *self->operations_;
+  auto arg = [&](int i) { return i < argc ? argv[i] : JS_UNDEFINED; };
+  // Numeric arguments, in order
+  double numbers[3];
+  auto toNumbers = [&](int count) {
+    for (int i = 0; i < count; i++) {
+      if (JS_ToFloat64(ctx, &numbers[i], arg(i)) != 0) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  switch (static_cast<GuestOperation>(magic)) {
+  case GuestOperation::Create:
+    if (!toNumbers(1)) {
+      return JS_EXCEPTION;
+    }
+    arena.create(numbers[0], arg(1), arg(2));
+    return JS_UNDEFINED;
+
+  case GuestOperation::Update:
+    if (!toNumbers(1)) {
+      return JS_EXCEPTION;
+    }
+    arena.update(numbers[0], arg(1), arg(2));
+    return JS_UNDEFINED;
+
+  case GuestOperation::Delete:
+    if (!toNumbers(1)) {
+      return JS_EXCEPTION;
+    }
+    arena.deleteNode(numbers[0]);
+    return JS_UNDEFINED;
+
+  case GuestOperation::Append:
+  case GuestOperation::Remove:
+    if (!toNumbers(2)) {
+      return JS_EXCEPTION;
+    }
+    arena.link(static_cast<GuestOperation>(magic) == GuestOperation::Append
+                   ? OperationArena::Kind::Append
+                   : OperationArena::Kind::Remove,
+               numbers[0], numbers[1]);
+    return JS_UNDEFINED;
+
+  case GuestOperation::Insert:
+    if (!toNumbers(3)) {
+      return JS_EXCEPTION;
+    }
+    arena.link(OperationArena::Kind::Insert, numbers[0], numbers[1],
+               numbers[2]);
+    return JS_UNDEFINED;
+
+  case GuestOperation::Push:
+    if (!JS_IsObject(arg(0))) {
+      return JS_ThrowTypeError(ctx, "operation must be an object");
+    }
+    arena.push(arg(0));
+    return JS_UNDEFINED;
+
+  case GuestOperation::Pending:
+    return JS_NewUint32(ctx, (uint32_t)arena.size());
+
+  case GuestOperation::Counts:
+    return arena.counts();
+
+  case GuestOperation::Commit: {
+    double version = 1, batchId = 0;
+    if (!JS_IsFunction(ctx, arg(0))) {
+      return JS_ThrowTypeError(ctx, "sink must be a function");
+    }
+    if (JS_ToFloat64(ctx, &version, arg(1)) != 0 ||
+        JS_ToFloat64(ctx, &batchId, arg(2)) != 0) {
+      return JS_EXCEPTION;
+    }
+    return self->commitOperations(arg(0), version, batchId);
+  }
+  }
+  return JS_UNDEFINED;
+}
+
+JSValue QuickJSSandboxContext::commitOperations(JSValueConst sink,
+                                                double version,
+                                                double batchId) {
+  OperationArena &arena = *operations_;
+  uint32_t count = (uint32_t)arena.size();
+  if (count == 0) {
+    return JS_NewUint32(qjsContext_, 0);
+  }
+
+  // The arena is emptied before the sink runs, so operations it records
+  // (a render triggered by the host) go to the next commit
+  if (!operationSinkFunc_ || !JS_IsObject(operationSink_) ||
+      JS_VALUE_GET_PTR(sink) != JS_VALUE_GET_PTR(operationSink_)) {
+    JSValue batch = arena.buildBatch(version, batchId);
+    arena.clear();
+    JSValue result = JS_Call(qjsContext_, sink, JS_UNDEFINED, 1, &batch);
+    JS_FreeValue(qjsContext_, batch);
+    if (JS_IsException(result)) {
+      return result;
+    }
+    JS_FreeValue(qjsContext_, result);
+    return JS_NewUint32(qjsContext_, count);
+  }
+
+  jsi::Runtime &rt = *hostRuntime_;
+  std::shared_ptr<jsi::Function> func = operationSinkFunc_;
+  BoundaryStats::CallScope callScope(boundary_.hostCalls);
+  try {
+    using Clock = std::chrono::steady_clock;
+    auto t0 = Clock::now();
+    jsi::Object batch = [&] {
+      // Also empty the arena when a conversion throws
+      struct ClearScope {
+        OperationArena &arena;
+        ~ClearScope() { arena.clear(); }
+      } clearScope{arena};
+      return operationBatchToJSI(rt, version, batchId);
+    }();
+    if (coalescer_) {
+      coalescer_->record(count, count, 0,
+                         std::chrono::duration<double, std::milli>(
+                             Clock::now() - t0)
+                             .count());
+    }
+    func->call(rt, std::move(batch));
+    return JS_NewUint32(qjsContext_, count);
+  } catch (const std::exception &e) {
+    return JS_ThrowInternalError(qjsContext_, "%s", e.what());
+  }
+}
+
+jsi::Object QuickJSSandboxContext::operationBatchToJSI(jsi::Runtime &rt,
+                                                       double version,
+                                                       double batchId) {
+  // The whole batch is one crossing
+  BoundaryStats::ConversionScope scope(boundary_.toHost, toHostDepth_);
+  using Kind = OperationArena::Kind;
+  const OperationArena &arena = *operations_;
+  const std::vector<OperationArena::Op> &ops = arena.ops();
+
+  auto name = [&](const char *text) {
+    return jsi::PropNameID::forAscii(rt, text);
+  };
+  jsi::PropNameID opName = name("op"), idName = name("id"),
+                  typeName = name("type"), propsName = name("props"),
+                  removedPropsName = name("removedProps"),
+                  parentIdName = name("parentId"),
+                  childIdName = name("childId"), indexName = name("index");
+  std::vector<jsi::String> kinds;
+  kinds.reserve(OperationArena::kKindCount - 1);
+  for (size_t k = 0; k + 1 < OperationArena::kKindCount; k++) {
+    kinds.push_back(jsi::String::createFromAscii(
+        rt, OperationArena::kindName(static_cast<Kind>(k))));
+  }
+  // Element types repeat: convert each guest string once per batch
+  std::vector<std::pair<void *, jsi::Value>> types;
+
+  jsi::Array list(rt, ops.size());
+  for (size_t i = 0; i < ops.size(); i++) {
+    const OperationArena::Op &op = ops[i];
+    if (op.kind == Kind::Other) {
+      list.setValueAtIndex(rt, i, qjsToJSI(rt, arena.value(op.value)));
+      continue;
+    }
+    jsi::Object item(rt);
+    item.setProperty(rt, opName, jsi::Value(rt, kinds[(size_t)op.kind]));
+    item.setProperty(rt, idName, op.id);
+    switch (op.kind) {
+    case Kind::Create: {
+      JSValueConst type = arena.value(op.value);
+      if (JS_IsString(type)) {
+        void *key = JS_VALUE_GET_PTR(type);
+        auto cached = std::find_if(
+            types.begin(), types.end(),
+            [&](const auto &entry) { return entry.first == key; });
+        if (cached == types.end()) {
+          types.emplace_back(key, qjsToJSI(rt, type));
+          cached = types.end() - 1;
+        }
+        item.setProperty(rt, typeName, jsi::Value(rt, cached->second));
+      } else {
+        item.setProperty(rt, typeName, qjsToJSI(rt, type));
+      }
+      item.setProperty(rt, propsName, qjsToJSI(rt, arena.value(op.value + 1)));
+      break;
+    }
+    case Kind::Update: {
+      item.setProperty(rt, propsName, qjsToJSI(rt, arena.value(op.value)));
+      JSValueConst removedProps = arena.value(op.value + 1);
+      if (!JS_IsUndefined(removedProps)) {
+        item.setProperty(rt, removedPropsName, qjsToJSI(rt, removedProps));
+      }
+      break;
+    }
+    case Kind::Append:
+    case Kind::Insert:
+    case Kind::Remove:
+      item.setProperty(rt, parentIdName, op.parentId);
+      item.setProperty(rt, childIdName, op.id);
+      if (op.kind == Kind::Insert) {
+        item.setProperty(rt, indexName, op.index);
+      }
+      break;
+    default:
+      break;
+    }
+    list.setValueAtIndex(rt, i, std::move(item));
+  }
+
+  jsi::Object batch(rt);
+  batch.setProperty(rt, "version", version);
+  batch.setProperty(rt, "batchId", batchId);
+  batch.setProperty(rt, "operations", std::move(list));
+  return batch;
+}
+
 void QuickJSSandboxContext::checkException() {
   JSValue exception = JS_GetException(qjsContext_);
   if (!JS_IsNull(exception) && !JS_IsUndefined(exception)) {
@@ -140,26 +835,143 @@ void QuickJSSandboxContext::checkException() {
   JS_FreeValue(qjsContext_, exception);
 }
 
-jsi::Value QuickJSSandboxContext::get(jsi::Runtime &rt,
-                                      const jsi::PropNameID &name) {
-  std::string propName = name.utf8(rt);
+// Properties of a context, in getPropertyNames() order; ContextSlot
+// indexes them
+static const qjs::StaticHostObject::PropertyList kContextProperties = {
+    {"eval", true},
+    {"evalBuffer", true},
+    {"evalFile", true},
+    {"createBundleStream", true},
+    {"setGlobal", true},
+    {"getGlobal", true},
+    {"estimateSize", true},
+    {"setOperationSink", true},
+    {"getCoalescingStats", true},
+    {"getConversionStats", true},
+    {"openMessageRing", true},
+    {"drainMessages", true},
+    {"getMessageRingStats", true},
+    {"setHostEventPolicy", true},
+    {"queueHostEvent", true},
+    {"flushHostEvents", true},
+    {"getHostEventStats", true},
+    {"getBoundaryStats", true},
+    {"resetBoundaryStats", true},
+    {"drainTrace", true},
+    {"getTraceStats", true},
+    {"dispose", true},
+    {"isDisposed", false},
+};
+
+enum class ContextSlot : size_t {
+  Eval,
+  EvalBuffer,
+  EvalFile,
+  CreateBundleStream,
+  SetGlobal,
+  GetGlobal,
+  EstimateSize,
+  SetOperationSink,
+  GetCoalescingStats,
+  GetConversionStats,
+  OpenMessageRing,
+  DrainMessages,
+  GetMessageRingStats,
+  SetHostEventPolicy,
+  QueueHostEvent,
+  FlushHostEvents,
+  GetHostEventStats,
+  GetBoundaryStats,
+  ResetBoundaryStats,
+  DrainTrace,
+  GetTraceStats,
+  Dispose,
+  IsDisposed,
+};
+
+const qjs::StaticHostObject::PropertyList &
+QuickJSSandboxContext::properties() const {
+  return kContextProperties;
+}
 
-  if (propName == "eval") {
+jsi::Value QuickJSSandboxContext::getSlot(jsi::Runtime &rt, size_t slot) {
+  switch (static_cast<ContextSlot>(slot)) {
+  case ContextSlot::Eval: {
     return jsi::Function::createFromHostFunction(
-        rt, name, 1,
+        rt, propertyName(rt, slot), 1,
         [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
                size_t count) -> jsi::Value {
           if (count < 1 || !args[0].isString()) {
             throw jsi::JSError(rt, "eval requires a string argument");
           }
           std::string code = args[0].asString(rt).utf8(rt);
+          if (count > 1 && args[1].isString()) {
+            std::string sourceURL = args[1].asString(rt).utf8(rt);
+            return this->eval(rt, code, sourceURL.c_str());
+          }
           return this->eval(rt, code);
         });
   }
 
-  if (propName == "setGlobal") {
+  case ContextSlot::EvalBuffer: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 2,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (count < 1 || !args[0].isObject() ||
+              !args[0].getObject(rt).isArrayBuffer(rt)) {
+            throw jsi::JSError(rt, "evalBuffer requires an ArrayBuffer");
+          }
+          jsi::ArrayBuffer buffer = args[0].getObject(rt).getArrayBuffer(rt);
+          std::string sourceURL = count > 1 && args[1].isString()
+                                      ? args[1].asString(rt).utf8(rt)
+                                      : "<eval>";
+          return this->evalBuffer(rt, buffer.data(rt), buffer.size(rt),
+                                  sourceURL.c_str());
+        });
+  }
+
+  case ContextSlot::EvalFile: {
     return jsi::Function::createFromHostFunction(
-        rt, name, 2,
+        rt, propertyName(rt, slot), 2,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (count < 1 || !args[0].isString()) {
+            throw jsi::JSError(rt, "evalFile requires a path");
+          }
+          std::string path = args[0].asString(rt).utf8(rt);
+          std::string sourceURL = count > 1 && args[1].isString()
+                                      ? args[1].asString(rt).utf8(rt)
+                                      : path;
+          return this->evalFile(rt, path, sourceURL.c_str());
+        });
+  }
+
+  case ContextSlot::CreateBundleStream: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 2,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (disposed_) {
+            throw jsi::JSError(rt, "Context has been disposed");
+          }
+          std::string sourceURL = "<bundle>";
+          if (count > 0 && args[0].isString()) {
+            sourceURL = args[0].getString(rt).utf8(rt);
+          }
+          size_t expectedBytes = 0;
+          if (count > 1 && args[1].isNumber() && args[1].asNumber() > 0) {
+            expectedBytes = (size_t)args[1].asNumber();
+          }
+          return jsi::Object::createFromHostObject(
+              rt, std::make_shared<QuickJSBundleStream>(
+                      shared_from_this(), sourceURL, expectedBytes));
+        });
+  }
+
+  case ContextSlot::SetGlobal: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 2,
         [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
                size_t count) -> jsi::Value {
           if (count < 2 || !args[0].isString()) {
@@ -172,9 +984,9 @@ jsi::Value QuickJSSandboxContext::get(jsi::Runtime &rt,
         });
   }
 
-  if (propName == "getGlobal") {
+  case ContextSlot::GetGlobal: {
     return jsi::Function::createFromHostFunction(
-        rt, name, 1,
+        rt, propertyName(rt, slot), 1,
         [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
                size_t count) -> jsi::Value {
           if (count < 1 || !args[0].isString()) {
@@ -185,9 +997,193 @@ jsi::Value QuickJSSandboxContext::get(jsi::Runtime &rt,
         });
   }
 
-  if (propName == "dispose") {
+  case ContextSlot::EstimateSize: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (count < 1) {
+            return sizeEstimateToJSI(rt, SizeEstimate());
+          }
+          return sizeEstimateToJSI(rt, this->estimateSize(rt, args[0]));
+        });
+  }
+
+  case ContextSlot::SetOperationSink: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 2,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (count < 2 || !args[0].isString() || !args[1].isObject() ||
+              !args[1].getObject(rt).isFunction(rt)) {
+            throw jsi::JSError(
+                rt, "setOperationSink requires (name: string, fn: function)");
+          }
+          std::string globalName = args[0].getString(rt).utf8(rt);
+          this->setOperationSink(rt, globalName,
+                                 args[1].getObject(rt).getFunction(rt));
+          return jsi::Value::undefined();
+        });
+  }
+
+  case ContextSlot::GetCoalescingStats: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value { return this->getCoalescingStats(rt); });
+  }
+
+  case ContextSlot::GetConversionStats: {
     return jsi::Function::createFromHostFunction(
-        rt, name, 0,
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value { return this->getConversionStats(rt); });
+  }
+
+  case ContextSlot::OpenMessageRing: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 2,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (count < 1 || !args[0].isString()) {
+            throw jsi::JSError(
+                rt, "openMessageRing requires (name: string, capacity?: "
+                    "number)");
+          }
+          size_t capacity = kDefaultMessageRingBytes;
+          if (count > 1 && args[1].isNumber() && args[1].asNumber() > 0) {
+            capacity = (size_t)std::min(args[1].asNumber(),
+                                        (double)MessageRing::kMaxCapacity);
+          }
+          this->openMessageRing(rt, args[0].getString(rt).utf8(rt), capacity);
+          return jsi::Value::undefined();
+        });
+  }
+
+  case ContextSlot::DrainMessages: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          size_t maxMessages = SIZE_MAX;
+          if (count > 0 && args[0].isNumber() && args[0].asNumber() >= 0) {
+            maxMessages = (size_t)args[0].asNumber();
+          }
+          return this->drainMessages(rt, maxMessages);
+        });
+  }
+
+  case ContextSlot::GetMessageRingStats: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value { return this->getMessageRingStats(rt); });
+  }
+
+  case ContextSlot::SetHostEventPolicy: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 2,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          HostEventQueue::Policy policy;
+          if (count < 2 || !args[0].isString() || !args[1].isString() ||
+              !HostEventQueue::parsePolicy(args[1].getString(rt).utf8(rt),
+                                           &policy)) {
+            throw jsi::JSError(rt, "setHostEventPolicy requires (name: "
+                                   "string, policy: 'all' | 'latest' | "
+                                   "'accumulate')");
+          }
+          std::lock_guard<std::recursive_mutex> lock(mutex_);
+          hostEvents_.setPolicy(args[0].getString(rt).utf8(rt), policy);
+          return jsi::Value::undefined();
+        });
+  }
+
+  case ContextSlot::QueueHostEvent: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 2,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (count < 1 || !args[0].isString()) {
+            throw jsi::JSError(
+                rt, "queueHostEvent requires (name: string, payload?: any)");
+          }
+          std::string eventName = args[0].getString(rt).utf8(rt);
+          if (count < 2) {
+            return jsi::Value((double)this->queueHostEvent(
+                rt, eventName, jsi::Value::undefined()));
+          }
+          return jsi::Value(
+              (double)this->queueHostEvent(rt, eventName, args[1]));
+        });
+  }
+
+  case ContextSlot::FlushHostEvents: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 2,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (count < 1 || !args[0].isString()) {
+            throw jsi::JSError(
+                rt,
+                "flushHostEvents requires (handler: string, maxEvents?: number)");
+          }
+          size_t maxEvents = SIZE_MAX;
+          if (count > 1 && args[1].isNumber() && args[1].asNumber() >= 0) {
+            maxEvents = (size_t)args[1].asNumber();
+          }
+          return jsi::Value((double)this->flushHostEvents(
+              rt, args[0].getString(rt).utf8(rt), maxEvents));
+        });
+  }
+
+  case ContextSlot::GetHostEventStats: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value { return this->getHostEventStats(rt); });
+  }
+
+  case ContextSlot::GetBoundaryStats: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value { return this->getBoundaryStats(rt); });
+  }
+
+  case ContextSlot::ResetBoundaryStats: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value {
+          this->resetBoundaryStats();
+          return jsi::Value::undefined();
+        });
+  }
+
+  case ContextSlot::DrainTrace: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          size_t maxEntries = SIZE_MAX;
+          if (count > 0 && args[0].isNumber() && args[0].asNumber() >= 0) {
+            maxEntries = (size_t)args[0].asNumber();
+          }
+          return this->drainTrace(rt, maxEntries);
+        });
+  }
+
+  case ContextSlot::GetTraceStats: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value { return this->getTraceStats(rt); });
+  }
+
+  case ContextSlot::Dispose: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
         [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
                size_t) -> jsi::Value {
           this->dispose();
@@ -195,10 +1191,10 @@ jsi::Value QuickJSSandboxContext::get(jsi::Runtime &rt,
         });
   }
 
-  if (propName == "isDisposed") {
+  case ContextSlot::IsDisposed: {
     return jsi::Value(disposed_);
   }
-
+  }
   return jsi::Value::undefined();
 }
 
@@ -207,28 +1203,169 @@ void QuickJSSandboxContext::set(jsi::Runtime &, const jsi::PropNameID &,
   // Read-only
 }
 
-std::vector<jsi::PropNameID>
-QuickJSSandboxContext::getPropertyNames(jsi::Runtime &rt) {
-  std::vector<jsi::PropNameID> props;
-  props.push_back(jsi::PropNameID::forUtf8(rt, "eval"));
-  props.push_back(jsi::PropNameID::forUtf8(rt, "setGlobal"));
-  props.push_back(jsi::PropNameID::forUtf8(rt, "getGlobal"));
-  props.push_back(jsi::PropNameID::forUtf8(rt, "dispose"));
-  props.push_back(jsi::PropNameID::forUtf8(rt, "isDisposed"));
-  return props;
+jsi::Value QuickJSSandboxContext::eval(jsi::Runtime &rt,
+                                       const std::string &code,
+                                       const char *sourceURL) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+
+  return takeEvalResult(rt,
+                        evalSource(code.c_str(), code.size(), sourceURL));
 }
 
-jsi::Value QuickJSSandboxContext::eval(jsi::Runtime &rt,
-                                       const std::string &code) {
+jsi::Value QuickJSSandboxContext::evalBuffer(jsi::Runtime &rt,
+                                             const uint8_t *data,
+                                             size_t size,
+                                             const char *sourceURL) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
 
   if (disposed_) {
     throw jsi::JSError(rt, "Context has been disposed");
   }
 
-  JSValue result = JS_Eval(qjsContext_, code.c_str(), code.size(), "<eval>",
-                           JS_EVAL_TYPE_GLOBAL);
+  const char *code = reinterpret_cast<const char *>(data);
+  if (size > 0 && data[size - 1] == '\0') {
+    return takeEvalResult(rt, evalSource(code, size - 1, sourceURL));
+  }
+  // The buffer may be shared or read-only, so it is never terminated in
+  // place
+  std::string source(code, size);
+  return takeEvalResult(rt,
+                        evalSource(source.c_str(), source.size(), sourceURL));
+}
+
+jsi::Value QuickJSSandboxContext::evalFile(jsi::Runtime &rt,
+                                           const std::string &path,
+                                           const char *sourceURL) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
 
+  std::string error;
+  std::unique_ptr<MappedFile> file = MappedFile::open(path, &error);
+  if (!file) {
+    throw jsi::JSError(rt, error);
+  }
+  // Unmapped once parsed, so the pages are not held while the bundle runs
+  JSValue result = evalSource(file->data(), file->size(), sourceURL,
+                              [&file] { file.reset(); });
+  return takeEvalResult(rt, result);
+}
+
+JSValue QuickJSSandboxContext::evalSource(
+    const char *code, size_t length, const char *sourceURL,
+    const std::function<void()> &parsed) {
+  // Bootstrap scripts the build precompiled (e.g. the guest bundle) skip
+  // parsing and compilation
+  JSValue function;
+  const BootstrapScript *script = findBootstrapScriptForSource(code, length);
+  if (!script || !loadBootstrapScript(qjsContext_, *script, &function)) {
+    function = JS_Eval(qjsContext_, code, length, sourceURL,
+                       JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+  }
+  if (parsed) {
+    parsed();
+  }
+  if (JS_IsException(function)) {
+    return function;
+  }
+  return JS_EvalFunction(qjsContext_, function);
+}
+
+jsi::Value QuickJSSandboxContext::evalBootstrap(jsi::Runtime &rt,
+                                                const BootstrapScript &script) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+
+  JSValue result;
+  if (!evalBootstrapScript(qjsContext_, script, &result)) {
+    throw jsi::JSError(rt, std::string("Failed to load bootstrap bytecode: ") +
+                               script.name);
+  }
+  return takeEvalResult(rt, result);
+}
+
+jsi::Value QuickJSSandboxContext::evalBundle(jsi::Runtime &rt,
+                                             BundleCompiler &compiler) {
+  // The worker may still be compiling (or the host still downloading):
+  // wait without blocking other users of the context
+  std::vector<uint8_t> bytecode;
+  bool compiled = compiler.wait(&bytecode);
+  if (compiler.cancelled()) {
+    throw jsi::JSError(rt, "Bundle stream was cancelled");
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+
+  JSValue result = JS_EXCEPTION;
+  if (compiled) {
+    JSValue function = JS_ReadObject(qjsContext_, bytecode.data(),
+                                     bytecode.size(), JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(function)) {
+      JS_FreeValue(qjsContext_, JS_GetException(qjsContext_));
+      compiled = false;
+    } else {
+      result = JS_EvalFunction(qjsContext_, function);
+    }
+  }
+  if (!compiled) {
+    // Also reports syntax errors, which the worker leaves to this thread
+    const std::string &source = compiler.source();
+    result = JS_Eval(qjsContext_, source.c_str(), source.size(),
+                     compiler.sourceURL().c_str(), JS_EVAL_TYPE_GLOBAL);
+  }
+  return takeEvalResult(rt, result);
+}
+
+size_t QuickJSSandboxContext::runPendingJobs(jsi::Runtime &rt,
+                                             size_t maxJobs) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+
+  size_t ran = 0;
+  std::string firstError;
+  while (ran < maxJobs) {
+    JSContext *jobContext = nullptr;
+    int ret = JS_ExecutePendingJob(qjsRuntime_, &jobContext);
+    if (ret == 0) {
+      break;
+    }
+    ran++;
+    if (ret < 0 && jobContext) {
+      // Keep draining; report the first failure once the queue is empty
+      JSValue exception = JS_GetException(jobContext);
+      if (firstError.empty()) {
+        const char *str = JS_ToCString(jobContext, exception);
+        firstError = str ? str : "Unknown error";
+        if (str)
+          JS_FreeCString(jobContext, str);
+      }
+      JS_FreeValue(jobContext, exception);
+    }
+  }
+  if (!firstError.empty()) {
+    throw jsi::JSError(rt, firstError);
+  }
+  return ran;
+}
+
+jsi::Value QuickJSSandboxContext::takeEvalResult(jsi::Runtime &rt,
+                                                 JSValue result) {
   if (JS_IsException(result)) {
     JSValue exception = JS_GetException(qjsContext_);
     const char *str = JS_ToCString(qjsContext_, exception);
@@ -261,12 +1398,48 @@ JSValue QuickJSSandboxContext::hostFunctionCallback(
 
   auto *self = data->self;
   jsi::Runtime *hostRt = self->hostRuntime_;
+  BoundaryStats::CallScope callScope(self->boundary_.hostCalls);
+
+  // Nested guest -> host calls get their own argument estimates
+  struct EstimateScope {
+    std::vector<ArgEstimate> &current;
+    std::vector<ArgEstimate> outer;
+    explicit EstimateScope(std::vector<ArgEstimate> &cur) : current(cur) {
+      outer.swap(current);
+    }
+    ~EstimateScope() { current.swap(outer); }
+  } estimateScope(self->callEstimates_);
 
   try {
     std::vector<jsi::Value> jsiArgs;
-    for (int i = 0; i < argc; i++) {
+    std::vector<SizeEstimate> argEstimates(argc);
+    jsiArgs.reserve(argc);
+    int first = 0;
+    if (data->coalesceOperations && argc > 0 && self->coalescer_) {
+      // Drop redundant operations before the batch is converted
+      using Clock = std::chrono::steady_clock;
+      auto t0 = Clock::now();
+      uint32_t opsIn, opsOut;
+      JSValue batch = self->coalescer_->coalesce(argv[0], &opsIn, &opsOut);
+      auto t1 = Clock::now();
+      jsiArgs.push_back(self->qjsToJSI(
+          *hostRt, JS_IsUndefined(batch) ? argv[0] : batch, &argEstimates[0]));
+      auto t2 = Clock::now();
+      JS_FreeValue(ctx, batch);
+      self->coalescer_->record(
+          opsIn, opsOut,
+          std::chrono::duration<double, std::milli>(t1 - t0).count(),
+          std::chrono::duration<double, std::milli>(t2 - t1).count());
+      first = 1;
+    }
+    for (int i = first; i < argc; i++) {
       // argv[i] is borrowed, no need to dup - qjsToJSI reads without consuming
-      jsiArgs.push_back(self->qjsToJSI(*hostRt, argv[i]));
+      jsiArgs.push_back(self->qjsToJSI(*hostRt, argv[i], &argEstimates[i]));
+    }
+    for (int i = 0; i < argc; i++) {
+      if (jsiArgs[i].isObject()) {
+        self->callEstimates_.push_back({&jsiArgs[i], argEstimates[i]});
+      }
     }
 
     jsi::Value result;
@@ -277,52 +1450,428 @@ JSValue QuickJSSandboxContext::hostFunctionCallback(
                                 jsiArgs.size());
     }
 
-    return self->jsiToQJS(*hostRt, result);
-  } catch (const std::exception &e) {
-    return JS_ThrowInternalError(ctx, "%s", e.what());
-  }
+    return self->jsiToQJS(*hostRt, result);
+  } catch (const std::exception &e) {
+    return JS_ThrowInternalError(ctx, "%s", e.what());
+  }
+}
+
+SizeEstimate QuickJSSandboxContext::estimateSize(jsi::Runtime &rt,
+                                                 const jsi::Value &value) {
+  if (value.isObject()) {
+    for (const auto &rec : callEstimates_) {
+      if (jsi::Value::strictEquals(rt, *rec.value, value)) {
+        return rec.estimate;
+      }
+    }
+  }
+  return quickjs_sandbox::estimateSize(rt, value);
+}
+
+void QuickJSSandboxContext::setGlobal(jsi::Runtime &rt, const std::string &name,
+                                      const jsi::Value &value) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+
+  JSValue global = JS_GetGlobalObject(qjsContext_);
+  JSValue qjsValue = jsiToQJS(rt, value);
+  if (JS_IsException(qjsValue)) {
+    JS_FreeValue(qjsContext_, global);
+    checkException();
+    return;
+  }
+  JS_SetPropertyStr(qjsContext_, global, name.c_str(), qjsValue);
+  JS_FreeValue(qjsContext_, global);
+}
+
+jsi::Value QuickJSSandboxContext::getGlobal(jsi::Runtime &rt,
+                                            const std::string &name) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+
+  JSValue global = JS_GetGlobalObject(qjsContext_);
+  JSValue value = JS_GetPropertyStr(qjsContext_, global, name.c_str());
+  JS_FreeValue(qjsContext_, global);
+
+  jsi::Value result = qjsToJSI(rt, value);
+  JS_FreeValue(qjsContext_, value);
+  return result;
+}
+
+void QuickJSSandboxContext::setOperationSink(jsi::Runtime &rt,
+                                             const std::string &name,
+                                             jsi::Function &&func) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+
+  if (!coalescer_) {
+    coalescer_ = std::make_unique<OperationCoalescer>(qjsContext_);
+  }
+  JSValue global = JS_GetGlobalObject(qjsContext_);
+  operationSinkFunc_ = std::make_shared<jsi::Function>(
+      jsi::Value(rt, func).getObject(rt).getFunction(rt));
+  JSValue sink = wrapFunctionForSandbox(rt, std::move(func), true);
+  JS_FreeValue(qjsContext_, operationSink_);
+  operationSink_ = JS_DupValue(qjsContext_, sink);
+  JS_SetPropertyStr(qjsContext_, global, name.c_str(), sink);
+  JS_FreeValue(qjsContext_, global);
+}
+
+jsi::Value QuickJSSandboxContext::getCoalescingStats(jsi::Runtime &rt) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  OperationCoalescer::Stats stats;
+  if (coalescer_) {
+    stats = coalescer_->stats();
+  }
+  jsi::Object result(rt);
+  result.setProperty(rt, "batches", (double)stats.batches);
+  result.setProperty(rt, "opsIn", (double)stats.opsIn);
+  result.setProperty(rt, "opsOut", (double)stats.opsOut);
+  result.setProperty(rt, "coalesceMs", stats.coalesceMs);
+  result.setProperty(rt, "conversionMs", stats.conversionMs);
+  result.setProperty(rt, "estimatedSavedMs", stats.estimatedSavedMs);
+  return result;
+}
+
+jsi::Value QuickJSSandboxContext::getConversionStats(jsi::Runtime &rt) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  jsi::Object result(rt);
+  result.setProperty(rt, "hits", (double)memoStats_.hits);
+  result.setProperty(rt, "misses", (double)memoStats_.misses);
+  result.setProperty(rt, "entries", (double)memoLru_.size());
+  result.setProperty(rt, "evictions", (double)memoStats_.evictions);
+  result.setProperty(rt, "capacity", (double)memoCapacity_);
+  return result;
+}
+
+void QuickJSSandboxContext::setConversionMemoSize(size_t maxEntries) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (qjsContext_ && (memoCapacity_ == 0) != (maxEntries == 0)) {
+    defineMemoFlag(qjsContext_, maxEntries != 0);
+  }
+  memoCapacity_ = maxEntries;
+  while (memoLru_.size() > memoCapacity_) {
+    MemoEntry &oldest = memoLru_.back();
+    memoIndex_.erase(JS_VALUE_GET_PTR(oldest.key));
+    JS_FreeValue(qjsContext_, oldest.key);
+    memoLru_.pop_back();
+    memoStats_.evictions++;
+  }
+}
+
+void QuickJSSandboxContext::openMessageRing(jsi::Runtime &rt,
+                                            const std::string &name,
+                                            size_t capacityBytes) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+  if (messageRing_) {
+    throw jsi::JSError(rt, "Message ring is already open");
+  }
+
+  messageRing_ = std::make_unique<MessageRing>(capacityBytes);
+  messageRingView_.store(messageRing_.get(), std::memory_order_release);
+  JSValue global = JS_GetGlobalObject(qjsContext_);
+  JSValue post =
+      JS_NewCFunction(qjsContext_, messageRingPost, name.c_str(), 1);
+  JS_SetPropertyStr(qjsContext_, global, name.c_str(), post);
+  JS_FreeValue(qjsContext_, global);
+}
+
+// Guest side of the message ring: runs on the thread evaluating guest code
+JSValue QuickJSSandboxContext::messageRingPost(JSContext *ctx, JSValueConst,
+                                               int argc, JSValueConst *argv) {
+  auto *self = static_cast<QuickJSSandboxContext *>(JS_GetContextOpaque(ctx));
+  if (!self || !self->messageRing_) {
+    return JS_ThrowInternalError(ctx, "Message ring is not open");
+  }
+
+  JSValue json = JS_JSONStringify(ctx, argc > 0 ? argv[0] : JS_UNDEFINED,
+                                  JS_UNDEFINED, JS_UNDEFINED);
+  if (JS_IsException(json)) {
+    return json;
+  }
+  if (!JS_IsString(json)) {
+    JS_FreeValue(ctx, json);
+    return JS_ThrowTypeError(ctx, "message is not JSON-serializable");
+  }
+
+  size_t length;
+  const char *text = JS_ToCStringLen(ctx, &length, json);
+  JS_FreeValue(ctx, json);
+  if (!text) {
+    return JS_EXCEPTION;
+  }
+  bool written = self->messageRing_->write(text, length);
+  JS_FreeCString(ctx, text);
+  return JS_NewBool(ctx, written);
+}
+
+jsi::Value QuickJSSandboxContext::drainMessages(jsi::Runtime &rt,
+                                                size_t maxMessages) {
+  // No context lock: the ring is the only state shared with the guest
+  MessageRing *ring = messageRingView_.load(std::memory_order_acquire);
+  if (!ring) {
+    return jsi::Array(rt, 0);
+  }
+
+  // Join the records into one JSON array and decode it in a single call
+  std::string &json = drainScratch_;
+  json.clear();
+  json.push_back('[');
+  size_t drained = ring->drain(
+      [&json](const uint8_t *data, uint32_t length) {
+        if (json.size() > 1) {
+          json.push_back(',');
+        }
+        json.append((const char *)data, length);
+      },
+      maxMessages);
+  if (drained == 0) {
+    return jsi::Array(rt, 0);
+  }
+  json.push_back(']');
+  return jsi::Value::createFromJsonUtf8(rt, (const uint8_t *)json.data(),
+                                        json.size());
+}
+
+jsi::Value QuickJSSandboxContext::getMessageRingStats(jsi::Runtime &rt) {
+  MessageRing::Stats stats;
+  if (MessageRing *ring = messageRingView_.load(std::memory_order_acquire)) {
+    stats = ring->stats();
+  }
+  jsi::Object result(rt);
+  result.setProperty(rt, "capacity", (double)stats.capacity);
+  result.setProperty(rt, "usedBytes", (double)stats.usedBytes);
+  result.setProperty(rt, "highWaterBytes", (double)stats.highWaterBytes);
+  result.setProperty(rt, "written", (double)stats.written);
+  result.setProperty(rt, "drained", (double)stats.drained);
+  result.setProperty(rt, "rejected", (double)stats.rejected);
+  return result;
+}
+
+size_t QuickJSSandboxContext::queueHostEvent(jsi::Runtime &rt,
+                                             const std::string &name,
+                                             const jsi::Value &payload) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+  return hostEvents_.push(rt, name, payload);
+}
+
+size_t QuickJSSandboxContext::flushHostEvents(jsi::Runtime &rt,
+                                              const std::string &handler,
+                                              size_t maxEvents) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Context has been disposed");
+  }
+  if (hostEvents_.pending() == 0 || maxEvents == 0) {
+    return 0;
+  }
+
+  JSValue global = JS_GetGlobalObject(qjsContext_);
+  JSValue handlerFn = JS_GetPropertyStr(qjsContext_, global, handler.c_str());
+  JS_FreeValue(qjsContext_, global);
+  if (!JS_IsFunction(qjsContext_, handlerFn)) {
+    // Keep the events for a later flush
+    JS_FreeValue(qjsContext_, handlerFn);
+    throw jsi::JSError(rt, "flushHostEvents: " + handler +
+                               " is not a function in the sandbox");
+  }
+
+  hostEvents_.take(eventScratch_, maxEvents);
+  std::string firstError;
+  try {
+    for (HostEventQueue::Event &event : eventScratch_) {
+      JSValue args[2];
+      args[0] =
+          JS_NewStringLen(qjsContext_, event.name.data(), event.name.size());
+      args[1] = jsiToQJS(rt, event.payload);
+      // The converted payload is a fresh object, so the sums can be
+      // written into it
+      if (!event.sums.empty() && JS_IsObject(args[1])) {
+        for (const auto &sum : event.sums) {
+          JS_SetPropertyStr(qjsContext_, args[1], sum.first.c_str(),
+                            JS_NewFloat64(qjsContext_, sum.second));
+        }
+      }
+      JSValue result = JS_Call(qjsContext_, handlerFn, JS_UNDEFINED, 2, args);
+      JS_FreeValue(qjsContext_, args[0]);
+      JS_FreeValue(qjsContext_, args[1]);
+      if (JS_IsException(result)) {
+        // Deliver the rest; report the first failure afterwards
+        JSValue exception = JS_GetException(qjsContext_);
+        if (firstError.empty()) {
+          const char *str = JS_ToCString(qjsContext_, exception);
+          firstError = str ? str : "Unknown error";
+          if (str)
+            JS_FreeCString(qjsContext_, str);
+        }
+        JS_FreeValue(qjsContext_, exception);
+      }
+      JS_FreeValue(qjsContext_, result);
+    }
+  } catch (...) {
+    JS_FreeValue(qjsContext_, handlerFn);
+    eventScratch_.clear();
+    throw;
+  }
+  JS_FreeValue(qjsContext_, handlerFn);
+
+  hostEvents_.recordDelivery(eventScratch_);
+  size_t delivered = eventScratch_.size();
+  eventScratch_.clear();
+  if (!firstError.empty()) {
+    throw jsi::JSError(rt, firstError);
+  }
+  return delivered;
+}
+
+jsi::Value QuickJSSandboxContext::getHostEventStats(jsi::Runtime &rt) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  const HostEventQueue::Stats &stats = hostEvents_.stats();
+  jsi::Object result(rt);
+  result.setProperty(rt, "queued", (double)stats.queued);
+  result.setProperty(rt, "coalesced", (double)stats.coalesced);
+  result.setProperty(rt, "delivered", (double)stats.delivered);
+  result.setProperty(rt, "pending", (double)hostEvents_.pending());
+  result.setProperty(rt, "maxPending", (double)stats.maxPending);
+  result.setProperty(rt, "flushes", (double)stats.flushes);
+  result.setProperty(rt, "avgWaitMs",
+                     stats.delivered ? stats.totalWaitMs / stats.delivered
+                                     : 0.0);
+  result.setProperty(rt, "maxWaitMs", stats.maxWaitMs);
+  return result;
+}
+
+static jsi::Object latencyToJSI(jsi::Runtime &rt,
+                                const LatencyHistogram &histogram) {
+  jsi::Object result(rt);
+  result.setProperty(rt, "count", (double)histogram.count());
+  result.setProperty(rt, "totalMs", histogram.totalNs() / 1e6);
+  result.setProperty(rt, "p50Ms", histogram.percentileNs(50) / 1e6);
+  result.setProperty(rt, "p90Ms", histogram.percentileNs(90) / 1e6);
+  result.setProperty(rt, "p99Ms", histogram.percentileNs(99) / 1e6);
+  result.setProperty(rt, "maxMs", histogram.maxNs() / 1e6);
+  return result;
+}
+
+static jsi::Object boundaryDirectionToJSI(
+    jsi::Runtime &rt, const BoundaryStats::Direction &direction) {
+  jsi::Object result(rt);
+  result.setProperty(rt, "crossings", (double)direction.crossings);
+  result.setProperty(rt, "values", (double)direction.values);
+  result.setProperty(rt, "objects", (double)direction.objects);
+  result.setProperty(rt, "strings", (double)direction.strings);
+  result.setProperty(rt, "bytes", (double)direction.bytes);
+  result.setProperty(rt, "functions", (double)direction.functions);
+  result.setProperty(rt, "conversion",
+                     latencyToJSI(rt, direction.conversion));
+  return result;
+}
+
+jsi::Value QuickJSSandboxContext::getBoundaryStats(jsi::Runtime &rt) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  jsi::Object result(rt);
+  result.setProperty(rt, "toGuest",
+                     boundaryDirectionToJSI(rt, boundary_.toGuest));
+  result.setProperty(rt, "toHost",
+                     boundaryDirectionToJSI(rt, boundary_.toHost));
+  result.setProperty(rt, "functionsReleased",
+                     (double)boundary_.functionsReleased);
+  result.setProperty(rt, "hostCalls", latencyToJSI(rt, boundary_.hostCalls));
+  result.setProperty(rt, "guestCalls",
+                     latencyToJSI(rt, boundary_.guestCalls));
+  return result;
 }
 
-void QuickJSSandboxContext::setGlobal(jsi::Runtime &rt, const std::string &name,
-                                      const jsi::Value &value) {
+void QuickJSSandboxContext::resetBoundaryStats() {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
+  boundary_.clear();
+}
 
-  if (disposed_) {
-    throw jsi::JSError(rt, "Context has been disposed");
+jsi::Value QuickJSSandboxContext::drainTrace(jsi::Runtime &rt,
+                                             size_t maxEntries) {
+  std::string json;
+  {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    trace_.drainJson(json, maxEntries);
   }
-
-  JSValue global = JS_GetGlobalObject(qjsContext_);
-  JSValue qjsValue = jsiToQJS(rt, value);
-  JS_SetPropertyStr(qjsContext_, global, name.c_str(), qjsValue);
-  JS_FreeValue(qjsContext_, global);
+  return jsi::Value::createFromJsonUtf8(rt, (const uint8_t *)json.data(),
+                                        json.size());
 }
 
-jsi::Value QuickJSSandboxContext::getGlobal(jsi::Runtime &rt,
-                                            const std::string &name) {
+jsi::Value QuickJSSandboxContext::getTraceStats(jsi::Runtime &rt) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
+  TraceBuffer::Stats stats = trace_.stats();
+  jsi::Object result(rt);
+  result.setProperty(rt, "recorded", (double)stats.recorded);
+  result.setProperty(rt, "dropped", (double)stats.dropped);
+  result.setProperty(rt, "drained", (double)stats.drained);
+  result.setProperty(rt, "pending", (double)stats.pending);
+  result.setProperty(rt, "capacity", (double)stats.capacity);
+  result.setProperty(rt, "names", (double)stats.names);
+  result.setProperty(rt, "timeOrigin", trace_.timeOrigin());
+  return result;
+}
 
-  if (disposed_) {
-    throw jsi::JSError(rt, "Context has been disposed");
+void QuickJSSandboxContext::clearMemo() {
+  for (MemoEntry &entry : memoLru_) {
+    JS_FreeValue(qjsContext_, entry.key);
   }
+  memoLru_.clear();
+  memoIndex_.clear();
+}
 
-  JSValue global = JS_GetGlobalObject(qjsContext_);
-  JSValue value = JS_GetPropertyStr(qjsContext_, global, name.c_str());
-  JS_FreeValue(qjsContext_, global);
-
-  jsi::Value result = qjsToJSI(rt, value);
-  JS_FreeValue(qjsContext_, value);
-  return result;
+void QuickJSSandboxContext::memoInsert(jsi::Runtime &rt, JSValue value,
+                                       const jsi::Value &result,
+                                       const SizeEstimate *estimate) {
+  memoLru_.push_front(MemoEntry{JS_DupValue(qjsContext_, value),
+                                jsi::Value(rt, result),
+                                estimate ? *estimate : SizeEstimate(),
+                                estimate != nullptr});
+  memoIndex_[JS_VALUE_GET_PTR(value)] = memoLru_.begin();
+  setConversionMemoSize(memoCapacity_); // evict past capacity
 }
 
-JSValue QuickJSSandboxContext::wrapFunctionForSandbox(jsi::Runtime &,
-                                                      jsi::Function &&func) {
+JSValue QuickJSSandboxContext::wrapFunctionForSandbox(jsi::Runtime &rt,
+                                                      jsi::Function &&func,
+                                                      bool coalesceOperations) {
+  // Keep the host function's name, so that guest stack traces and the
+  // function profiler can tell the trampolines apart
+  std::string functionName;
+  jsi::Value nameVal = func.getProperty(rt, "name");
+  if (nameVal.isString()) {
+    functionName = nameVal.getString(rt).utf8(rt);
+  }
+
   // Store the function
   std::string callbackId = "cb_" + std::to_string(++callbackCounter_);
   auto funcPtr = std::make_shared<jsi::Function>(std::move(func));
   callbacks_[callbackId] = funcPtr;
 
   // Create HostFunctionData
-  auto *data = new HostFunctionData{this, funcPtr, callbackId};
+  auto *data =
+      new HostFunctionData{this, funcPtr, callbackId, coalesceOperations};
 
   // Create an opaque JS object to hold the data pointer (with our registered
   // class that has finalizer)
@@ -337,12 +1886,21 @@ JSValue QuickJSSandboxContext::wrapFunctionForSandbox(jsi::Runtime &,
                                         &dataObj);
 
   JS_FreeValue(qjsContext_, dataObj);
+  if (!functionName.empty() && !JS_IsException(funcVal)) {
+    JSAtom atom = JS_NewAtomLen(qjsContext_, functionName.data(),
+                                functionName.size());
+    JS_DefinePropertyValueStr(qjsContext_, funcVal, "name",
+                              JS_AtomToString(qjsContext_, atom),
+                              JS_PROP_CONFIGURABLE);
+    JS_FreeAtom(qjsContext_, atom);
+  }
   return funcVal;
 }
 
 // Convert jsi::Value to QuickJS JSValue
 JSValue QuickJSSandboxContext::jsiToQJS(jsi::Runtime &rt,
                                         const jsi::Value &value) {
+  BoundaryStats::ConversionScope scope(boundary_.toGuest, toGuestDepth_);
   if (value.isUndefined()) {
     return JS_UNDEFINED;
   }
@@ -357,6 +1915,8 @@ JSValue QuickJSSandboxContext::jsiToQJS(jsi::Runtime &rt,
   }
   if (value.isString()) {
     std::string str = value.asString(rt).utf8(rt);
+    boundary_.toGuest.strings++;
+    boundary_.toGuest.bytes += str.size();
     return JS_NewStringLen(qjsContext_, str.c_str(), str.size());
   }
   if (value.isSymbol()) {
@@ -372,29 +1932,61 @@ JSValue QuickJSSandboxContext::jsiToQJS(jsi::Runtime &rt,
     // Handle functions
     if (obj.isFunction(rt)) {
       jsi::Function func = obj.asFunction(rt);
+      boundary_.toGuest.functions++;
       return wrapFunctionForSandbox(rt, std::move(func));
     }
+    boundary_.toGuest.objects++;
 
     // Handle arrays
     if (obj.isArray(rt)) {
-      jsi::Array arr = obj.asArray(rt);
-      size_t len = arr.size(rt);
-      JSValue jsArr = JS_NewArray(qjsContext_);
-      for (size_t i = 0; i < len; i++) {
-        JSValue elem = jsiToQJS(rt, arr.getValueAtIndex(rt, i));
-        JS_SetPropertyUint32(qjsContext_, jsArr, (uint32_t)i, elem);
+      std::vector<jsi::Value> elements =
+          qjs::getArrayValues(rt, obj.asArray(rt));
+      // Allocated once; each element replaces an undefined in place
+      JSValue jsArr =
+          JS_NewArrayFrom(qjsContext_, (uint32_t)elements.size(), nullptr);
+      if (JS_IsException(jsArr)) {
+        return jsArr;
+      }
+      // Nothing else can reach the new array, so its storage stays put
+      // while the elements are converted
+      JSValue *values;
+      uint32_t count;
+      if (!JS_GetFastArray(qjsContext_, jsArr, &values, &count) ||
+          count != elements.size()) {
+        JS_FreeValue(qjsContext_, jsArr);
+        return JS_ThrowInternalError(qjsContext_, "Array is not fast");
+      }
+      try {
+        for (size_t i = 0; i < elements.size(); i++) {
+          JSValue elem = jsiToQJS(rt, elements[i]);
+          if (JS_IsException(elem)) {
+            JS_FreeValue(qjsContext_, jsArr);
+            return elem;
+          }
+          values[i] = elem;
+        }
+      } catch (...) {
+        JS_FreeValue(qjsContext_, jsArr);
+        throw;
       }
       return jsArr;
     }
 
     // Handle plain objects
-    jsi::Array propNames = obj.getPropertyNames(rt);
-    size_t len = propNames.size(rt);
+    std::vector<jsi::Value> propNames =
+        qjs::getArrayValues(rt, obj.getPropertyNames(rt));
     JSValue jsObj = JS_NewObject(qjsContext_);
-    for (size_t i = 0; i < len; i++) {
-      std::string key = propNames.getValueAtIndex(rt, i).asString(rt).utf8(rt);
+    if (JS_IsException(jsObj)) {
+      return jsObj;
+    }
+    for (size_t i = 0; i < propNames.size(); i++) {
+      std::string key = propNames[i].asString(rt).utf8(rt);
       jsi::Value propVal = obj.getProperty(rt, key.c_str());
       JSValue qjsVal = jsiToQJS(rt, propVal);
+      if (JS_IsException(qjsVal)) {
+        JS_FreeValue(qjsContext_, jsObj);
+        return qjsVal;
+      }
       JS_SetPropertyStr(qjsContext_, jsObj, key.c_str(), qjsVal);
     }
     return jsObj;
@@ -403,27 +1995,45 @@ JSValue QuickJSSandboxContext::jsiToQJS(jsi::Runtime &rt,
   return JS_UNDEFINED;
 }
 
-// Convert QuickJS JSValue to jsi::Value
-jsi::Value QuickJSSandboxContext::qjsToJSI(jsi::Runtime &rt, JSValue value) {
+// Convert QuickJS JSValue to jsi::Value. When `estimate` is given, the
+// JSON.stringify footprint of the value is accumulated into it as well.
+jsi::Value QuickJSSandboxContext::qjsToJSI(jsi::Runtime &rt, JSValue value,
+                                           SizeEstimate *estimate) {
+  BoundaryStats::ConversionScope scope(boundary_.toHost, toHostDepth_);
   if (JS_IsUndefined(value)) {
     return jsi::Value::undefined();
   }
   if (JS_IsNull(value)) {
+    if (estimate)
+      estimate->bytes += 4;
     return jsi::Value::null();
   }
   if (JS_IsBool(value)) {
-    return jsi::Value(JS_ToBool(qjsContext_, value) != 0);
+    bool b = JS_ToBool(qjsContext_, value) != 0;
+    if (estimate)
+      estimate->bytes += b ? 4 : 5;
+    return jsi::Value(b);
   }
   if (JS_IsNumber(value)) {
     double num;
     JS_ToFloat64(qjsContext_, &num, value);
+    if (estimate)
+      estimate->bytes += estimateNumberBytes(num);
     return jsi::Value(num);
   }
   if (JS_IsString(value)) {
-    const char *str = JS_ToCString(qjsContext_, value);
-    jsi::String jsiStr = jsi::String::createFromUtf8(rt, str ? str : "");
+    size_t len = 0;
+    const char *str = JS_ToCStringLen(qjsContext_, &len, value);
+    jsi::String jsiStr = jsi::String::createFromUtf8(
+        rt, reinterpret_cast<const uint8_t *>(str ? str : ""), len);
     if (str)
       JS_FreeCString(qjsContext_, str);
+    boundary_.toHost.strings++;
+    boundary_.toHost.bytes += len;
+    if (estimate) {
+      estimate->bytes += len + 2;
+      estimate->strings++;
+    }
     return jsiStr;
   }
   if (JS_IsSymbol(value)) {
@@ -437,21 +2047,10 @@ jsi::Value QuickJSSandboxContext::qjsToJSI(jsi::Runtime &rt, JSValue value) {
     JS_FreeAtom(qjsContext_, atom);
     return jsi::String::createFromUtf8(rt, symStr);
   }
-  if (JS_IsArray(qjsContext_, value)) {
-    JSValue lengthVal = JS_GetPropertyStr(qjsContext_, value, "length");
-    uint32_t length;
-    JS_ToUint32(qjsContext_, &length, lengthVal);
-    JS_FreeValue(qjsContext_, lengthVal);
-
-    jsi::Array arr = jsi::Array(rt, length);
-    for (uint32_t i = 0; i < length; i++) {
-      JSValue elem = JS_GetPropertyUint32(qjsContext_, value, i);
-      arr.setValueAtIndex(rt, i, qjsToJSI(rt, elem));
-      JS_FreeValue(qjsContext_, elem);
-    }
-    return std::move(arr);
-  }
   if (JS_IsFunction(qjsContext_, value)) {
+    mutableConversions_++;
+    boundary_.toHost.functions++;
+
     // Store the sandbox function
     std::string funcKey =
         "__sandbox_fn_" + std::to_string(++g_sandboxFuncCounter) + "__";
@@ -476,6 +2075,7 @@ jsi::Value QuickJSSandboxContext::qjsToJSI(jsi::Runtime &rt, JSValue value) {
           if (self->disposed_) {
             throw jsi::JSError(rt, "Context has been disposed");
           }
+          BoundaryStats::CallScope callScope(self->boundary_.guestCalls);
 
           JSValue global = JS_GetGlobalObject(self->qjsContext_);
           JSValue sandboxFunc =
@@ -518,38 +2118,117 @@ jsi::Value QuickJSSandboxContext::qjsToJSI(jsi::Runtime &rt, JSValue value) {
         });
   }
   if (JS_IsObject(value)) {
-    jsi::Object jsiObj = jsi::Object(rt);
-
-    // Get property names
-    JSPropertyEnum *props;
-    uint32_t propCount;
-    if (JS_GetOwnPropertyNames(qjsContext_, &props, &propCount, value,
-                               JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) == 0) {
-      for (uint32_t i = 0; i < propCount; i++) {
-        const char *key = JS_AtomToCString(qjsContext_, props[i].atom);
-        if (key) {
-          JSValue propVal = JS_GetProperty(qjsContext_, value, props[i].atom);
-          jsiObj.setProperty(rt, key, qjsToJSI(rt, propVal));
-          JS_FreeValue(qjsContext_, propVal);
-          JS_FreeCString(qjsContext_, key);
+    boundary_.toHost.objects++;
+    if (memoCapacity_ == 0) {
+      return qjsObjectToJSI(rt, value, estimate);
+    }
+
+    // Only non-extensible objects can be frozen; skip the lookup otherwise
+    bool candidate = JS_IsExtensible(qjsContext_, value) == 0;
+    if (candidate) {
+      auto it = memoIndex_.find(JS_VALUE_GET_PTR(value));
+      if (it != memoIndex_.end()) {
+        MemoEntry &entry = *it->second;
+        memoLru_.splice(memoLru_.begin(), memoLru_, it->second);
+        memoStats_.hits++;
+        if (estimate) {
+          if (!entry.hasEstimate) {
+            entry.estimate = quickjs_sandbox::estimateSize(rt, entry.value);
+            entry.hasEstimate = true;
+          }
+          estimate->bytes += entry.estimate.bytes;
+          estimate->objects += entry.estimate.objects;
+          estimate->strings += entry.estimate.strings;
         }
-        JS_FreeAtom(qjsContext_, props[i].atom);
+        return jsi::Value(rt, entry.value);
       }
-      js_free(qjsContext_, props);
     }
-
-    return std::move(jsiObj);
+    memoStats_.misses++;
+
+    uint64_t mutableBefore = mutableConversions_;
+    SizeEstimate before = estimate ? *estimate : SizeEstimate();
+    jsi::Value result = qjsObjectToJSI(rt, value, estimate);
+    if (candidate && mutableConversions_ == mutableBefore &&
+        JS_IsFrozenData(qjsContext_, value)) {
+      SizeEstimate own;
+      if (estimate) {
+        own.bytes = estimate->bytes - before.bytes;
+        own.objects = estimate->objects - before.objects;
+        own.strings = estimate->strings - before.strings;
+      }
+      memoInsert(rt, value, result, estimate ? &own : nullptr);
+    } else {
+      mutableConversions_++;
+    }
+    return result;
   }
 
   return jsi::Value::undefined();
 }
 
+// Arrays and plain objects, without the memo
+jsi::Value QuickJSSandboxContext::qjsObjectToJSI(jsi::Runtime &rt,
+                                                 JSValue value,
+                                                 SizeEstimate *estimate) {
+  if (JS_IsArray(qjsContext_, value)) {
+    JSValue lengthVal = JS_GetPropertyStr(qjsContext_, value, "length");
+    uint32_t length;
+    JS_ToUint32(qjsContext_, &length, lengthVal);
+    JS_FreeValue(qjsContext_, lengthVal);
+
+    if (estimate) {
+      estimate->objects++;
+      estimate->bytes += length ? length + 1 : 2; // brackets and commas
+    }
+    std::vector<jsi::Value> elements;
+    elements.reserve(std::min<uint32_t>(length, kMaxReservedElements));
+    for (uint32_t i = 0; i < length; i++) {
+      JSValue elem = JS_GetPropertyUint32(qjsContext_, value, i);
+      if (estimate && isOmittedByJSON(qjsContext_, elem))
+        estimate->bytes += 4; // null
+      elements.push_back(qjsToJSI(rt, elem, estimate));
+      JS_FreeValue(qjsContext_, elem);
+    }
+    return qjs::createArrayFromValues(rt, elements.data(), elements.size());
+  }
+  jsi::Object jsiObj = jsi::Object(rt);
+  size_t members = 0;
+
+  // Get property names
+  JSPropertyEnum *props;
+  uint32_t propCount;
+  if (JS_GetOwnPropertyNames(qjsContext_, &props, &propCount, value,
+                             JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) == 0) {
+    for (uint32_t i = 0; i < propCount; i++) {
+      const char *key = JS_AtomToCString(qjsContext_, props[i].atom);
+      if (key) {
+        JSValue propVal = JS_GetProperty(qjsContext_, value, props[i].atom);
+        if (estimate && !isOmittedByJSON(qjsContext_, propVal)) {
+          estimate->bytes += strlen(key) + 3; // "key":
+          members++;
+        }
+        jsiObj.setProperty(rt, key, qjsToJSI(rt, propVal, estimate));
+        JS_FreeValue(qjsContext_, propVal);
+        JS_FreeCString(qjsContext_, key);
+      }
+      JS_FreeAtom(qjsContext_, props[i].atom);
+    }
+    js_free(qjsContext_, props);
+  }
+  if (estimate) {
+    estimate->objects++;
+    estimate->bytes += members ? members + 1 : 2; // braces and commas
+  }
+
+  return std::move(jsiObj);
+}
+
 // MARK: - QuickJSSandboxRuntime Implementation
 
 QuickJSSandboxRuntime::QuickJSSandboxRuntime(jsi::Runtime &hostRuntime,
                                              double timeout)
     : qjsRuntime_(nullptr), hostRuntime_(&hostRuntime), timeout_(timeout),
-      disposed_(false) {
+      conversionMemoSize_(kDefaultConversionMemoSize), disposed_(false) {
   qjsRuntime_ = JS_NewRuntime();
   if (!qjsRuntime_) {
     throw jsi::JSError(hostRuntime, "Failed to create QuickJS runtime");
@@ -605,27 +2284,117 @@ void QuickJSSandboxRuntime::dispose() {
   }
 }
 
-jsi::Value QuickJSSandboxRuntime::get(jsi::Runtime &rt,
-                                      const jsi::PropNameID &name) {
-  std::string propName = name.utf8(rt);
+// Properties of a sandbox runtime (RuntimeSlot)
+static const qjs::StaticHostObject::PropertyList kRuntimeProperties = {
+    {"createContext", true},
+    {"getHeapInfo", true},
+    {"dumpOpcodeStats", true},
+    {"resetOpcodeStats", true},
+    {"setFunctionProfiling", true},
+    {"resetFunctionProfile", true},
+    {"getFunctionProfile", true},
+    {"dispose", true},
+};
+
+enum class RuntimeSlot : size_t {
+  CreateContext,
+  GetHeapInfo,
+  DumpOpcodeStats,
+  ResetOpcodeStats,
+  SetFunctionProfiling,
+  ResetFunctionProfile,
+  GetFunctionProfile,
+  Dispose,
+};
+
+const qjs::StaticHostObject::PropertyList &
+QuickJSSandboxRuntime::properties() const {
+  return kRuntimeProperties;
+}
 
-  if (propName == "createContext") {
+jsi::Value QuickJSSandboxRuntime::getSlot(jsi::Runtime &rt, size_t slot) {
+  switch (static_cast<RuntimeSlot>(slot)) {
+  case RuntimeSlot::CreateContext: {
     return jsi::Function::createFromHostFunction(
-        rt, name, 0,
+        rt, propertyName(rt, slot), 0,
         [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
                size_t) -> jsi::Value { return this->createContext(rt); });
   }
 
-  if (propName == "dispose") {
+  case RuntimeSlot::GetHeapInfo: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value { return this->getHeapInfo(rt); });
+  }
+
+  case RuntimeSlot::DumpOpcodeStats: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          size_t maxPairs = 40;
+          if (count > 0 && args[0].isNumber()) {
+            maxPairs = (size_t)std::max(0.0, args[0].getNumber());
+          }
+          return this->dumpOpcodeStats(rt, maxPairs);
+        });
+  }
+
+  case RuntimeSlot::ResetOpcodeStats: {
     return jsi::Function::createFromHostFunction(
-        rt, name, 0,
+        rt, propertyName(rt, slot), 0,
         [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
                size_t) -> jsi::Value {
-          this->dispose();
+          this->resetOpcodeStats();
+          return jsi::Value::undefined();
+        });
+  }
+
+  case RuntimeSlot::SetFunctionProfiling: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          this->setFunctionProfiling(rt, count > 0 && args[0].isBool() &&
+                                             args[0].getBool());
+          return jsi::Value::undefined();
+        });
+  }
+
+  case RuntimeSlot::ResetFunctionProfile: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value {
+          this->resetFunctionProfile();
           return jsi::Value::undefined();
         });
   }
 
+  case RuntimeSlot::GetFunctionProfile: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          size_t maxFunctions = SIZE_MAX;
+          if (count > 0 && args[0].isNumber()) {
+            maxFunctions = (size_t)std::max(0.0, args[0].getNumber());
+          }
+          return this->getFunctionProfile(rt, maxFunctions);
+        });
+  }
+
+  case RuntimeSlot::Dispose: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value {
+          this->dispose();
+          return jsi::Value::undefined();
+        });
+  }
+  }
   return jsi::Value::undefined();
 }
 
@@ -634,12 +2403,149 @@ void QuickJSSandboxRuntime::set(jsi::Runtime &, const jsi::PropNameID &,
   // Read-only
 }
 
-std::vector<jsi::PropNameID>
-QuickJSSandboxRuntime::getPropertyNames(jsi::Runtime &rt) {
-  std::vector<jsi::PropNameID> props;
-  props.push_back(jsi::PropNameID::forUtf8(rt, "createContext"));
-  props.push_back(jsi::PropNameID::forUtf8(rt, "dispose"));
-  return props;
+jsi::Value QuickJSSandboxRuntime::getHeapInfo(jsi::Runtime &rt) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Runtime has been disposed");
+  }
+
+  JSMemoryUsage usage;
+  JS_ComputeMemoryUsage(qjsRuntime_, &usage);
+  JSRegExpCacheStats regexpCache;
+  JS_GetRegExpCacheStats(qjsRuntime_, &regexpCache);
+
+  jsi::Object info(rt);
+  info.setProperty(rt, "malloc_size", (double)usage.malloc_size);
+  info.setProperty(rt, "malloc_count", (double)usage.malloc_count);
+  JSMallocStats mallocStats;
+  JS_GetMallocStats(qjsRuntime_, &mallocStats);
+  info.setProperty(rt, "malloc_peak_size",
+                   (double)mallocStats.peak_malloc_size);
+  info.setProperty(rt, "malloc_allocations", (double)mallocStats.allocations);
+  info.setProperty(rt, "memory_used_size", (double)usage.memory_used_size);
+  info.setProperty(rt, "atom_size", (double)usage.atom_size);
+  info.setProperty(rt, "str_size", (double)usage.str_size);
+  info.setProperty(rt, "obj_size", (double)usage.obj_size);
+  info.setProperty(rt, "shape_size", (double)usage.shape_size);
+  info.setProperty(rt, "js_func_size", (double)usage.js_func_size);
+  info.setProperty(rt, "context_count", (double)contexts_.size());
+  info.setProperty(rt, "regexp_cache_count", (double)regexpCache.count);
+  info.setProperty(rt, "regexp_cache_size", (double)regexpCache.size);
+  info.setProperty(rt, "regexp_cache_hits", (double)regexpCache.hits);
+  info.setProperty(rt, "regexp_cache_misses", (double)regexpCache.misses);
+  info.setProperty(rt, "regexp_cache_evictions",
+                   (double)regexpCache.evictions);
+  return info;
+}
+
+jsi::Value QuickJSSandboxRuntime::dumpOpcodeStats(jsi::Runtime &rt,
+                                                  size_t maxPairs) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Runtime has been disposed");
+  }
+
+  std::ostringstream out;
+  qjs::QuickJSInstrumentation::writeOpcodeStats(qjsRuntime_, out, maxPairs);
+  return jsi::String::createFromUtf8(rt, out.str());
+}
+
+void QuickJSSandboxRuntime::resetOpcodeStats() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!disposed_) {
+    JS_ResetOpcodeStats(qjsRuntime_);
+  }
+}
+
+void QuickJSSandboxRuntime::setFunctionProfiling(jsi::Runtime &rt,
+                                                 bool enabled) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Runtime has been disposed");
+  }
+  JS_SetFunctionProfiling(qjsRuntime_, enabled);
+}
+
+void QuickJSSandboxRuntime::resetFunctionProfile() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!disposed_) {
+    JS_ResetFunctionProfile(qjsRuntime_);
+  }
+}
+
+jsi::Value QuickJSSandboxRuntime::getFunctionProfile(jsi::Runtime &rt,
+                                                     size_t maxFunctions) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  if (disposed_) {
+    throw jsi::JSError(rt, "Runtime has been disposed");
+  }
+
+  auto functions =
+      qjs::QuickJSInstrumentation::collectFunctionProfile(qjsRuntime_);
+  size_t count = std::min(maxFunctions, functions.size());
+  jsi::Array result(rt, count);
+  for (size_t i = 0; i < count; i++) {
+    const auto &f = functions[i];
+    jsi::Object entry(rt);
+    entry.setProperty(rt, "name", jsi::String::createFromUtf8(rt, f.name));
+    if (!f.native) {
+      entry.setProperty(rt, "file", jsi::String::createFromUtf8(rt, f.file));
+      entry.setProperty(rt, "line", f.line);
+    }
+    entry.setProperty(rt, "native", f.native);
+    entry.setProperty(rt, "calls", (double)f.calls);
+    entry.setProperty(rt, "selfMs", f.selfNs / 1e6);
+    entry.setProperty(rt, "inclusiveMs", f.inclusiveNs / 1e6);
+    result.setValueAtIndex(rt, i, std::move(entry));
+  }
+  return result;
+}
+
+JSMallocStats QuickJSSandboxRuntime::mallocStats() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  JSMallocStats stats = {};
+  if (!disposed_) {
+    JS_GetMallocStats(qjsRuntime_, &stats);
+  }
+  return stats;
+}
+
+void QuickJSSandboxRuntime::resetMallocStats() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!disposed_) {
+    JS_ResetMallocStats(qjsRuntime_);
+  }
+}
+
+std::string QuickJSSandboxRuntime::dumpFunctionProfile(size_t maxFunctions) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::ostringstream out;
+  if (!disposed_) {
+    qjs::QuickJSInstrumentation::writeFunctionProfile(qjsRuntime_, out,
+                                                      maxFunctions);
+  }
+  return out.str();
+}
+
+void QuickJSSandboxRuntime::setRegExpCacheSize(int maxCount) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!disposed_) {
+    JS_SetRegExpCacheSize(qjsRuntime_, maxCount);
+  }
+}
+
+void QuickJSSandboxRuntime::setConversionMemoSize(size_t maxEntries) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  conversionMemoSize_ = maxEntries;
+}
+
+void QuickJSSandboxRuntime::setLazyIntrinsics(bool enabled) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  lazyIntrinsics_ = enabled;
 }
 
 jsi::Value QuickJSSandboxRuntime::createContext(jsi::Runtime &rt) {
@@ -649,29 +2555,156 @@ jsi::Value QuickJSSandboxRuntime::createContext(jsi::Runtime &rt) {
     throw jsi::JSError(rt, "Runtime has been disposed");
   }
 
-  auto context = std::make_shared<QuickJSSandboxContext>(*hostRuntime_,
-                                                         qjsRuntime_, timeout_);
+  auto context = std::make_shared<QuickJSSandboxContext>(
+      *hostRuntime_, qjsRuntime_, timeout_, lazyIntrinsics_);
+  context->setConversionMemoSize(conversionMemoSize_);
   contexts_.push_back(context);
 
   return jsi::Object::createFromHostObject(rt, context);
 }
 
+// MARK: - QuickJSBundleStream Implementation
+
+QuickJSBundleStream::QuickJSBundleStream(
+    std::shared_ptr<QuickJSSandboxContext> context, std::string sourceURL,
+    size_t expectedBytes)
+    : context_(std::move(context)),
+      compiler_(std::move(sourceURL), expectedBytes) {}
+
+// BundleStreamSlot indexes these
+static const qjs::StaticHostObject::PropertyList kBundleStreamProperties = {
+    {"append", true},
+    {"finish", true},
+    {"cancel", true},
+    {"getStats", true},
+};
+
+enum class BundleStreamSlot : size_t {
+  Append,
+  Finish,
+  Cancel,
+  GetStats,
+};
+
+const qjs::StaticHostObject::PropertyList &
+QuickJSBundleStream::properties() const {
+  return kBundleStreamProperties;
+}
+
+jsi::Value QuickJSBundleStream::getSlot(jsi::Runtime &rt, size_t slot) {
+  switch (static_cast<BundleStreamSlot>(slot)) {
+  case BundleStreamSlot::Append: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+               size_t count) -> jsi::Value {
+          if (compiler_.finished() || compiler_.cancelled()) {
+            throw jsi::JSError(rt, "Bundle stream is finished or cancelled");
+          }
+          if (count > 0 && args[0].isString()) {
+            std::string chunk = args[0].getString(rt).utf8(rt);
+            compiler_.append(chunk.data(), chunk.size());
+            return jsi::Value::undefined();
+          }
+          if (count > 0 && args[0].isObject()) {
+            jsi::Object object = args[0].getObject(rt);
+            if (object.isArrayBuffer(rt)) {
+              jsi::ArrayBuffer buffer = object.getArrayBuffer(rt);
+              compiler_.append(reinterpret_cast<const char *>(buffer.data(rt)),
+                               buffer.size(rt));
+              return jsi::Value::undefined();
+            }
+          }
+          throw jsi::JSError(rt,
+                             "append requires a string or ArrayBuffer chunk");
+        });
+  }
+
+  case BundleStreamSlot::Finish: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value {
+          if (compiler_.finished() || compiler_.cancelled()) {
+            throw jsi::JSError(rt, "Bundle stream is finished or cancelled");
+          }
+          compiler_.finish();
+          std::shared_ptr<QuickJSSandboxContext> context = context_.lock();
+          if (!context) {
+            throw jsi::JSError(rt, "Context has been disposed");
+          }
+          return context->evalBundle(rt, compiler_);
+        });
+  }
+
+  case BundleStreamSlot::Cancel: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value {
+          compiler_.cancel();
+          return jsi::Value::undefined();
+        });
+  }
+
+  case BundleStreamSlot::GetStats: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [this](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+               size_t) -> jsi::Value {
+          BundleCompiler::Stats stats = compiler_.stats();
+          jsi::Object result(rt);
+          result.setProperty(rt, "bytes", (double)stats.bytes);
+          result.setProperty(rt, "chunks", (double)stats.chunks);
+          result.setProperty(rt, "compileMs", stats.compileMs);
+          result.setProperty(rt, "waitMs", stats.waitMs);
+          result.setProperty(rt, "streamed", stats.streamed);
+          return result;
+        });
+  }
+  }
+  return jsi::Value::undefined();
+}
+
 // MARK: - QuickJSSandboxModule Implementation
 
 QuickJSSandboxModule::QuickJSSandboxModule(jsi::Runtime &) {}
 
 QuickJSSandboxModule::~QuickJSSandboxModule() {}
 
-jsi::Value QuickJSSandboxModule::get(jsi::Runtime &rt,
-                                     const jsi::PropNameID &name) {
-  std::string propName = name.utf8(rt);
+// Properties of the module (ModuleSlot)
+static const qjs::StaticHostObject::PropertyList kModuleProperties = {
+    {"createRuntime", true},
+    {"estimateSize", true},
+    {"createTreeStore", true},
+    {"getBootstrapScripts", true},
+    {"isAvailable", true},
+};
+
+enum class ModuleSlot : size_t {
+  CreateRuntime,
+  EstimateSize,
+  CreateTreeStore,
+  GetBootstrapScripts,
+  IsAvailable,
+};
+
+const qjs::StaticHostObject::PropertyList &
+QuickJSSandboxModule::properties() const {
+  return kModuleProperties;
+}
 
-  if (propName == "createRuntime") {
+jsi::Value QuickJSSandboxModule::getSlot(jsi::Runtime &rt, size_t slot) {
+  switch (static_cast<ModuleSlot>(slot)) {
+  case ModuleSlot::CreateRuntime: {
     return jsi::Function::createFromHostFunction(
-        rt, name, 1,
+        rt, propertyName(rt, slot), 1,
         [](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
            size_t count) -> jsi::Value {
           double timeout = 30000; // default 30s
+          int regexpCacheSize = JS_REGEXP_CACHE_DEFAULT_SIZE;
+          double conversionMemoSize = kDefaultConversionMemoSize;
+          bool lazyIntrinsics = false;
 
           if (count > 0 && args[0].isObject()) {
             jsi::Object opts = args[0].asObject(rt);
@@ -681,20 +2714,87 @@ jsi::Value QuickJSSandboxModule::get(jsi::Runtime &rt,
                 timeout = timeoutVal.getNumber();
               }
             }
+            if (opts.hasProperty(rt, "regexpCacheSize")) {
+              jsi::Value sizeVal = opts.getProperty(rt, "regexpCacheSize");
+              if (sizeVal.isNumber()) {
+                regexpCacheSize = (int)sizeVal.getNumber();
+              }
+            }
+            if (opts.hasProperty(rt, "conversionMemoSize")) {
+              jsi::Value memoVal = opts.getProperty(rt, "conversionMemoSize");
+              if (memoVal.isNumber()) {
+                conversionMemoSize = std::max(0.0, memoVal.getNumber());
+              }
+            }
+            if (opts.hasProperty(rt, "lazyIntrinsics")) {
+              jsi::Value lazyVal = opts.getProperty(rt, "lazyIntrinsics");
+              if (lazyVal.isBool()) {
+                lazyIntrinsics = lazyVal.getBool();
+              }
+            }
           }
 
           auto runtime = std::make_shared<QuickJSSandboxRuntime>(rt, timeout);
+          runtime->setRegExpCacheSize(regexpCacheSize);
+          runtime->setConversionMemoSize((size_t)conversionMemoSize);
+          runtime->setLazyIntrinsics(lazyIntrinsics);
           return jsi::Object::createFromHostObject(rt, runtime);
         });
   }
 
-  if (propName == "isAvailable") {
+  case ModuleSlot::EstimateSize: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 1,
+        [](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+           size_t count) -> jsi::Value {
+          if (count < 1) {
+            return sizeEstimateToJSI(rt, SizeEstimate());
+          }
+          return sizeEstimateToJSI(rt, estimateSize(rt, args[0]));
+        });
+  }
+
+  case ModuleSlot::CreateTreeStore: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+           size_t) -> jsi::Value {
+          return jsi::Object::createFromHostObject(
+              rt, std::make_shared<NodeTreeStore>());
+        });
+  }
+
+  case ModuleSlot::GetBootstrapScripts: {
+    return jsi::Function::createFromHostFunction(
+        rt, propertyName(rt, slot), 0,
+        [](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *,
+           size_t) -> jsi::Value {
+          size_t count;
+          const BootstrapScript *scripts = bootstrapScripts(&count);
+          jsi::Array result(rt, count);
+          for (size_t i = 0; i < count; i++) {
+            jsi::Object entry(rt);
+            entry.setProperty(
+                rt, "name", jsi::String::createFromUtf8(rt, scripts[i].name));
+            entry.setProperty(rt, "bytecodeBytes",
+                              (double)scripts[i].bytecodeSize);
+            entry.setProperty(rt, "sourceBytes",
+                              (double)scripts[i].sourceLength);
+            entry.setProperty(rt, "uses",
+                              (double)bootstrapScriptUses(scripts[i]));
+            result.setValueAtIndex(rt, i, std::move(entry));
+          }
+          return result;
+        });
+  }
+
+  case ModuleSlot::IsAvailable: {
     return jsi::Function::createFromHostFunction(
-        rt, name, 0,
+        rt, propertyName(rt, slot), 0,
         [](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
            size_t) -> jsi::Value { return jsi::Value(true); });
   }
-
+  }
   return jsi::Value::undefined();
 }
 
@@ -703,14 +2803,6 @@ void QuickJSSandboxModule::set(jsi::Runtime &, const jsi::PropNameID &,
   // Read-only
 }
 
-std::vector<jsi::PropNameID>
-QuickJSSandboxModule::getPropertyNames(jsi::Runtime &rt) {
-  std::vector<jsi::PropNameID> props;
-  props.push_back(jsi::PropNameID::forUtf8(rt, "createRuntime"));
-  props.push_back(jsi::PropNameID::forUtf8(rt, "isAvailable"));
-  return props;
-}
-
 void QuickJSSandboxModule::install(jsi::Runtime &runtime) {
   auto module = std::make_shared<QuickJSSandboxModule>(runtime);
   jsi::Object moduleObj = jsi::Object::createFromHostObject(runtime, module);
@@ -1,40 +1,203 @@
 #pragma once
 
+#include "Bootstrap.h"
+#include "BoundaryStats.h"
+#include "BundleCompiler.h"
+#include "HostEventQueue.h"
+#include "MessageRing.h"
+#include "OperationArena.h"
+#include "OperationCoalescer.h"
+#include "StaticHostObject.h"
+#include "TraceBuffer.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <jsi/jsi.h>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <quickjs.h>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace quickjs_sandbox {
 
 using namespace facebook;
 
+/**
+ * SizeEstimate - Approximate JSON.stringify() footprint of a value
+ *
+ * bytes is the UTF-8 length of the JSON text, ignoring string escapes,
+ * toJSON() and the exact digits of non-integral numbers.
+ */
+struct SizeEstimate {
+  size_t bytes = 0;
+  size_t objects = 0; // objects and arrays
+  size_t strings = 0; // string values (keys are not counted)
+};
+
+/**
+ * Walk a host value the way JSON.stringify would, without building the
+ * JSON text. Throws jsi::JSError for values nested too deeply (cycles).
+ *
+ * Strings and keys are measured in place (getStringData()), but each
+ * object still costs a property-name array and a handle per property
+ * through jsi, so this path is cheaper than JSON.stringify, not
+ * allocation-free. Guest values measured during conversion are.
+ */
+SizeEstimate estimateSize(jsi::Runtime &rt, const jsi::Value &value);
+
 /**
  * QuickJSSandboxContext - Wraps a single isolated QuickJS context
  *
  * Exposed to JS as a HostObject with SYNCHRONOUS methods:
- * - eval(code: string): unknown
+ * - eval(code: string, sourceURL?: string): unknown
+ * - evalBuffer(buffer: ArrayBuffer, sourceURL?: string): unknown
+ * - evalFile(path: string, sourceURL?: string): unknown
+ * - createBundleStream(sourceURL?: string, expectedBytes?: number): BundleStream
  * - setGlobal(name: string, value: unknown): void
  * - getGlobal(name: string): unknown
+ * - estimateSize(value: unknown): { bytes, objects, strings }
+ * - setOperationSink(name: string, fn: (batch) => void): void
+ * - getCoalescingStats(): { batches, opsIn, opsOut, ... }
+ * - getConversionStats(): { hits, misses, entries, evictions, capacity }
+ * - openMessageRing(name: string, capacityBytes?: number): void
+ * - drainMessages(maxMessages?: number): unknown[]
+ * - getMessageRingStats(): { capacity, usedBytes, highWaterBytes, ... }
+ * - setHostEventPolicy(name: string, policy: 'all' | 'latest' | 'accumulate')
+ * - queueHostEvent(name: string, payload: unknown): number
+ * - flushHostEvents(handler: string, maxEvents?: number): number
+ * - getHostEventStats(): { queued, coalesced, delivered, pending, ... }
+ * - getBoundaryStats(): { toGuest, toHost, hostCalls, guestCalls, ... }
+ * - resetBoundaryStats(): void
+ * - drainTrace(maxEntries?: number): { names, name, kind, startTime, duration }
+ * - getTraceStats(): { recorded, dropped, drained, pending, ... }
  * - dispose(): void
+ *
+ * Arguments of a guest -> host call are measured while they are converted,
+ * so estimateSize() on one of them inside the host callback is a lookup.
+ *
+ * setOperationSink() installs `fn` as a global like setGlobal(), but the
+ * batch passed to it is coalesced natively (see OperationCoalescer) before
+ * it is converted.
+ *
+ * Guest objects and arrays that can no longer change (frozen, containing
+ * only primitives and such objects, e.g. StyleSheet.create() results with
+ * the Engine's freezeStyles option) are converted once: the host object is
+ * reused, keyed by the guest object, while it stays in a bounded LRU memo. The host copy is shared by every
+ * conversion of that guest object and is not frozen, so host code must
+ * copy it before changing it (the Receiver does). The guest global
+ * `__rill_conversion_memo` is true while the memo is enabled.
+ *
+ * openMessageRing() installs a guest global `name(message): boolean` that
+ * JSON-encodes its argument into a per-context MessageRing and returns
+ * false when the ring is full. drainMessages() decodes everything posted
+ * since the last drain in one step and does not take the context lock, so
+ * the host can drain while the guest runs elsewhere. Open the ring before
+ * the context is shared with another thread; it lives until the context
+ * is destroyed.
+ *
+ * queueHostEvent() holds host -> guest events natively, coalesced per event
+ * name (see HostEventQueue), and flushHostEvents() converts the survivors
+ * and calls the guest global `handler(name, payload)` for each of them in
+ * one host call.
+ *
+ * Every conversion and trampoline call is counted and timed (see
+ * BoundaryStats); getBoundaryStats() reports the totals since the context
+ * was created or the last resetBoundaryStats().
+ *
+ * The guest gets a native `performance` with now(), mark(name, options?),
+ * measure(name, startOrOptions?, endMark?), clearMarks(name?) and
+ * timeOrigin, and native console.time()/timeLog()/timeEnd(). Marks,
+ * measures and ended console timers are recorded in a per-context
+ * TraceBuffer instead of crossing the boundary; drainTrace() returns
+ * everything recorded since the last drain, decoded in one step, as
+ * parallel arrays: entry i is named names[name[i]], is a mark (kind 0) or
+ * a measure (kind 1), and has startTime[i] and duration[i]. Times are ms
+ * since the context was created (timeOrigin, a wall-clock epoch time, is
+ * in getTraceStats()).
+ *
+ * The guest reconciler records its operations with native intrinsics
+ * instead of allocating op objects: __rill_op_create(id, type, props),
+ * __rill_op_update(id, props, removedProps), __rill_op_delete(id),
+ * __rill_op_append(parentId, childId), __rill_op_insert(parentId, childId,
+ * index), __rill_op_remove(parentId, childId) and __rill_op_push(op) for
+ * any other operation append to a per-context OperationArena, and
+ * __rill_op_commit(sink, version, batchId) hands everything recorded to
+ * `sink` as one { version, batchId, operations } batch, returning the
+ * operation count. When `sink` is the function installed by
+ * setOperationSink(), the batch is built directly as a host value (one
+ * crossing, not coalesced), so the operations never exist as guest
+ * objects; any other sink is called with a guest batch.
+ * __rill_op_pending() and __rill_op_counts() ({ [op]: count }) describe
+ * the operations not committed yet.
+ *
+ * createBundleStream() evaluates a bundle that is still downloading: it is
+ * compiled on a worker thread as its chunks are appended (see
+ * BundleCompiler and QuickJSBundleStream), so finish() only has to wait
+ * for the tail and run it.
+ *
+ * evalBuffer() parses UTF-8 source in place from the host ArrayBuffer's
+ * memory instead of going through a host string. The parser needs a '\0'
+ * after the source: a buffer ending in one is parsed up to it, anything
+ * else is copied once. The buffer is never written. evalFile() maps
+ * the file (see MappedFile), so the source never reaches the heap. The
+ * sourceURL (default "<eval>", or the path for evalFile()) names the
+ * script in stack traces.
  */
-class QuickJSSandboxContext : public jsi::HostObject {
+class QuickJSSandboxContext
+    : public qjs::StaticHostObject,
+      public std::enable_shared_from_this<QuickJSSandboxContext> {
 public:
+  // lazyIntrinsics: see QuickJSSandboxRuntime::setLazyIntrinsics()
   QuickJSSandboxContext(jsi::Runtime &hostRuntime, JSRuntime *qjsRuntime,
-                        double timeout);
+                        double timeout, bool lazyIntrinsics = false);
   ~QuickJSSandboxContext() override;
 
-  jsi::Value get(jsi::Runtime &rt, const jsi::PropNameID &name) override;
+  const PropertyList &properties() const override;
+  jsi::Value getSlot(jsi::Runtime &rt, size_t slot) override;
   void set(jsi::Runtime &rt, const jsi::PropNameID &name,
            const jsi::Value &value) override;
-  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime &rt) override;
 
-  jsi::Value eval(jsi::Runtime &rt, const std::string &code);
+  jsi::Value eval(jsi::Runtime &rt, const std::string &code,
+                  const char *sourceURL = "<eval>");
+  jsi::Value evalBuffer(jsi::Runtime &rt, const uint8_t *data, size_t size,
+                        const char *sourceURL);
+  jsi::Value evalFile(jsi::Runtime &rt, const std::string &path,
+                      const char *sourceURL);
+  // Evaluate an embedded bootstrap script's bytecode (see Bootstrap.h)
+  jsi::Value evalBootstrap(jsi::Runtime &rt, const BootstrapScript &script);
+  // Evaluate a streamed bundle once `compiler` is finished: its bytecode,
+  // or its source when it could not be compiled ahead. Blocks until the
+  // worker is done (without holding the context lock).
+  jsi::Value evalBundle(jsi::Runtime &rt, BundleCompiler &compiler);
+  // Run up to maxJobs queued promise jobs of the sandbox runtime (shared by
+  // its contexts); returns the number run. Native embedders only: the JS
+  // API does not expose it.
+  size_t runPendingJobs(jsi::Runtime &rt, size_t maxJobs = SIZE_MAX);
   void setGlobal(jsi::Runtime &rt, const std::string &name,
                  const jsi::Value &value);
   jsi::Value getGlobal(jsi::Runtime &rt, const std::string &name);
+  SizeEstimate estimateSize(jsi::Runtime &rt, const jsi::Value &value);
+  void setOperationSink(jsi::Runtime &rt, const std::string &name,
+                        jsi::Function &&func);
+  jsi::Value getCoalescingStats(jsi::Runtime &rt);
+  jsi::Value getConversionStats(jsi::Runtime &rt);
+  void setConversionMemoSize(size_t maxEntries);
+  void openMessageRing(jsi::Runtime &rt, const std::string &name,
+                       size_t capacityBytes);
+  jsi::Value drainMessages(jsi::Runtime &rt, size_t maxMessages);
+  jsi::Value getMessageRingStats(jsi::Runtime &rt);
+  size_t queueHostEvent(jsi::Runtime &rt, const std::string &name,
+                        const jsi::Value &payload);
+  size_t flushHostEvents(jsi::Runtime &rt, const std::string &handler,
+                         size_t maxEvents);
+  jsi::Value getHostEventStats(jsi::Runtime &rt);
+  jsi::Value getBoundaryStats(jsi::Runtime &rt);
+  void resetBoundaryStats();
+  jsi::Value drainTrace(jsi::Runtime &rt, size_t maxEntries);
+  jsi::Value getTraceStats(jsi::Runtime &rt);
   void dispose();
 
   bool isDisposed() const { return disposed_; }
@@ -51,47 +214,191 @@ private:
     QuickJSSandboxContext *self;
     std::shared_ptr<jsi::Function> func;
     std::string callbackId;
+    bool coalesceOperations;
   };
   std::unordered_map<std::string, std::shared_ptr<jsi::Function>> callbacks_;
   int callbackCounter_;
 
+  // Sizes of the object arguments of the guest -> host call in progress
+  struct ArgEstimate {
+    const jsi::Value *value;
+    SizeEstimate estimate;
+  };
+  std::vector<ArgEstimate> callEstimates_;
+
+  // Created by the first setOperationSink()
+  std::unique_ptr<OperationCoalescer> coalescer_;
+  // The latest setOperationSink() function: its guest wrapper (retained)
+  // and the host function, for commits from the arena
+  JSValue operationSink_;
+  std::shared_ptr<jsi::Function> operationSinkFunc_;
+  // Operations recorded by the __rill_op_* intrinsics since the last commit
+  std::unique_ptr<OperationArena> operations_;
+
+  // Conversion memo, most recently used first
+  struct MemoEntry {
+    JSValue key; // keeps the guest object (and so its address) alive
+    jsi::Value value;
+    SizeEstimate estimate;
+    bool hasEstimate;
+  };
+  struct MemoStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+  std::list<MemoEntry> memoLru_;
+  std::unordered_map<void *, std::list<MemoEntry>::iterator> memoIndex_;
+  size_t memoCapacity_;
+  MemoStats memoStats_;
+  // Bumped for every converted object, array or function that is not
+  // memoized, so a parent can tell whether all of its contents were
+  uint64_t mutableConversions_;
+
+  // Created by openMessageRing() and kept until the context is destroyed.
+  // The consumer reads it without the context lock, so it is published
+  // through messageRingView_; drainScratch_ belongs to the consumer
+  std::unique_ptr<MessageRing> messageRing_;
+  std::atomic<MessageRing *> messageRingView_{nullptr};
+  std::string drainScratch_;
+
+  HostEventQueue hostEvents_;
+  std::vector<HostEventQueue::Event> eventScratch_;
+
+  BoundaryStats boundary_;
+  // Nesting of the conversions in progress, per direction
+  int toGuestDepth_;
+  int toHostDepth_;
+
+  // User Timing entries of the guest's performance and console timers
+  TraceBuffer trace_;
+
   // JS class for HostFunctionData opaque storage
   static JSClassID hostFunctionDataClassID_;
   static void hostFunctionDataFinalizer(JSRuntime *rt, JSValue val);
   void ensureClassRegistered();
 
   JSValue jsiToQJS(jsi::Runtime &rt, const jsi::Value &value);
-  jsi::Value qjsToJSI(jsi::Runtime &rt, JSValue value);
-  JSValue wrapFunctionForSandbox(jsi::Runtime &rt, jsi::Function &&func);
+  jsi::Value qjsToJSI(jsi::Runtime &rt, JSValue value,
+                      SizeEstimate *estimate = nullptr);
+  jsi::Value qjsObjectToJSI(jsi::Runtime &rt, JSValue value,
+                            SizeEstimate *estimate);
+  void memoInsert(jsi::Runtime &rt, JSValue value, const jsi::Value &result,
+                  const SizeEstimate *estimate);
+  void clearMemo();
+  JSValue wrapFunctionForSandbox(jsi::Runtime &rt, jsi::Function &&func,
+                                 bool coalesceOperations = false);
 
   void checkException();
+  // With mutex_ held: evaluate `length` bytes of source at `code`, which
+  // must be followed by a '\0', as the global script sourceURL (embedded
+  // bootstrap scripts run from their bytecode). The source is no longer
+  // read once parsed() is called, before the script runs.
+  JSValue evalSource(const char *code, size_t length, const char *sourceURL,
+                     const std::function<void()> &parsed = nullptr);
+  // Convert an eval completion value, throwing on JS_EXCEPTION
+  jsi::Value takeEvalResult(jsi::Runtime &rt, JSValue result);
   void installConsole();
+  void installPerformance();
+  void installOperations();
+  // __rill_op_commit(): deliver the arena's operations to `sink`
+  JSValue commitOperations(JSValueConst sink, double version, double batchId);
+  jsi::Object operationBatchToJSI(jsi::Runtime &rt, double version,
+                                  double batchId);
 
   static JSValue hostFunctionCallback(JSContext *ctx, JSValueConst this_val,
                                       int argc, JSValueConst *argv, int magic,
                                       JSValue *func_data);
+  static JSValue messageRingPost(JSContext *ctx, JSValueConst this_val,
+                                 int argc, JSValueConst *argv);
+  // performance.* and console.time*(); magic is a GuestTiming
+  static JSValue guestTiming(JSContext *ctx, JSValueConst this_val, int argc,
+                             JSValueConst *argv, int magic);
+  // __rill_op_*(); magic is a GuestOperation
+  static JSValue guestOperation(JSContext *ctx, JSValueConst this_val,
+                                int argc, JSValueConst *argv, int magic);
+};
+
+/**
+ * QuickJSBundleStream - A bundle being compiled while it downloads
+ *
+ * Returned by QuickJSSandboxContext's createBundleStream(). Exposed to JS
+ * as a HostObject with:
+ * - append(chunk: string | ArrayBuffer): void (UTF-8 bytes)
+ * - finish(): unknown - evaluates the bundle in the context and returns
+ *   its completion value, like eval()
+ * - cancel(): void
+ * - getStats(): { bytes, chunks, compileMs, waitMs, streamed }
+ *
+ * Dropping the stream without finish() cancels the compile. The stream
+ * does not keep the context alive.
+ */
+class QuickJSBundleStream : public qjs::StaticHostObject {
+public:
+  QuickJSBundleStream(std::shared_ptr<QuickJSSandboxContext> context,
+                      std::string sourceURL, size_t expectedBytes);
+
+  const PropertyList &properties() const override;
+  jsi::Value getSlot(jsi::Runtime &rt, size_t slot) override;
+
+private:
+  std::weak_ptr<QuickJSSandboxContext> context_;
+  BundleCompiler compiler_;
 };
 
 /**
  * QuickJSSandboxRuntime - Factory for isolated contexts
+ *
+ * All contexts of a runtime share one JSRuntime, so runtime-wide caches
+ * (e.g. compiled RegExp programs) are shared between them.
+ *
+ * With lazyIntrinsics, contexts are created with JS_NewContextLazy(): the
+ * Date, Map/Set and typed array built-ins are only instantiated when the
+ * guest first reads one of their globals, which roughly halves the fixed
+ * cost of a context that never uses them.
+ *
+ * Exposed to JS as a HostObject with:
+ * - createContext(): Context
+ * - getHeapInfo(): { [key: string]: number }, including the allocator
+ *   peak (malloc_peak_size) and allocation count (malloc_allocations)
+ * - dispose(): void
  */
-class QuickJSSandboxRuntime : public jsi::HostObject {
+class QuickJSSandboxRuntime : public qjs::StaticHostObject {
 public:
   QuickJSSandboxRuntime(jsi::Runtime &hostRuntime, double timeout);
   ~QuickJSSandboxRuntime() override;
 
-  jsi::Value get(jsi::Runtime &rt, const jsi::PropNameID &name) override;
+  const PropertyList &properties() const override;
+  jsi::Value getSlot(jsi::Runtime &rt, size_t slot) override;
   void set(jsi::Runtime &rt, const jsi::PropNameID &name,
            const jsi::Value &value) override;
-  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime &rt) override;
 
   jsi::Value createContext(jsi::Runtime &rt);
+  jsi::Value getHeapInfo(jsi::Runtime &rt);
+  // Opcode histogram of all contexts (builds with CONFIG_OPCODE_STATS)
+  jsi::Value dumpOpcodeStats(jsi::Runtime &rt, size_t maxPairs);
+  void resetOpcodeStats();
+  // Instrumented per-function profile of all contexts, by self time
+  void setFunctionProfiling(jsi::Runtime &rt, bool enabled);
+  void resetFunctionProfile();
+  jsi::Value getFunctionProfile(jsi::Runtime &rt, size_t maxFunctions);
+  std::string dumpFunctionProfile(size_t maxFunctions);
+  // Allocator totals and peak since creation or the last reset. Native
+  // embedders only: getHeapInfo() reports them to JS.
+  JSMallocStats mallocStats();
+  void resetMallocStats();
+  void setRegExpCacheSize(int maxCount);
+  void setConversionMemoSize(size_t maxEntries);
+  // Applies to contexts created afterwards
+  void setLazyIntrinsics(bool enabled);
   void dispose();
 
 private:
   JSRuntime *qjsRuntime_;
   jsi::Runtime *hostRuntime_;
   double timeout_;
+  size_t conversionMemoSize_;
+  bool lazyIntrinsics_ = false;
   bool disposed_;
   std::vector<std::shared_ptr<QuickJSSandboxContext>> contexts_;
   std::recursive_mutex mutex_;
@@ -101,18 +408,21 @@ private:
  * QuickJSSandboxModule - Top-level JSI module
  *
  * Installed as global.__QuickJSSandboxJSI with:
- * - createRuntime(options?: { timeout?: number }): Runtime
+ * - createRuntime(options?: { timeout?: number, regexpCacheSize?: number,
+ *   conversionMemoSize?: number, lazyIntrinsics?: boolean }): Runtime
+ * - estimateSize(value: unknown): { bytes, objects, strings }
+ * - createTreeStore(): NodeTreeStore
  * - isAvailable(): boolean
  */
-class QuickJSSandboxModule : public jsi::HostObject {
+class QuickJSSandboxModule : public qjs::StaticHostObject {
 public:
   explicit QuickJSSandboxModule(jsi::Runtime &runtime);
   ~QuickJSSandboxModule() override;
 
-  jsi::Value get(jsi::Runtime &rt, const jsi::PropNameID &name) override;
+  const PropertyList &properties() const override;
+  jsi::Value getSlot(jsi::Runtime &rt, size_t slot) override;
   void set(jsi::Runtime &rt, const jsi::PropNameID &name,
            const jsi::Value &value) override;
-  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime &rt) override;
 
   static void install(jsi::Runtime &runtime);
 };
@@ -0,0 +1,31 @@
+#include "StaticHostObject.h"
+
+namespace qjs {
+
+jsi::Value StaticHostObject::get(jsi::Runtime &rt,
+                                 const jsi::PropNameID &name) {
+  std::string propName = name.utf8(rt);
+  const PropertyList &props = properties();
+  for (size_t slot = 0; slot < props.size(); slot++) {
+    if (propName == props[slot].name) {
+      return getSlot(rt, slot);
+    }
+  }
+  return jsi::Value::undefined();
+}
+
+std::vector<jsi::PropNameID> StaticHostObject::getPropertyNames(
+    jsi::Runtime &rt) {
+  std::vector<jsi::PropNameID> names;
+  for (const Property &property : properties()) {
+    names.push_back(jsi::PropNameID::forAscii(rt, property.name));
+  }
+  return names;
+}
+
+jsi::PropNameID StaticHostObject::propertyName(jsi::Runtime &rt,
+                                               size_t slot) const {
+  return jsi::PropNameID::forAscii(rt, properties()[slot].name);
+}
+
+} // namespace qjs
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <jsi/jsi.h>
+#include <vector>
+
+namespace jsi = facebook::jsi;
+
+namespace qjs {
+
+/**
+ * StaticHostObject - A HostObject with a fixed set of properties
+ *
+ * The class declares its properties once (properties()) and answers gets
+ * by slot, the index in that list. A QuickJSRuntime host maps property
+ * atoms to slots once per class, so a get needs neither a PropNameID nor
+ * string compares, and keeps the function returned for a method slot on
+ * the object, so each method is created once per object. Names outside
+ * the list read as undefined.
+ *
+ * Other runtimes go through get() and getPropertyNames(), implemented
+ * here on top of the slots.
+ */
+class StaticHostObject : public jsi::HostObject {
+public:
+  struct Property {
+    const char *name;
+    // The value is a function that stays valid for the object's lifetime
+    bool method;
+  };
+  using PropertyList = std::vector<Property>;
+
+  // The same list, at the same address, for every object of the class
+  virtual const PropertyList &properties() const = 0;
+  virtual jsi::Value getSlot(jsi::Runtime &rt, size_t slot) = 0;
+
+  jsi::Value get(jsi::Runtime &rt, const jsi::PropNameID &name) override;
+  std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime &rt) override;
+
+protected:
+  // Name for the function of a method slot
+  jsi::PropNameID propertyName(jsi::Runtime &rt, size_t slot) const;
+};
+
+} // namespace qjs
@@ -0,0 +1,300 @@
+#include "TraceBuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace quickjs_sandbox {
+
+namespace {
+
+double steadyMs() {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void appendJsonString(std::string &out, std::string_view text) {
+  static const char kHex[] = "0123456789abcdef";
+  out.push_back('"');
+  for (char c : text) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if ((unsigned char)c < 0x20) {
+        out += "\\u00";
+        out.push_back(kHex[(unsigned char)c >> 4]);
+        out.push_back(kHex[c & 0xf]);
+      } else {
+        out.push_back(c);
+      }
+    }
+  }
+  out.push_back('"');
+}
+
+void appendUint(std::string &out, uint64_t value) {
+  char buffer[24];
+  char *end = buffer + sizeof(buffer);
+  char *p = end;
+  do {
+    *--p = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  out.append(p, (size_t)(end - p));
+}
+
+// ms rounded to the clock's nanosecond resolution; %g would cost more
+// than the rest of the entry
+void appendMs(std::string &out, double ms) {
+  if (!std::isfinite(ms)) {
+    out += "null";
+    return;
+  }
+  if (std::fabs(ms) >= 1e12) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.17g", ms);
+    out.append(buffer, (size_t)length);
+    return;
+  }
+  int64_t ns = std::llround(ms * 1e6);
+  if (ns < 0) {
+    out.push_back('-');
+    ns = -ns;
+  }
+  appendUint(out, (uint64_t)(ns / 1000000));
+  uint32_t fraction = (uint32_t)(ns % 1000000);
+  if (fraction != 0) {
+    char digits[7] = {'.'};
+    int length = 6;
+    for (int i = 6; i > 0; i--, fraction /= 10) {
+      digits[i] = (char)('0' + fraction % 10);
+    }
+    while (digits[length] == '0') {
+      length--;
+    }
+    out.append(digits, (size_t)length + 1);
+  }
+}
+
+} // namespace
+
+TraceBuffer::TraceBuffer(size_t capacity, size_t nameCapacity)
+    : origin_(steadyMs()),
+      timeOrigin_(std::chrono::duration<double, std::milli>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count()),
+      capacity_(capacity), nameCapacity_(nameCapacity) {}
+
+double TraceBuffer::now() const { return steadyMs() - origin_; }
+
+uint32_t TraceBuffer::intern(std::string_view name) {
+  auto it = nameIndex_.find(name);
+  if (it != nameIndex_.end()) {
+    return it->second;
+  }
+  if (nameIndex_.size() >= nameCapacity_) {
+    return kNoName;
+  }
+  Name entry{std::string(name), std::string(), NAN, NAN, 0, UINT32_MAX};
+  appendJsonString(entry.json, name);
+  uint32_t index;
+  if (!freeNames_.empty()) {
+    index = freeNames_.back();
+    freeNames_.pop_back();
+    names_[index] = std::move(entry);
+  } else {
+    index = (uint32_t)names_.size();
+    names_.push_back(std::move(entry));
+  }
+  nameIndex_.emplace(names_[index].text, index);
+  return index;
+}
+
+uint32_t TraceBuffer::find(std::string_view name) const {
+  auto it = nameIndex_.find(name);
+  return it != nameIndex_.end() ? it->second : kNoName;
+}
+
+void TraceBuffer::release(uint32_t name) {
+  if (name == kNoName) {
+    return;
+  }
+  Name &entry = names_[name];
+  if (entry.pending != 0 || !std::isnan(entry.markTime) ||
+      !std::isnan(entry.timerStart)) {
+    return;
+  }
+  nameIndex_.erase(entry.text);
+  entry.text = std::string();
+  entry.json = std::string();
+  freeNames_.push_back(name);
+}
+
+void TraceBuffer::record(EntryType type, uint32_t name, double startTime,
+                         double duration) {
+  recorded_++;
+  if (name == kNoName || entries_.size() - head_ >= capacity_) {
+    dropped_++;
+    release(name);
+    return;
+  }
+  names_[name].pending++;
+  entries_.push_back(Entry{type, name, startTime, duration});
+}
+
+void TraceBuffer::mark(uint32_t name, double startTime) {
+  if (name != kNoName) {
+    names_[name].markTime = startTime;
+  }
+  record(EntryType::Mark, name, startTime, 0);
+}
+
+bool TraceBuffer::markTime(uint32_t name, double *time) const {
+  if (name == kNoName || std::isnan(names_[name].markTime)) {
+    return false;
+  }
+  *time = names_[name].markTime;
+  return true;
+}
+
+void TraceBuffer::clearMark(uint32_t name) {
+  if (name != kNoName) {
+    names_[name].markTime = NAN;
+    release(name);
+  }
+}
+
+void TraceBuffer::clearMarks() {
+  for (uint32_t i = 0; i < names_.size(); i++) {
+    if (!std::isnan(names_[i].markTime)) {
+      names_[i].markTime = NAN;
+      release(i);
+    }
+  }
+}
+
+void TraceBuffer::measure(uint32_t name, double startTime, double endTime) {
+  record(EntryType::Measure, name, startTime, endTime - startTime);
+}
+
+bool TraceBuffer::startTimer(uint32_t name) {
+  if (name == kNoName) {
+    dropped_++;
+    return true;
+  }
+  if (!std::isnan(names_[name].timerStart)) {
+    return false;
+  }
+  names_[name].timerStart = now();
+  return true;
+}
+
+bool TraceBuffer::timerElapsed(uint32_t name, double *ms) const {
+  if (name == kNoName || std::isnan(names_[name].timerStart)) {
+    return false;
+  }
+  *ms = now() - names_[name].timerStart;
+  return true;
+}
+
+bool TraceBuffer::endTimer(uint32_t name, double *ms) {
+  if (name == kNoName || std::isnan(names_[name].timerStart)) {
+    return false;
+  }
+  double start = names_[name].timerStart;
+  double end = now();
+  names_[name].timerStart = NAN;
+  measure(name, start, end);
+  *ms = end - start;
+  return true;
+}
+
+size_t TraceBuffer::drainJson(std::string &json, size_t maxEntries) {
+  size_t count = std::min(entries_.size() - head_, maxEntries);
+  const Entry *first = entries_.data() + head_;
+
+  // Number the names these entries use
+  drainNames_.clear();
+  json += "{\"names\":[";
+  for (size_t i = 0; i < count; i++) {
+    Name &name = names_[first[i].name];
+    if (name.drainIndex == UINT32_MAX) {
+      if (!drainNames_.empty()) {
+        json.push_back(',');
+      }
+      json += name.json;
+      name.drainIndex = (uint32_t)drainNames_.size();
+      drainNames_.push_back(first[i].name);
+    }
+  }
+  json.push_back(']');
+
+  auto column = [&](const char *key, auto &&append) {
+    json += key;
+    for (size_t i = 0; i < count; i++) {
+      if (i > 0) {
+        json.push_back(',');
+      }
+      append(first[i]);
+    }
+    json.push_back(']');
+  };
+  column(",\"name\":[", [&](const Entry &entry) {
+    appendUint(json, names_[entry.name].drainIndex);
+  });
+  column(",\"kind\":[", [&](const Entry &entry) {
+    json.push_back(entry.type == EntryType::Mark ? '0' : '1');
+  });
+  column(",\"startTime\":[",
+         [&](const Entry &entry) { appendMs(json, entry.startTime); });
+  column(",\"duration\":[",
+         [&](const Entry &entry) { appendMs(json, entry.duration); });
+  json.push_back('}');
+
+  for (size_t i = 0; i < count; i++) {
+    names_[first[i].name].pending--;
+  }
+  for (uint32_t name : drainNames_) {
+    names_[name].drainIndex = UINT32_MAX;
+    release(name);
+  }
+
+  head_ += count;
+  drained_ += count;
+  if (head_ == entries_.size()) {
+    entries_.clear();
+    head_ = 0;
+  } else if (head_ > entries_.size() / 2) {
+    entries_.erase(entries_.begin(), entries_.begin() + (ptrdiff_t)head_);
+    head_ = 0;
+  }
+  return count;
+}
+
+TraceBuffer::Stats TraceBuffer::stats() const {
+  Stats stats;
+  stats.recorded = recorded_;
+  stats.dropped = dropped_;
+  stats.drained = drained_;
+  stats.pending = entries_.size() - head_;
+  stats.capacity = capacity_;
+  stats.names = nameIndex_.size();
+  return stats;
+}
+
+} // namespace quickjs_sandbox
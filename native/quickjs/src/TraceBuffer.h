@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace quickjs_sandbox {
+
+/**
+ * TraceBuffer - User Timing entries recorded by one context's guest
+ *
+ * Backs the guest's performance.mark()/measure() and console.time()/
+ * timeEnd(). Entries are appended natively, so instrumenting a hot path
+ * costs no host calls, and the host takes everything recorded since the
+ * last drain in one step with drainJson(), as parallel arrays (decoding
+ * one object per entry would cost several times more).
+ *
+ * Times are milliseconds on the steady clock since the buffer's time
+ * origin (its creation), drained with nanosecond resolution. Names are
+ * interned: a name recorded again costs no allocation, and its JSON form
+ * is encoded once. The latest time of each mark and the start of each
+ * running console timer are kept by name, so measure() and timeEnd()
+ * still find them after a drain.
+ *
+ * Once `capacity` entries are pending, further entries are dropped and
+ * counted until the host drains. A name is released once no pending
+ * entry, mark or running timer uses it; at most `nameCapacity` are held,
+ * and entries under a name beyond that are dropped and counted as well.
+ *
+ * Not synchronized: the context calls it with its lock held.
+ */
+class TraceBuffer {
+public:
+  enum class EntryType : uint8_t { Mark, Measure };
+
+  struct Entry {
+    EntryType type;
+    uint32_t name;
+    double startTime;
+    double duration; // 0 for marks
+  };
+
+  struct Stats {
+    uint64_t recorded = 0;
+    uint64_t dropped = 0;
+    uint64_t drained = 0;
+    uint64_t pending = 0;
+    uint64_t capacity = 0;
+    uint64_t names = 0;
+  };
+
+  static constexpr size_t kDefaultCapacity = 4096;
+  static constexpr size_t kDefaultNameCapacity = 4096;
+  // No such name, or no room for it
+  static constexpr uint32_t kNoName = UINT32_MAX;
+
+  explicit TraceBuffer(size_t capacity = kDefaultCapacity,
+                       size_t nameCapacity = kDefaultNameCapacity);
+
+  TraceBuffer(const TraceBuffer &) = delete;
+  TraceBuffer &operator=(const TraceBuffer &) = delete;
+
+  // ms since the time origin
+  double now() const;
+  // Wall-clock time of the origin, ms since the Unix epoch
+  double timeOrigin() const { return timeOrigin_; }
+
+  // Index of `name`, added if needed; kNoName when the names are full
+  uint32_t intern(std::string_view name);
+  // Index of `name` without adding it; kNoName when it is not held
+  uint32_t find(std::string_view name) const;
+
+  // The functions below accept kNoName: a name that was never recorded
+  void mark(uint32_t name, double startTime);
+  // Latest time of mark `name`; false when it was never set or cleared
+  bool markTime(uint32_t name, double *time) const;
+  void clearMark(uint32_t name);
+  void clearMarks();
+  void measure(uint32_t name, double startTime, double endTime);
+
+  // console.time(): false when the timer is already running. Without a
+  // name (the names are full) the timer is dropped.
+  bool startTimer(uint32_t name);
+  // ms since the timer started; false when it is not running
+  bool timerElapsed(uint32_t name, double *ms) const;
+  // Stops the timer and records it as a measure; false when not running
+  bool endTimer(uint32_t name, double *ms);
+
+  /**
+   * Append up to maxEntries pending entries, oldest first, to `json` and
+   * remove them. Returns the count. The JSON is
+   * { names, name, kind, startTime, duration }: entry i is named
+   * names[name[i]] and is a mark (kind 0) or a measure (kind 1).
+   */
+  size_t drainJson(std::string &json, size_t maxEntries = SIZE_MAX);
+
+  Stats stats() const;
+
+private:
+  void record(EntryType type, uint32_t name, double startTime,
+              double duration);
+  // Frees the name's slot once nothing uses it
+  void release(uint32_t name);
+
+  double origin_;     // steady clock, ms
+  double timeOrigin_; // system clock, ms
+  size_t capacity_;
+  size_t nameCapacity_;
+
+  // Entries not drained yet start at head_
+  std::vector<Entry> entries_;
+  size_t head_ = 0;
+
+  // Interned names; a deque so the map's views stay valid. Per name: its
+  // JSON string literal, latest mark time and running timer start (NaN
+  // when unset), and its pending entries. Released slots are reused.
+  struct Name {
+    std::string text;
+    std::string json;
+    double markTime;
+    double timerStart;
+    uint32_t pending;
+    // drainJson(): index in `names`, UINT32_MAX when not listed yet
+    uint32_t drainIndex;
+  };
+  std::deque<Name> names_;
+  std::unordered_map<std::string_view, uint32_t> nameIndex_;
+  std::vector<uint32_t> freeNames_;
+  // drainJson(): names listed by the current drain
+  std::vector<uint32_t> drainNames_;
+
+  uint64_t recorded_ = 0;
+  uint64_t dropped_ = 0;
+  uint64_t drained_ = 0;
+};
+
+} // namespace quickjs_sandbox
@@ -3,9 +3,24 @@
  *
  * Simple C API for WASM that exposes QuickJS functionality
  * for E2E testing in Node.js/Browser environments.
+ *
+ * The API is handle based: one WASM instance hosts any number of runtimes
+ * (qjs_runtime_new), each with any number of contexts (qjs_context_new).
+ * Every context is an isolated guest with its own globals, host callback,
+ * timer callback and timer ids. Contexts of one runtime share its heap, GC
+ * and job queue; guests that must not share them get a runtime each.
+ *
+ * Handles are the JSRuntime / JSContext pointers, passed to JS as numbers.
+ *
+ * Values cross the boundary either as JSON strings (qjs_eval, ...) or in
+ * the binary encoding of wasm_value.h (qjs_eval_value, ...), which the
+ * host writes into the context's input buffer and reads from its result
+ * buffer. Both buffers live in linear memory and are reused across calls.
  */
 
+#include "wasm_value.h"
 #include <quickjs.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -16,95 +31,201 @@
 #define EXPORT
 #endif
 
-// Global runtime and context (one per WASM instance)
-static JSRuntime *g_runtime = NULL;
-static JSContext *g_context = NULL;
-
-// Callback function pointer type (set from JS)
+// Callback function pointer types (set from JS)
 typedef void (*HostCallbackFn)(const char *event, const char *data);
-static HostCallbackFn g_host_callback = NULL;
+typedef void (*TimerCallbackFn)(int timer_id);
+
+// Growable byte buffer, kept for the context's lifetime
+typedef struct QJSBuffer {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} QJSBuffer;
+
+// Per-context state (JS_GetContextOpaque)
+typedef struct QJSContextState {
+    JSContext *ctx;
+    HostCallbackFn host_callback;
+    TimerCallbackFn timer_callback;
+    int timer_id;
+    JSValue timers; // timer id -> callback, not visible to the guest
+    QJSBuffer input;  // encoded values and code from the host
+    QJSBuffer result; // encoded results for the host
+    struct QJSContextState *next;
+} QJSContextState;
+
+// Per-runtime state (JS_GetRuntimeOpaque): the contexts still alive, so
+// qjs_runtime_free can release them
+typedef struct QJSRuntimeState {
+    QJSContextState *contexts;
+} QJSRuntimeState;
+
+static QJSContextState *context_state(JSContext *ctx) {
+    return ctx ? (QJSContextState *)JS_GetContextOpaque(ctx) : NULL;
+}
+
+// A job still queued keeps the context alive past JS_FreeContext, so the
+// opaque is cleared first and the guest-facing callbacks check for it
+static void free_context(QJSContextState *state) {
+    JSContext *ctx = state->ctx;
+    JS_FreeValue(ctx, state->timers);
+    JS_SetContextOpaque(ctx, NULL);
+    JS_FreeContext(ctx);
+    free(state->input.data);
+    free(state->result.data);
+    free(state);
+}
 
 // ============================================
 // Lifecycle
 // ============================================
 
-EXPORT int qjs_init(void) {
-    if (g_runtime != NULL) {
-        return 0; // Already initialized
+/**
+ * Create a runtime (heap, GC and job queue)
+ * Returns NULL on failure
+ */
+EXPORT JSRuntime *qjs_runtime_new(void) {
+    QJSRuntimeState *state = calloc(1, sizeof(QJSRuntimeState));
+    if (!state) {
+        return NULL;
     }
 
-    g_runtime = JS_NewRuntime();
-    if (!g_runtime) {
-        return -1;
+    JSRuntime *rt = JS_NewRuntime();
+    if (!rt) {
+        free(state);
+        return NULL;
     }
 
     // Set memory limit (64MB)
-    JS_SetMemoryLimit(g_runtime, 64 * 1024 * 1024);
+    JS_SetMemoryLimit(rt, 64 * 1024 * 1024);
 
     // Set max stack size (1MB)
-    JS_SetMaxStackSize(g_runtime, 1024 * 1024);
+    JS_SetMaxStackSize(rt, 1024 * 1024);
 
-    g_context = JS_NewContext(g_runtime);
-    if (!g_context) {
-        JS_FreeRuntime(g_runtime);
-        g_runtime = NULL;
-        return -2;
+    JS_SetRuntimeOpaque(rt, state);
+    return rt;
+}
+
+/**
+ * Free a runtime and every context still alive in it
+ */
+EXPORT void qjs_runtime_free(JSRuntime *rt) {
+    if (!rt) return;
+
+    QJSRuntimeState *state = JS_GetRuntimeOpaque(rt);
+    while (state->contexts) {
+        QJSContextState *ctx_state = state->contexts;
+        state->contexts = ctx_state->next;
+        free_context(ctx_state);
     }
+    JS_FreeRuntime(rt);
+    free(state);
+}
 
-    return 0;
+/**
+ * Create an isolated guest context in a runtime
+ * Returns NULL on failure
+ */
+EXPORT JSContext *qjs_context_new(JSRuntime *rt) {
+    if (!rt) return NULL;
+
+    QJSContextState *state = calloc(1, sizeof(QJSContextState));
+    if (!state) {
+        return NULL;
+    }
+
+    JSContext *ctx = JS_NewContext(rt);
+    if (!ctx) {
+        free(state);
+        return NULL;
+    }
+    state->ctx = ctx;
+    state->timers = JS_NewObject(ctx);
+    JS_SetContextOpaque(ctx, state);
+
+    QJSRuntimeState *rt_state = JS_GetRuntimeOpaque(rt);
+    state->next = rt_state->contexts;
+    rt_state->contexts = state;
+    return ctx;
 }
 
-EXPORT void qjs_destroy(void) {
-    if (g_context) {
-        JS_FreeContext(g_context);
-        g_context = NULL;
+/**
+ * Free a context; its runtime stays alive
+ */
+EXPORT void qjs_context_free(JSContext *ctx) {
+    QJSContextState *state = context_state(ctx);
+    if (!state) return;
+
+    QJSRuntimeState *rt_state = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
+    QJSContextState **link = &rt_state->contexts;
+    while (*link && *link != state) {
+        link = &(*link)->next;
     }
-    if (g_runtime) {
-        JS_FreeRuntime(g_runtime);
-        g_runtime = NULL;
+    if (*link) {
+        *link = state->next;
     }
-    g_host_callback = NULL;
+    free_context(state);
 }
 
 // ============================================
 // Code Evaluation
 // ============================================
 
+/**
+ * Take the pending exception as {"error":"<message>"}
+ */
+static char *exception_json(JSContext *ctx) {
+    JSValue exception = JS_GetException(ctx);
+    JSValue message = JS_ToString(ctx, exception);
+    JS_FreeValue(ctx, exception);
+
+    JSValue quoted = JS_IsException(message)
+                         ? JS_EXCEPTION
+                         : JS_JSONStringify(ctx, message, JS_UNDEFINED, JS_UNDEFINED);
+    JS_FreeValue(ctx, message);
+
+    const char *str = JS_IsException(quoted) ? NULL : JS_ToCString(ctx, quoted);
+    JS_FreeValue(ctx, quoted);
+    if (!str) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return strdup("{\"error\":\"unknown\"}");
+    }
+
+    char *error_json = malloc(strlen(str) + 16);
+    sprintf(error_json, "{\"error\":%s}", str);
+    JS_FreeCString(ctx, str);
+    return error_json;
+}
+
 /**
  * Evaluate JavaScript code and return result as JSON string
  * Caller must free the returned string
  */
-EXPORT char *qjs_eval(const char *code) {
-    if (!g_context) {
+EXPORT char *qjs_eval(JSContext *ctx, const char *code) {
+    if (!context_state(ctx)) {
         return strdup("{\"error\":\"Context not initialized\"}");
     }
 
-    JSValue result = JS_Eval(g_context, code, strlen(code), "<eval>",
+    JSValue result = JS_Eval(ctx, code, strlen(code), "<eval>",
                              JS_EVAL_TYPE_GLOBAL);
 
     if (JS_IsException(result)) {
-        JSValue exception = JS_GetException(g_context);
-        const char *msg = JS_ToCString(g_context, exception);
-        char *error_json = malloc(strlen(msg) + 32);
-        sprintf(error_json, "{\"error\":\"%s\"}", msg ? msg : "unknown");
-        if (msg) JS_FreeCString(g_context, msg);
-        JS_FreeValue(g_context, exception);
-        return error_json;
+        return exception_json(ctx);
     }
 
     // Convert result to JSON
-    JSValue json_str = JS_JSONStringify(g_context, result, JS_UNDEFINED, JS_UNDEFINED);
-    JS_FreeValue(g_context, result);
+    JSValue json_str = JS_JSONStringify(ctx, result, JS_UNDEFINED, JS_UNDEFINED);
+    JS_FreeValue(ctx, result);
 
     if (JS_IsException(json_str)) {
-        JS_FreeValue(g_context, json_str);
+        JS_FreeValue(ctx, JS_GetException(ctx));
         return strdup("{\"value\":\"[unstringifiable]\"}");
     }
 
-    const char *str = JS_ToCString(g_context, json_str);
+    const char *str = JS_ToCString(ctx, json_str);
     char *output = str ? strdup(str) : strdup("null");
-    if (str) JS_FreeCString(g_context, str);
-    JS_FreeValue(g_context, json_str);
+    if (str) JS_FreeCString(ctx, str);
+    JS_FreeValue(ctx, json_str);
 
     return output;
 }
@@ -113,22 +234,20 @@ EXPORT char *qjs_eval(const char *code) {
  * Evaluate code without returning result (for module/setup code)
  * Returns 0 on success, -1 on error
  */
-EXPORT int qjs_eval_void(const char *code) {
-    if (!g_context) {
+EXPORT int qjs_eval_void(JSContext *ctx, const char *code) {
+    if (!context_state(ctx)) {
         return -1;
     }
 
-    JSValue result = JS_Eval(g_context, code, strlen(code), "<eval>",
+    JSValue result = JS_Eval(ctx, code, strlen(code), "<eval>",
                              JS_EVAL_TYPE_GLOBAL);
 
     if (JS_IsException(result)) {
-        JSValue exception = JS_GetException(g_context);
-        JS_FreeValue(g_context, exception);
-        JS_FreeValue(g_context, result);
+        JS_FreeValue(ctx, JS_GetException(ctx));
         return -1;
     }
 
-    JS_FreeValue(g_context, result);
+    JS_FreeValue(ctx, result);
     return 0;
 }
 
@@ -139,19 +258,19 @@ EXPORT int qjs_eval_void(const char *code) {
 /**
  * Set a global variable from JSON string
  */
-EXPORT int qjs_set_global_json(const char *name, const char *json_value) {
-    if (!g_context) return -1;
-
-    JSValue global = JS_GetGlobalObject(g_context);
-    JSValue value = JS_ParseJSON(g_context, json_value, strlen(json_value), "<json>");
+EXPORT int qjs_set_global_json(JSContext *ctx, const char *name,
+                               const char *json_value) {
+    if (!context_state(ctx)) return -1;
 
+    JSValue value = JS_ParseJSON(ctx, json_value, strlen(json_value), "<json>");
     if (JS_IsException(value)) {
-        JS_FreeValue(g_context, global);
+        JS_FreeValue(ctx, JS_GetException(ctx));
         return -1;
     }
 
-    JS_SetPropertyStr(g_context, global, name, value);
-    JS_FreeValue(g_context, global);
+    JSValue global = JS_GetGlobalObject(ctx);
+    JS_SetPropertyStr(ctx, global, name, value);
+    JS_FreeValue(ctx, global);
     return 0;
 }
 
@@ -159,38 +278,481 @@ EXPORT int qjs_set_global_json(const char *name, const char *json_value) {
  * Get a global variable as JSON string
  * Caller must free the returned string
  */
-EXPORT char *qjs_get_global_json(const char *name) {
-    if (!g_context) return strdup("null");
+EXPORT char *qjs_get_global_json(JSContext *ctx, const char *name) {
+    if (!context_state(ctx)) return strdup("null");
 
-    JSValue global = JS_GetGlobalObject(g_context);
-    JSValue value = JS_GetPropertyStr(g_context, global, name);
-    JS_FreeValue(g_context, global);
+    JSValue global = JS_GetGlobalObject(ctx);
+    JSValue value = JS_GetPropertyStr(ctx, global, name);
+    JS_FreeValue(ctx, global);
 
-    JSValue json_str = JS_JSONStringify(g_context, value, JS_UNDEFINED, JS_UNDEFINED);
-    JS_FreeValue(g_context, value);
+    JSValue json_str = JS_JSONStringify(ctx, value, JS_UNDEFINED, JS_UNDEFINED);
+    JS_FreeValue(ctx, value);
 
     if (JS_IsException(json_str)) {
-        JS_FreeValue(g_context, json_str);
+        JS_FreeValue(ctx, JS_GetException(ctx));
         return strdup("null");
     }
 
-    const char *str = JS_ToCString(g_context, json_str);
+    const char *str = JS_ToCString(ctx, json_str);
     char *output = str ? strdup(str) : strdup("null");
-    if (str) JS_FreeCString(g_context, str);
-    JS_FreeValue(g_context, json_str);
+    if (str) JS_FreeCString(ctx, str);
+    JS_FreeValue(ctx, json_str);
 
     return output;
 }
 
+// ============================================
+// Binary Values (wasm_value.h)
+// ============================================
+
+/**
+ * Make room for `extra` more bytes; capacity doubles so a buffer that has
+ * held a large value keeps its size for the next call
+ */
+static int buffer_reserve(QJSBuffer *buf, size_t extra) {
+    size_t needed = buf->size + extra;
+    if (needed <= buf->capacity) {
+        return 0;
+    }
+    size_t capacity = buf->capacity ? buf->capacity : 256;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    uint8_t *data = realloc(buf->data, capacity);
+    if (!data) {
+        return -1;
+    }
+    buf->data = data;
+    buf->capacity = capacity;
+    return 0;
+}
+
+static int put_tag(QJSBuffer *buf, uint8_t tag) {
+    if (buffer_reserve(buf, 1)) return -1;
+    buf->data[buf->size++] = tag;
+    return 0;
+}
+
+// Tag and fixed-size payload; WASM is little endian, so payloads are
+// copied as they are in memory
+static int put_scalar(QJSBuffer *buf, uint8_t tag, const void *payload,
+                      size_t size) {
+    if (buffer_reserve(buf, 1 + size)) return -1;
+    buf->data[buf->size] = tag;
+    memcpy(buf->data + buf->size + 1, payload, size);
+    buf->size += 1 + size;
+    return 0;
+}
+
+static int put_uvar(QJSBuffer *buf, uint32_t value) {
+    if (buffer_reserve(buf, 5)) return -1;
+    while (value >= 0x80) {
+        buf->data[buf->size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buf->data[buf->size++] = (uint8_t)value;
+    return 0;
+}
+
+static int put_bytes(QJSBuffer *buf, const void *bytes, size_t length) {
+    if (length > UINT32_MAX || put_uvar(buf, (uint32_t)length) ||
+        buffer_reserve(buf, length)) {
+        return -1;
+    }
+    memcpy(buf->data + buf->size, bytes, length);
+    buf->size += length;
+    return 0;
+}
+
+static int encode_value(JSContext *ctx, QJSBuffer *buf, JSValueConst value,
+                        int depth);
+
+static int encode_string(JSContext *ctx, QJSBuffer *buf, JSValueConst value) {
+    size_t length;
+    const char *str = JS_ToCStringLen(ctx, &length, value);
+    if (!str) return -1;
+    int ret = put_tag(buf, WASM_VALUE_STRING) || put_bytes(buf, str, length) ? -1 : 0;
+    JS_FreeCString(ctx, str);
+    if (ret) JS_ThrowOutOfMemory(ctx);
+    return ret;
+}
+
+static int encode_array(JSContext *ctx, QJSBuffer *buf, JSValueConst array,
+                        int depth) {
+    JSValue length_value = JS_GetPropertyStr(ctx, array, "length");
+    uint32_t length;
+    if (JS_ToUint32(ctx, &length, length_value)) {
+        JS_FreeValue(ctx, length_value);
+        return -1;
+    }
+    JS_FreeValue(ctx, length_value);
+
+    if (put_tag(buf, WASM_VALUE_ARRAY) || put_uvar(buf, length)) {
+        JS_ThrowOutOfMemory(ctx);
+        return -1;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        JSValue element = JS_GetPropertyUint32(ctx, array, i);
+        int ret = JS_IsException(element) ? -1
+                                          : encode_value(ctx, buf, element, depth + 1);
+        JS_FreeValue(ctx, element);
+        if (ret) return -1;
+    }
+    return 0;
+}
+
+// Own enumerable string keys, like JSON.stringify
+static int encode_object(JSContext *ctx, QJSBuffer *buf, JSValueConst obj,
+                         int depth) {
+    JSPropertyEnum *props;
+    uint32_t count;
+    if (JS_GetOwnPropertyNames(ctx, &props, &count, obj,
+                               JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY)) {
+        return -1;
+    }
+
+    int ret = put_tag(buf, WASM_VALUE_OBJECT) || put_uvar(buf, count) ? -1 : 0;
+    if (ret) JS_ThrowOutOfMemory(ctx);
+    for (uint32_t i = 0; i < count && !ret; i++) {
+        const char *key = JS_AtomToCString(ctx, props[i].atom);
+        if (!key) {
+            ret = -1;
+            break;
+        }
+        if (put_bytes(buf, key, strlen(key))) {
+            JS_ThrowOutOfMemory(ctx);
+            ret = -1;
+        }
+        JS_FreeCString(ctx, key);
+        if (ret) break;
+
+        JSValue value = JS_GetProperty(ctx, obj, props[i].atom);
+        ret = JS_IsException(value) ? -1 : encode_value(ctx, buf, value, depth + 1);
+        JS_FreeValue(ctx, value);
+    }
+
+    JS_FreeEnumArray(ctx, props, count);
+    return ret;
+}
+
+/**
+ * Append a value to buf
+ * Returns 0, or -1 with a pending exception
+ */
+static int encode_value(JSContext *ctx, QJSBuffer *buf, JSValueConst value,
+                        int depth) {
+    if (depth > WASM_VALUE_MAX_DEPTH) {
+        JS_ThrowRangeError(ctx, "value is nested too deeply (cyclic?)");
+        return -1;
+    }
+
+    int ret;
+    switch (JS_VALUE_GET_NORM_TAG(value)) {
+    case JS_TAG_INT: {
+        int32_t i = JS_VALUE_GET_INT(value);
+        ret = put_scalar(buf, WASM_VALUE_INT32, &i, 4);
+        break;
+    }
+    case JS_TAG_FLOAT64: {
+        double d = JS_VALUE_GET_FLOAT64(value);
+        ret = put_scalar(buf, WASM_VALUE_FLOAT64, &d, 8);
+        break;
+    }
+    case JS_TAG_BOOL:
+        ret = put_tag(buf, JS_VALUE_GET_BOOL(value) ? WASM_VALUE_TRUE : WASM_VALUE_FALSE);
+        break;
+    case JS_TAG_NULL:
+        ret = put_tag(buf, WASM_VALUE_NULL);
+        break;
+    case JS_TAG_STRING:
+        return encode_string(ctx, buf, value);
+    case JS_TAG_OBJECT: {
+        if (JS_IsFunction(ctx, value)) {
+            ret = put_tag(buf, WASM_VALUE_UNDEFINED);
+            break;
+        }
+        if (JS_IsArrayBuffer(ctx, value)) {
+            size_t length;
+            uint8_t *bytes = JS_GetArrayBuffer(ctx, &length, value);
+            if (!bytes) { // detached
+                return -1;
+            }
+            ret = put_tag(buf, WASM_VALUE_BYTES) || put_bytes(buf, bytes, length) ? -1 : 0;
+            break;
+        }
+        JSValue to_json = JS_GetPropertyStr(ctx, value, "toJSON");
+        if (JS_IsException(to_json)) {
+            return -1;
+        }
+        if (JS_IsFunction(ctx, to_json)) {
+            JSValue json = JS_Call(ctx, to_json, value, 0, NULL);
+            JS_FreeValue(ctx, to_json);
+            if (JS_IsException(json)) {
+                return -1;
+            }
+            ret = encode_value(ctx, buf, json, depth + 1);
+            JS_FreeValue(ctx, json);
+            return ret;
+        }
+        JS_FreeValue(ctx, to_json);
+
+        int is_array = JS_IsArray(ctx, value);
+        if (is_array < 0) {
+            return -1;
+        }
+        return is_array ? encode_array(ctx, buf, value, depth)
+                        : encode_object(ctx, buf, value, depth);
+    }
+    default: // undefined, symbols, big numbers
+        ret = put_tag(buf, WASM_VALUE_UNDEFINED);
+        break;
+    }
+    if (ret) JS_ThrowOutOfMemory(ctx);
+    return ret;
+}
+
+/**
+ * Replace the context's result with a value, or with an ERROR carrying the
+ * exception raised by the guest or by encoding
+ * Returns the result length, -1 when out of memory
+ */
+static int encode_result(JSContext *ctx, QJSContextState *state, JSValue value) {
+    QJSBuffer *buf = &state->result;
+    buf->size = 0;
+    int ret = JS_IsException(value) ? -1 : encode_value(ctx, buf, value, 0);
+    JS_FreeValue(ctx, value);
+
+    if (ret) {
+        buf->size = 0;
+        JSValue exception = JS_GetException(ctx);
+        const char *msg = JS_ToCString(ctx, exception);
+        JS_FreeValue(ctx, exception);
+        if (!msg) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+        }
+        const char *text = msg ? msg : "unknown";
+        ret = put_tag(buf, WASM_VALUE_ERROR) || put_bytes(buf, text, strlen(text)) ? -1 : 0;
+        if (msg) JS_FreeCString(ctx, msg);
+        if (ret) return -1;
+    }
+    return buf->size > INT32_MAX ? -1 : (int)buf->size;
+}
+
+// Bounds-checked reader over an encoded value
+typedef struct QJSReader {
+    const uint8_t *pos;
+    const uint8_t *end;
+} QJSReader;
+
+static int read_uvar(QJSReader *r, uint32_t *value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35 && r->pos < r->end; shift += 7) {
+        uint8_t byte = *r->pos++;
+        result |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Length-prefixed bytes, returned in place
+static const uint8_t *read_bytes(QJSReader *r, uint32_t *length) {
+    if (read_uvar(r, length) || (size_t)(r->end - r->pos) < *length) return NULL;
+    const uint8_t *bytes = r->pos;
+    r->pos += *length;
+    return bytes;
+}
+
+static JSValue throw_malformed(JSContext *ctx) {
+    return JS_ThrowSyntaxError(ctx, "malformed binary value");
+}
+
+/**
+ * Read one value
+ * Returns JS_EXCEPTION when the encoding is malformed
+ */
+static JSValue decode_value(JSContext *ctx, QJSReader *r, int depth) {
+    if (r->pos >= r->end || depth > WASM_VALUE_MAX_DEPTH) {
+        return throw_malformed(ctx);
+    }
+
+    uint32_t length;
+    const uint8_t *bytes;
+    switch (*r->pos++) {
+    case WASM_VALUE_UNDEFINED:
+        return JS_UNDEFINED;
+    case WASM_VALUE_NULL:
+        return JS_NULL;
+    case WASM_VALUE_FALSE:
+        return JS_FALSE;
+    case WASM_VALUE_TRUE:
+        return JS_TRUE;
+    case WASM_VALUE_INT32: {
+        int32_t i;
+        if (r->end - r->pos < 4) return throw_malformed(ctx);
+        memcpy(&i, r->pos, 4);
+        r->pos += 4;
+        return JS_NewInt32(ctx, i);
+    }
+    case WASM_VALUE_FLOAT64: {
+        double d;
+        if (r->end - r->pos < 8) return throw_malformed(ctx);
+        memcpy(&d, r->pos, 8);
+        r->pos += 8;
+        return JS_NewFloat64(ctx, d);
+    }
+    case WASM_VALUE_STRING:
+        if (!(bytes = read_bytes(r, &length))) return throw_malformed(ctx);
+        return JS_NewStringLen(ctx, (const char *)bytes, length);
+    case WASM_VALUE_BYTES:
+        if (!(bytes = read_bytes(r, &length))) return throw_malformed(ctx);
+        return JS_NewArrayBufferCopy(ctx, bytes, length);
+    case WASM_VALUE_ARRAY: {
+        // Each element takes at least a byte
+        if (read_uvar(r, &length) || (size_t)(r->end - r->pos) < length) {
+            return throw_malformed(ctx);
+        }
+        JSValue array = JS_NewArray(ctx);
+        for (uint32_t i = 0; i < length && !JS_IsException(array); i++) {
+            JSValue element = decode_value(ctx, r, depth + 1);
+            if (JS_IsException(element) ||
+                JS_DefinePropertyValueUint32(ctx, array, i, element, JS_PROP_C_W_E) < 0) {
+                JS_FreeValue(ctx, array);
+                array = JS_EXCEPTION;
+            }
+        }
+        return array;
+    }
+    case WASM_VALUE_OBJECT: {
+        // Each entry takes at least two bytes
+        if (read_uvar(r, &length) || (size_t)(r->end - r->pos) / 2 < length) {
+            return throw_malformed(ctx);
+        }
+        JSValue obj = JS_NewObject(ctx);
+        for (uint32_t i = 0; i < length && !JS_IsException(obj); i++) {
+            uint32_t key_length;
+            const uint8_t *key = read_bytes(r, &key_length);
+            if (!key) {
+                JS_FreeValue(ctx, obj);
+                return throw_malformed(ctx);
+            }
+            JSAtom atom = JS_NewAtomLen(ctx, (const char *)key, key_length);
+            JSValue value = atom == JS_ATOM_NULL ? JS_EXCEPTION
+                                                 : decode_value(ctx, r, depth + 1);
+            // Define, not set: a "__proto__" key is plain data, as in JSON.parse
+            if (JS_IsException(value) ||
+                JS_DefinePropertyValue(ctx, obj, atom, value, JS_PROP_C_W_E) < 0) {
+                JS_FreeValue(ctx, obj);
+                obj = JS_EXCEPTION;
+            }
+            JS_FreeAtom(ctx, atom);
+        }
+        return obj;
+    }
+    default:
+        return throw_malformed(ctx);
+    }
+}
+
+/**
+ * Reserve the context's input buffer: at least `size` bytes (plus a byte
+ * for a terminating NUL), keeping its contents
+ * Returns the buffer address (it can move on every call), NULL on failure
+ */
+EXPORT uint8_t *qjs_input_buffer(JSContext *ctx, size_t size) {
+    QJSContextState *state = context_state(ctx);
+    if (!state) return NULL;
+
+    QJSBuffer *buf = &state->input;
+    buf->size = 0;
+    if (size == SIZE_MAX || buffer_reserve(buf, size + 1)) {
+        return NULL;
+    }
+    return buf->data;
+}
+
+/**
+ * Address of the context's result buffer, valid until the next call on
+ * the context
+ */
+EXPORT const uint8_t *qjs_result_buffer(JSContext *ctx) {
+    QJSContextState *state = context_state(ctx);
+    return state ? state->result.data : NULL;
+}
+
+/**
+ * Evaluate `code_length` bytes of UTF-8 code from the input buffer
+ * Returns the length of the encoded result (an ERROR if the code threw),
+ * -1 on failure
+ */
+EXPORT int qjs_eval_value(JSContext *ctx, size_t code_length) {
+    QJSContextState *state = context_state(ctx);
+    if (!state || code_length >= state->input.capacity) {
+        return -1;
+    }
+
+    // The parser expects NUL-terminated input
+    char *code = (char *)state->input.data;
+    code[code_length] = '\0';
+    JSValue result = JS_Eval(ctx, code, code_length, "<eval>", JS_EVAL_TYPE_GLOBAL);
+    return encode_result(ctx, state, result);
+}
+
+/**
+ * Set a global variable from the `length` byte value in the input buffer
+ * Returns 0 on success, -1 if the encoding is malformed
+ */
+EXPORT int qjs_set_global_value(JSContext *ctx, const char *name, size_t length) {
+    QJSContextState *state = context_state(ctx);
+    if (!state || length > state->input.capacity) {
+        return -1;
+    }
+
+    QJSReader reader = {state->input.data, state->input.data + length};
+    JSValue value = decode_value(ctx, &reader, 0);
+    if (!JS_IsException(value) && reader.pos != reader.end) {
+        JS_FreeValue(ctx, value);
+        value = throw_malformed(ctx);
+    }
+    if (JS_IsException(value)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return -1;
+    }
+
+    JSValue global = JS_GetGlobalObject(ctx);
+    JS_SetPropertyStr(ctx, global, name, value);
+    JS_FreeValue(ctx, global);
+    return 0;
+}
+
+/**
+ * Encode a global variable into the result buffer
+ * Returns the result length, -1 on failure
+ */
+EXPORT int qjs_get_global_value(JSContext *ctx, const char *name) {
+    QJSContextState *state = context_state(ctx);
+    if (!state) return -1;
+
+    JSValue global = JS_GetGlobalObject(ctx);
+    JSValue value = JS_GetPropertyStr(ctx, global, name);
+    JS_FreeValue(ctx, global);
+    return encode_result(ctx, state, value);
+}
+
 // ============================================
 // Host Callback (for __sendToHost, etc.)
 // ============================================
 
 /**
- * Set the host callback function pointer
+ * Set the context's host callback function pointer
  */
-EXPORT void qjs_set_host_callback(HostCallbackFn callback) {
-    g_host_callback = callback;
+EXPORT void qjs_set_host_callback(JSContext *ctx, HostCallbackFn callback) {
+    QJSContextState *state = context_state(ctx);
+    if (state) {
+        state->host_callback = callback;
+    }
 }
 
 /**
@@ -198,7 +760,8 @@ EXPORT void qjs_set_host_callback(HostCallbackFn callback) {
  */
 static JSValue js_send_to_host(JSContext *ctx, JSValueConst this_val,
                                 int argc, JSValueConst *argv) {
-    if (!g_host_callback || argc < 2) {
+    QJSContextState *state = context_state(ctx);
+    if (!state || !state->host_callback || argc < 2) {
         return JS_UNDEFINED;
     }
 
@@ -207,7 +770,7 @@ static JSValue js_send_to_host(JSContext *ctx, JSValueConst this_val,
     const char *data = JS_ToCString(ctx, json_data);
 
     if (event && data) {
-        g_host_callback(event, data);
+        state->host_callback(event, data);
     }
 
     if (event) JS_FreeCString(ctx, event);
@@ -220,30 +783,30 @@ static JSValue js_send_to_host(JSContext *ctx, JSValueConst this_val,
 /**
  * Install __sendToHost function in global scope
  */
-EXPORT void qjs_install_host_functions(void) {
-    if (!g_context) return;
+EXPORT void qjs_install_host_functions(JSContext *ctx) {
+    if (!context_state(ctx)) return;
 
-    JSValue global = JS_GetGlobalObject(g_context);
+    JSValue global = JS_GetGlobalObject(ctx);
 
     // __sendToHost(event, data)
-    JS_SetPropertyStr(g_context, global, "__sendToHost",
-                      JS_NewCFunction(g_context, js_send_to_host, "__sendToHost", 2));
+    JS_SetPropertyStr(ctx, global, "__sendToHost",
+                      JS_NewCFunction(ctx, js_send_to_host, "__sendToHost", 2));
 
-    JS_FreeValue(g_context, global);
+    JS_FreeValue(ctx, global);
 }
 
 // ============================================
 // Timer Support
 // ============================================
 
-static int g_timer_id = 0;
-
-// Timer callback function pointer type
-typedef void (*TimerCallbackFn)(int timer_id);
-static TimerCallbackFn g_timer_callback = NULL;
-
-EXPORT void qjs_set_timer_callback(TimerCallbackFn callback) {
-    g_timer_callback = callback;
+/**
+ * Set the context's timer callback function pointer
+ */
+EXPORT void qjs_set_timer_callback(JSContext *ctx, TimerCallbackFn callback) {
+    QJSContextState *state = context_state(ctx);
+    if (state) {
+        state->timer_callback = callback;
+    }
 }
 
 /**
@@ -252,34 +815,22 @@ EXPORT void qjs_set_timer_callback(TimerCallbackFn callback) {
  */
 static JSValue js_set_timeout(JSContext *ctx, JSValueConst this_val,
                               int argc, JSValueConst *argv) {
-    if (argc < 2) return JS_NewInt32(ctx, -1);
+    QJSContextState *state = context_state(ctx);
+    if (!state || argc < 2) return JS_NewInt32(ctx, -1);
 
     // Get delay
     int32_t delay = 0;
     JS_ToInt32(ctx, &delay, argv[1]);
 
-    // Generate timer ID
-    int timer_id = ++g_timer_id;
+    // Generate timer ID (per context)
+    int timer_id = ++state->timer_id;
 
-    // Store callback in global __timers object
-    JSValue global = JS_GetGlobalObject(ctx);
-    JSValue timers = JS_GetPropertyStr(ctx, global, "__timers");
-    if (JS_IsUndefined(timers)) {
-        timers = JS_NewObject(ctx);
-        JS_SetPropertyStr(ctx, global, "__timers", JS_DupValue(ctx, timers));
-    }
-
-    char id_str[16];
-    snprintf(id_str, sizeof(id_str), "%d", timer_id);
-    JS_SetPropertyStr(ctx, timers, id_str, JS_DupValue(ctx, argv[0]));
-
-    JS_FreeValue(ctx, timers);
-    JS_FreeValue(ctx, global);
+    JS_SetPropertyUint32(ctx, state->timers, timer_id, JS_DupValue(ctx, argv[0]));
 
     // Notify host to schedule timer
-    if (g_timer_callback) {
+    if (state->timer_callback) {
         // Encode: (timer_id << 16) | delay (max delay 65535ms)
-        g_timer_callback((timer_id << 16) | (delay & 0xFFFF));
+        state->timer_callback((timer_id << 16) | (delay & 0xFFFF));
     }
 
     return JS_NewInt32(ctx, timer_id);
@@ -290,21 +841,15 @@ static JSValue js_set_timeout(JSContext *ctx, JSValueConst this_val,
  */
 static JSValue js_clear_timeout(JSContext *ctx, JSValueConst this_val,
                                 int argc, JSValueConst *argv) {
-    if (argc < 1) return JS_UNDEFINED;
-
-    int32_t timer_id;
-    JS_ToInt32(ctx, &timer_id, argv[0]);
-
-    // Remove callback from __timers
-    JSValue global = JS_GetGlobalObject(ctx);
-    JSValue timers = JS_GetPropertyStr(ctx, global, "__timers");
-    if (!JS_IsUndefined(timers)) {
-        char id_str[16];
-        snprintf(id_str, sizeof(id_str), "%d", timer_id);
-        JS_DeleteProperty(ctx, timers, JS_NewAtom(ctx, id_str), 0);
+    QJSContextState *state = context_state(ctx);
+    if (!state || argc < 1) return JS_UNDEFINED;
+
+    uint32_t timer_id;
+    if (JS_ToUint32(ctx, &timer_id, argv[0]) == 0) {
+        JSAtom atom = JS_NewAtomUInt32(ctx, timer_id);
+        JS_DeleteProperty(ctx, state->timers, atom, 0);
+        JS_FreeAtom(ctx, atom);
     }
-    JS_FreeValue(ctx, timers);
-    JS_FreeValue(ctx, global);
 
     return JS_UNDEFINED;
 }
@@ -312,100 +857,90 @@ static JSValue js_clear_timeout(JSContext *ctx, JSValueConst this_val,
 /**
  * Fire a timer callback (called from host when timer expires)
  */
-EXPORT void qjs_fire_timer(int timer_id) {
-    if (!g_context) return;
+EXPORT void qjs_fire_timer(JSContext *ctx, int timer_id) {
+    QJSContextState *state = context_state(ctx);
+    if (!state || timer_id <= 0) return;
 
-    JSValue global = JS_GetGlobalObject(g_context);
-    JSValue timers = JS_GetPropertyStr(g_context, global, "__timers");
+    JSAtom atom = JS_NewAtomUInt32(ctx, (uint32_t)timer_id);
+    JSValue callback = JS_GetProperty(ctx, state->timers, atom);
 
-    if (!JS_IsUndefined(timers)) {
-        char id_str[16];
-        snprintf(id_str, sizeof(id_str), "%d", timer_id);
-        JSValue callback = JS_GetPropertyStr(g_context, timers, id_str);
+    if (JS_IsFunction(ctx, callback)) {
+        // Remove timer before firing (setTimeout is one-shot)
+        JS_DeleteProperty(ctx, state->timers, atom, 0);
 
-        if (JS_IsFunction(g_context, callback)) {
-            JSValue result = JS_Call(g_context, callback, JS_UNDEFINED, 0, NULL);
-            JS_FreeValue(g_context, result);
-
-            // Remove timer after firing (setTimeout is one-shot)
-            JS_DeleteProperty(g_context, timers, JS_NewAtom(g_context, id_str), 0);
+        JSValue result = JS_Call(ctx, callback, JS_UNDEFINED, 0, NULL);
+        if (JS_IsException(result)) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
         }
-        JS_FreeValue(g_context, callback);
+        JS_FreeValue(ctx, result);
     }
-
-    JS_FreeValue(g_context, timers);
-    JS_FreeValue(g_context, global);
+    JS_FreeValue(ctx, callback);
+    JS_FreeAtom(ctx, atom);
 }
 
 /**
  * Install timer functions in global scope
  */
-EXPORT void qjs_install_timer_functions(void) {
-    if (!g_context) return;
-
-    JSValue global = JS_GetGlobalObject(g_context);
+EXPORT void qjs_install_timer_functions(JSContext *ctx) {
+    if (!context_state(ctx)) return;
 
-    // Create __timers storage
-    JS_SetPropertyStr(g_context, global, "__timers", JS_NewObject(g_context));
+    JSValue global = JS_GetGlobalObject(ctx);
 
     // setTimeout and clearTimeout
-    JS_SetPropertyStr(g_context, global, "setTimeout",
-                      JS_NewCFunction(g_context, js_set_timeout, "setTimeout", 2));
-    JS_SetPropertyStr(g_context, global, "clearTimeout",
-                      JS_NewCFunction(g_context, js_clear_timeout, "clearTimeout", 1));
+    JS_SetPropertyStr(ctx, global, "setTimeout",
+                      JS_NewCFunction(ctx, js_set_timeout, "setTimeout", 2));
+    JS_SetPropertyStr(ctx, global, "clearTimeout",
+                      JS_NewCFunction(ctx, js_clear_timeout, "clearTimeout", 1));
 
-    JS_FreeValue(g_context, global);
+    JS_FreeValue(ctx, global);
 }
 
 // ============================================
 // Console Support
 // ============================================
 
-static JSValue js_console_log(JSContext *ctx, JSValueConst this_val,
-                              int argc, JSValueConst *argv) {
+static void console_output(JSContext *ctx, const char *event, int argc,
+                           JSValueConst *argv) {
+    QJSContextState *state = context_state(ctx);
+    if (!state || !state->host_callback) return;
     for (int i = 0; i < argc; i++) {
         const char *str = JS_ToCString(ctx, argv[i]);
         if (str) {
-            if (g_host_callback) {
-                g_host_callback("console.log", str);
-            }
+            state->host_callback(event, str);
             JS_FreeCString(ctx, str);
         }
     }
+}
+
+static JSValue js_console_log(JSContext *ctx, JSValueConst this_val,
+                              int argc, JSValueConst *argv) {
+    console_output(ctx, "console.log", argc, argv);
     return JS_UNDEFINED;
 }
 
 static JSValue js_console_error(JSContext *ctx, JSValueConst this_val,
                                 int argc, JSValueConst *argv) {
-    for (int i = 0; i < argc; i++) {
-        const char *str = JS_ToCString(ctx, argv[i]);
-        if (str) {
-            if (g_host_callback) {
-                g_host_callback("console.error", str);
-            }
-            JS_FreeCString(ctx, str);
-        }
-    }
+    console_output(ctx, "console.error", argc, argv);
     return JS_UNDEFINED;
 }
 
-EXPORT void qjs_install_console(void) {
-    if (!g_context) return;
-
-    JSValue global = JS_GetGlobalObject(g_context);
-    JSValue console = JS_NewObject(g_context);
+EXPORT void qjs_install_console(JSContext *ctx) {
+    if (!context_state(ctx)) return;
 
-    JS_SetPropertyStr(g_context, console, "log",
-                      JS_NewCFunction(g_context, js_console_log, "log", 1));
-    JS_SetPropertyStr(g_context, console, "error",
-                      JS_NewCFunction(g_context, js_console_error, "error", 1));
-    JS_SetPropertyStr(g_context, console, "warn",
-                      JS_NewCFunction(g_context, js_console_log, "warn", 1));
-    JS_SetPropertyStr(g_context, console, "info",
-                      JS_NewCFunction(g_context, js_console_log, "info", 1));
-
-    JS_SetPropertyStr(g_context, global, "console", console);
-    JS_FreeValue(g_context, global);
+    JSValue global = JS_GetGlobalObject(ctx);
+    JSValue console = JS_NewObject(ctx);
+
+    JS_SetPropertyStr(ctx, console, "log",
+                      JS_NewCFunction(ctx, js_console_log, "log", 1));
+    JS_SetPropertyStr(ctx, console, "error",
+                      JS_NewCFunction(ctx, js_console_error, "error", 1));
+    JS_SetPropertyStr(ctx, console, "warn",
+                      JS_NewCFunction(ctx, js_console_log, "warn", 1));
+    JS_SetPropertyStr(ctx, console, "info",
+                      JS_NewCFunction(ctx, js_console_log, "info", 1));
+
+    JS_SetPropertyStr(ctx, global, "console", console);
+    JS_FreeValue(ctx, global);
 }
 
 // ============================================
@@ -413,16 +948,16 @@ EXPORT void qjs_install_console(void) {
 // ============================================
 
 /**
- * Execute pending jobs (microtasks/promises)
+ * Execute pending jobs (microtasks/promises) of every context in a runtime
  * Returns number of jobs executed, -1 on error
  */
-EXPORT int qjs_execute_pending_jobs(void) {
-    if (!g_context) return -1;
+EXPORT int qjs_execute_pending_jobs(JSRuntime *rt) {
+    if (!rt) return -1;
 
     int count = 0;
     JSContext *ctx;
 
-    while (JS_ExecutePendingJob(g_runtime, &ctx) > 0) {
+    while (JS_ExecutePendingJob(rt, &ctx) > 0) {
         count++;
         if (count > 10000) {
             // Safety limit to prevent infinite loops
@@ -445,12 +980,12 @@ EXPORT void qjs_free_string(char *str) {
 }
 
 /**
- * Get current memory usage
+ * Get the runtime's current memory usage (all of its contexts)
  */
-EXPORT size_t qjs_get_memory_usage(void) {
-    if (!g_runtime) return 0;
+EXPORT size_t qjs_get_memory_usage(JSRuntime *rt) {
+    if (!rt) return 0;
 
     JSMemoryUsage usage;
-    JS_ComputeMemoryUsage(g_runtime, &usage);
+    JS_ComputeMemoryUsage(rt, &usage);
     return usage.memory_used_size;
 }
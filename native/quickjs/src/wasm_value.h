@@ -0,0 +1,46 @@
+/**
+ * Binary value encoding for the WASM bindings
+ *
+ * Values cross the WASM boundary as bytes in linear memory instead of JSON
+ * text: wasm_bindings.c and EmscriptenBindings.cpp write and read them, the
+ * JS side decodes them with a DataView (QuickJSWASMValueCodec.ts).
+ *
+ * A value is a one byte tag followed by its payload, unaligned. Numbers
+ * are little endian; lengths and counts (uvar) are unsigned LEB128 of at
+ * most 5 bytes, so short keys and strings take a single length byte:
+ *   UNDEFINED, NULL, FALSE, TRUE  -
+ *   INT32                         i32
+ *   FLOAT64                       f64
+ *   STRING                        uvar byte length, UTF-8
+ *   ARRAY                         uvar count, count values
+ *   OBJECT                        uvar count, count x (uvar key length,
+ *                                 UTF-8 key, value)
+ *   BYTES                         uvar byte length, bytes (an ArrayBuffer)
+ *   ERROR                         uvar byte length, UTF-8 message; only as a
+ *                                 result, for an exception thrown by the guest
+ *
+ * Objects with a toJSON() method are encoded as its result. Functions,
+ * symbols and other values without a data form are encoded as UNDEFINED.
+ * Nesting deeper than WASM_VALUE_MAX_DEPTH (a cycle) is an error.
+ */
+
+#ifndef WASM_VALUE_H
+#define WASM_VALUE_H
+
+enum {
+    WASM_VALUE_UNDEFINED = 0,
+    WASM_VALUE_NULL = 1,
+    WASM_VALUE_FALSE = 2,
+    WASM_VALUE_TRUE = 3,
+    WASM_VALUE_INT32 = 4,
+    WASM_VALUE_FLOAT64 = 5,
+    WASM_VALUE_STRING = 6,
+    WASM_VALUE_ARRAY = 7,
+    WASM_VALUE_OBJECT = 8,
+    WASM_VALUE_BYTES = 9,
+    WASM_VALUE_ERROR = 10,
+};
+
+#define WASM_VALUE_MAX_DEPTH 256
+
+#endif /* WASM_VALUE_H */
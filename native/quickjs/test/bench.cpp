@@ -0,0 +1,210 @@
+/*
+ * QuickJS Sandbox Benchmark Runner
+ *
+ * Same shape as the test runner (main.cpp): creates a host QuickJS JSI
+ * runtime, installs the sandbox module and runs the JavaScript benchmark
+ * scenarios in sandbox_bench.js. The host additionally gets a
+ * high-resolution performance.now() for timing and __readFile(path) for
+ * loading fixtures (returns undefined when the file is missing), plus for
+ * bundle loading:
+ * - __readFileBuffer(path): the file as an ArrayBuffer, or undefined
+ * - __writeFile(path, text): boolean
+ * - __peakMemoryKB(reset?): peak resident set size in KB (Linux VmHWM),
+ *   reset to the current size (after trimming the heap) when `reset` is
+ *   true; undefined where it cannot be read
+ *
+ * Usage: quickjs_sandbox_bench [filter]
+ *   filter - only run scenarios whose name contains this substring
+ */
+
+#include "../src/QuickJSRuntimeFactory.h"
+#include "../src/QuickJSSandboxJSI.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace facebook;
+
+static std::string readFile(const std::string &path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + path);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  return buffer.str();
+}
+
+class FileBuffer : public jsi::MutableBuffer {
+public:
+  explicit FileBuffer(std::string contents) : contents_(std::move(contents)) {}
+  size_t size() const override { return contents_.size(); }
+  uint8_t *data() override {
+    return reinterpret_cast<uint8_t *>(&contents_[0]);
+  }
+
+private:
+  std::string contents_;
+};
+
+// VmHWM from /proc/self/status, in KB; -1 where it is not available
+static long peakMemoryKB(bool reset) {
+  if (reset) {
+#ifdef __GLIBC__
+    // Return freed heap first, so earlier runs do not hide new allocations
+    malloc_trim(0);
+#endif
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+  }
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::atol(line.c_str() + 6);
+    }
+  }
+  return -1;
+}
+
+static void installHostGlobals(jsi::Runtime &runtime) {
+  auto console = jsi::Object(runtime);
+  auto log = jsi::Function::createFromHostFunction(
+      runtime, jsi::PropNameID::forAscii(runtime, "log"), 1,
+      [](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+         size_t count) -> jsi::Value {
+        for (size_t i = 0; i < count; i++) {
+          if (i > 0)
+            std::cout << " ";
+          if (args[i].isString()) {
+            std::cout << args[i].asString(rt).utf8(rt);
+          } else {
+            std::cout << args[i].toString(rt).utf8(rt);
+          }
+        }
+        std::cout << std::endl;
+        return jsi::Value::undefined();
+      });
+  console.setProperty(runtime, "log", std::move(log));
+  runtime.global().setProperty(runtime, "console", std::move(console));
+
+  auto performance = jsi::Object(runtime);
+  auto now = jsi::Function::createFromHostFunction(
+      runtime, jsi::PropNameID::forAscii(runtime, "now"), 0,
+      [](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
+         size_t) -> jsi::Value {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+        return jsi::Value((double)ns / 1e6);
+      });
+  performance.setProperty(runtime, "now", std::move(now));
+  runtime.global().setProperty(runtime, "performance", std::move(performance));
+
+  auto readFileFn = jsi::Function::createFromHostFunction(
+      runtime, jsi::PropNameID::forAscii(runtime, "__readFile"), 1,
+      [](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+         size_t count) -> jsi::Value {
+        if (count < 1 || !args[0].isString()) {
+          return jsi::Value::undefined();
+        }
+        try {
+          return jsi::String::createFromUtf8(
+              rt, readFile(args[0].asString(rt).utf8(rt)));
+        } catch (const std::runtime_error &) {
+          return jsi::Value::undefined();
+        }
+      });
+  runtime.global().setProperty(runtime, "__readFile", std::move(readFileFn));
+
+  auto readFileBufferFn = jsi::Function::createFromHostFunction(
+      runtime, jsi::PropNameID::forAscii(runtime, "__readFileBuffer"), 1,
+      [](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+         size_t count) -> jsi::Value {
+        if (count < 1 || !args[0].isString()) {
+          return jsi::Value::undefined();
+        }
+        try {
+          return jsi::ArrayBuffer(
+              rt, std::make_shared<FileBuffer>(
+                      readFile(args[0].asString(rt).utf8(rt))));
+        } catch (const std::runtime_error &) {
+          return jsi::Value::undefined();
+        }
+      });
+  runtime.global().setProperty(runtime, "__readFileBuffer",
+                               std::move(readFileBufferFn));
+
+  auto writeFileFn = jsi::Function::createFromHostFunction(
+      runtime, jsi::PropNameID::forAscii(runtime, "__writeFile"), 2,
+      [](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+         size_t count) -> jsi::Value {
+        if (count < 2 || !args[0].isString() || !args[1].isString()) {
+          return false;
+        }
+        std::ofstream file(args[0].asString(rt).utf8(rt), std::ios::binary);
+        file << args[1].asString(rt).utf8(rt);
+        return file.good();
+      });
+  runtime.global().setProperty(runtime, "__writeFile", std::move(writeFileFn));
+
+  auto peakMemoryFn = jsi::Function::createFromHostFunction(
+      runtime, jsi::PropNameID::forAscii(runtime, "__peakMemoryKB"), 1,
+      [](jsi::Runtime &, const jsi::Value &, const jsi::Value *args,
+         size_t count) -> jsi::Value {
+        long kb = peakMemoryKB(count > 0 && args[0].isBool() && args[0].getBool());
+        return kb < 0 ? jsi::Value::undefined() : jsi::Value((double)kb);
+      });
+  runtime.global().setProperty(runtime, "__peakMemoryKB",
+                               std::move(peakMemoryFn));
+}
+
+int main(int argc, const char *argv[]) {
+  try {
+    auto runtime = qjs::createQuickJSRuntime("");
+    installHostGlobals(*runtime);
+    quickjs_sandbox::QuickJSSandboxModule::install(*runtime);
+
+    runtime->global().setProperty(
+        *runtime, "__benchFilter",
+        jsi::String::createFromUtf8(*runtime, argc > 1 ? argv[1] : ""));
+
+    std::vector<std::string> searchPaths = {
+        "test/sandbox_bench.js", "./test/sandbox_bench.js",
+        "../test/sandbox_bench.js", "sandbox_bench.js"};
+
+    std::string benchCode;
+    bool found = false;
+    for (const auto &path : searchPaths) {
+      try {
+        benchCode = readFile(path);
+        found = true;
+        break;
+      } catch (...) {
+        // Try next path
+      }
+    }
+
+    if (!found) {
+      std::cerr << "Error: Could not find sandbox_bench.js" << std::endl;
+      return 1;
+    }
+
+    auto buffer = std::make_shared<jsi::StringBuffer>(benchCode);
+    runtime->evaluateJavaScript(buffer, "sandbox_bench.js");
+  } catch (const jsi::JSError &e) {
+    std::cerr << "JavaScript Error: " << e.getMessage() << std::endl;
+    std::cerr << "Stack: " << e.getStack() << std::endl;
+    return 1;
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
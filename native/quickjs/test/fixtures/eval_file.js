@@ -0,0 +1,6 @@
+// Evaluated by sandbox_test.js with evalFile()
+function fromFile() {
+  return new Error('from file').stack;
+}
+var fileStack = fromFile();
+40 + 2;
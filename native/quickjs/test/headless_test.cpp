@@ -0,0 +1,194 @@
+/*
+ * Headless host tests
+ *
+ * Renders a small guest app through rill::HeadlessHost and
+ * rill::HeadlessHostPool with the embedded guest runtime. Skipped when the
+ * library was built without it (see QUICKJS_SANDBOX_EMBED_BOOTSTRAP).
+ */
+
+#include "../src/BundleCompiler.h"
+#include "../src/HeadlessHost.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *kApp = R"JS(
+var React = globalThis.React;
+var h = React.createElement;
+function Row(props) {
+  var s = React.useState(0);
+  React.useEffect(function () { s[1](1); }, []);
+  return h('View', { onPress: function () {} }, h('Text', null, props.label + ':' + s[0]));
+}
+function App(props) {
+  var cfg = RillSDK.useConfig();
+  var rows = [];
+  for (var i = 0; i < props.rows; i++) rows.push(h(Row, { key: i, label: 'row' + i }));
+  return h('List', { title: cfg.title }, rows);
+}
+module.exports = { default: App };
+globalThis.__RillGuest = module.exports;
+)JS";
+
+int passed = 0;
+int failed = 0;
+
+void check(bool condition, const std::string &name) {
+  if (condition) {
+    passed++;
+    std::cout << "  ✓ " << name << std::endl;
+  } else {
+    failed++;
+    std::cout << "  ✗ " << name << std::endl;
+  }
+}
+
+bool contains(const std::string &haystack, const std::string &needle) {
+  return haystack.find(needle) != std::string::npos;
+}
+
+// Feed `code` to `compiler` in small chunks from another thread, like a
+// download
+std::thread feed(quickjs_sandbox::BundleCompiler &compiler,
+                 const std::string &code) {
+  return std::thread([&compiler, code] {
+    for (size_t pos = 0; pos < code.size(); pos += 16) {
+      compiler.append(code.data() + pos, std::min<size_t>(16, code.size() - pos));
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    compiler.finish();
+  });
+}
+
+template <typename Fn> bool throwsHeadlessError(Fn fn, const char *message) {
+  try {
+    fn();
+  } catch (const rill::HeadlessError &e) {
+    return contains(e.what(), message);
+  }
+  return false;
+}
+
+} // namespace
+
+int main() {
+  try {
+    rill::HeadlessHost probe;
+    probe.loadBundle("globalThis.__RillGuest = function () { return null; };");
+  } catch (const rill::HeadlessError &e) {
+    if (contains(e.what(), "not embedded")) {
+      std::cout << "Skipping headless tests: " << e.what() << std::endl;
+      return 0;
+    }
+    throw;
+  }
+
+  std::cout << "\n=== HeadlessHost ===" << std::endl;
+  {
+    rill::HeadlessHost host;
+    check(!host.hasBundle(), "no bundle before loadBundle");
+    check(throwsHeadlessError([&] { host.render(); }, "No guest bundle"),
+          "render without a bundle throws");
+
+    host.loadBundle(kApp);
+    check(host.hasBundle(), "hasBundle after loadBundle");
+
+    rill::RenderResult first = host.render(R"({"rows":2,"title":"t"})");
+    check(first.tree.rfind(R"([["List",{"title":"t"},["View",{"onPress":)", 0) == 0,
+          "root element with props from useConfig");
+    check(contains(first.tree, R"(["Text",{},"row0:1"])") &&
+              contains(first.tree, R"(["Text",{},"row1:1"])"),
+          "effects and state updates settle before returning");
+    check(contains(first.tree, R"("__type":"function")"),
+          "function props are serialized as references");
+    check(first.nodes == 7, "node count");
+    check(first.batches >= 2 && first.timers >= 1,
+          "mount batch and scheduler timer are counted");
+
+    rill::RenderResult updated = host.render(R"({"rows":3,"title":"u"})", true);
+    check(contains(updated.tree, R"({"title":"u"})") &&
+              contains(updated.tree, R"("row2:1")"),
+          "keepState re-render applies the new props");
+    check(updated.operations < first.operations,
+          "keepState commits only the difference");
+
+    rill::HeapStats heap = host.heapStats();
+    host.resetHeapStats();
+    rill::HeapStats reset = host.heapStats();
+    check(heap.allocations > 0 && heap.peakHeapBytes >= heap.heapBytes &&
+              reset.allocations == 0 && reset.peakHeapBytes == reset.heapBytes,
+          "guest heap peak and allocations, and their reset");
+
+    rill::RenderResult fresh = host.render(R"({"rows":1,"title":"t"})");
+    check(fresh.nodes == 4 && !contains(fresh.tree, "row1"),
+          "fresh render replaces the tree");
+
+    host.loadBundle("1;");
+    check(throwsHeadlessError([&] { host.render(); }, "no component export"),
+          "bundle without a component throws on render");
+    check(throwsHeadlessError(
+              [&] { host.loadBundle("throw new Error('boom');"); }, "boom"),
+          "guest errors while loading surface as HeadlessError");
+    check(throwsHeadlessError([&] { host.render("[1"); }, ""),
+          "malformed props throw");
+  }
+
+  std::cout << "\n=== Streamed bundle ===" << std::endl;
+  {
+    rill::HeadlessHost host;
+    host.loadBundle(kApp);
+    std::string expected = host.render(R"({"rows":2,"title":"t"})").tree;
+
+    quickjs_sandbox::BundleCompiler compiler("app.js", 4096);
+    std::thread producer = feed(compiler, kApp);
+    host.loadBundle(compiler);
+    producer.join();
+    check(host.render(R"({"rows":2,"title":"t"})").tree == expected,
+          "streamed bundle renders like a loaded one");
+    quickjs_sandbox::BundleCompiler::Stats stats = compiler.stats();
+    check(stats.streamed && stats.bytes == std::string(kApp).size() &&
+              stats.chunks > 1,
+          "bundle compiled while it arrived");
+
+    quickjs_sandbox::BundleCompiler broken("broken.js");
+    std::thread brokenProducer = feed(broken, "var a = 1;\nvar = ;\n");
+    check(throwsHeadlessError([&] { host.loadBundle(broken); }, "SyntaxError"),
+          "syntax errors in a streamed bundle surface as HeadlessError");
+    brokenProducer.join();
+  }
+
+  std::cout << "\n=== HeadlessHostPool ===" << std::endl;
+  {
+    rill::HeadlessHostPool pool(3);
+    check(pool.threads() == 3, "worker count");
+
+    auto bundle = std::make_shared<const std::string>(kApp);
+    std::vector<std::future<rill::RenderResult>> futures;
+    for (int i = 0; i < 6; i++) {
+      futures.push_back(pool.submit(
+          bundle, R"({"rows":)" + std::to_string(i) + R"(,"title":"p"})"));
+    }
+    bool allMatch = true;
+    for (int i = 0; i < 6; i++) {
+      rill::RenderResult result = futures[i].get();
+      allMatch = allMatch && result.nodes == 1 + 3u * i;
+    }
+    check(allMatch, "each job renders its own props");
+
+    auto broken = std::make_shared<const std::string>("throw new Error('bad');");
+    auto failing = pool.submit(broken);
+    check(throwsHeadlessError([&] { failing.get(); }, "bad"),
+          "job errors are delivered through the future");
+    check(pool.submit(bundle, R"({"rows":1,"title":"p"})").get().nodes == 4,
+          "workers recover after a failed job");
+  }
+
+  std::cout << "\n" << passed << " passed, " << failed << " failed"
+            << std::endl;
+  return failed == 0 ? 0 : 1;
+}
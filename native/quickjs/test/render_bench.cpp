@@ -0,0 +1,235 @@
+/*
+ * End-to-end render benchmark
+ *
+ * Renders a keyed 1k-row list through rill::HeadlessHost: a host
+ * QuickJSRuntime with the sandbox module, the real guest runtime (React and
+ * the Rill reconciler, embedded at build time or given with --runtime) and
+ * the native operation sink and tree. Each scenario prepares the tree
+ * untimed, then times one commit (render until React is idle):
+ *   mount      - 0 -> N rows
+ *   update     - every 10th row's text changes
+ *   swap       - rows 1 and N-2 trade places
+ *   reverse    - all rows reversed
+ *   unmount    - N -> 0 rows
+ *
+ * Reports operations per second, commit latency percentiles and the guest
+ * heap (peak and allocations per commit, from the QuickJS allocator).
+ *
+ * Usage: quickjs_render_bench [--rows n] [--iterations n] [--runtime path]
+ *                             [--json] [filter]
+ */
+
+#include "../src/HeadlessHost.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *kApp = R"JS(
+var React = globalThis.React;
+var h = React.createElement;
+var rowStyle = { height: 44, paddingHorizontal: 16, flexDirection: 'row' };
+function onSelect() {}
+var Row = React.memo(function Row(props) {
+  return h('View', { style: rowStyle, onPress: onSelect }, h('Text', null, props.label));
+});
+function App(props) {
+  var n = props.rows || 0;
+  var ids = [];
+  for (var i = 0; i < n; i++) ids.push(props.reverse ? n - 1 - i : i);
+  if (props.swap && n > 3) {
+    var t = ids[1];
+    ids[1] = ids[n - 2];
+    ids[n - 2] = t;
+  }
+  var rows = ids.map(function (id) {
+    var label = 'row ' + id + (id % 10 === 0 ? ' #' + (props.tick || 0) : '');
+    return h(Row, { key: id, label: label });
+  });
+  return h('ScrollView', null, rows);
+}
+globalThis.__RillGuest = { default: App };
+)JS";
+
+struct Sample {
+  double ms;
+  uint32_t operations;
+  uint64_t allocations;
+  size_t peakHeapBytes;
+};
+
+struct Scenario {
+  const char *name;
+  // Untimed setup before commit i (a render without keepState starts a
+  // fresh tree), then the timed commit's props
+  std::function<void(rill::HeadlessHost &, int)> prepare;
+  std::function<std::string(int)> props;
+  uint32_t expectedNodes;
+};
+
+bool readFile(const std::string &path, std::string *out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  *out = buffer.str();
+  return true;
+}
+
+std::string rowsProps(int rows, const char *extra = "") {
+  return "{\"rows\":" + std::to_string(rows) + extra + "}";
+}
+
+double percentile(std::vector<double> sorted, double p) {
+  size_t index = (size_t)(p / 100.0 * (double)(sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int usage() {
+  std::cerr << "usage: quickjs_render_bench [--rows n] [--iterations n] "
+               "[--runtime path] [--json] [filter]"
+            << std::endl;
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int rows = 1000;
+  int iterations = 10;
+  bool json = false;
+  std::string filter;
+  rill::HeadlessOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--rows" && hasValue) {
+      rows = std::max(4, std::atoi(argv[++i]));
+    } else if (arg == "--iterations" && hasValue) {
+      iterations = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--runtime" && hasValue) {
+      if (!readFile(argv[++i], &options.guestRuntimeSource)) {
+        std::cerr << "quickjs_render_bench: cannot read " << argv[i]
+                  << std::endl;
+        return 1;
+      }
+    } else if (arg == "--json") {
+      json = true;
+    } else if (arg[0] == '-' || !filter.empty()) {
+      return usage();
+    } else {
+      filter = arg;
+    }
+  }
+
+  const uint32_t fullNodes = 1 + 3 * (uint32_t)rows;
+  auto mounted = [rows](rill::HeadlessHost &host, int) {
+    host.render(rowsProps(rows));
+  };
+  std::vector<Scenario> scenarios = {
+      {"mount", [](rill::HeadlessHost &host, int) { host.render(rowsProps(0)); },
+       [rows](int) { return rowsProps(rows); }, fullNodes},
+      {"update",
+       [rows](rill::HeadlessHost &host, int i) {
+         if (i == 0) {
+           host.render(rowsProps(rows));
+         }
+       },
+       [rows](int i) {
+         return rowsProps(rows, (",\"tick\":" + std::to_string(i + 1)).c_str());
+       },
+       fullNodes},
+      {"swap", mounted, [rows](int) { return rowsProps(rows, ",\"swap\":true"); },
+       fullNodes},
+      {"reverse", mounted,
+       [rows](int) { return rowsProps(rows, ",\"reverse\":true"); }, fullNodes},
+      {"unmount", mounted, [](int) { return rowsProps(0); }, 1},
+  };
+
+  std::ostringstream report;
+  if (json) {
+    report << "{\"rows\":" << rows << ",\"iterations\":" << iterations
+           << ",\"scenarios\":{";
+  } else {
+    report << "=== render (" << rows << " rows, " << iterations
+           << " commits per scenario) ===\n";
+  }
+
+  try {
+    rill::HeadlessHost host(options);
+    host.loadBundle(kApp);
+    bool first = true;
+
+    for (const Scenario &scenario : scenarios) {
+      if (!filter.empty() &&
+          std::string(scenario.name).find(filter) == std::string::npos) {
+        continue;
+      }
+      std::vector<Sample> samples;
+      for (int i = 0; i < iterations; i++) {
+        scenario.prepare(host, i);
+        host.resetHeapStats();
+        rill::RenderResult result = host.render(scenario.props(i), true);
+        rill::HeapStats heap = host.heapStats();
+        if (result.nodes != scenario.expectedNodes) {
+          throw rill::HeadlessError(std::string(scenario.name) + ": " +
+                                    std::to_string(result.nodes) +
+                                    " nodes, expected " +
+                                    std::to_string(scenario.expectedNodes));
+        }
+        samples.push_back({result.renderMs, result.operations,
+                           heap.allocations, heap.peakHeapBytes});
+      }
+
+      std::vector<double> times;
+      double totalMs = 0;
+      uint64_t operations = 0;
+      uint64_t allocations = 0;
+      size_t peakHeap = 0;
+      for (const Sample &sample : samples) {
+        times.push_back(sample.ms);
+        totalMs += sample.ms;
+        operations += sample.operations;
+        allocations += sample.allocations;
+        peakHeap = std::max(peakHeap, sample.peakHeapBytes);
+      }
+      std::sort(times.begin(), times.end());
+
+      char line[512];
+      const char *format =
+          json ? "%s\"%s\":{\"ops_per_commit\":%.0f,\"ops_per_s\":%.0f,"
+                 "\"p50_ms\":%.3f,\"p95_ms\":%.3f,\"p99_ms\":%.3f,"
+                 "\"peak_heap_kb\":%.0f,\"allocs_per_commit\":%.0f}"
+               : "%s  %-8s ops/commit=%.0f ops/s=%.0f p50_ms=%.3f "
+                 "p95_ms=%.3f p99_ms=%.3f peak_heap_kb=%.0f "
+                 "allocs/commit=%.0f\n";
+      snprintf(line, sizeof(line), format, json && !first ? "," : "",
+               scenario.name, (double)operations / samples.size(),
+               totalMs > 0 ? operations / (totalMs / 1000) : 0.0,
+               percentile(times, 50), percentile(times, 95),
+               percentile(times, 99), peakHeap / 1024.0,
+               (double)allocations / samples.size());
+      report << line;
+      first = false;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "quickjs_render_bench: " << e.what() << std::endl;
+    return 1;
+  }
+
+  if (json) {
+    report << "}}\n";
+  }
+  std::cout << report.str();
+  return 0;
+}
@@ -0,0 +1,953 @@
+/**
+ * QuickJS Sandbox Benchmarks
+ *
+ * Runs in the Host JS runtime (see bench.cpp). Each scenario prints one
+ * line per variant so results can be diffed between builds.
+ */
+
+(() => {
+  var sandbox = globalThis.__QuickJSSandboxJSI;
+  var filter = globalThis.__benchFilter || '';
+
+  function now() {
+    return performance.now();
+  }
+
+  function scenario(name, fn) {
+    if (filter && name.indexOf(filter) === -1) return;
+    console.log(`\n=== ${name} ===`);
+    fn();
+  }
+
+  function report(label, fields) {
+    var parts = [];
+    for (var key in fields) {
+      var v = fields[key];
+      parts.push(`${key}=${typeof v === 'number' && v % 1 !== 0 ? v.toFixed(3) : v}`);
+    }
+    console.log(`  ${label}: ${parts.join(' ')}`);
+  }
+
+  // Validation-heavy guest form: RegExp literals compiled at load time and
+  // `new RegExp(pattern)` compiled per validation, in several contexts.
+  scenario('regexp-form-validation', () => {
+    var FORM_SOURCE = `
+      var rules = [
+        { field: 'email', pattern: '^[\\\\w.+-]+@[\\\\w-]+(\\\\.[\\\\w-]+)+$', flags: 'i' },
+        { field: 'phone', pattern: '^\\\\+?[0-9 ()-]{7,20}$', flags: '' },
+        { field: 'zip', pattern: '^\\\\d{5}(-\\\\d{4})?$', flags: '' },
+        { field: 'url', pattern: '^https?:\\\\/\\\\/[^\\\\s/$.?#].[^\\\\s]*$', flags: 'i' },
+        { field: 'date', pattern: '^\\\\d{4}-\\\\d{2}-\\\\d{2}$', flags: '' },
+        { field: 'name', pattern: '^[A-Za-z][A-Za-z \\'-]{1,63}$', flags: '' },
+      ];
+      var literalChecks = [
+        /^[A-Z]{2}\\d{2}[A-Z0-9]{11,30}$/, /^(?:4\\d{12}(?:\\d{3})?|5[1-5]\\d{14})$/,
+        /^#(?:[0-9a-f]{3}){1,2}$/i, /^\\s*$/, /^[\\w-]{3,16}$/, /(?=.*\\d)(?=.*[a-z]).{8,}/,
+      ];
+      var values = {
+        email: 'someone@example.com', phone: '+1 (555) 010-9999', zip: '94107-1234',
+        url: 'https://example.com/a/b?c=d', date: '2024-01-15', name: "O'Neil",
+      };
+      function validate() {
+        var ok = 0;
+        for (var i = 0; i < rules.length; i++) {
+          var r = rules[i];
+          if (new RegExp(r.pattern, r.flags).test(values[r.field])) ok++;
+        }
+        for (var j = 0; j < literalChecks.length; j++) {
+          if (literalChecks[j].test('password1')) ok++;
+        }
+        return ok;
+      }
+    `;
+    var CONTEXTS = 8;
+    var ROUNDS = 2000;
+
+    [0, 64].forEach((cacheSize) => {
+      var runtime = sandbox.createRuntime({ regexpCacheSize: cacheSize });
+      var t0 = now();
+      var contexts = [];
+      for (var i = 0; i < CONTEXTS; i++) {
+        var ctx = runtime.createContext();
+        ctx.eval(FORM_SOURCE);
+        contexts.push(ctx);
+      }
+      var loadMs = now() - t0;
+
+      t0 = now();
+      for (var c = 0; c < contexts.length; c++) {
+        contexts[c].eval(`for (var k = 0; k < ${ROUNDS}; k++) validate();`);
+      }
+      var validateMs = now() - t0;
+      var validations = CONTEXTS * ROUNDS;
+      var info = runtime.getHeapInfo();
+      var lookups = info.regexp_cache_hits + info.regexp_cache_misses;
+      report(`cacheSize=${cacheSize}`, {
+        load_ms: loadMs,
+        validate_ms: validateMs,
+        validations_per_sec: Math.round(validations / (validateMs / 1000)),
+        hit_rate: lookups ? info.regexp_cache_hits / lookups : 0,
+        cache_bytes: info.regexp_cache_size,
+      });
+      runtime.dispose();
+    });
+  });
+  // String transcoding across the boundary: long text nodes (mostly ASCII
+  // with some accented / CJK characters) and objects with many short keys.
+  scenario('string-transcoding', () => {
+    var runtime = sandbox.createRuntime();
+    var ctx = runtime.createContext();
+    var ascii = 'The quick brown fox jumps over the lazy dog. ';
+    var mixed = 'Crème brûlée at the café, naïve façade — 東京 ';
+    var texts = {
+      ascii: ascii.repeat(400),
+      mixed: (ascii.repeat(6) + mixed).repeat(60),
+      cjk: '数据同步已完成，请稍后刷新页面。'.repeat(400),
+    };
+    var ROUNDS = 300;
+
+    Object.keys(texts).forEach((kind) => {
+      var text = texts[kind];
+      ctx.setGlobal('text', text);
+      var t0 = now();
+      for (var i = 0; i < ROUNDS; i++) {
+        ctx.setGlobal('text', text);
+        if (ctx.getGlobal('text').length !== text.length) throw new Error('length mismatch');
+      }
+      var ms = now() - t0;
+      report(`text-${kind}`, {
+        chars: text.length,
+        ms: ms,
+        mchars_per_sec: (text.length * ROUNDS * 2) / (ms * 1000),
+      });
+    });
+
+    var props = {};
+    for (var k = 0; k < 64; k++) props[`key${k}`] = k;
+    var KEY_ROUNDS = 2000;
+    var t0 = now();
+    for (var r = 0; r < KEY_ROUNDS; r++) {
+      ctx.setGlobal('props', props);
+    }
+    var ms = now() - t0;
+    report('short-keys', { keys: 64, ms: ms, keys_per_sec: Math.round((64 * KEY_ROUNDS) / (ms / 1000)) });
+
+    ctx.dispose();
+    runtime.dispose();
+  });
+  // JSON.parse / JSON.stringify of ~1MB API-response style payloads inside
+  // a guest context.
+  scenario('json-1mb', () => {
+    var runtime = sandbox.createRuntime();
+    var ctx = runtime.createContext();
+    ctx.eval(`
+      var items = [];
+      for (var i = 0; i < 3100; i++) {
+        items.push({
+          id: 100000 + i,
+          title: 'Item number ' + i + ' in the catalogue',
+          description: 'Line one of the description.\\nLine two with "quotes" and a tab\\t.',
+          price: (i * 7.31) % 1000,
+          tags: ['alpha', 'beta', i % 2 ? 'gamma' : 'delta'],
+          author: { name: 'Zoë Ångström', email: 'user' + i + '@example.com', verified: i % 3 === 0 },
+          ratio: i / 3,
+          active: true,
+          parent: null,
+        });
+      }
+      var payload = { status: 'ok', count: items.length, items: items };
+      var json = JSON.stringify(payload);
+    `);
+    var bytes = ctx.eval('json.length');
+    var ROUNDS = 10;
+
+    var t0 = now();
+    ctx.eval(`for (var r = 0; r < ${ROUNDS}; r++) JSON.parse(json);`);
+    var parseMs = (now() - t0) / ROUNDS;
+
+    t0 = now();
+    ctx.eval(`for (var r = 0; r < ${ROUNDS}; r++) JSON.stringify(payload);`);
+    var stringifyMs = (now() - t0) / ROUNDS;
+
+    t0 = now();
+    ctx.eval(`for (var r = 0; r < ${ROUNDS}; r++) JSON.stringify(payload, null, 2);`);
+    var prettyMs = (now() - t0) / ROUNDS;
+
+    if (ctx.eval('JSON.stringify(JSON.parse(json)) === json') !== true) throw new Error('round trip mismatch');
+
+    report('parse', { bytes: bytes, ms: parseMs, mb_per_sec: bytes / 1048576 / (parseMs / 1000) });
+    report('stringify', { bytes: bytes, ms: stringifyMs, mb_per_sec: bytes / 1048576 / (stringifyMs / 1000) });
+    report('stringify-indent', { ms: prettyMs });
+
+    ctx.dispose();
+    runtime.dispose();
+  });
+  // Diagnostics payload sizing for guest -> host events: JSON.stringify in
+  // the host vs the native estimate (walked, or recorded during conversion).
+  scenario('payload-size', () => {
+    var runtime = sandbox.createRuntime();
+    var ctx = runtime.createContext();
+    var GUEST_PAYLOAD = `({
+      type: 'batch',
+      operations: Array.from({ length: 200 }, (_, i) => ({
+        op: 'update', id: i, props: { title: 'Row ' + i, subtitle: 'Détails ' + i, selected: i % 2 === 0, width: i * 3 },
+      })),
+    })`;
+    var ROUNDS = 200;
+    var modes = {
+      'json-stringify': (payload) => JSON.stringify(payload).length,
+      'module-walk': (payload) => sandbox.estimateSize(payload).bytes,
+      'context-recorded': (payload) => ctx.estimateSize(payload).bytes,
+    };
+
+    Object.keys(modes).forEach((mode) => {
+      var measure = modes[mode];
+      var bytes = 0;
+      ctx.setGlobal('__sendEventToHost', (name, payload) => {
+        bytes = measure(payload);
+      });
+      ctx.eval(`var payload = ${GUEST_PAYLOAD};`);
+      var t0 = now();
+      ctx.eval(`for (var r = 0; r < ${ROUNDS}; r++) __sendEventToHost('OPS', payload);`);
+      var ms = now() - t0;
+      report(mode, { bytes: bytes, ms: ms, us_per_event: (ms * 1000) / ROUNDS });
+    });
+
+    ctx.dispose();
+    runtime.dispose();
+  });
+  // High-frequency updates: 100 animated nodes updated 10 times per batch,
+  // plus list reorders, sent through a plain host function vs an operation
+  // sink that coalesces natively before conversion.
+  scenario('op-coalescing', () => {
+    var BATCH_SOURCE = `
+      function makeBatch(seq) {
+        var ops = [];
+        for (var frame = 0; frame < 10; frame++) {
+          for (var id = 1; id <= 100; id++) {
+            ops.push({ op: 'UPDATE', id: id, props: { style: { opacity: frame / 10, left: id * frame }, label: 'n' + id }, timestamp: seq });
+          }
+          ops.push({ op: 'REORDER', parentId: 1000, childIds: [3, 1, 2, frame] });
+        }
+        return { version: 1, batchId: seq, operations: ops };
+      }
+    `;
+    var ROUNDS = 50;
+    [false, true].forEach((coalesce) => {
+      var runtime = sandbox.createRuntime();
+      var ctx = runtime.createContext();
+      ctx.eval(BATCH_SOURCE);
+      var received = 0;
+      var sink = (batch) => {
+        received += batch.operations.length;
+      };
+      if (coalesce) ctx.setOperationSink('__sendToHost', sink);
+      else ctx.setGlobal('__sendToHost', sink);
+      ctx.eval('var batches = []; for (var s = 0; s < ' + ROUNDS + '; s++) batches.push(makeBatch(s));');
+      var t0 = now();
+      ctx.eval('for (var s = 0; s < batches.length; s++) __sendToHost(batches[s]);');
+      var ms = now() - t0;
+      var fields = { ops_in: 1010 * ROUNDS, ops_out: received, ms_per_batch: ms / ROUNDS };
+      if (coalesce) {
+        var stats = ctx.getCoalescingStats();
+        fields.coalesce_ms = stats.coalesceMs / ROUNDS;
+        fields.conversion_ms = stats.conversionMs / ROUNDS;
+        fields.est_saved_ms = stats.estimatedSavedMs / ROUNDS;
+      }
+      report(coalesce ? 'setOperationSink' : 'setGlobal', fields);
+      ctx.dispose();
+      runtime.dispose();
+    });
+  });
+  // Steady-state list scroll: every frame re-sends the visible rows, whose
+  // props reference the same StyleSheet.create() (frozen) style objects.
+  scenario('frozen-style-memo', () => {
+    var SCROLL_SOURCE = `
+      function deepFreeze(o) {
+        Object.values(o).forEach((v) => typeof v === 'object' && v && deepFreeze(v));
+        return Object.freeze(o);
+      }
+      var styles = deepFreeze({
+        row: { flexDirection: 'row', alignItems: 'center', paddingHorizontal: 16, paddingVertical: 12, borderBottomWidth: 1, borderColor: '#eee' },
+        avatar: { width: 40, height: 40, borderRadius: 20, marginRight: 12, backgroundColor: '#ccc' },
+        title: { fontSize: 16, fontWeight: '600', color: '#222' },
+        subtitle: { fontSize: 13, color: '#777', marginTop: 2 },
+        badge: { position: 'absolute', right: 16, top: 12, transform: [{ scale: 0.9 }, { translateY: -2 }] },
+      });
+      var ROW_PROPS = deepFreeze({ accessible: true, hitSlop: { top: 4, bottom: 4, left: 4, right: 4 } });
+      function frame(offset) {
+        var ops = [];
+        for (var r = 0; r < 40; r++) {
+          var i = offset + r;
+          ops.push({ op: 'UPDATE', id: i * 4, props: { style: styles.row, common: ROW_PROPS, testID: 'row-' + i } });
+          ops.push({ op: 'UPDATE', id: i * 4 + 1, props: { style: styles.avatar } });
+          ops.push({ op: 'UPDATE', id: i * 4 + 2, props: { style: styles.title, text: 'Item ' + i } });
+          ops.push({ op: 'UPDATE', id: i * 4 + 3, props: { style: [styles.subtitle, styles.badge], text: 'Sub ' + i } });
+        }
+        return { version: 1, batchId: offset, operations: ops };
+      }
+    `;
+    var FRAMES = 300;
+    [0, 1024].forEach((memoSize) => {
+      var runtime = sandbox.createRuntime({ conversionMemoSize: memoSize });
+      var ctx = runtime.createContext();
+      ctx.eval(SCROLL_SOURCE);
+      var ops = 0;
+      ctx.setGlobal('__sendToHost', (batch) => {
+        ops += batch.operations.length;
+      });
+      ctx.eval('var frames = []; for (var f = 0; f < ' + FRAMES + '; f++) frames.push(frame(f));');
+      var t0 = now();
+      ctx.eval('for (var f = 0; f < frames.length; f++) __sendToHost(frames[f]);');
+      var ms = now() - t0;
+      var stats = ctx.getConversionStats();
+      var lookups = stats.hits + stats.misses;
+      report(`conversionMemoSize=${memoSize}`, {
+        ops: ops,
+        ms_per_frame: ms / FRAMES,
+        hit_rate: lookups ? stats.hits / lookups : 0,
+        entries: stats.entries,
+      });
+      ctx.dispose();
+      runtime.dispose();
+    });
+  });
+  // 10k-row list reorders applied to the host tree: the Receiver's JS
+  // structure handlers (Map/Set/array splice) vs the native tree store,
+  // including the children arrays handed back for rendering.
+  scenario('tree-reorder-10k', () => {
+    var ROWS = 10000;
+    var LIST = 1;
+
+    function jsTree() {
+      var nodes = new Map([[0, { children: [] }]]);
+      var childSets = new Map([[0, new Set()]]);
+      var parentOf = new Map();
+      function detach(childId, parentId) {
+        var set = childSets.get(parentId);
+        if (set && set.has(childId)) {
+          var list = nodes.get(parentId).children;
+          list.splice(list.indexOf(childId), 1);
+          set.delete(childId);
+        }
+      }
+      var handlers = {
+        CREATE: (op) => {
+          nodes.set(op.id, { children: [] });
+          childSets.set(op.id, new Set());
+        },
+        APPEND: (op) => {
+          var set = childSets.get(op.parentId);
+          if (set && !set.has(op.childId)) {
+            nodes.get(op.parentId).children.push(op.childId);
+            set.add(op.childId);
+          }
+          parentOf.set(op.childId, op.parentId);
+        },
+        INSERT: (op) => {
+          var set = childSets.get(op.parentId);
+          if (!set) return;
+          detach(op.childId, op.parentId);
+          nodes.get(op.parentId).children.splice(op.index, 0, op.childId);
+          set.add(op.childId);
+          parentOf.set(op.childId, op.parentId);
+        },
+        REORDER: (op) => {
+          var node = nodes.get(op.parentId);
+          var next = new Set(op.childIds);
+          for (var i = 0; i < node.children.length; i++) {
+            var id = node.children[i];
+            if (!next.has(id) && parentOf.get(id) === op.parentId) parentOf.delete(id);
+          }
+          for (var j = 0; j < op.childIds.length; j++) parentOf.set(op.childIds[j], op.parentId);
+          node.children = op.childIds;
+          childSets.set(op.parentId, next);
+        },
+      };
+      return {
+        apply: (ops) => {
+          for (var i = 0; i < ops.length; i++) handlers[ops[i].op](ops[i]);
+        },
+        children: (id) => nodes.get(id).children,
+      };
+    }
+
+    function nativeTree() {
+      var store = sandbox.createTreeStore();
+      var children = new Map();
+      return {
+        apply: (ops) => {
+          var changed = store.applyBatch(ops).childrenChanged;
+          for (var i = 0; i < changed.length; i++) children.set(changed[i], store.getChildren(changed[i]));
+        },
+        children: (id) => children.get(id),
+      };
+    }
+
+    var mountOps = [{ op: 'CREATE', id: LIST }, { op: 'APPEND', parentId: 0, childId: LIST }];
+    var order = [];
+    for (var r = 0; r < ROWS; r++) {
+      var id = 100 + r;
+      mountOps.push({ op: 'CREATE', id: id }, { op: 'APPEND', parentId: LIST, childId: id });
+      order.push(id);
+    }
+    var seed = 42;
+    function random(n) {
+      seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+      return seed % n;
+    }
+    // Moves as React emits them: INSERT of existing rows at new indices
+    var moveBatches = [];
+    for (var b = 0; b < 20; b++) {
+      var moves = [];
+      for (var m = 0; m < 50; m++) {
+        moves.push({ op: 'INSERT', parentId: LIST, childId: 100 + random(ROWS), index: random(ROWS) });
+      }
+      moveBatches.push(moves);
+    }
+    var swapBatches = [];
+    for (var s = 0; s < 200; s++) {
+      var a = random(ROWS);
+      var z = random(ROWS);
+      swapBatches.push([
+        { op: 'INSERT', parentId: LIST, childId: 100 + a, index: z },
+        { op: 'INSERT', parentId: LIST, childId: 100 + z, index: a },
+      ]);
+    }
+    var reorderBatches = [];
+    for (var k = 0; k < 10; k++) {
+      reorderBatches.push([{ op: 'REORDER', parentId: LIST, childIds: k % 2 ? order.slice() : order.slice().reverse() }]);
+    }
+
+    var results = {};
+    [
+      ['js-receiver', jsTree],
+      ['native-store', nativeTree],
+    ].forEach(([label, make]) => {
+      var tree = make();
+      var t0 = now();
+      tree.apply(mountOps);
+      var mountMs = now() - t0;
+      function run(batches) {
+        var start = now();
+        for (var i = 0; i < batches.length; i++) tree.apply(batches[i]);
+        return (now() - start) / batches.length;
+      }
+      var fields = {
+        mount_ms: mountMs,
+        move50_ms: run(moveBatches),
+        swap_ms: run(swapBatches),
+        reorder_ms: run(reorderBatches),
+      };
+      results[label] = tree.children(LIST).join(',');
+      report(label, fields);
+    });
+    if (results['js-receiver'] !== results['native-store']) throw new Error('tree mismatch');
+  });
+
+  // Guest telemetry/event chatter: 200 small messages per frame, delivered
+  // by a synchronous host call each, or posted to the ring and drained once
+  // per frame.
+  scenario('message-ring', () => {
+    var FRAMES = 100;
+    var PER_FRAME = 200;
+    var FRAME_SOURCE = `
+      function frame(f) {
+        for (var i = 0; i < ${PER_FRAME}; i++) {
+          __post({ type: 'scroll', frame: f, i: i, offset: f * 16 + i / 10 });
+        }
+      }
+    `;
+    ['host-call', 'ring'].forEach((mode) => {
+      var runtime = sandbox.createRuntime();
+      var ctx = runtime.createContext();
+      var received = 0;
+      if (mode === 'ring') ctx.openMessageRing('__post', 1 << 20);
+      else ctx.setGlobal('__post', (msg) => void (received += msg.i >= 0 ? 1 : 0));
+      ctx.eval(FRAME_SOURCE);
+      var guestMs = 0;
+      var drainMs = 0;
+      for (var f = 0; f < FRAMES; f++) {
+        var t0 = now();
+        ctx.eval(`frame(${f})`);
+        var t1 = now();
+        if (mode === 'ring') {
+          var batch = ctx.drainMessages();
+          for (var i = 0; i < batch.length; i++) received += batch[i].i >= 0 ? 1 : 0;
+        }
+        guestMs += t1 - t0;
+        drainMs += now() - t1;
+      }
+      if (received !== FRAMES * PER_FRAME) throw new Error('lost messages');
+      var fields = { guest_ms: guestMs / FRAMES, drain_ms: drainMs / FRAMES, frame_ms: (guestMs + drainMs) / FRAMES };
+      if (mode === 'ring') fields.high_water_kb = ctx.getMessageRingStats().highWaterBytes / 1024;
+      report(mode, fields);
+      ctx.dispose();
+      runtime.dispose();
+    });
+  });
+
+  // Event flood: 500 host events per frame (scroll 70%, pan 20%, press
+  // 10%) for a guest that does some work per event. Direct delivery is what
+  // the Engine does per HOST_EVENT (setGlobal + eval). The queues flush once
+  // per frame; `queue` also coalesces scroll (latest) and pan (accumulate).
+  scenario('host-event-flood', () => {
+    var FRAMES = 40;
+    var PER_FRAME = 500;
+    var GUEST_SOURCE = `
+      var state = { y: 0, dx: 0, presses: 0, calls: 0 };
+      function __handleHostEvent(name, payload) {
+        state.calls++;
+        var work = 0;
+        for (var i = 0; i < 200; i++) work += i * payload.v;
+        if (name === 'scroll') state.y = payload.y;
+        else if (name === 'pan') state.dx += payload.dx;
+        else state.presses++;
+        return work;
+      }
+    `;
+    function makeEvent(f, i) {
+      var r = i % 10;
+      if (r < 7) return ['scroll', { y: f * PER_FRAME + i, v: 1 }];
+      if (r < 9) return ['pan', { dx: 1, v: 1 }];
+      return ['press', { id: i, v: 1 }];
+    }
+    var results = {};
+    ['direct', 'queue-all', 'queue'].forEach((mode) => {
+      var runtime = sandbox.createRuntime();
+      var ctx = runtime.createContext();
+      ctx.eval(GUEST_SOURCE);
+      if (mode === 'queue') {
+        ctx.setHostEventPolicy('scroll', 'latest');
+        ctx.setHostEventPolicy('pan', 'accumulate');
+      }
+      var frameTimes = [];
+      var start = now();
+      for (var f = 0; f < FRAMES; f++) {
+        var t0 = now();
+        for (var i = 0; i < PER_FRAME; i++) {
+          var event = makeEvent(f, i);
+          if (mode !== 'direct') {
+            ctx.queueHostEvent(event[0], event[1]);
+          } else {
+            ctx.setGlobal('__hostMessage', { type: 'HOST_EVENT', eventName: event[0], payload: event[1] });
+            ctx.eval('__handleHostEvent(__hostMessage.eventName, __hostMessage.payload)');
+          }
+        }
+        if (mode !== 'direct') ctx.flushHostEvents('__handleHostEvent');
+        frameTimes.push(now() - t0);
+      }
+      var totalMs = now() - start;
+      frameTimes.sort((a, b) => a - b);
+      var state = ctx.eval('JSON.stringify([state.y, state.dx, state.presses])');
+      var fields = {
+        events_per_s: Math.round((FRAMES * PER_FRAME) / (totalMs / 1000)),
+        frame_p50_ms: frameTimes[Math.floor(FRAMES * 0.5)],
+        frame_p95_ms: frameTimes[Math.floor(FRAMES * 0.95)],
+        guest_calls: ctx.eval('state.calls'),
+      };
+      if (mode !== 'direct') {
+        var stats = ctx.getHostEventStats();
+        fields.coalesced = stats.coalesced;
+        fields.avg_wait_ms = stats.avgWaitMs;
+        fields.max_wait_ms = stats.maxWaitMs;
+      }
+      results[mode] = state;
+      report(mode, fields);
+      ctx.dispose();
+      runtime.dispose();
+    });
+    if (results.direct !== results.queue || results.direct !== results['queue-all']) {
+      throw new Error('final guest state differs');
+    }
+  });
+
+  // Context creation and guest bundle load with the embedded bootstrap
+  // bytecode vs parsing the same source (a trailing newline defeats the
+  // source match)
+  scenario('context-bootstrap', () => {
+    var CREATES = 500;
+    var LOADS = 20;
+    var runtime = sandbox.createRuntime();
+
+    // The runtime keeps its contexts until it is disposed; hold on to them
+    // here as well so the host objects are not collected before that
+    var contexts = [];
+    var times = [];
+    for (var i = 0; i < CREATES; i++) {
+      var t0 = now();
+      var created = runtime.createContext();
+      created.dispose();
+      times.push(now() - t0);
+      contexts.push(created);
+    }
+    times.sort((a, b) => a - b);
+    report('create+dispose', {
+      p50_ms: times[Math.floor(CREATES * 0.5)],
+      p95_ms: times[Math.floor(CREATES * 0.95)],
+      embedded: sandbox.getBootstrapScripts().map((s) => s.name).join(','),
+    });
+
+    var moduleSource = __readFile('../../src/guest/build/bundle.ts');
+    if (moduleSource === undefined) {
+      console.log('  guest bundle: skipped (src/guest/build/bundle.ts not found)');
+      runtime.dispose();
+      return;
+    }
+    var exports = {};
+    new Function('exports', moduleSource.replace(/^export const (\w+)/gm, 'exports.$1'))(exports);
+    var bundle = exports.GUEST_BUNDLE_CODE;
+
+    [
+      ['bundle-bytecode', bundle],
+      ['bundle-source', `${bundle}\n`],
+    ].forEach(([label, code]) => {
+      var loadTimes = [];
+      for (var j = 0; j < LOADS; j++) {
+        var ctx = runtime.createContext();
+        var t1 = now();
+        ctx.eval(code);
+        loadTimes.push(now() - t1);
+        ctx.dispose();
+        contexts.push(ctx);
+      }
+      loadTimes.sort((a, b) => a - b);
+      report(label, {
+        p50_ms: loadTimes[Math.floor(LOADS * 0.5)],
+        min_ms: loadTimes[0],
+        source_kb: Math.round(code.length / 1024),
+      });
+    });
+    runtime.dispose();
+  });
+
+  // Guest -> host and host -> guest calls with small arguments, as reported
+  // by the always-on boundary counters
+  scenario('boundary-calls', () => {
+    var CALLS = 20000;
+    var runtime = sandbox.createRuntime();
+    var ctx = runtime.createContext();
+    var sum = 0;
+    ctx.setGlobal('__onPress', (event) => void (sum += event.x));
+    ctx.eval(`function run(n) { for (var i = 0; i < n; i++) __onPress({ x: 1, target: 'row' }); }`);
+    var guestAdd = ctx.eval('(function (a, b) { return a + b; })');
+    ctx.resetBoundaryStats();
+
+    var t0 = now();
+    ctx.eval(`run(${CALLS})`);
+    var t1 = now();
+    for (var i = 0; i < CALLS; i++) guestAdd(i, 1);
+    var t2 = now();
+    if (sum !== CALLS) throw new Error('lost calls');
+
+    var stats = ctx.getBoundaryStats();
+    report('guest->host', {
+      calls_per_s: Math.round(CALLS / ((t1 - t0) / 1000)),
+      p50_us: stats.hostCalls.p50Ms * 1000,
+      p99_us: stats.hostCalls.p99Ms * 1000,
+      values: stats.toHost.values,
+    });
+    report('host->guest', {
+      calls_per_s: Math.round(CALLS / ((t2 - t1) / 1000)),
+      p50_us: stats.guestCalls.p50Ms * 1000,
+      p99_us: stats.guestCalls.p99Ms * 1000,
+      values: stats.toGuest.values,
+    });
+    ctx.dispose();
+    runtime.dispose();
+  });
+
+  // Array-heavy payloads in both directions: children lists of a 1000-row
+  // list and style arrays (nested arrays of small objects) per row
+  scenario('array-conversion', () => {
+    var ROUNDS = 50;
+    var runtime = sandbox.createRuntime();
+    var ctx = runtime.createContext();
+    ctx.eval(`
+      var children = [];
+      for (var i = 0; i < 1000; i++) children.push(i + 1);
+      var styleRows = [];
+      for (var i = 0; i < 1000; i++) {
+        styleRows.push([{ flex: 1 }, i % 2 ? { opacity: 0.5 } : null, [{ margin: 4 }, { padding: i % 8 }], 'row']);
+      }
+      function accept(list) { return list.length; }
+    `);
+    var received = 0;
+    ctx.setGlobal('__receive', (list) => void (received += list.length));
+    var accept = ctx.eval('accept');
+    var hostChildren = ctx.eval('children');
+    var hostStyles = ctx.eval('styleRows');
+
+    var variants = [
+      ['children guest->host', () => ctx.eval('__receive(children)')],
+      ['styles guest->host', () => ctx.eval('__receive(styleRows)')],
+      ['children host->guest', () => accept(hostChildren)],
+      ['styles host->guest', () => accept(hostStyles)],
+    ];
+    variants.forEach(([label, run]) => {
+      run();
+      var t0 = now();
+      for (var r = 0; r < ROUNDS; r++) run();
+      var ms = now() - t0;
+      report(label, { ms_per_list: ms / ROUNDS, elements_per_ms: Math.round((1000 * ROUNDS) / ms) });
+    });
+    if (received !== 1000 * 2 * (ROUNDS + 1)) throw new Error('lost elements');
+    ctx.dispose();
+    runtime.dispose();
+  });
+
+  // Property reads on the sandbox HostObjects the way the engine glue does
+  // them: a method looked up per call, plus value properties
+  scenario('hostobject-access', () => {
+    var READS = 100000;
+    var runtime = sandbox.createRuntime();
+    var ctx = runtime.createContext();
+    var store = sandbox.createTreeStore();
+    var variants = [
+      ['context method lookup', () => ctx.getGlobal],
+      ['context value', () => ctx.isDisposed],
+      ['tree store value', () => store.size],
+      ['unknown property', () => ctx.then],
+    ];
+    variants.forEach(([label, read]) => {
+      var t0 = now();
+      for (var i = 0; i < READS; i++) read();
+      var ms = now() - t0;
+      report(label, { ns_per_read: (ms * 1e6) / READS });
+    });
+    var t0 = now();
+    for (var i = 0; i < READS / 10; i++) store.has(i);
+    report('tree store call', { ns_per_call: (now() - t0) * 1e6 / (READS / 10) });
+    ctx.dispose();
+    runtime.dispose();
+  });
+
+  // A ~4 MB minified bundle evaluated from a host string, an ArrayBuffer
+  // (parsed in place) and a mapped file: load latency and the peak RSS
+  // growth while it loads
+  scenario('bundle-load', () => {
+    var MODULES = 10000;
+    var ROUNDS = 3;
+    var PATH = '/tmp/quickjs_sandbox_bundle_load.js';
+    var parts = ['var M=[];'];
+    for (var i = 0; i < MODULES; i++) {
+      parts.push(`M.push(function(){var s={container:{flex:1,padding:${i},backgroundColor:"#fafafa"},` +
+        `title:{fontSize:${12 + (i % 8)},fontWeight:"600"}},labels=["one","two","three"];` +
+        `function C${i}(p){var v=p.value==null?0:p.value;return [s.container,s.title,\`Item ${i} \${labels[v%3]}\`]}` +
+        `C${i}.displayName="C${i}";return C${i}}());`);
+    }
+    parts.push('M.length\n');
+    var code = parts.join('');
+    if (!__writeFile(PATH, code)) {
+      report('skipped', { reason: 'cannot write ' + PATH });
+      return;
+    }
+    var buffer = __readFileBuffer(PATH);
+
+    var variants = [
+      ['eval(string)', (ctx) => ctx.eval(code, 'bundle.js')],
+      ['evalBuffer', (ctx) => ctx.evalBuffer(buffer, 'bundle.js')],
+      ['evalFile', (ctx) => ctx.evalFile(PATH, 'bundle.js')],
+    ];
+    variants.forEach(([label, load]) => {
+      var times = [];
+      var peak = 0;
+      for (var r = 0; r < ROUNDS; r++) {
+        var runtime = sandbox.createRuntime();
+        var ctx = runtime.createContext();
+        var before = __peakMemoryKB(true);
+        var t0 = now();
+        var modules = load(ctx);
+        times.push(now() - t0);
+        var after = __peakMemoryKB();
+        if (after !== undefined) peak = Math.max(peak, after - before);
+        if (modules !== MODULES) throw new Error(`${label} loaded ${modules} modules`);
+        ctx.dispose();
+        runtime.dispose();
+      }
+      times.sort((a, b) => a - b);
+      report(label, {
+        bundle_kb: Math.round(code.length / 1024),
+        load_ms: times[times.length >> 1],
+        peak_rss_growth_kb: __peakMemoryKB() === undefined ? 'n/a' : peak,
+      });
+    });
+  });
+
+  // Heap cost of each additional context, with all built-ins created up front
+  // vs Date, Map/Set and typed arrays created on first use. 'used' contexts
+  // then touch Map and Date, as most guests do.
+  scenario('context-memory', () => {
+    var CONTEXTS = 64;
+    [false, true].forEach((lazyIntrinsics) => {
+      ['idle', 'used'].forEach((kind) => {
+        var runtime = sandbox.createRuntime({ lazyIntrinsics: lazyIntrinsics });
+        var contexts = [runtime.createContext()];
+        var before = runtime.getHeapInfo().malloc_size;
+        var t0 = now();
+        for (var i = 0; i < CONTEXTS; i++) {
+          var ctx = runtime.createContext();
+          if (kind === 'used') ctx.eval('new Map().set(Date.now(), 1).size');
+          contexts.push(ctx);
+        }
+        var ms = now() - t0;
+        var bytes = runtime.getHeapInfo().malloc_size - before;
+        report(`${lazyIntrinsics ? 'lazy' : 'eager'}-${kind}`, {
+          kb_per_context: Math.round(bytes / CONTEXTS / 102.4) / 10,
+          create_us: Math.round((ms * 1000) / CONTEXTS),
+        });
+        contexts.forEach((c) => c.dispose());
+        runtime.dispose();
+      });
+    });
+  });
+
+  // Guest instrumentation: a mark/measure pair per iteration reported
+  // through a host callback each time vs recorded natively and drained
+  // once per frame
+  scenario('user-timing', () => {
+    var FRAMES = 20;
+    var PER_FRAME = 1000;
+    var MARKS = FRAMES * PER_FRAME * 2;
+    var runtime = sandbox.createRuntime();
+    var ctx = runtime.createContext();
+    var received = 0;
+    ctx.setGlobal('__hostMark', (name, time) => {
+      received++;
+    });
+    ctx.eval(`
+      function work(i) { var s = 0; for (var k = 0; k < 20; k++) s += k * i; return s; }
+      function viaHost(n) {
+        for (var i = 0; i < n; i++) {
+          __hostMark('work-start', performance.now());
+          work(i);
+          __hostMark('work-end', performance.now());
+        }
+      }
+      function viaTrace(n) {
+        for (var i = 0; i < n; i++) {
+          performance.mark('work-start');
+          work(i);
+          performance.measure('work', 'work-start');
+        }
+      }
+      function bare(n) { for (var i = 0; i < n; i++) work(i); }
+    `);
+    var frames = (code) => {
+      var t0 = now();
+      for (var f = 0; f < FRAMES; f++) ctx.eval(code);
+      return now() - t0;
+    };
+
+    var bareMs = frames(`bare(${PER_FRAME})`);
+    var hostMs = frames(`viaHost(${PER_FRAME})`);
+    if (received !== MARKS) throw new Error(`received ${received} marks`);
+
+    var traceMs = 0;
+    var drainMs = 0;
+    var drained = 0;
+    for (var f = 0; f < FRAMES; f++) {
+      var t0 = now();
+      ctx.eval(`viaTrace(${PER_FRAME})`);
+      var t1 = now();
+      drained += ctx.drainTrace().name.length;
+      traceMs += t1 - t0;
+      drainMs += now() - t1;
+    }
+    var stats = ctx.getTraceStats();
+    if (drained !== MARKS || stats.dropped !== 0) throw new Error(`drained ${drained} marks`);
+
+    var overheadNs = (ms) => Math.round(((ms - bareMs) * 1e6) / MARKS);
+    report('host-callback', {
+      ms: hostMs,
+      ns_per_mark: overheadNs(hostMs),
+    });
+    report('trace-buffer', {
+      ms: traceMs,
+      ns_per_mark: overheadNs(traceMs),
+      drain_ms: drainMs,
+      drain_ns_per_entry: Math.round((drainMs * 1e6) / drained),
+    });
+    ctx.dispose();
+    runtime.dispose();
+  });
+
+  scenario('op-arena', () => {
+    // A large mount: every node is a CREATE plus an APPEND, one commit per
+    // frame
+    var NODES = 10000;
+    var FRAMES = 10;
+    var runtime = sandbox.createRuntime();
+    var ctx = runtime.createContext();
+    var received = 0;
+    ctx.setOperationSink('__sendToHost', (batch) => {
+      received += batch.operations.length;
+    });
+    ctx.eval(`
+      // OperationCollector's JS path
+      var jsOps = [];
+      function jsAdd(op) { jsOps.push(Object.assign({}, op, { timestamp: Date.now() })); }
+      function jsFlush(batchId) {
+        var counts = {};
+        jsOps.forEach(function (op) { counts[op.op] = (counts[op.op] || 0) + 1; });
+        globalThis.__OP_COUNTS = counts;
+        var batch = { version: 1, batchId: batchId, operations: jsOps.slice() };
+        jsOps = [];
+        __sendToHost(batch);
+      }
+      function props(i) {
+        return { style: { flex: 1, padding: i % 8 }, testID: 'node-' + i };
+      }
+      function mountJs(n) {
+        for (var i = 1; i <= n; i++) {
+          jsAdd({ op: 'CREATE', id: i, type: 'View', props: props(i) });
+          jsAdd({ op: 'APPEND', id: i, parentId: i >> 1, childId: i });
+        }
+      }
+      function mountNative(n) {
+        for (var i = 1; i <= n; i++) {
+          __rill_op_create(i, 'View', props(i));
+          __rill_op_append(i >> 1, i);
+        }
+      }
+    `);
+
+    var convertedMs = 0;
+    var run = (record, commit) => {
+      var recordMs = 0;
+      var commitMs = 0;
+      for (var f = 0; f < FRAMES; f++) {
+        var t0 = now();
+        ctx.eval(record);
+        var t1 = now();
+        ctx.eval(commit.replace('$id', f + 1));
+        recordMs += t1 - t0;
+        commitMs += now() - t1;
+      }
+      if (received !== NODES * 2 * FRAMES) throw new Error(`received ${received} ops`);
+      received = 0;
+      var stats = ctx.getCoalescingStats();
+      var conversionMs = stats.conversionMs - convertedMs;
+      convertedMs = stats.conversionMs;
+      return { recordMs, commitMs, conversionMs };
+    };
+    var js = run(`mountJs(${NODES})`, 'jsFlush($id)');
+    var native = run(`mountNative(${NODES})`, '__rill_op_commit(__sendToHost, 1, $id)');
+
+    var perOp = (ms) => Math.round((ms * 1e6) / (NODES * 2 * FRAMES));
+    report('js-collector', {
+      record_ms: js.recordMs / FRAMES,
+      commit_ms: js.commitMs / FRAMES,
+      conversion_ms: js.conversionMs / FRAMES,
+      ns_per_op: perOp(js.recordMs + js.commitMs),
+    });
+    report('native-arena', {
+      record_ms: native.recordMs / FRAMES,
+      commit_ms: native.commitMs / FRAMES,
+      conversion_ms: native.conversionMs / FRAMES,
+      ns_per_op: perOp(native.recordMs + native.commitMs),
+    });
+    ctx.dispose();
+    runtime.dispose();
+  });
+})();
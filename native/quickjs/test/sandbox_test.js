@@ -438,6 +438,822 @@
   assert(ctx.eval('-0') === 0, 'Negative zero'); // Note: -0 === 0 in JS
   assert(ctx.eval("''") === '', 'Empty string literal');
 
+  // 30. RegExp cache shared across contexts
+  console.log('\n30. RegExp Cache');
+  var reRuntime = sandbox.createRuntime();
+  var reCtx1 = reRuntime.createContext();
+  var reCtx2 = reRuntime.createContext();
+  var reInfo = reRuntime.getHeapInfo();
+  var reHits = reInfo.regexp_cache_hits;
+  reCtx1.eval("var emailRe = /^[^@\\s]+@[^@\\s]+$/; var zipRe = new RegExp('^\\\\d{5}$');");
+  reCtx2.eval("var emailRe = /^[^@\\s]+@[^@\\s]+$/; var zipRe = new RegExp('^\\\\d{5}$');");
+  reInfo = reRuntime.getHeapInfo();
+  assert(reInfo.regexp_cache_hits - reHits >= 2, 'Second context reuses compiled RegExps');
+  assert(reCtx2.eval("emailRe.test('a@b.c') && !emailRe.test('a b@c')") === true, 'Cached literal RegExp matches');
+  assert(reCtx2.eval("zipRe.test('12345') && !zipRe.test('1234a')") === true, 'Cached constructed RegExp matches');
+  assert(reCtx1.eval("new RegExp('abc', 'i').test('ABC') && !new RegExp('abc').test('ABC')") === true, 'Flags are part of the cache key');
+  assertThrows(() => {
+    reCtx2.eval("new RegExp('(')");
+  }, 'Invalid pattern still throws');
+  reRuntime.dispose();
+
+  var noCacheRuntime = sandbox.createRuntime({ regexpCacheSize: 0 });
+  var noCacheCtx = noCacheRuntime.createContext();
+  noCacheCtx.eval("var r1 = /x+/; var r2 = /x+/;");
+  assert(noCacheRuntime.getHeapInfo().regexp_cache_count === 0, 'regexpCacheSize: 0 disables the cache');
+  noCacheRuntime.dispose();
+
+  // 31. String transcoding (vectorized UTF-8 / UTF-16 paths)
+  console.log('\n31. String Transcoding');
+  var longAscii = 'The quick brown fox jumps over the lazy dog. '.repeat(50);
+  var longMixed = ('plain ascii run of text '.repeat(3) + 'café naïve — 東京 😀 ').repeat(20);
+  ctx.setGlobal('longAscii', longAscii);
+  ctx.setGlobal('longMixed', longMixed);
+  assert(ctx.getGlobal('longAscii') === longAscii, 'Long ASCII string round-trips');
+  assert(ctx.getGlobal('longMixed') === longMixed, 'Long mixed UTF-8 string round-trips');
+  assert(ctx.eval('longMixed.length') === longMixed.length, 'UTF-16 length preserved');
+  assert(ctx.eval("longMixed.indexOf('😀')") === longMixed.indexOf('😀'), 'Surrogate pairs decoded');
+  assert(ctx.eval("'\\u00e9\\u00e8' + 'x'.repeat(40)") === 'éè' + 'x'.repeat(40), 'Latin-1 string returned');
+  var longKey = 'a_rather_long_property_name_for_hashing_';
+  var wideKey = longKey + '東京';
+  var keyed = {};
+  keyed[longKey] = 1;
+  keyed[wideKey] = 2;
+  ctx.setGlobal('keyed', keyed);
+  assert(ctx.eval(`keyed['a_rather_long_' + 'property_name_for_hashing_']`) === 1, 'Long property key lookup');
+  assert(ctx.eval(`keyed['${longKey}' + '\\u6771\\u4eac']`) === 2, 'Long wide property key lookup');
+  assert(ctx.eval(`new Map([['${longKey}'.repeat(2), 7]]).get('${longKey}${longKey}')`) === 7, 'Long Map string key lookup');
+
+  // 32. JSON fast paths (vectorized string scanning, plain data stringify)
+  console.log('\n32. JSON Fast Paths');
+  assert(ctx.eval(`JSON.parse('{"a":"x\\\\n\\\\u00e9\\\\ud83d\\\\ude00","b":[1,-0.5,2e3,12345678901234567890]}').a`) === 'x\né😀', 'JSON.parse decodes escapes');
+  assert(ctx.eval(`JSON.stringify(JSON.parse('[1,-0.5,2e3,0.1,123456789.125,12345678901234567890]'))`) === '[1,-0.5,2000,0.1,123456789.125,12345678901234567000]', 'JSON.parse numbers');
+  assertThrows(() => {
+    ctx.eval(`JSON.parse('{"a":"unterminated}')`);
+  }, 'JSON.parse rejects an unterminated string');
+  assertThrows(() => {
+    ctx.eval(`JSON.parse('[01]')`);
+  }, 'JSON.parse rejects leading zeros');
+  assert(ctx.eval(`JSON.stringify({ s: 'q"\\\\\\n\\u0001', u: 'é東京😀\\ud83d', n: [1, 1.5, NaN], f: function () {}, x: undefined })`) === '{"s":"q\\"\\\\\\n\\u0001","u":"é東京😀\\ud83d","n":[1,1.5,null]}', 'JSON.stringify plain data');
+  assert(ctx.eval(`JSON.stringify({ 2: 'b', a: 1, 1: 'a' })`) === '{"1":"a","2":"b","a":1}', 'JSON.stringify integer keys first');
+  assert(ctx.eval(`JSON.stringify([new Date(0), { toJSON: function () { return 't'; } }])`) === '["1970-01-01T00:00:00.000Z","t"]', 'JSON.stringify honors toJSON');
+  assert(ctx.eval(`var sparse = [1]; sparse.length = 3; JSON.stringify(sparse)`) === '[1,null,null]', 'JSON.stringify array length');
+  assertThrows(() => {
+    ctx.eval(`var cyc = { a: [] }; cyc.a.push(cyc); JSON.stringify(cyc)`);
+  }, 'JSON.stringify detects cycles');
+  assert(ctx.eval(`var big = []; for (var i = 0; i < 500; i++) big.push({ id: i, name: 'n' + i, r: i / 7 }); JSON.stringify(JSON.parse(JSON.stringify(big))) === JSON.stringify(big)`) === true, 'JSON round trip');
+
+  // 33. Serialized size estimation
+  console.log('\n33. Size Estimation');
+  function utf8Length(str) {
+    return unescape(encodeURIComponent(str)).length;
+  }
+  var sizedPayload = {
+    type: 'update',
+    ids: [1, 22, -333, null, true, false],
+    node: { text: 'héllo 東京', props: { on: undefined, fn: function () {} } },
+    list: [function () {}, undefined, 'x'],
+  };
+  var sizedJSON = JSON.stringify(sizedPayload);
+  var moduleEstimate = sandbox.estimateSize(sizedPayload);
+  assert(moduleEstimate.bytes === utf8Length(sizedJSON), 'Module estimate matches JSON byte length');
+  assert(moduleEstimate.objects === 5, 'Module estimate counts objects and arrays');
+  assert(moduleEstimate.strings === 3, 'Module estimate counts string values');
+  assert(sandbox.estimateSize('abc').bytes === 5 && sandbox.estimateSize(1234).bytes === 4, 'Primitive estimates');
+  var wideEstimate = sandbox.estimateSize({ 'caf\u00e9': '\u00e9\u20ac\ud83d\ude00' });
+  // {"café":"é€😀"}: braces, 8 bytes of key and 11 of value
+  assert(wideEstimate.bytes === 2 + 8 + 11, 'Non-ASCII strings measured as UTF-8', wideEstimate.bytes);
+  assertThrows(() => {
+    var cyclic = { a: [] };
+    cyclic.a.push(cyclic);
+    sandbox.estimateSize(cyclic);
+  }, 'Cyclic value throws');
+
+  var seenEstimates = [];
+  ctx.setGlobal('__reportSize', (name, payload) => {
+    seenEstimates.push({ name: name, estimate: ctx.estimateSize(payload), walked: sandbox.estimateSize(payload) });
+  });
+  ctx.eval(`__reportSize('guest', {
+    type: 'update',
+    ids: [1, 22, -333, null, true, false],
+    node: { text: 'héllo 東京', props: { on: undefined, fn: function () {} } },
+    list: [function () {}, undefined, 'x'],
+  })`);
+  assert(seenEstimates.length === 1, 'Host callback received payload');
+  assert(seenEstimates[0].estimate.bytes === utf8Length(sizedJSON), 'Conversion-time estimate matches JSON byte length');
+  assert(
+    seenEstimates[0].estimate.objects === seenEstimates[0].walked.objects &&
+      seenEstimates[0].estimate.strings === seenEstimates[0].walked.strings,
+    'Conversion-time estimate matches walked estimate'
+  );
+  assert(ctx.estimateSize({ a: [1, 2] }).bytes === 11, 'Context estimate outside a host call');
+
+  // Looking up a string argument compares it with strictEquals repeatedly
+  var stringEstimates = [];
+  ctx.setGlobal('__reportString', (text) => {
+    for (var i = 0; i < 100; i++) stringEstimates.push(ctx.estimateSize(text).bytes);
+  });
+  ctx.eval("__reportString('x'.repeat(40) + 'é')");
+  ctx.eval('__reportString(String(42))');
+  assert(stringEstimates.length === 200, 'Host callback received string arguments');
+  assert(stringEstimates[0] === 44 && stringEstimates[99] === 44, 'String argument estimate is stable');
+  assert(stringEstimates[199] === 4, 'Short string argument estimate is stable');
+
+  // 34. Native operation coalescing (setOperationSink)
+  console.log('\n34. Operation Coalescing');
+  var sunk = [];
+  ctx.setOperationSink('__sinkOps', (batch) => {
+    sunk.push(batch);
+  });
+  function sinkOps(ops) {
+    sunk = [];
+    ctx.eval(`__sinkOps({ version: 1, batchId: 7, operations: ${JSON.stringify(ops)} })`);
+    return sunk[0];
+  }
+  function opNames(batch) {
+    return batch.operations.map((o) => o.op + ':' + (o.id ?? o.childId ?? o.parentId)).join(',');
+  }
+  var merged = sinkOps([
+    { op: 'CREATE', id: 1, type: 'View', props: {} },
+    { op: 'UPDATE', id: 2, props: { a: 1, b: 1 }, timestamp: 5 },
+    { op: 'UPDATE', id: 3, props: { x: 1 } },
+    { op: 'UPDATE', id: 2, props: { c: 2 }, removedProps: ['b', 'z'] },
+    { op: 'UPDATE', id: 2, props: { a: 3, z: 4 } },
+  ]);
+  assert(merged.version === 1 && merged.batchId === 7, 'Batch fields preserved');
+  assert(opNames(merged) === 'CREATE:1,UPDATE:2,UPDATE:3', 'UPDATEs of a node merge in place');
+  assert(JSON.stringify(merged.operations[1].props) === '{"a":3,"c":2,"z":4}', 'Merged props (later wins)');
+  assert(JSON.stringify(merged.operations[1].removedProps) === '["b"]', 'Merged removedProps exclude re-set keys');
+  assert(merged.operations[1].timestamp === 5, 'Merged UPDATE keeps first op fields');
+  assert(
+    opNames(sinkOps([
+      { op: 'UPDATE', id: 2, props: { a: 1 } },
+      { op: 'TEXT', id: 2, text: 'x' },
+      { op: 'UPDATE', id: 2, props: { a: 2 } },
+    ])) === 'UPDATE:2,TEXT:2,UPDATE:2',
+    'TEXT separates UPDATEs'
+  );
+  assert(
+    opNames(sinkOps([
+      { op: 'CREATE', id: 9, type: 'Text', props: {} },
+      { op: 'UPDATE', id: 9, props: { a: 1 } },
+      { op: 'UPDATE', id: 4, props: { a: 1 } },
+      { op: 'DELETE', id: 9 },
+    ])) === 'UPDATE:4',
+    'Unattached CREATE/DELETE pair dropped'
+  );
+  assert(
+    opNames(sinkOps([
+      { op: 'CREATE', id: 9, type: 'Text', props: {} },
+      { op: 'APPEND', parentId: 1, childId: 9 },
+      { op: 'DELETE', id: 9 },
+    ])) === 'CREATE:9,APPEND:9,DELETE:9',
+    'Attached CREATE/DELETE pair kept'
+  );
+  assert(
+    opNames(sinkOps([
+      { op: 'REORDER', parentId: 1, childIds: [2, 3] },
+      { op: 'UPDATE', id: 2, props: {} },
+      { op: 'REORDER', parentId: 1, childIds: [3, 2] },
+    ])) === 'UPDATE:2,REORDER:1',
+    'Only the last REORDER survives'
+  );
+  assert(
+    opNames(sinkOps([
+      { op: 'REORDER', parentId: 1, childIds: [2, 3] },
+      { op: 'APPEND', parentId: 1, childId: 4 },
+      { op: 'REORDER', parentId: 1, childIds: [4, 3, 2] },
+    ])) === 'REORDER:1,APPEND:4,REORDER:1',
+    'APPEND separates REORDERs'
+  );
+  var inserts = sinkOps([
+    { op: 'INSERT', parentId: 1, childId: 5, index: 0 },
+    { op: 'INSERT', parentId: 1, childId: 5, index: 2 },
+    { op: 'INSERT', parentId: 1, childId: 6, index: 0 },
+    { op: 'INSERT', parentId: 1, childId: 5, index: 1 },
+  ]);
+  assert(
+    inserts.operations.map((o) => o.childId + '@' + o.index).join(',') === '5@2,6@0,5@1',
+    'Repeated INSERT dropped only without intervening siblings'
+  );
+  var single = sinkOps([{ op: 'UPDATE', id: 1, props: { a: 1 } }]);
+  assert(single.operations.length === 1 && single.operations[0].props.a === 1, 'Single-op batch passes through');
+  var coalescing = ctx.getCoalescingStats();
+  assert(coalescing.batches === 8 && coalescing.opsIn === 26 && coalescing.opsOut === 19, 'Coalescing stats count ops');
+
+  // 35. Native node tree store
+  console.log('\n35. Node Tree Store');
+  var store = sandbox.createTreeStore();
+  function sorted(ids) {
+    return ids.slice().sort((a, b) => a - b).join(',');
+  }
+  var mount = store.applyBatch([
+    { op: 'CREATE', id: 1, type: 'View', props: {} },
+    { op: 'CREATE', id: 2, type: 'Text', props: {} },
+    { op: 'CREATE', id: 3, type: 'Text', props: {} },
+    { op: 'CREATE', id: 4, type: 'Text', props: {} },
+    { op: 'APPEND', id: 2, parentId: 1, childId: 2 },
+    { op: 'APPEND', id: 3, parentId: 1, childId: 3 },
+    { op: 'APPEND', id: 3, parentId: 1, childId: 3 },
+    { op: 'INSERT', id: 4, parentId: 1, childId: 4, index: 1 },
+    { op: 'APPEND', id: 1, parentId: 0, childId: 1 },
+    { op: 'REF_CALL', refId: 1, method: 'focus', args: [], callId: 'c1' },
+  ]);
+  assert(store.size === 4 && store.has(4) && !store.has(0), 'CREATE adds nodes');
+  assert(store.getChildren(1).join(',') === '2,4,3', 'APPEND/INSERT order (duplicate APPEND ignored)');
+  assert(store.getChildren(0).join(',') === '1' && store.getParent(1) === 0, 'Root children');
+  assert(mount.applied === 5 && mount.ignored === 0, 'Only structure ops are counted');
+  assert(sorted(mount.dirty) === '0,1,2,3,4' && sorted(mount.childrenChanged) === '0,1', 'Mount dirty ids');
+
+  var moved = store.applyBatch([
+    { op: 'INSERT', id: 3, parentId: 1, childId: 3, index: 0 },
+    { op: 'INSERT', id: 2, parentId: 1, childId: 2, index: 99 },
+    { op: 'UPDATE', id: 4, props: { a: 1 } },
+  ]);
+  assert(store.getChildren(1).join(',') === '3,4,2', 'INSERT moves an existing child');
+  assert(sorted(moved.dirty) === '1,4' && moved.childrenChanged.join(',') === '1', 'Only touched nodes are dirty');
+
+  store.applyBatch([{ op: 'REORDER', id: 1, parentId: 1, childIds: [2, 99, 3, 2] }]);
+  assert(store.getChildren(1).join(',') === '2,3', 'REORDER skips unknown and duplicate ids');
+  assert(store.getParent(4) === undefined, 'REORDER detaches omitted children');
+  assert(store.applyBatch([{ op: 'APPEND', id: 1, parentId: 2, childId: 1 }]).ignored === 1, 'Cycles are rejected');
+
+  store.applyBatch([
+    { op: 'CREATE', id: 5, type: 'Text', props: {} },
+    { op: 'APPEND', id: 5, parentId: 2, childId: 5 },
+    { op: 'APPEND', id: 2, parentId: 4, childId: 2 },
+  ]);
+  assert(store.getChildren(1).join(',') === '3' && store.getParent(2) === 4, 'A node has a single parent');
+  var removed = store.applyBatch([
+    { op: 'REMOVE', id: 3, parentId: 1, childId: 3 },
+    { op: 'DELETE', id: 4 },
+    { op: 'TEXT', id: 5, text: 'gone' },
+  ]);
+  assert(sorted(removed.deleted) === '2,4,5' && store.size === 2, 'DELETE removes the subtree');
+  assert(removed.applied === 2 && removed.ignored === 0 && removed.dirty.join(',') === '1', 'Deleted nodes are not dirty');
+  assert(store.getChildren(1).length === 0 && store.getParent(3) === undefined, 'REMOVE detaches');
+
+  var bulk = [];
+  for (var n = 10; n < 1010; n++) {
+    bulk.push({ op: 'CREATE', id: n, type: 'View', props: {} }, { op: 'APPEND', id: n, parentId: 0, childId: n });
+  }
+  store.applyBatch(bulk, 1000);
+  assert(store.size === 502 && store.getChildren(0).length === 501, 'applyBatch honours count');
+  bulk = [];
+  for (n = 10; n < 1010; n++) bulk.push({ op: 'DELETE', id: n });
+  assert(store.applyBatch(bulk).deleted.length === 500 && store.size === 2, 'Index survives mass deletes');
+  var recreate = store.applyBatch([
+    { op: 'CREATE', id: 20, type: 'View', props: {} },
+    { op: 'CREATE', id: 21, type: 'Text', props: {} },
+    { op: 'APPEND', id: 21, parentId: 20, childId: 21 },
+    { op: 'APPEND', id: 20, parentId: 1, childId: 20 },
+  ]);
+  recreate = store.applyBatch([{ op: 'CREATE', id: 20, type: 'View', props: {} }]);
+  assert(store.has(20) && !store.has(21) && store.getParent(20) === undefined, 'Re-created node starts detached and empty');
+  assert(store.getChildren(1).indexOf(20) < 0 && recreate.childrenChanged.join(',') === '1', 'Re-created node leaves its old parent');
+  assert(recreate.deleted.join(',') === '21' && recreate.dirty.indexOf(20) >= 0, 'Old subtree is reported deleted');
+  store.clear();
+  assert(store.size === 0 && store.getChildren(0).length === 0, 'clear() empties the store');
+
+  // 36. Conversion memo for frozen guest objects
+  console.log('\n36. Conversion Memo');
+  var memoCtx = runtime.createContext();
+  var received = [];
+  memoCtx.setGlobal('__take', (value) => {
+    received.push({ value: value, bytes: memoCtx.estimateSize(value).bytes });
+  });
+  function take(expr) {
+    received = [];
+    memoCtx.eval(`__take(${expr}); __take(${expr});`);
+    return received;
+  }
+  memoCtx.eval(`
+    function deepFreeze(o) { Object.values(o).forEach((v) => typeof v === 'object' && v && deepFreeze(v)); return Object.freeze(o); }
+    var styles = deepFreeze({ row: { flex: 1, padding: 8, transform: [{ scale: 2 }] }, label: { color: 'red' } });
+    var shallow = Object.freeze({ inner: { a: 1 } });
+    var withFn = Object.freeze({ onPress: function () {} });
+    var plain = { a: 1 };
+  `);
+  var memoBefore = memoCtx.getConversionStats();
+  var styleHits = take('styles.row');
+  assert(styleHits[0].value === styleHits[1].value, 'Deep-frozen object reused across calls');
+  assert(!Object.isFrozen(styleHits[0].value), 'Memoized host object is shared, not frozen');
+  assert(memoCtx.eval('__rill_conversion_memo') === true, 'The guest can tell the memo is on');
+  assert(styleHits[0].value.transform[0].scale === 2, 'Memoized value converted correctly');
+  assert(styleHits[1].bytes === JSON.stringify(styleHits[1].value).length, 'Estimate on a memo hit');
+  var props = take('({ style: styles.label, title: "x" })');
+  assert(props[0].value !== props[1].value && props[0].value.style === props[1].value.style, 'Frozen child of a fresh object reused');
+  assert(take('shallow')[0].value !== take('shallow')[0].value, 'Shallow-frozen object with mutable contents not memoized');
+  assert(take('withFn')[0].value !== take('withFn')[0].value, 'Frozen object with functions not memoized');
+  var plainValues = take('plain');
+  assert(plainValues[0].value !== plainValues[1].value && !Object.isFrozen(plainValues[0].value), 'Mutable object not memoized');
+  var memoAfter = memoCtx.getConversionStats();
+  assert(memoAfter.hits - memoBefore.hits === 2, 'Memo hits counted', JSON.stringify(memoAfter));
+  assert(memoAfter.entries === 4 && memoAfter.capacity === 1024, 'Memo entries counted', JSON.stringify(memoAfter));
+  memoCtx.dispose();
+
+  var smallMemoRuntime = sandbox.createRuntime({ conversionMemoSize: 2 });
+  var smallCtx = smallMemoRuntime.createContext();
+  smallCtx.setGlobal('__take', () => {});
+  smallCtx.eval(`for (var i = 0; i < 5; i++) __take(Object.freeze({ i: i }));`);
+  var smallStats = smallCtx.getConversionStats();
+  assert(smallStats.entries === 2 && smallStats.evictions === 3, 'Memo capacity bounds entries');
+  smallCtx.dispose();
+  smallMemoRuntime.dispose();
+  var noMemoRuntime = sandbox.createRuntime({ conversionMemoSize: 0 });
+  var noMemoCtx = noMemoRuntime.createContext();
+  var noMemo = [];
+  noMemoCtx.setGlobal('__take', (v) => noMemo.push(v));
+  noMemoCtx.eval(`var f = Object.freeze({ a: 1 }); __take(f); __take(f);`);
+  assert(noMemo[0] !== noMemo[1] && noMemoCtx.getConversionStats().hits === 0, 'conversionMemoSize: 0 disables the memo');
+  assert(noMemoCtx.eval('__rill_conversion_memo') === false, 'The guest can tell the memo is off');
+  noMemoCtx.dispose();
+  noMemoRuntime.dispose();
+
+  // 37. Guest -> host message ring
+  console.log('\n37. Message Ring');
+  var ringCtx = runtime.createContext();
+  assert(ringCtx.drainMessages().length === 0, 'drainMessages() before open is empty');
+  ringCtx.openMessageRing('__post', 1024);
+  assertThrows(() => ringCtx.openMessageRing('__post2'), 'Ring can only be opened once');
+  assert(ringCtx.eval(`__post({ type: 'a', n: 1 })`) === true, 'Guest post returns true');
+  ringCtx.eval(`__post('text'); __post([1, 2]); __post(null)`);
+  var drained = ringCtx.drainMessages();
+  assert(JSON.stringify(drained) === '[{"type":"a","n":1},"text",[1,2],null]', 'Messages drained in order', JSON.stringify(drained));
+  assert(ringCtx.drainMessages().length === 0, 'Drain releases messages');
+  assertThrows(() => ringCtx.eval(`__post(undefined)`), 'Non-serializable message throws');
+  ringCtx.eval(`__post(1); __post(2); __post(3)`);
+  assert(JSON.stringify(ringCtx.drainMessages(2)) === '[1,2]' && JSON.stringify(ringCtx.drainMessages()) === '[3]', 'drainMessages(max) limits the batch');
+  // 1 KiB ring: fill it, check backpressure, then wrap around repeatedly
+  var accepted = ringCtx.eval(`var ok = 0; while (__post('x'.repeat(40))) ok++; ok`);
+  assert(accepted > 10 && accepted < 25, 'Full ring rejects posts', String(accepted));
+  assert(ringCtx.drainMessages().length === accepted, 'All accepted messages drained after overflow');
+  var wrapOk = true;
+  for (var round = 0; round < 50; round++) {
+    ringCtx.eval(`for (var i = 0; i < 7; i++) __post({ round: ${round}, i: i, pad: 'y'.repeat(${round} % 30) })`);
+    var batch = ringCtx.drainMessages();
+    if (batch.length !== 7 || batch[6].round !== round || batch[6].i !== 6) wrapOk = false;
+  }
+  assert(wrapOk, 'Records survive wrap-around');
+  assert(ringCtx.eval(`__post('z'.repeat(2000))`) === false, 'Oversized message rejected');
+  var ringStats = ringCtx.getMessageRingStats();
+  assert(ringStats.capacity === 1024 && ringStats.usedBytes === 0, 'Ring stats capacity/usage', JSON.stringify(ringStats));
+  assert(ringStats.written === ringStats.drained && ringStats.rejected === 2, 'Ring stats counters', JSON.stringify(ringStats));
+  assert(ringStats.highWaterBytes > 900 && ringStats.highWaterBytes <= 1024, 'Ring high-water mark', JSON.stringify(ringStats));
+  ringCtx.dispose();
+
+  // 38. Coalescing host event queue
+  console.log('\n38. Host Event Queue');
+  var evCtx = runtime.createContext();
+  evCtx.eval(`var seen = []; function onEvent(name, payload) { seen.push([name, payload]); }`);
+  evCtx.setHostEventPolicy('scroll', 'latest');
+  evCtx.setHostEventPolicy('pan', 'accumulate');
+  assertThrows(() => evCtx.setHostEventPolicy('x', 'sometimes'), 'Unknown policy rejected');
+  evCtx.queueHostEvent('scroll', { y: 1 });
+  evCtx.queueHostEvent('press', { id: 1 });
+  evCtx.queueHostEvent('pan', { dx: 1, dy: 2, phase: 'start' });
+  evCtx.queueHostEvent('scroll', { y: 2 });
+  evCtx.queueHostEvent('pan', { dx: 3, dy: -1, phase: 'move' });
+  evCtx.queueHostEvent('press', { id: 2 });
+  var pending = evCtx.queueHostEvent('scroll', { y: 3 });
+  assert(pending === 4, 'Coalesced events counted once while pending', String(pending));
+  assert(evCtx.flushHostEvents('onEvent') === 4, 'flushHostEvents returns delivered count');
+  var seenEvents = evCtx.eval('JSON.stringify(seen)');
+  assert(
+    seenEvents === '[["press",{"id":1}],["pan",{"dx":4,"dy":1,"phase":"move"}],["press",{"id":2}],["scroll",{"y":3}]]',
+    'Latest-wins, accumulated deltas and keep-all in queue order',
+    seenEvents
+  );
+  assert(evCtx.flushHostEvents('onEvent') === 0, 'Flush with nothing pending');
+  for (var e = 0; e < 5; e++) evCtx.queueHostEvent('tick', e);
+  evCtx.eval('seen = []');
+  assert(evCtx.flushHostEvents('onEvent', 2) === 2 && evCtx.flushHostEvents('onEvent') === 3, 'maxEvents leaves the rest queued');
+  assert(evCtx.eval('seen.map(function (s) { return s[1]; }).join()') === '0,1,2,3,4', 'Keep-all preserves every event');
+  evCtx.queueHostEvent('scroll', { y: 9 });
+  assertThrows(() => evCtx.flushHostEvents('missingHandler'), 'Missing handler throws');
+  evCtx.eval(`function failing(name, payload) { seen.push(payload); if (payload === 1) throw new Error('boom'); }`);
+  evCtx.eval('seen = []');
+  evCtx.queueHostEvent('tick', 1);
+  evCtx.queueHostEvent('tick', 2);
+  assertThrows(() => evCtx.flushHostEvents('failing'), 'Handler error reported');
+  assert(evCtx.eval('JSON.stringify(seen)') === '[{"y":9},1,2]', 'Events kept after missing handler and delivered past a failure');
+  var evStats = evCtx.getHostEventStats();
+  assert(evStats.queued === 15 && evStats.coalesced === 3 && evStats.delivered === 12 && evStats.pending === 0, 'Host event stats', JSON.stringify(evStats));
+  assert(evStats.flushes === 4 && evStats.maxPending === 5 && evStats.maxWaitMs >= evStats.avgWaitMs, 'Host event flush stats', JSON.stringify(evStats));
+  evCtx.dispose();
+
+  // 39. Precompiled bootstrap bytecode
+  console.log('\n39. Bootstrap Bytecode');
+  var findConsoleScript = () => sandbox.getBootstrapScripts().filter((s) => s.name === 'console')[0];
+  var consoleScript = findConsoleScript();
+  assert(consoleScript && consoleScript.bytecodeBytes > 0 && consoleScript.sourceBytes > 0, 'Console shim embedded', JSON.stringify(sandbox.getBootstrapScripts()));
+  var bootCtx = runtime.createContext();
+  assert(findConsoleScript().uses === consoleScript.uses + 1, 'Context creation loads the console from bytecode');
+  assert(bootCtx.eval('typeof console.log + typeof console.groupEnd') === 'functionfunction', 'Console installed from bytecode');
+  assert(bootCtx.eval('console.log.toString()').indexOf('__qjs_print') !== -1, 'Function source kept in bytecode');
+  assert(bootCtx.eval('var x = 1; x + 1') === 2, 'Other code still evaluated from source');
+  bootCtx.dispose();
+
+  // 40. Opcode execution statistics
+  console.log('\n40. Opcode Stats');
+  var opRuntime = sandbox.createRuntime();
+  var opCtx = opRuntime.createContext();
+  var opStats = opRuntime.dumpOpcodeStats();
+  if (opStats.indexOf('unavailable') !== -1) {
+    assert(true, 'Opcode stats report that they are not built in');
+  } else {
+    opRuntime.resetOpcodeStats();
+    opCtx.eval('var s = 0; for (var i = 0; i < 1000; i++) s += i; s');
+    opStats = opRuntime.dumpOpcodeStats(5);
+    var opCount = Number(/opcodes: (\d+) executed/.exec(opStats)[1]);
+    assert(opCount > 5000 && opCount < 20000, 'Opcodes of the loop counted', opStats);
+    assert(/^\s+1\s+\S+/m.test(opStats) && opStats.indexOf('add') !== -1, 'Histogram lists the loop opcodes', opStats);
+    assert(/pairs: \d+ distinct/.test(opStats) && opStats.indexOf(' -> ') !== -1, 'Opcode pairs listed', opStats);
+    opRuntime.resetOpcodeStats();
+    assert(/opcodes: 0 executed/.test(opRuntime.dumpOpcodeStats()), 'Reset clears the counters');
+  }
+  opCtx.dispose();
+  opRuntime.dispose();
+  assertThrows(() => opRuntime.dumpOpcodeStats(), 'Stats of a disposed runtime throw');
+
+  // 41. Per-function profile
+  console.log('\n41. Function Profile');
+  var profRuntime = sandbox.createRuntime();
+  var profCtx = profRuntime.createContext();
+  profCtx.setGlobal('hostAdd', function hostAdd(a, b) { return a + b; });
+  profCtx.eval(`function leaf(n) { return hostAdd(n, 1); }
+function Component(n) { var s = 0; for (var i = 0; i < n; i++) s += leaf(i); return [s].map(function mapper(x) { return x; })[0]; }`);
+  profCtx.eval('Component(3)');
+  profRuntime.setFunctionProfiling(true);
+  profCtx.eval('for (var k = 0; k < 10; k++) Component(5)');
+  profRuntime.setFunctionProfiling(false);
+  profCtx.eval('Component(5)');
+  var profile = profRuntime.getFunctionProfile();
+  var findProfile = (name) => profile.filter((p) => p.name === name)[0];
+  var componentProfile = findProfile('Component');
+  var leafProfile = findProfile('leaf');
+  assert(componentProfile && componentProfile.calls === 10 && leafProfile && leafProfile.calls === 50, 'Calls counted while enabled only', JSON.stringify(profile));
+  assert(componentProfile.line === 2 && leafProfile.line === 1 && !componentProfile.native && typeof componentProfile.file === 'string', 'Bytecode functions located by file and line', JSON.stringify(componentProfile));
+  var hostProfile = findProfile('hostAdd');
+  assert(hostProfile && hostProfile.native && hostProfile.calls === 50, 'Host functions profiled by name', JSON.stringify(profile));
+  assert(findProfile('map').native && findProfile('mapper').calls === 10, 'Builtins and closures profiled');
+  assert(profile.every((p) => p.selfMs >= 0 && p.inclusiveMs >= p.selfMs), 'Self time within inclusive time');
+  assert(componentProfile.inclusiveMs >= leafProfile.inclusiveMs, 'Inclusive time covers callees');
+  assert(profRuntime.getFunctionProfile(2).length === 2, 'maxFunctions limits the report');
+  profRuntime.resetFunctionProfile();
+  assert(profRuntime.getFunctionProfile().length === 0, 'Reset clears the profile');
+  profCtx.dispose();
+  profRuntime.dispose();
+
+  // 42. Boundary traffic
+  console.log('\n42. Boundary Stats');
+  var bCtx = runtime.createContext();
+  var empty = bCtx.getBoundaryStats();
+  assert(empty.toGuest.crossings === 0 && empty.hostCalls.count === 0 && empty.hostCalls.p99Ms === 0, 'Fresh context has no traffic', JSON.stringify(empty));
+  bCtx.setGlobal('echo', function echo(value) { return value; });
+  bCtx.setGlobal('data', { name: 'abc', list: [1, 'de', { f: 'g' }] });
+  bCtx.eval('for (var i = 0; i < 20; i++) echo("xy")');
+  var guestFn = bCtx.eval('(function (a) { return a + 1; })');
+  guestFn(1);
+  guestFn(2);
+  var bStats = bCtx.getBoundaryStats();
+  // setGlobal x2, echo results x20, guestFn arguments x2
+  assert(bStats.toGuest.crossings === 2 + 20 + 2 && bStats.toGuest.values === 1 + 7 + 20 + 2 && bStats.toGuest.objects === 3, 'Values to the guest counted with nesting', JSON.stringify(bStats.toGuest));
+  assert(bStats.toGuest.strings === 3 + 20 && bStats.toGuest.bytes === 6 + 40 && bStats.toGuest.functions === 1, 'Strings, bytes and functions to the guest', JSON.stringify(bStats.toGuest));
+  // echo arguments x20, eval results x2 (the loop completes with "xy"), guestFn results x2
+  assert(bStats.toHost.strings === 21 && bStats.toHost.bytes === 42 && bStats.toHost.functions === 1, 'Strings and functions to the host', JSON.stringify(bStats.toHost));
+  assert(bStats.toHost.crossings === 20 + 2 + 2 && bStats.toHost.conversion.count === bStats.toHost.crossings, 'One conversion per crossing', JSON.stringify(bStats.toHost));
+  assert(bStats.hostCalls.count === 20 && bStats.guestCalls.count === 2, 'Trampoline calls counted', JSON.stringify(bStats));
+  var hc = bStats.hostCalls;
+  assert(hc.p50Ms > 0 && hc.p50Ms <= hc.p90Ms && hc.p90Ms <= hc.p99Ms && hc.p99Ms <= hc.maxMs && hc.maxMs <= hc.totalMs, 'Latency percentiles ordered', JSON.stringify(hc));
+  bCtx.setGlobal('echo', undefined);
+  assert(bCtx.getBoundaryStats().functionsReleased === 1, 'Collected host function wrappers counted as released');
+  bCtx.resetBoundaryStats();
+  var reset = bCtx.getBoundaryStats();
+  assert(reset.toGuest.values === 0 && reset.hostCalls.count === 0 && reset.guestCalls.maxMs === 0, 'Reset clears counters and histograms', JSON.stringify(reset));
+  bCtx.dispose();
+
+  // 43. Allocator totals and peak
+  console.log('\n43. Allocator Stats');
+  var heapRuntime = sandbox.createRuntime();
+  var heapCtx = heapRuntime.createContext();
+  var heapBefore = heapRuntime.getHeapInfo();
+  assert(heapBefore.malloc_allocations > 0 && heapBefore.malloc_peak_size >= heapBefore.malloc_size, 'Context creation counted', JSON.stringify(heapBefore));
+  heapCtx.eval('var big = []; for (var i = 0; i < 10000; i++) big.push({ i: i }); big = null;');
+  var heapAfter = heapRuntime.getHeapInfo();
+  assert(heapAfter.malloc_allocations - heapBefore.malloc_allocations >= 10000, 'Every allocation counted', JSON.stringify(heapAfter));
+  assert(heapAfter.malloc_peak_size > heapBefore.malloc_size + 10000 * 16 && heapAfter.malloc_peak_size > heapAfter.malloc_size, 'Peak kept after the garbage is freed', JSON.stringify(heapAfter));
+  heapCtx.dispose();
+  heapRuntime.dispose();
+
+  // 44. Bundles compiled while they download
+  console.log('\n44. Bundle Streams');
+  var streamCtx = runtime.createContext();
+  // In a block, so lexical declarations can be evaluated again
+  var streamSource = '{var parts=[];parts.push("a;b,c");parts.push(`t;${1+2},u\nv`);/* x;y,\nz */' +
+    'parts.push(/[;,]+/.source);// c;d,e\nlet\nletValue = 5;parts.push(letValue);' +
+    'class Base{};class Derived extends Base{};parts.push(new Derived() instanceof Base, "é;€".length);' +
+    'function add(a,b){return a+b}parts.push(add(1,2));parts.join("|")}';
+  var expected = streamCtx.eval(streamSource);
+  streamCtx.eval('parts = undefined');
+  var chunkSizes = [1, 3, 7, 64];
+  var allStreamed = true;
+  for (var ci = 0; ci < chunkSizes.length; ci++) {
+    var stream = streamCtx.createBundleStream('app.js', streamSource.length * 3);
+    for (var pos = 0; pos < streamSource.length; pos += chunkSizes[ci]) {
+      stream.append(streamSource.slice(pos, pos + chunkSizes[ci]));
+    }
+    var streamed = stream.finish();
+    assert(streamed === expected, 'Streamed in ' + chunkSizes[ci] + ' char chunks', streamed);
+    allStreamed = allStreamed && stream.getStats().streamed;
+  }
+  assert(allStreamed, 'Compiled while streaming');
+  var bytesStream = streamCtx.createBundleStream('bytes.js');
+  bytesStream.append(new Uint8Array([49, 59, 32]).buffer);
+  bytesStream.append('40 + 2');
+  assert(bytesStream.finish() === 42, 'ArrayBuffer and string chunks');
+  var bytesStats = bytesStream.getStats();
+  assert(bytesStats.bytes === 9 && bytesStats.chunks === 2 && bytesStats.compileMs >= 0, 'Stream stats', JSON.stringify(bytesStats));
+  var overflow = streamCtx.createBundleStream('big.js', 4);
+  overflow.append('var big = 1;');
+  overflow.append('big + 1');
+  assert(overflow.finish() === 2 && !overflow.getStats().streamed, 'Bundle larger than expected falls back to eval');
+  var broken = streamCtx.createBundleStream('broken.js');
+  broken.append('var ok = 1;\nvar = ;');
+  var brokenError = '';
+  try { broken.finish(); } catch (e) { brokenError = String(e.message); }
+  assert(brokenError.indexOf('SyntaxError') >= 0, 'Syntax errors are reported', brokenError);
+  assertThrows(() => broken.append('1'), 'Append after finish throws');
+  var cancelled = streamCtx.createBundleStream('cancelled.js');
+  cancelled.append('1;');
+  cancelled.cancel();
+  assertThrows(() => cancelled.finish(), 'Finish after cancel throws');
+  streamCtx.dispose();
+
+  // 45. Arrays built and read in bulk
+  console.log('\n45. Array Conversion');
+  var arrayCtx = runtime.createContext();
+  var children = [];
+  for (var ai = 0; ai < 200; ai++) {
+    children.push({ type: 'Text', key: 'k' + ai, props: { style: [{ flex: 1 }, null, [{ margin: ai }]] } });
+  }
+  arrayCtx.setGlobal('children', children);
+  assert(arrayCtx.eval('children.length === 200 && children[199].props.style[2][0].margin === 199'), 'Host array of objects reaches the guest');
+  var roundTrip = arrayCtx.eval('children');
+  assert(roundTrip.length === 200 && roundTrip[7].key === 'k7' && roundTrip[7].props.style[1] === null, 'Guest array of objects reaches the host');
+  var holey = [1, , 3];
+  holey.length = 5;
+  arrayCtx.setGlobal('holey', holey);
+  assert(arrayCtx.eval('holey.length === 5 && holey[0] === 1 && holey[1] === undefined && holey[2] === 3 && holey[4] === undefined'), 'Holey host array keeps its length', arrayCtx.eval('JSON.stringify(holey)'));
+  var guestHoley = arrayCtx.eval('var g = ["a"]; g.length = 3; g');
+  assert(guestHoley.length === 3 && guestHoley[0] === 'a' && guestHoley[2] === undefined, 'Holey guest array keeps its length');
+  var mixed = arrayCtx.eval('["s", 1.5, true, null, undefined, 7n > 0n, [], {}]');
+  assert(mixed.length === 8 && mixed[0] === 's' && mixed[1] === 1.5 && mixed[5] === true && Array.isArray(mixed[6]), 'Mixed element types', JSON.stringify(mixed));
+  arrayCtx.setGlobal('keyed', { b: 1, a: 2, 10: 3, 2: 4 });
+  assert(arrayCtx.eval('Object.keys(keyed).join()') === '2,10,b,a', 'Host object property order', arrayCtx.eval('Object.keys(keyed).join()'));
+  arrayCtx.setGlobal('empty', []);
+  assert(arrayCtx.eval('Array.isArray(empty) && empty.length === 0'), 'Empty array');
+  arrayCtx.dispose();
+
+  // 46. Sandbox HostObjects with a fixed property set
+  console.log('\n46. Static Host Objects');
+  var staticCtx = runtime.createContext();
+  assert(staticCtx.eval === staticCtx.eval && staticCtx.setGlobal === staticCtx.setGlobal, 'Methods are created once per object');
+  assert(staticCtx.eval('6 * 7') === 42, 'Cached method works');
+  assert(staticCtx.noSuchProperty === undefined && staticCtx[0] === undefined, 'Unknown properties are undefined');
+  var otherCtx = runtime.createContext();
+  assert(otherCtx.eval !== staticCtx.eval, 'Methods are per object');
+  var store = sandbox.createTreeStore();
+  assert(store.size === 0 && store.getChildren === store.getChildren, 'Tree store values and methods');
+  var heldEval = otherCtx.eval;
+  heldEval.owner = otherCtx; // cycle through a cached method
+  otherCtx.dispose();
+  otherCtx = undefined;
+  heldEval = undefined;
+  // Collected (no cycle) while its runtime still holds it
+  var contextCount = runtime.getHeapInfo().context_count;
+  var droppedCtx = runtime.createContext();
+  droppedCtx.eval('var kept = 1');
+  droppedCtx = undefined;
+  assert(runtime.getHeapInfo().context_count === contextCount + 1, 'An undisposed context stays with its runtime');
+  assert(runtime.createContext().eval('6 * 7') === 42, 'Runtime works after collecting a context');
+  assert(staticCtx.isDisposed === false, 'Value properties are read on every get');
+  staticCtx.dispose();
+  assert(staticCtx.isDisposed === true, 'Value property reflects dispose');
+
+  // 47. Evaluating ArrayBuffers and files with a source URL
+  console.log('\n47. Source Buffers and Files');
+  var bufferCtx = runtime.createContext();
+  var toBuffer = function (text) {
+    var bytes = new Uint8Array(text.length);
+    for (var bi = 0; bi < text.length; bi++) bytes[bi] = text.charCodeAt(bi);
+    return bytes.buffer;
+  };
+  var stackSource = 'function where() {\n  return new Error("here").stack;\n}\nwhere()\n';
+  var newlineBuffer = toBuffer(stackSource);
+  var bufferStack = bufferCtx.evalBuffer(newlineBuffer, 'app/bundle.js');
+  assert(String(bufferStack).indexOf('app/bundle.js:2') >= 0, 'Stack trace names the buffer source URL', bufferStack);
+  assert(new Uint8Array(newlineBuffer)[newlineBuffer.byteLength - 1] === 10, 'Buffer is not modified');
+  assert(bufferCtx.evalBuffer(toBuffer('6 * 7')) === 42, 'Buffer without a trailing NUL is copied');
+  assert(bufferCtx.evalBuffer(toBuffer('1 + 2\0')) === 3, 'NUL-terminated buffer');
+  assert(String(bufferCtx.eval('new Error("x").stack', 'named.js')).indexOf('named.js') >= 0, 'eval takes a source URL');
+  var bufferError = '';
+  try { bufferCtx.evalBuffer(toBuffer('var = ;\n'), 'broken.js'); } catch (e) { bufferError = String(e.message); }
+  assert(bufferError.indexOf('SyntaxError') >= 0, 'Buffer syntax errors are reported', bufferError);
+  assertThrows(() => bufferCtx.evalBuffer('1 + 1'), 'evalBuffer requires an ArrayBuffer');
+  assertThrows(() => bufferCtx.evalFile('test/fixtures/missing.js'), 'Missing file throws');
+  var fileResult;
+  ['test/fixtures/eval_file.js', '../test/fixtures/eval_file.js'].some(function (path) {
+    try { fileResult = bufferCtx.evalFile(path, 'fixtures/eval_file.js'); return true; } catch (e) { return false; }
+  });
+  assert(fileResult === 42, 'evalFile evaluates a mapped file', fileResult);
+  assert(String(bufferCtx.getGlobal('fileStack')).indexOf('fixtures/eval_file.js:3') >= 0, 'Stack trace names the file source URL', bufferCtx.getGlobal('fileStack'));
+  bufferCtx.dispose();
+  assertThrows(() => bufferCtx.evalBuffer(toBuffer('1\n')), 'evalBuffer after dispose throws');
+
+  // 48. Contexts with lazily instantiated built-ins
+  console.log('\n48. Lazy Intrinsics');
+  var eagerRuntime = sandbox.createRuntime();
+  var lazyRuntime = sandbox.createRuntime({ lazyIntrinsics: true });
+  // Contexts are referenced until their runtime is disposed
+  var perContext = function (rt) {
+    var first = rt.createContext();
+    var before = rt.getHeapInfo().malloc_size;
+    var extra = [];
+    for (var ci = 0; ci < 8; ci++) extra.push(rt.createContext());
+    var bytes = (rt.getHeapInfo().malloc_size - before) / 8;
+    extra.forEach(function (c) { c.dispose(); });
+    return { bytes: bytes, ctx: first, extra: extra };
+  };
+  var eager = perContext(eagerRuntime);
+  var lazy = perContext(lazyRuntime);
+  assert(lazy.bytes < eager.bytes * 0.8, 'Lazy contexts are smaller', lazy.bytes + ' vs ' + eager.bytes);
+  var globalNames = 'Object.getOwnPropertyNames(globalThis).join()';
+  assert(lazy.ctx.eval(globalNames) === eager.ctx.eval(globalNames), 'Same globals in the same order');
+  assert(lazy.ctx.eval('new Map([[1, 2]]).get(1) + new Set([1, 1]).size') === 3, 'Map and Set on first use');
+  assert(lazy.ctx.eval('new Date(0).toISOString()') === '1970-01-01T00:00:00.000Z', 'Date on first use');
+  assert(lazy.ctx.eval('new DataView(new Uint8Array([7, 9]).buffer).getUint8(1)') === 9, 'Typed arrays on first use');
+  assert(lazy.ctx.eval('Object.getPrototypeOf(new Float64Array(1)) === Float64Array.prototype'), 'Typed array prototypes are shared');
+  assert(lazy.ctx.eval('delete WeakMap; typeof WeakMap') === 'undefined', 'Unread built-ins can be deleted');
+  assert(lazy.ctx.eval('Date = 5; Date') === 5, 'Built-in globals stay writable');
+  var lazyBytes = lazy.ctx.eval('Array.from(new Uint8Array([1, 2, 3]))');
+  assert(lazyBytes.join() === '1,2,3', 'Typed array data crosses to the host', lazyBytes);
+  var freshLazy = lazyRuntime.createContext();
+  assert(freshLazy.evalBuffer(new Uint8Array([52, 50, 10]).buffer) === 42, 'Host buffers reach a context that never read ArrayBuffer');
+  freshLazy.dispose();
+  lazy.ctx.dispose();
+  eager.ctx.dispose();
+  lazyRuntime.dispose();
+  eagerRuntime.dispose();
+  lazy = eager = freshLazy = undefined;
+
+  // 49. Guest performance marks and console timers
+  console.log('\n49. Guest User Timing');
+  var timingCtx = runtime.createContext();
+  var t0 = timingCtx.eval('performance.now()');
+  assert(typeof t0 === 'number' && t0 >= 0, 'performance.now() is native', t0);
+  assert(timingCtx.eval('var a = performance.now(), b = performance.now(); b >= a'), 'performance.now() is monotonic');
+  assert(Math.abs(timingCtx.eval('performance.timeOrigin') - Date.now()) < 60000, 'timeOrigin is a wall-clock time');
+  timingCtx.eval(
+    'performance.mark("start");' +
+    'for (var w = 0, x = 0; w < 10000; w++) x += w;' +
+    'performance.mark("end");' +
+    'performance.measure("loop", "start", "end");' +
+    'performance.measure("fixed", { start: 10, duration: 5 });' +
+    'performance.mark("at", { startTime: 3 });' +
+    'console.time("render"); console.timeEnd("render");' +
+    'console.timeLog("missing");'
+  );
+  var toEntries = function (trace) {
+    return trace.name.map(function (n, i) {
+      return { name: trace.names[n], entryType: trace.kind[i] ? 'measure' : 'mark', startTime: trace.startTime[i], duration: trace.duration[i] };
+    });
+  };
+  var trace = timingCtx.drainTrace();
+  assert(trace.names.join() === 'start,end,loop,fixed,at,render', 'Each name is listed once', JSON.stringify(trace.names));
+  var entries = toEntries(trace);
+  assert(entries.map(function (e) { return e.entryType + ':' + e.name; }).join() ===
+    'mark:start,mark:end,measure:loop,measure:fixed,mark:at,measure:render', 'Entries are drained in order', JSON.stringify(entries));
+  assert(entries[2].startTime === entries[0].startTime && Math.abs(entries[2].duration - (entries[1].startTime - entries[0].startTime)) < 1e-5,
+    'measure() between marks', JSON.stringify(entries[2]));
+  assert(entries[3].startTime === 10 && entries[3].duration === 5, 'measure() with options');
+  assert(entries[4].startTime === 3 && entries[4].duration === 0, 'mark() with startTime');
+  assert(entries[5].duration >= 0, 'console.timeEnd() records a measure');
+  assert(timingCtx.drainTrace().name.length === 0, 'A drain removes the entries');
+  assert(timingCtx.eval('performance.measure("late", "start"); 1') === 1, 'Marks survive a drain');
+  assertThrows(() => timingCtx.eval('performance.measure("bad", "nope")'), 'Unknown marks throw');
+  timingCtx.eval('performance.clearMarks("start")');
+  assertThrows(() => timingCtx.eval('performance.measure("late", "start")'), 'clearMarks() forgets a mark');
+  timingCtx.eval('for (var m = 0; m < 100; m++) performance.mark("m\\"" + (m % 3))');
+  trace = timingCtx.drainTrace(50);
+  assert(trace.name.length === 50 && trace.names.join('|') === 'late|m"0|m"1|m"2', 'drainTrace() takes a maximum', JSON.stringify(trace.names));
+  assert(timingCtx.drainTrace().startTime.length === 51, 'The rest is drained next');
+  var traceStats = timingCtx.getTraceStats();
+  assert(traceStats.recorded === 107 && traceStats.drained === 107 && traceStats.pending === 0 && traceStats.dropped === 0,
+    'Trace stats', JSON.stringify(traceStats));
+  // The marks end, at and three m"; looked-up names (missing, nope) are not kept
+  assert(traceStats.names === 5, 'Names are released once unused', traceStats.names);
+  timingCtx.eval('for (var r = 0; r < 3000; r++) { performance.mark("row-" + r); performance.clearMarks("row-" + r); }');
+  timingCtx.drainTrace();
+  assert(timingCtx.getTraceStats().names === 5, 'Per-item names do not accumulate', timingCtx.getTraceStats().names);
+  timingCtx.eval('for (var r = 0; r < 4200; r++) performance.mark("item-" + r)');
+  traceStats = timingCtx.getTraceStats();
+  assert(traceStats.names === 4096 && traceStats.dropped === 4200 - (4096 - 5), 'Names are capped', JSON.stringify(traceStats));
+  timingCtx.eval('performance.clearMarks()');
+  timingCtx.drainTrace();
+  assert(timingCtx.getTraceStats().names === 0, 'clearMarks() releases drained names', timingCtx.getTraceStats().names);
+  var droppedBefore = timingCtx.getTraceStats().dropped;
+  timingCtx.eval('for (var d = 0; d < 5000; d++) performance.mark("flood")');
+  traceStats = timingCtx.getTraceStats();
+  assert(traceStats.pending === traceStats.capacity && traceStats.dropped - droppedBefore === 5000 - traceStats.capacity,
+    'A full buffer drops entries', JSON.stringify(traceStats));
+  timingCtx.dispose();
+  assert(timingCtx.drainTrace().kind.length === traceStats.capacity, 'Entries can be drained after dispose');
+
+  // 50. Reconciler operations recorded natively (__rill_op_*)
+  console.log('\n50. Operation Arena');
+  var opCtx = runtime.createContext();
+  var committed = [];
+  opCtx.setOperationSink('__sendToHost', (batch) => {
+    committed.push(batch);
+  });
+  assert(opCtx.eval('typeof __rill_op_create + typeof __rill_op_commit') === 'functionfunction', 'Operation intrinsics installed');
+  opCtx.eval(
+    'var style = { color: "red" };' +
+    '__rill_op_create(1, "View", { style: style, onPress: { __type: "function", __fnId: "fn_1" } });' +
+    '__rill_op_create(2, "__TEXT__", { text: "hi" });' +
+    '__rill_op_append(1, 2);' +
+    '__rill_op_append(0, 1);' +
+    '__rill_op_insert(1, 3, 0);' +
+    '__rill_op_update(1, { a: 1 }, ["b"]);' +
+    '__rill_op_remove(1, 3);' +
+    '__rill_op_delete(3);' +
+    '__rill_op_push({ op: "REORDER", id: 1, parentId: 1, childIds: [2] });'
+  );
+  assert(opCtx.eval('__rill_op_pending()') === 9, 'Operations pending until commit');
+  assert(opCtx.eval('JSON.stringify(__rill_op_counts())') ===
+    '{"REORDER":1,"CREATE":2,"UPDATE":1,"DELETE":1,"APPEND":2,"INSERT":1,"REMOVE":1}', 'Pending counts by op',
+    opCtx.eval('JSON.stringify(__rill_op_counts())'));
+  var opBoundary = opCtx.getBoundaryStats();
+  assert(opCtx.eval('__rill_op_commit(__sendToHost, 1, 4)') === 9 && committed.length === 1, 'Commit delivers one batch');
+  var arenaBatch = committed[0];
+  assert(arenaBatch.version === 1 && arenaBatch.batchId === 4, 'Batch fields');
+  assert(JSON.stringify(arenaBatch.operations) === JSON.stringify([
+    { op: 'CREATE', id: 1, type: 'View', props: { style: { color: 'red' }, onPress: { __type: 'function', __fnId: 'fn_1' } } },
+    { op: 'CREATE', id: 2, type: '__TEXT__', props: { text: 'hi' } },
+    { op: 'APPEND', id: 2, parentId: 1, childId: 2 },
+    { op: 'APPEND', id: 1, parentId: 0, childId: 1 },
+    { op: 'INSERT', id: 3, parentId: 1, childId: 3, index: 0 },
+    { op: 'UPDATE', id: 1, props: { a: 1 }, removedProps: ['b'] },
+    { op: 'REMOVE', id: 3, parentId: 1, childId: 3 },
+    { op: 'DELETE', id: 3 },
+    { op: 'REORDER', id: 1, parentId: 1, childIds: [2] },
+  ]), 'Operations in the collector layout', JSON.stringify(arenaBatch.operations));
+  var opCrossings = opCtx.getBoundaryStats();
+  // The batch and eval()'s result
+  assert(opCrossings.toHost.crossings - opBoundary.toHost.crossings === 2, 'A commit is one crossing',
+    opCrossings.toHost.crossings - opBoundary.toHost.crossings);
+  assert(opCtx.eval('__rill_op_pending()') === 0 && opCtx.eval('__rill_op_commit(__sendToHost, 1, 5)') === 0 && committed.length === 1,
+    'Empty commits are not delivered');
+  var opStats = opCtx.getCoalescingStats();
+  assert(opStats.batches === 1 && opStats.opsIn === 9 && opStats.opsOut === 9, 'Arena commits are counted', JSON.stringify(opStats));
+  var guestSunk = opCtx.eval(
+    'var seen = [];' +
+    '__rill_op_create(7, "Text", {});' +
+    '__rill_op_append(0, 7);' +
+    '__rill_op_commit(function (batch) { seen.push(batch); }, 2, 8);' +
+    'JSON.stringify(seen)'
+  );
+  assert(guestSunk === '[{"version":2,"batchId":8,"operations":[{"op":"CREATE","id":7,"type":"Text","props":{}},' +
+    '{"op":"APPEND","id":7,"parentId":0,"childId":7}]}]', 'Other sinks get a guest batch', guestSunk);
+  assert(committed.length === 1, 'Guest sinks bypass the host');
+  opCtx.setOperationSink('__sendToHost', () => {
+    opCtx.eval('__rill_op_delete(8)');
+    throw new Error('sink failed');
+  });
+  opCtx.eval('__rill_op_delete(5)');
+  assertThrows(() => opCtx.eval('__rill_op_commit(__sendToHost, 1, 9)'), 'Sink errors reach the guest');
+  assert(opCtx.eval('JSON.stringify(__rill_op_counts())') === '{"DELETE":1}', 'Operations recorded by the sink go to the next commit');
+  assertThrows(() => opCtx.eval('__rill_op_commit(1, 1, 1)'), 'The sink must be a function');
+  assertThrows(() => opCtx.eval('__rill_op_push(1)'), 'Pushed operations must be objects');
+  opCtx.dispose();
+
+  // 51. Base atoms shared by every runtime
+  console.log('\n51. Base Atom Table');
+  var atomRuntime1 = sandbox.createRuntime();
+  var atomRuntime2 = sandbox.createRuntime();
+  var atomCtx1 = atomRuntime1.createContext();
+  var atomCtx2 = atomRuntime2.createContext();
+  var atomCode =
+    'var el = { op: "CREATE", id: 1, props: { style: { flexDirection: "row", backgroundColor: "red" } } };' +
+    'el.onPress = 1; delete el.id; el["par" + "entId"] = 0;' +
+    'JSON.stringify([Object.keys(el), el.parentId, "style" in el.props, [1, 2][Symbol.iterator]().next().value])';
+  var atomResult = atomCtx1.eval(atomCode);
+  assert(atomResult === '[["op","props","onPress","parentId"],0,true,1]', 'App atoms are ordinary property names', atomResult);
+  assert(atomCtx2.eval(atomCode) === atomResult, 'Same atoms in every runtime');
+  atomRuntime1.dispose();
+  atomRuntime2.dispose();
+
   // Summary
   console.log('\n=== Test Summary ===');
   console.log(`Total: ${testsRun}`);
@@ -0,0 +1,261 @@
+/*
+ * Streamed bundle load benchmark
+ *
+ * Loads a guest bundle served by a throttled local "server" (a producer
+ * thread releasing 16 KB chunks at the link bandwidth) into
+ * rill::HeadlessHost and renders it once:
+ *   after     - download everything, then loadBundle(string)
+ *   streamed  - loadBundle(BundleCompiler) while the download runs: the
+ *               guest runtime is set up and the bundle compiled off-thread
+ *               as it arrives
+ *
+ * Reports time to first render (TTFR, from the start of the download) and
+ * the JS thread's load time after the last byte arrived, which is what
+ * streaming hides. The bundle is a synthetic minified app (~1 MB, one
+ * line) unless --bundle gives one that sets globalThis.__RillGuest.
+ *
+ * Usage: quickjs_stream_bench [--mbps a,b,...] [--iterations n]
+ *                             [--bundle path] [--json] [filter]
+ */
+
+#include "../src/BundleCompiler.h"
+#include "../src/HeadlessHost.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kChunkBytes = 16 * 1024;
+
+double nowMs() {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool readFile(const std::string &path, std::string *out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  *out = buffer.str();
+  return true;
+}
+
+// A minified app: `modules` small components with literals, templates and
+// regexps, on one line like bundler output
+std::string syntheticBundle(int modules) {
+  std::string code = "var React=globalThis.React,h=React.createElement,M=[];";
+  for (int i = 0; i < modules; i++) {
+    std::string n = std::to_string(i);
+    code += "M.push(function(){var s={container:{flex:1,padding:" + n +
+            ",backgroundColor:\"#fafafa\"},title:{fontSize:" +
+            std::to_string(12 + i % 8) +
+            ",fontWeight:\"600\"}},re=/^item-(\\d+);$/,labels=[\"one\","
+            "\"two\",\"three\"];function C" + n +
+            "(p){var v=p.value==null?0:p.value,m=re.exec(\"item-" + n +
+            ";\");return h(\"View\",{style:s.container},h(\"Text\",{style:"
+            "s.title},`Item ${" + n +
+            "} ${labels[v%3]} ${m?m[1]:\"\"}`))}C" + n +
+            ".displayName=\"C" + n + "\";return C" + n + "}());";
+  }
+  code += "function App(){var c=[];for(var i=0;i<M.length;i+=" +
+          std::to_string(std::max(1, modules / 20)) +
+          ")c.push(h(M[i],{key:i,value:i}));return h(\"ScrollView\",null,c)}"
+          "globalThis.__RillGuest={default:App};";
+  return code;
+}
+
+// Releases `code` in chunks no faster than `mbps` from `start`; calls
+// deliver(chunk, length) for each and returns when all are delivered
+template <typename Deliver>
+void serve(const std::string &code, double mbps, double start,
+           Deliver deliver) {
+  double bytesPerMs = mbps * 1000000 / 8 / 1000;
+  for (size_t pos = 0; pos < code.size(); pos += kChunkBytes) {
+    size_t length = std::min(kChunkBytes, code.size() - pos);
+    double due = start + (double)(pos + length) / bytesPerMs;
+    double wait = due - nowMs();
+    if (wait > 0) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds((int64_t)(wait * 1000)));
+    }
+    deliver(code.data() + pos, length);
+  }
+}
+
+struct Sample {
+  double ttfrMs;
+  double tailMs; // last byte -> bundle loaded
+  double compileMs;
+  bool streamed;
+};
+
+Sample loadAfterDownload(rill::HeadlessHost &host, const std::string &code,
+                         double mbps) {
+  // Loading the loaded bundle again is a no-op
+  host.loadBundle("0;");
+  double start = nowMs();
+  std::string received;
+  serve(code, mbps, start, [&received](const char *data, size_t length) {
+    received.append(data, length);
+  });
+  double downloaded = nowMs();
+  host.loadBundle(received);
+  double loaded = nowMs();
+  host.render();
+  return {nowMs() - start, loaded - downloaded, 0, false};
+}
+
+Sample loadStreamed(rill::HeadlessHost &host, const std::string &code,
+                    double mbps) {
+  double start = nowMs();
+  double downloaded = 0;
+  quickjs_sandbox::BundleCompiler compiler("bundle.js", code.size());
+  std::thread server([&] {
+    serve(code, mbps, start, [&compiler](const char *data, size_t length) {
+      compiler.append(data, length);
+    });
+    downloaded = nowMs();
+    compiler.finish();
+  });
+  try {
+    host.loadBundle(compiler);
+  } catch (...) {
+    compiler.cancel();
+    server.join();
+    throw;
+  }
+  double loaded = nowMs();
+  server.join();
+  host.render();
+  quickjs_sandbox::BundleCompiler::Stats stats = compiler.stats();
+  return {nowMs() - start, loaded - downloaded, stats.compileMs,
+          stats.streamed};
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+int usage() {
+  std::cerr << "usage: quickjs_stream_bench [--mbps a,b,...] [--iterations n] "
+               "[--bundle path] [--json] [filter]"
+            << std::endl;
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<double> bandwidths = {8, 32, 128};
+  int iterations = 3;
+  bool json = false;
+  std::string filter;
+  std::string code;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--mbps" && hasValue) {
+      bandwidths.clear();
+      std::stringstream list(argv[++i]);
+      std::string item;
+      while (std::getline(list, item, ',')) {
+        double mbps = std::atof(item.c_str());
+        if (mbps > 0) {
+          bandwidths.push_back(mbps);
+        }
+      }
+      if (bandwidths.empty()) {
+        return usage();
+      }
+    } else if (arg == "--iterations" && hasValue) {
+      iterations = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--bundle" && hasValue) {
+      if (!readFile(argv[++i], &code)) {
+        std::cerr << "quickjs_stream_bench: cannot read " << argv[i]
+                  << std::endl;
+        return 1;
+      }
+    } else if (arg == "--json") {
+      json = true;
+    } else if (arg[0] == '-' || !filter.empty()) {
+      return usage();
+    } else {
+      filter = arg;
+    }
+  }
+  if (code.empty()) {
+    code = syntheticBundle(2500);
+  }
+
+  std::ostringstream report;
+  if (json) {
+    report << "{\"bundle_bytes\":" << code.size()
+           << ",\"iterations\":" << iterations << ",\"scenarios\":{";
+  } else {
+    report << "=== stream (" << code.size() / 1024 << " KB bundle, "
+           << iterations << " loads per scenario) ===\n";
+  }
+
+  try {
+    rill::HeadlessHost host;
+    bool first = true;
+    for (double mbps : bandwidths) {
+      for (int streamed = 0; streamed < 2; streamed++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s@%gmbps",
+                 streamed ? "streamed" : "after", mbps);
+        if (!filter.empty() &&
+            std::string(name).find(filter) == std::string::npos) {
+          continue;
+        }
+        std::vector<double> ttfr;
+        std::vector<double> tail;
+        std::vector<double> compile;
+        bool allStreamed = true;
+        for (int i = 0; i < iterations; i++) {
+          Sample sample = streamed ? loadStreamed(host, code, mbps)
+                                   : loadAfterDownload(host, code, mbps);
+          ttfr.push_back(sample.ttfrMs);
+          tail.push_back(sample.tailMs);
+          compile.push_back(sample.compileMs);
+          allStreamed = allStreamed && sample.streamed;
+        }
+
+        char line[512];
+        const char *format =
+            json ? "%s\"%s\":{\"ttfr_ms\":%.1f,\"load_after_last_byte_ms\":"
+                   "%.1f,\"worker_compile_ms\":%.1f,\"streamed\":%s}"
+                 : "%s  %-18s ttfr_ms=%.1f load_after_last_byte_ms=%.1f "
+                   "worker_compile_ms=%.1f streamed=%s\n";
+        snprintf(line, sizeof(line), format, json && !first ? "," : "", name,
+                 median(ttfr), median(tail), median(compile),
+                 streamed && allStreamed ? "true" : "false");
+        report << line;
+        first = false;
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "quickjs_stream_bench: " << e.what() << std::endl;
+    return 1;
+  }
+
+  if (json) {
+    report << "}}\n";
+  }
+  std::cout << report.str();
+  return 0;
+}
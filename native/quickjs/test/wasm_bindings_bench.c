@@ -0,0 +1,133 @@
+/*
+ * WASM bindings value transfer benchmark
+ *
+ * Per-call cost of moving a value across the C API of src/wasm_bindings.c
+ * (built natively) as JSON text versus the binary encoding of wasm_value.h:
+ *   get  - qjs_get_global_json + qjs_free_string vs qjs_get_global_value
+ *   set  - qjs_set_global_json vs qjs_input_buffer copy + qjs_set_global_value
+ *   eval - qjs_eval + qjs_free_string vs qjs_eval_value of a global
+ * for a small object and a 1000-row list. Only the guest side is measured;
+ * JSON.parse versus DataView decoding on the host comes on top.
+ *
+ * Usage: quickjs_wasm_bench [filter]
+ */
+
+#include "../src/wasm_bindings.c"
+#include <time.h>
+
+typedef struct Payload {
+    const char *name;
+    const char *source;
+} Payload;
+
+static const Payload kPayloads[] = {
+    {"small", "({id: 42, title: 'Row 42', price: 19.99, selected: true})"},
+    {"large", "Array.from({length: 1000}, (_, i) => ({id: i, title: 'Row ' + i,"
+              " price: i * 1.25 + 0.01, selected: i % 2 === 0, tags: ['a', 'b']}))"},
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+typedef void (*CallFn)(JSContext *ctx, void *arg);
+
+// Runs fn for about 200 ms, returns microseconds per call
+static double time_calls(JSContext *ctx, CallFn fn, void *arg) {
+    long calls = 0;
+    long batch = 1;
+    double start = now_ms();
+    double elapsed = 0;
+    while (elapsed < 200) {
+        for (long i = 0; i < batch; i++) {
+            fn(ctx, arg);
+        }
+        calls += batch;
+        batch *= 2;
+        elapsed = now_ms() - start;
+    }
+    return elapsed * 1e3 / calls;
+}
+
+typedef struct Encoded {
+    char *json;
+    uint8_t *bytes;
+    size_t length;
+} Encoded;
+
+static void get_json(JSContext *ctx, void *arg) {
+    qjs_free_string(qjs_get_global_json(ctx, "payload"));
+}
+
+static void get_binary(JSContext *ctx, void *arg) {
+    qjs_get_global_value(ctx, "payload");
+}
+
+static void set_json(JSContext *ctx, void *arg) {
+    qjs_set_global_json(ctx, "copy", ((Encoded *)arg)->json);
+}
+
+static void set_binary(JSContext *ctx, void *arg) {
+    Encoded *encoded = arg;
+    memcpy(qjs_input_buffer(ctx, encoded->length), encoded->bytes, encoded->length);
+    qjs_set_global_value(ctx, "copy", encoded->length);
+}
+
+static void eval_json(JSContext *ctx, void *arg) {
+    qjs_free_string(qjs_eval(ctx, "payload"));
+}
+
+static void eval_binary(JSContext *ctx, void *arg) {
+    memcpy(qjs_input_buffer(ctx, 7), "payload", 7);
+    qjs_eval_value(ctx, 7);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : NULL;
+    JSRuntime *rt = qjs_runtime_new();
+    JSContext *ctx = qjs_context_new(rt);
+
+    printf("=== wasm value transfer (us per call, json -> binary) ===\n");
+    for (size_t p = 0; p < sizeof(kPayloads) / sizeof(kPayloads[0]); p++) {
+        const Payload *payload = &kPayloads[p];
+        if (filter && !strstr(payload->name, filter)) {
+            continue;
+        }
+
+        char setup[512];
+        snprintf(setup, sizeof(setup), "globalThis.payload = %s", payload->source);
+        qjs_eval_void(ctx, setup);
+
+        Encoded encoded;
+        encoded.json = qjs_get_global_json(ctx, "payload");
+        encoded.length = qjs_get_global_value(ctx, "payload");
+        encoded.bytes = malloc(encoded.length);
+        memcpy(encoded.bytes, qjs_result_buffer(ctx), encoded.length);
+
+        struct {
+            const char *name;
+            CallFn json;
+            CallFn binary;
+        } ops[] = {
+            {"get", get_json, get_binary},
+            {"set", set_json, set_binary},
+            {"eval", eval_json, eval_binary},
+        };
+        printf("  %s: %zu bytes json, %zu bytes binary\n", payload->name,
+               strlen(encoded.json), encoded.length);
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+            double json_us = time_calls(ctx, ops[i].json, &encoded);
+            double binary_us = time_calls(ctx, ops[i].binary, &encoded);
+            printf("    %-5s %10.3f -> %10.3f  (%.2fx)\n", ops[i].name, json_us,
+                   binary_us, json_us / binary_us);
+        }
+
+        qjs_free_string(encoded.json);
+        free(encoded.bytes);
+    }
+
+    qjs_runtime_free(rt);
+    return 0;
+}
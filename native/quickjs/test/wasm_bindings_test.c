@@ -0,0 +1,276 @@
+/*
+ * WASM bindings tests
+ *
+ * Runs the C API of src/wasm_bindings.c natively (EXPORT is empty outside
+ * Emscripten): handle lifecycle, the binary value encoding, isolation
+ * between guests of one runtime and of separate runtimes, per-context
+ * callbacks and timers. Prints the heap cost of each additional guest.
+ */
+
+#include "../src/wasm_bindings.c"
+
+static int passed = 0;
+static int failed = 0;
+
+static void check(int condition, const char *name) {
+    if (condition) {
+        passed++;
+        printf("  \xE2\x9C\x93 %s\n", name);
+    } else {
+        failed++;
+        printf("  \xE2\x9C\x97 %s\n", name);
+    }
+}
+
+// eval and compare the JSON result
+static int eval_is(JSContext *ctx, const char *code, const char *expected) {
+    char *result = qjs_eval(ctx, code);
+    int equal = strcmp(result, expected) == 0;
+    if (!equal) {
+        printf("    %s -> %s (expected %s)\n", code, result, expected);
+    }
+    qjs_free_string(result);
+    return equal;
+}
+
+// Host and timer callbacks record what they receive, one set per guest
+typedef struct Recorded {
+    char events[256];
+    int timers[8];
+    int timer_count;
+} Recorded;
+
+static Recorded g_a;
+static Recorded g_b;
+
+static void record_event(Recorded *r, const char *event, const char *data) {
+    size_t len = strlen(r->events);
+    snprintf(r->events + len, sizeof(r->events) - len, "%s=%s;", event, data);
+}
+
+static void host_a(const char *event, const char *data) { record_event(&g_a, event, data); }
+static void host_b(const char *event, const char *data) { record_event(&g_b, event, data); }
+static void timer_a(int encoded) { g_a.timers[g_a.timer_count++ & 7] = encoded; }
+static void timer_b(int encoded) { g_b.timers[g_b.timer_count++ & 7] = encoded; }
+
+// Copy bytes into the context's input buffer
+static size_t put_input(JSContext *ctx, const void *bytes, size_t length) {
+    memcpy(qjs_input_buffer(ctx, length), bytes, length);
+    return length;
+}
+
+static int eval_value(JSContext *ctx, const char *code) {
+    return qjs_eval_value(ctx, put_input(ctx, code, strlen(code)));
+}
+
+// Compare an encoded result with the expected bytes
+static int result_is(JSContext *ctx, int length, const void *expected, size_t size) {
+    return length == (int)size && memcmp(qjs_result_buffer(ctx), expected, size) == 0;
+}
+
+static JSContext *new_guest(JSRuntime *rt, HostCallbackFn host, TimerCallbackFn timer) {
+    JSContext *ctx = qjs_context_new(rt);
+    qjs_set_host_callback(ctx, host);
+    qjs_install_host_functions(ctx);
+    qjs_set_timer_callback(ctx, timer);
+    qjs_install_timer_functions(ctx);
+    qjs_install_console(ctx);
+    return ctx;
+}
+
+int main(void) {
+    printf("\n=== Lifecycle ===\n");
+    {
+        JSRuntime *rt = qjs_runtime_new();
+        check(rt != NULL, "runtime handle");
+        JSContext *ctx = qjs_context_new(rt);
+        check(ctx != NULL, "context handle");
+        check(eval_is(ctx, "1 + 2", "3"), "eval returns JSON");
+        check(eval_is(ctx, "throw new Error('say \"hi\"')",
+                      "{\"error\":\"Error: say \\\"hi\\\"\"}"),
+              "errors are escaped JSON");
+        check(qjs_eval_void(ctx, "globalThis.x = 1") == 0 &&
+                  qjs_eval_void(ctx, "(") == -1,
+              "eval_void status");
+        check(qjs_set_global_json(ctx, "cfg", "{\"a\":[1,2]}") == 0 &&
+                  qjs_set_global_json(ctx, "bad", "{") == -1,
+              "set_global_json status");
+        char *cfg = qjs_get_global_json(ctx, "cfg");
+        check(strcmp(cfg, "{\"a\":[1,2]}") == 0, "get_global_json round trip");
+        qjs_free_string(cfg);
+
+        qjs_context_free(ctx);
+        JSContext *other = qjs_context_new(rt);
+        check(eval_is(other, "typeof x", "\"undefined\""),
+              "runtime outlives a freed context");
+        // Contexts still alive are freed with the runtime
+        qjs_context_new(rt);
+        qjs_runtime_free(rt);
+        check(eval_is(NULL, "1", "{\"error\":\"Context not initialized\"}"),
+              "NULL context is rejected");
+    }
+
+    printf("\n=== Binary values ===\n");
+    {
+        JSRuntime *rt = qjs_runtime_new();
+        JSContext *ctx = qjs_context_new(rt);
+
+        const uint8_t scalars[] = {
+            WASM_VALUE_ARRAY, 6,
+            WASM_VALUE_INT32, 0xfe, 0xff, 0xff, 0xff,
+            WASM_VALUE_TRUE, WASM_VALUE_NULL, WASM_VALUE_UNDEFINED,
+            WASM_VALUE_UNDEFINED, // function
+            WASM_VALUE_STRING, 2, 0xc3, 0xa9,
+        };
+        check(result_is(ctx, eval_value(ctx, "[-2, true, null, undefined, () => 1, '\\u00e9']"),
+                        scalars, sizeof(scalars)),
+              "scalars, arrays and UTF-8 strings");
+
+        double sum = 0.1 + 0.2;
+        uint8_t number[9] = {WASM_VALUE_FLOAT64};
+        memcpy(number + 1, &sum, 8);
+        check(result_is(ctx, eval_value(ctx, "0.1 + 0.2"), number, sizeof(number)),
+              "doubles keep full precision");
+
+        const uint8_t object[] = {
+            WASM_VALUE_OBJECT, 2,
+            1, 'a', WASM_VALUE_BYTES, 2, 7, 8,
+            1, 'd', WASM_VALUE_STRING, 1, 'x',
+        };
+        check(result_is(ctx, eval_value(ctx, "({a: new Uint8Array([7, 8]).buffer,"
+                                             " d: {toJSON() { return 'x'; }}})"),
+                        object, sizeof(object)),
+              "objects, ArrayBuffers and toJSON");
+
+        const uint8_t error[] = {WASM_VALUE_ERROR, 8, 'E', 'r', 'r', 'o', 'r', ':', ' ', 'x'};
+        check(result_is(ctx, eval_value(ctx, "throw new Error('x')"), error, sizeof(error)),
+              "exceptions are encoded as ERROR");
+        int cyclic = eval_value(ctx, "var o = {}; o.o = o; o");
+        check(cyclic > 0 && qjs_result_buffer(ctx)[0] == WASM_VALUE_ERROR,
+              "cycles are reported as ERROR");
+
+        // Round trip through set_global_value
+        int length = eval_value(ctx, "({n: [1.5, 'two', {x: null}], __proto__: null})");
+        uint8_t copy[128];
+        memcpy(copy, qjs_result_buffer(ctx), length);
+        check(qjs_set_global_value(ctx, "copy", put_input(ctx, copy, length)) == 0 &&
+                  eval_is(ctx, "copy", "{\"n\":[1.5,\"two\",{\"x\":null}]}"),
+              "set_global_value decodes an encoded value");
+
+        const uint8_t proto[] = {
+            WASM_VALUE_OBJECT, 1,
+            9, '_', '_', 'p', 'r', 'o', 't', 'o', '_', '_', WASM_VALUE_INT32, 1, 0, 0, 0,
+        };
+        qjs_set_global_value(ctx, "proto", put_input(ctx, proto, sizeof(proto)));
+        check(eval_is(ctx, "Object.getPrototypeOf(proto) === Object.prototype && "
+                           "Object.keys(proto)[0] === '__proto__'", "true"),
+              "__proto__ keys are data, as in JSON.parse");
+
+        const uint8_t truncated[] = {WASM_VALUE_ARRAY, 2, WASM_VALUE_NULL};
+        const uint8_t trailing[] = {WASM_VALUE_NULL, WASM_VALUE_NULL};
+        const uint8_t huge[] = {WASM_VALUE_STRING, 0xff, 0xff, 0xff, 0xff, 0x0f};
+        check(qjs_set_global_value(ctx, "bad", put_input(ctx, truncated, sizeof(truncated))) == -1 &&
+                  qjs_set_global_value(ctx, "bad", put_input(ctx, trailing, sizeof(trailing))) == -1 &&
+                  qjs_set_global_value(ctx, "bad", put_input(ctx, huge, sizeof(huge))) == -1 &&
+                  eval_is(ctx, "typeof bad", "\"undefined\""),
+              "malformed values are rejected");
+
+        qjs_eval_void(ctx, "globalThis.big = 'x'.repeat(100000)");
+        check(qjs_get_global_value(ctx, "big") == 1 + 3 + 100000, "get_global_value");
+        const uint8_t *result = qjs_result_buffer(ctx);
+        eval_value(ctx, "1");
+        check(qjs_result_buffer(ctx) == result, "result buffer is reused");
+
+        qjs_runtime_free(rt);
+    }
+
+    printf("\n=== Guests in one runtime ===\n");
+    {
+        JSRuntime *rt = qjs_runtime_new();
+        JSContext *a = new_guest(rt, host_a, timer_a);
+        JSContext *b = new_guest(rt, host_b, timer_b);
+
+        qjs_eval_void(a, "globalThis.name = 'a'");
+        check(eval_is(b, "typeof name", "\"undefined\""), "globals are isolated");
+
+        qjs_eval_void(a, "__sendToHost('ev', {v: 1}); console.log('la')");
+        qjs_eval_void(b, "console.error('lb')");
+        check(strcmp(g_a.events, "ev={\"v\":1};console.log=la;") == 0 &&
+                  strcmp(g_b.events, "console.error=lb;") == 0,
+              "host callbacks are per context");
+
+        qjs_eval_void(a, "globalThis.fired = []; setTimeout(() => fired.push('a1'), 5);"
+                         "var t = setTimeout(() => fired.push('a2'), 7); clearTimeout(t)");
+        qjs_eval_void(b, "globalThis.fired = []; setTimeout(() => fired.push('b1'), 9)");
+        check(g_a.timer_count == 2 && g_a.timers[0] == ((1 << 16) | 5) &&
+                  g_b.timer_count == 1 && g_b.timers[0] == ((1 << 16) | 9),
+              "timer ids and callbacks are per context");
+
+        qjs_fire_timer(a, 1);
+        qjs_fire_timer(a, 2);
+        qjs_fire_timer(a, 1);
+        check(eval_is(a, "fired", "[\"a1\"]") && eval_is(b, "fired", "[]"),
+              "fire_timer runs one context's callback once");
+        qjs_fire_timer(b, 1);
+        check(eval_is(b, "fired", "[\"b1\"]"), "same timer id in another context");
+
+        qjs_eval_void(a, "Promise.resolve().then(() => fired.push('pa'))");
+        qjs_eval_void(b, "Promise.resolve().then(() => fired.push('pb'))");
+        check(qjs_execute_pending_jobs(rt) == 2, "runtime runs every context's jobs");
+
+        // A queued job keeps a freed context alive; its callbacks find no state
+        g_a.events[0] = '\0';
+        g_a.timer_count = 0;
+        qjs_eval_void(a, "Promise.resolve().then(() => { __sendToHost('late', 1);"
+                         " console.log('late'); clearTimeout(setTimeout(() => {}, 1)) })");
+        qjs_context_free(a);
+        check(qjs_execute_pending_jobs(rt) == 1 && g_a.events[0] == '\0' &&
+                  g_a.timer_count == 0,
+              "jobs of a freed context reach no callbacks");
+
+        qjs_runtime_free(rt);
+    }
+
+    printf("\n=== Guests in separate runtimes ===\n");
+    {
+        JSRuntime *rt1 = qjs_runtime_new();
+        JSRuntime *rt2 = qjs_runtime_new();
+        JSContext *a = qjs_context_new(rt1);
+        JSContext *b = qjs_context_new(rt2);
+        qjs_eval_void(a, "Promise.resolve().then(() => {})");
+        check(qjs_execute_pending_jobs(rt2) == 0 && qjs_execute_pending_jobs(rt1) == 1,
+              "job queues are per runtime");
+        size_t before = qjs_get_memory_usage(rt2);
+        qjs_eval_void(a, "globalThis.big = new Array(10000).fill(1)");
+        check(qjs_get_memory_usage(rt2) == before, "heaps are per runtime");
+        qjs_context_free(b);
+        qjs_runtime_free(rt2);
+        qjs_runtime_free(rt1);
+    }
+
+    printf("\n=== Memory per guest ===\n");
+    {
+        enum { GUESTS = 8 };
+        JSRuntime *rt = qjs_runtime_new();
+        size_t empty = qjs_get_memory_usage(rt);
+        JSContext *ctx = new_guest(rt, host_a, timer_a);
+        size_t first = qjs_get_memory_usage(rt);
+        for (int i = 1; i < GUESTS; i++) {
+            ctx = new_guest(rt, host_a, timer_a);
+        }
+        size_t all = qjs_get_memory_usage(rt);
+        size_t per_context = (all - first) / (GUESTS - 1);
+        check(per_context > 0 && per_context < first,
+              "an extra context costs less than a runtime with one");
+        (void)ctx;
+        qjs_runtime_free(rt);
+
+        printf("    runtime without contexts: %zu KB\n", empty / 1024);
+        printf("    guest with its own runtime: %zu KB\n", first / 1024);
+        printf("    additional guest in a shared runtime: %zu KB\n",
+               per_context / 1024);
+    }
+
+    printf("\n%d passed, %d failed\n", passed, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+/*
+ * Bootstrap bytecode compiler
+ *
+ * Build-time tool that compiles the sandbox bootstrap scripts to QuickJS
+ * bytecode and writes them as constexpr byte arrays to a header included
+ * by src/Bootstrap.cpp. Must be built from the same vendor QuickJS with the
+ * same options as the library.
+ *
+ * Usage: compile_bootstrap <out.h> [name=path#EXPORT ...]
+ *
+ * The console shim (src/ConsoleShim.h) is always included as "console".
+ * Each further entry reads the generated TypeScript module at `path` (a
+ * file of `export const NAME = <literal>;` declarations) and compiles the
+ * string exported as EXPORT, as the host would pass it to eval(). Missing
+ * files are skipped with a warning so the library builds outside the
+ * monorepo.
+ */
+
+#include "../src/Bootstrap.h"
+#include "../src/ConsoleShim.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Compiled {
+  std::string name;
+  std::string source;
+  std::vector<uint8_t> bytecode;
+};
+
+bool readFile(const std::string &path, std::string *out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  *out = buffer.str();
+  return true;
+}
+
+void printException(JSContext *ctx, const std::string &what) {
+  JSValue exception = JS_GetException(ctx);
+  const char *str = JS_ToCString(ctx, exception);
+  std::cerr << "compile_bootstrap: " << what << ": "
+            << (str ? str : "unknown error") << std::endl;
+  if (str)
+    JS_FreeCString(ctx, str);
+  JS_FreeValue(ctx, exception);
+}
+
+// Evaluate `export const A = ...;` declarations as global assignments and
+// return the string value of `exportName`
+bool extractExport(JSContext *ctx, const std::string &module,
+                   const std::string &exportName, std::string *out) {
+  std::string script;
+  script.reserve(module.size());
+  size_t pos = 0;
+  while (pos < module.size()) {
+    size_t lineEnd = module.find('\n', pos);
+    if (lineEnd == std::string::npos) {
+      lineEnd = module.size();
+    } else {
+      lineEnd++;
+    }
+    static const char kExport[] = "export const ";
+    if (module.compare(pos, sizeof(kExport) - 1, kExport) == 0) {
+      script += "globalThis.";
+      script.append(module, pos + sizeof(kExport) - 1,
+                    lineEnd - pos - (sizeof(kExport) - 1));
+    } else {
+      script.append(module, pos, lineEnd - pos);
+    }
+    pos = lineEnd;
+  }
+
+  JSValue result = JS_Eval(ctx, script.c_str(), script.size(), "<module>",
+                           JS_EVAL_TYPE_GLOBAL);
+  if (JS_IsException(result)) {
+    printException(ctx, "evaluating module");
+    return false;
+  }
+  JS_FreeValue(ctx, result);
+
+  JSValue global = JS_GetGlobalObject(ctx);
+  JSValue value = JS_GetPropertyStr(ctx, global, exportName.c_str());
+  JS_FreeValue(ctx, global);
+  if (!JS_IsString(value)) {
+    JS_FreeValue(ctx, value);
+    std::cerr << "compile_bootstrap: " << exportName << " is not a string"
+              << std::endl;
+    return false;
+  }
+  size_t length;
+  const char *str = JS_ToCStringLen(ctx, &length, value);
+  JS_FreeValue(ctx, value);
+  if (!str) {
+    return false;
+  }
+  out->assign(str, length);
+  JS_FreeCString(ctx, str);
+  return true;
+}
+
+bool compile(JSContext *ctx, Compiled &script, const char *filename) {
+  JSValue function =
+      JS_Eval(ctx, script.source.c_str(), script.source.size(), filename,
+              JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+  if (JS_IsException(function)) {
+    printException(ctx, "compiling " + script.name);
+    return false;
+  }
+  size_t size;
+  uint8_t *bytes =
+      JS_WriteObject(ctx, &size, function, JS_WRITE_OBJ_BYTECODE);
+  JS_FreeValue(ctx, function);
+  if (!bytes) {
+    printException(ctx, "serializing " + script.name);
+    return false;
+  }
+  script.bytecode.assign(bytes, bytes + size);
+  js_free(ctx, bytes);
+  return true;
+}
+
+std::string identifier(const std::string &name) {
+  std::string id = "kBootstrap_";
+  for (char c : name) {
+    id += (isalnum((unsigned char)c) ? c : '_');
+  }
+  return id;
+}
+
+bool writeHeader(const std::string &path,
+                 const std::vector<Compiled> &scripts) {
+  std::ostringstream out;
+  out << "// Generated by tools/compile_bootstrap.cpp - do not edit\n"
+      << "#pragma once\n\n"
+      << "namespace quickjs_sandbox {\n\n";
+  for (const Compiled &script : scripts) {
+    out << "static constexpr uint8_t " << identifier(script.name) << "[] = {";
+    for (size_t i = 0; i < script.bytecode.size(); i++) {
+      if (i % 16 == 0) {
+        out << "\n   ";
+      }
+      out << ' ' << (unsigned)script.bytecode[i] << ',';
+    }
+    out << "\n};\n\n";
+  }
+  out << "static constexpr BootstrapScript kBootstrapScripts[] = {\n";
+  for (const Compiled &script : scripts) {
+    char hash[32];
+    snprintf(hash, sizeof(hash), "0x%016llxULL",
+             (unsigned long long)quickjs_sandbox::hashBootstrapSource(script.source.data(),
+                                                     script.source.size()));
+    out << "    {\"" << script.name << "\", " << identifier(script.name)
+        << ", sizeof(" << identifier(script.name) << "), "
+        << script.source.size() << ", " << hash << "},\n";
+  }
+  out << "};\n\n"
+      << "static constexpr size_t kBootstrapScriptCount = " << scripts.size()
+      << ";\n\n"
+      << "} // namespace quickjs_sandbox\n";
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << out.str();
+  return file.good();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "usage: compile_bootstrap <out.h> [name=path#EXPORT ...]"
+              << std::endl;
+    return 2;
+  }
+
+  JSRuntime *rt = JS_NewRuntime();
+  std::vector<Compiled> scripts;
+  bool ok = true;
+
+  {
+    JSContext *ctx = JS_NewContext(rt);
+    Compiled console{"console", quickjs_sandbox::kConsoleShimSource, {}};
+    ok = compile(ctx, console, "<console>");
+    scripts.push_back(std::move(console));
+    JS_FreeContext(ctx);
+  }
+
+  for (int i = 2; ok && i < argc; i++) {
+    std::string spec = argv[i];
+    size_t eq = spec.find('=');
+    size_t hash = spec.rfind('#');
+    if (eq == std::string::npos || hash == std::string::npos || hash < eq) {
+      std::cerr << "compile_bootstrap: bad entry " << spec << std::endl;
+      ok = false;
+      break;
+    }
+    Compiled script;
+    script.name = spec.substr(0, eq);
+    std::string path = spec.substr(eq + 1, hash - eq - 1);
+    std::string exportName = spec.substr(hash + 1);
+
+    std::string module;
+    if (!readFile(path, &module)) {
+      std::cerr << "compile_bootstrap: skipping " << script.name << " ("
+                << path << " not found)" << std::endl;
+      continue;
+    }
+    // A fresh context per script, so modules cannot affect each other
+    JSContext *ctx = JS_NewContext(rt);
+    // eval() compiles host code as "<eval>"; keep stack traces identical
+    ok = extractExport(ctx, module, exportName, &script.source) &&
+         compile(ctx, script, "<eval>");
+    JS_FreeContext(ctx);
+    scripts.push_back(std::move(script));
+  }
+
+  JS_FreeRuntime(rt);
+  if (!ok || !writeHeader(argv[1], scripts)) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Headless Rill renderer
+ *
+ * Command line driver for rill::HeadlessHost: renders a guest bundle (as
+ * built by `rill build`) and prints the committed tree as compact JSON.
+ * With --repeat the bundle is rendered that many times on --threads
+ * workers and the throughput is reported on stderr.
+ *
+ * Usage: rill_headless [options] <bundle.js>
+ *   --props <json>        root props / useConfig() value (default {})
+ *   --props-file <path>   read the props from a file
+ *   --repeat <n>          render n times (default 1)
+ *   --threads <n>         worker threads for --repeat (default: cores)
+ *   --settle <ms>         virtual time timers may advance (default 0)
+ *   --runtime <path>      guest runtime JS instead of the embedded one
+ *   --stats               print render statistics to stderr
+ *   --log                 forward guest console output to stderr
+ *   --opcode-stats        render --repeat times on one thread and print the
+ *                         guest's opcode histogram (QUICKJS_OPCODE_STATS)
+ *   --profile             render --repeat times on one thread and print the
+ *                         guest's per-function calls and times
+ */
+
+#include "../src/HeadlessHost.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+bool readFile(const std::string &path, std::string *out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  *out = buffer.str();
+  return true;
+}
+
+int usage() {
+  std::cerr << "usage: rill_headless [--props json | --props-file path] "
+               "[--repeat n] [--threads n] [--settle ms] [--runtime path] "
+               "[--stats] [--log] [--opcode-stats] [--profile] "
+               "<bundle.js>"
+            << std::endl;
+  return 2;
+}
+
+void printStats(const rill::RenderResult &result) {
+  std::cerr << "batches=" << result.batches
+            << " operations=" << result.operations
+            << " nodes=" << result.nodes << " timers=" << result.timers
+            << " render_ms=" << result.renderMs << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string bundlePath;
+  std::string props = "{}";
+  size_t repeat = 1;
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  bool stats = false;
+  bool opcodeStats = false;
+  bool profile = false;
+  rill::HeadlessOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--props" && hasValue) {
+      props = argv[++i];
+    } else if (arg == "--props-file" && hasValue) {
+      if (!readFile(argv[++i], &props)) {
+        std::cerr << "rill_headless: cannot read " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg == "--repeat" && hasValue) {
+      repeat = std::max(1l, std::atol(argv[++i]));
+    } else if (arg == "--threads" && hasValue) {
+      threads = std::max(1l, std::atol(argv[++i]));
+    } else if (arg == "--settle" && hasValue) {
+      options.settleMs = std::atof(argv[++i]);
+    } else if (arg == "--runtime" && hasValue) {
+      if (!readFile(argv[++i], &options.guestRuntimeSource)) {
+        std::cerr << "rill_headless: cannot read " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg == "--stats") {
+      stats = true;
+    } else if (arg == "--opcode-stats") {
+      opcodeStats = true;
+    } else if (arg == "--profile") {
+      profile = true;
+    } else if (arg == "--log") {
+      options.onLog = [](const std::string &level, const std::string &text) {
+        std::cerr << "[guest:" << level << "] " << text << std::endl;
+      };
+    } else if (arg[0] == '-' || !bundlePath.empty()) {
+      return usage();
+    } else {
+      bundlePath = arg;
+    }
+  }
+  if (bundlePath.empty()) {
+    return usage();
+  }
+
+  auto bundle = std::make_shared<std::string>();
+  if (!readFile(bundlePath, bundle.get())) {
+    std::cerr << "rill_headless: cannot read " << bundlePath << std::endl;
+    return 1;
+  }
+
+  try {
+    if (repeat == 1 || opcodeStats || profile) {
+      rill::HeadlessHost host(options);
+      host.loadBundle(*bundle);
+      // Count the renders only, not the bundle load
+      host.resetOpcodeStats();
+      if (profile) {
+        host.setFunctionProfiling(true);
+      }
+      rill::RenderResult result;
+      for (size_t i = 0; i < repeat; i++) {
+        result = host.render(props);
+      }
+      std::cout << result.tree << std::endl;
+      if (stats) {
+        printStats(result);
+      }
+      if (opcodeStats) {
+        std::cerr << host.opcodeStats();
+      }
+      if (profile) {
+        std::cerr << host.functionProfile(50);
+      }
+      return 0;
+    }
+
+    rill::HeadlessHostPool pool(std::min(threads, repeat), options);
+    std::shared_ptr<const std::string> shared = bundle;
+    // Load the bundle on every worker before timing
+    std::vector<std::future<rill::RenderResult>> warmup;
+    for (size_t i = 0; i < pool.threads(); i++) {
+      warmup.push_back(pool.submit(shared, props));
+    }
+    for (auto &future : warmup) {
+      future.get();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<rill::RenderResult>> futures;
+    futures.reserve(repeat);
+    for (size_t i = 0; i < repeat; i++) {
+      futures.push_back(pool.submit(shared, props));
+    }
+    std::vector<double> times;
+    times.reserve(repeat);
+    rill::RenderResult first;
+    for (size_t i = 0; i < futures.size(); i++) {
+      rill::RenderResult result = futures[i].get();
+      times.push_back(result.renderMs);
+      if (i == 0) {
+        first = std::move(result);
+      }
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    std::sort(times.begin(), times.end());
+    std::cout << first.tree << std::endl;
+    if (stats) {
+      printStats(first);
+    }
+    std::cerr << "renders=" << repeat << " threads=" << pool.threads()
+              << " renders_per_s=" << (size_t)(repeat / seconds)
+              << " p50_ms=" << times[times.size() / 2]
+              << " p99_ms=" << times[times.size() * 99 / 100] << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << "rill_headless: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -535,6 +535,43 @@ describe('React Native APIs', () => {
       const result = StyleSheet.create(styles);
       expect(result).toEqual(styles);
     });
+
+    it('should keep created styles mutable without the conversion memo', async () => {
+      const { StyleSheet } = await sdkImport;
+      const result = StyleSheet.create({ badge: { opacity: 1 } });
+      expect(Object.isFrozen(result)).toBe(false);
+      result.badge.opacity = 0.5;
+      expect(result.badge.opacity).toBe(0.5);
+    });
+
+    it('should keep created styles mutable with the conversion memo alone', async () => {
+      const { StyleSheet } = await sdkImport;
+      const g = globalThis as Record<string, unknown>;
+      g.__rill_conversion_memo = true;
+      try {
+        const result = StyleSheet.create({ badge: { opacity: 1 } });
+        expect(Object.isFrozen(result)).toBe(false);
+        result.badge.opacity = 0.5;
+        expect(result.badge.opacity).toBe(0.5);
+      } finally {
+        delete g.__rill_conversion_memo;
+      }
+    });
+
+    it('should deep-freeze created styles when the host opted in', async () => {
+      const { StyleSheet } = await sdkImport;
+      const g = globalThis as Record<string, unknown>;
+      g.__rill_conversion_memo = true;
+      g.__rill_freeze_styles = true;
+      try {
+        const result = StyleSheet.create({ badge: { transform: [{ scale: 2 }] } });
+        expect(Object.isFrozen(result)).toBe(true);
+        expect(Object.isFrozen(result.badge.transform[0])).toBe(true);
+      } finally {
+        delete g.__rill_conversion_memo;
+        delete g.__rill_freeze_styles;
+      }
+    });
   });
 
   describe('Platform', () => {
@@ -201,6 +201,139 @@ describe('OperationCollector', () => {
       expect(receivedBatches[0].version).toBe(1);
     });
   });
+
+  describe('typed operations', () => {
+    it('should record the same operations as add', () => {
+      collector.create(1, 'View', { a: 1 });
+      collector.append(0, 1);
+      collector.insert(1, 2, 0);
+      collector.update(1, { a: 2 }, ['b']);
+      collector.remove(1, 2);
+      collector.delete(2);
+      collector.flush(sendToHost);
+
+      const ops = receivedBatches[0].operations.map(({ timestamp: _t, ...op }) => op);
+      expect(ops).toEqual([
+        { op: 'CREATE', id: 1, type: 'View', props: { a: 1 } },
+        { op: 'APPEND', id: 1, parentId: 0, childId: 1 },
+        { op: 'INSERT', id: 2, parentId: 1, childId: 2, index: 0 },
+        { op: 'UPDATE', id: 1, props: { a: 2 }, removedProps: ['b'] },
+        { op: 'REMOVE', id: 2, parentId: 1, childId: 2 },
+        { op: 'DELETE', id: 2 },
+      ]);
+    });
+  });
+
+  describe('native operation intrinsics', () => {
+    const names = [
+      'create',
+      'update',
+      'delete',
+      'append',
+      'insert',
+      'remove',
+      'push',
+      'pending',
+      'counts',
+      'commit',
+    ];
+    const g = globalThis as Record<string, unknown>;
+    let calls: [string, unknown[]][];
+
+    beforeEach(() => {
+      calls = [];
+      for (const name of names) {
+        g[`__rill_op_${name}`] = (...args: unknown[]) => {
+          calls.push([name, args]);
+          if (name === 'pending') return 2;
+          if (name === 'counts') return { CREATE: 1, REORDER: 1 };
+          return undefined;
+        };
+      }
+      collector = new OperationCollector();
+    });
+
+    afterEach(() => {
+      for (const name of names) delete g[`__rill_op_${name}`];
+      g.__rillOpArenaOwner = undefined;
+    });
+
+    it('should record through the intrinsics', () => {
+      const reorder = { op: 'REORDER' as const, id: 1, parentId: 1, childIds: [2] };
+      collector.create(1, 'View', {});
+      collector.add(reorder);
+
+      expect(calls).toEqual([
+        ['create', [1, 'View', {}]],
+        ['push', [reorder]],
+      ]);
+      expect(collector.pendingCount).toBe(2);
+    });
+
+    it('should commit natively on flush', () => {
+      collector.create(1, 'View', {});
+      collector.flush(sendToHost);
+
+      expect(calls.at(-1)).toEqual(['commit', [sendToHost, 1, 1]]);
+      expect(globalThis.__OP_COUNTS).toEqual({ CREATE: 1, REORDER: 1 });
+      expect(globalThis.__TOTAL_OPS).toBe(2);
+      expect(sendToHost).not.toHaveBeenCalled();
+    });
+  });
+
+  describe('native arena shared by roots', () => {
+    const g = globalThis as Record<string, unknown>;
+    // One arena per context, as in the sandbox
+    let arena: number[];
+
+    beforeEach(() => {
+      arena = [];
+      g.__rill_op_create = (id: number) => arena.push(id);
+      g.__rill_op_pending = () => arena.length;
+      g.__rill_op_counts = () => ({ CREATE: arena.length });
+      g.__rill_op_commit = (sink: SendToHost, version: number, batchId: number) => {
+        const operations = arena;
+        arena = [];
+        sink({ version, batchId, operations } as unknown as OperationBatch);
+        return operations.length;
+      };
+    });
+
+    afterEach(() => {
+      for (const name of ['create', 'pending', 'counts', 'commit']) {
+        delete g[`__rill_op_${name}`];
+      }
+      g.__rillOpArenaOwner = undefined;
+    });
+
+    it('should keep a second root out of the arena', () => {
+      const first = new OperationCollector();
+      const second = new OperationCollector();
+      const firstBatches: OperationBatch[] = [];
+      const secondBatches: OperationBatch[] = [];
+
+      first.create(1, 'View', {});
+      second.create(2, 'Text', {});
+      first.flush((batch) => firstBatches.push(batch));
+      second.flush((batch) => secondBatches.push(batch));
+
+      expect(firstBatches.map((b) => b.operations)).toEqual([[1]]);
+      expect(secondBatches.map((b) => b.operations.map((op) => op.id))).toEqual([[2]]);
+    });
+
+    it('should hand the arena on when released', () => {
+      const first = new OperationCollector();
+      const batches: OperationBatch[] = [];
+      first.create(1, 'View', {});
+      first.release((batch) => batches.push(batch));
+
+      // Pending ops are sent before the arena is given up
+      expect(batches.map((b) => b.operations)).toEqual([[1]]);
+      const next = new OperationCollector();
+      next.create(2, 'View', {});
+      expect(arena).toEqual([2]);
+    });
+  });
 });
 
 // ============ createReconciler tests ============
@@ -8,11 +8,7 @@
 import React from 'react';
 import Reconciler from 'react-reconciler';
 import { DefaultEventPriority } from 'react-reconciler/constants';
-import type {
-  SerializedCreateOperation,
-  SerializedUpdateOperation,
-  VNode,
-} from '../../../sdk/types';
+import type { VNode } from '../../../sdk/types';
 import type { CallbackRegistry, SendToHost } from '../../../shared';
 import { isDevToolsEnabled, type RenderTiming, sendDevToolsMessage } from './devtools';
 import { serializeProps } from './guest-encoder';
@@ -125,13 +121,7 @@ export function createReconciler(
 
       // Send serialized props to Host
       // Functions are now properly serialized with fnIds
-      const op: SerializedCreateOperation = {
-        op: 'CREATE',
-        id,
-        type,
-        props: serializedProps,
-      };
-      collector.add(op);
+      collector.create(id, type, serializedProps);
 
       // DevTools: record mount timing
       if (isDevToolsEnabled()) {
@@ -157,13 +147,7 @@ export function createReconciler(
         parent: null,
       };
 
-      const op: SerializedCreateOperation = {
-        op: 'CREATE',
-        id,
-        type: '__TEXT__',
-        props: { text },
-      };
-      collector.add(op);
+      collector.create(id, '__TEXT__', { text });
       return node;
     },
 
@@ -171,21 +155,21 @@ export function createReconciler(
       globalThis.__APPEND_CHILD_CALLED = Date.now();
       parent.children.push(child);
       child.parent = parent;
-      collector.add({ op: 'APPEND', id: child.id, parentId: parent.id, childId: child.id });
+      collector.append(parent.id, child.id);
     },
 
     appendInitialChild(parent: VNode, child: VNode): void {
       globalThis.__APPEND_INITIAL_CALLED = Date.now();
       parent.children.push(child);
       child.parent = parent;
-      collector.add({ op: 'APPEND', id: child.id, parentId: parent.id, childId: child.id });
+      collector.append(parent.id, child.id);
     },
 
     appendChildToContainer(container: RootContainer, child: VNode): void {
       globalThis.__APPEND_TO_CONTAINER_CALLED = Date.now();
       container.children.push(child);
       // parentId=0 signals root container on the host side
-      collector.add({ op: 'APPEND', id: child.id, parentId: 0, childId: child.id });
+      collector.append(0, child.id);
     },
 
     insertBefore(parent: VNode, child: VNode, beforeChild: VNode): void {
@@ -193,13 +177,7 @@ export function createReconciler(
       if (index !== -1) {
         parent.children.splice(index, 0, child);
         child.parent = parent;
-        collector.add({
-          op: 'INSERT',
-          id: child.id,
-          parentId: parent.id,
-          childId: child.id,
-          index,
-        });
+        collector.insert(parent.id, child.id, index);
       }
     },
 
@@ -208,7 +186,7 @@ export function createReconciler(
       if (index !== -1) {
         container.children.splice(index, 0, child);
         // parentId=0 signals root container on the host side
-        collector.add({ op: 'INSERT', id: child.id, parentId: 0, childId: child.id, index });
+        collector.insert(0, child.id, index);
       }
     },
 
@@ -217,7 +195,7 @@ export function createReconciler(
       if (index !== -1) {
         parent.children.splice(index, 1);
         child.parent = null;
-        collector.add({ op: 'REMOVE', id: child.id, parentId: parent.id, childId: child.id });
+        collector.remove(parent.id, child.id);
 
         // Store deleted root for cleanup after commit
         pendingDeleteRoots.set(child.id, child);
@@ -229,7 +207,7 @@ export function createReconciler(
       if (index !== -1) {
         container.children.splice(index, 1);
         // parentId=0 signals root container on the host side
-        collector.add({ op: 'REMOVE', id: child.id, parentId: 0, childId: child.id });
+        collector.remove(0, child.id);
 
         // Store deleted root for cleanup after commit
         pendingDeleteRoots.set(child.id, child);
@@ -276,13 +254,7 @@ export function createReconciler(
 
       const removedProps = getRemovedProps(oldProps, newProps);
 
-      const op: SerializedUpdateOperation = {
-        op: 'UPDATE',
-        id: instance.id,
-        props: serializedProps,
-        removedProps,
-      };
-      collector.add(op);
+      collector.update(instance.id, serializedProps, removedProps);
 
       // DevTools: record update timing
       if (isDevToolsEnabled()) {
@@ -298,13 +270,7 @@ export function createReconciler(
 
     commitTextUpdate(textInstance: VNode, _oldText: string, newText: string): void {
       textInstance.props = { text: newText };
-      const op: SerializedUpdateOperation = {
-        op: 'UPDATE',
-        id: textInstance.id,
-        props: { text: newText },
-        removedProps: [],
-      };
-      collector.add(op);
+      collector.update(textInstance.id, { text: newText }, []);
     },
 
     // ============ Container Methods ============
@@ -495,7 +461,7 @@ function collectDeleteOperations(node: VNode, collector: OperationCollector): vo
   }
 
   // Then delete this node
-  collector.add({ op: 'DELETE', id: node.id });
+  collector.delete(node.id);
 }
 
 /**
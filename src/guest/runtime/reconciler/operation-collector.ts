@@ -1,14 +1,72 @@
 /**
  * Operation Collector
  * Collects operations during render phase, sends all during commit phase
+ *
+ * In the QuickJS sandbox the operations are recorded by native intrinsics
+ * (`__rill_op_*`) into a per-context arena instead of as objects, and
+ * committed to the host as one batch. The arena is shared by the whole
+ * context, so only one collector (root) owns it at a time; the others
+ * collect in JS.
  */
 
-import type { SendToHost, SerializedOperation, SerializedOperationBatch } from '../../../sdk/types';
+import type {
+  SendToHost,
+  SerializedOperation,
+  SerializedOperationBatch,
+  SerializedValueObject,
+} from '../../../sdk/types';
+
+/**
+ * Native operation arena of the sandbox context (see QuickJSSandboxContext)
+ */
+interface NativeOperations {
+  create(id: number, type: string, props: SerializedValueObject): void;
+  update(id: number, props: SerializedValueObject, removedProps?: string[]): void;
+  delete(id: number): void;
+  append(parentId: number, childId: number): void;
+  insert(parentId: number, childId: number, index: number): void;
+  remove(parentId: number, childId: number): void;
+  push(op: SerializedOperation): void;
+  pending(): number;
+  counts(): Record<string, number>;
+  commit(sendToHost: SendToHost, version: number, batchId: number): number;
+}
+
+function getNativeOperations(): NativeOperations | null {
+  const g = globalThis as Record<string, unknown>;
+  if (typeof g.__rill_op_commit !== 'function') return null;
+  return {
+    create: g.__rill_op_create,
+    update: g.__rill_op_update,
+    delete: g.__rill_op_delete,
+    append: g.__rill_op_append,
+    insert: g.__rill_op_insert,
+    remove: g.__rill_op_remove,
+    push: g.__rill_op_push,
+    pending: g.__rill_op_pending,
+    counts: g.__rill_op_counts,
+    commit: g.__rill_op_commit,
+  } as NativeOperations;
+}
+
+/**
+ * Claim the context's arena for `owner`, or null when another collector
+ * holds it. Stored on globalThis like the reconciler map, so bundles that
+ * each load this module see the same owner.
+ */
+function claimNativeOperations(owner: OperationCollector): NativeOperations | null {
+  const g = globalThis as Record<string, unknown>;
+  if (g.__rillOpArenaOwner) return null;
+  const native = getNativeOperations();
+  if (native) g.__rillOpArenaOwner = owner;
+  return native;
+}
 
 export class OperationCollector {
   private operations: SerializedOperation[] = [];
   private batchId = 0;
   private version = 1;
+  private native = claimNativeOperations(this);
 
   private isDebugEnabled(): boolean {
     try {
@@ -22,43 +80,92 @@ export class OperationCollector {
    * Add operation
    */
   add(op: SerializedOperation): void {
-    this.operations.push({
-      ...op,
-      timestamp: Date.now(),
-    });
+    if (this.native) {
+      this.native.push(op);
+    } else {
+      this.operations.push({
+        ...op,
+        timestamp: Date.now(),
+      });
+    }
 
     // 调试：少量输出，便于确认是否有 CREATE/APPEND/UPDATE 被收集（默认关闭）
     if (this.isDebugEnabled()) {
-      const len = this.operations.length;
+      const len = this.pendingCount;
       if (len <= 10 || len % 50 === 0) {
         console.log('[rill:reconciler] add op', op.op, 'len', len);
       }
     }
   }
 
+  // Typed forms of add(): recorded without an op object when native
+
+  create(id: number, type: string, props: SerializedValueObject): void {
+    if (this.native) this.native.create(id, type, props);
+    else this.add({ op: 'CREATE', id, type, props });
+  }
+
+  update(id: number, props: SerializedValueObject, removedProps?: string[]): void {
+    if (this.native) this.native.update(id, props, removedProps);
+    else this.add({ op: 'UPDATE', id, props, removedProps });
+  }
+
+  delete(id: number): void {
+    if (this.native) this.native.delete(id);
+    else this.add({ op: 'DELETE', id });
+  }
+
+  /** parentId 0 is the root container */
+  append(parentId: number, childId: number): void {
+    if (this.native) this.native.append(parentId, childId);
+    else this.add({ op: 'APPEND', id: childId, parentId, childId });
+  }
+
+  insert(parentId: number, childId: number, index: number): void {
+    if (this.native) this.native.insert(parentId, childId, index);
+    else this.add({ op: 'INSERT', id: childId, parentId, childId, index });
+  }
+
+  remove(parentId: number, childId: number): void {
+    if (this.native) this.native.remove(parentId, childId);
+    else this.add({ op: 'REMOVE', id: childId, parentId, childId });
+  }
+
   /**
    * Flush and send all operations
    */
   flush(sendToHost: SendToHost): void {
-    if (this.operations.length === 0) {
+    const opLen = this.pendingCount;
+    if (opLen === 0) {
       if (this.isDebugEnabled()) {
         console.warn('[rill:reconciler] flush called with 0 ops');
       }
       return;
     }
 
-    const opLen = this.operations.length;
     const debug = this.isDebugEnabled();
     if (debug) console.log('[rill:reconciler] flush ops=', opLen);
 
     // Track operation counts using global variable for debugging
-    const opCounts: Record<string, number> = {};
-    this.operations.forEach((op) => {
-      opCounts[op.op] = (opCounts[op.op] || 0) + 1;
-    });
+    let opCounts: Record<string, number>;
+    if (this.native) {
+      opCounts = this.native.counts();
+    } else {
+      opCounts = {};
+      this.operations.forEach((op) => {
+        opCounts[op.op] = (opCounts[op.op] || 0) + 1;
+      });
+    }
     globalThis.__OP_COUNTS = opCounts;
     globalThis.__TOTAL_OPS = opLen;
 
+    // Committed in one native step; the ops are never guest objects
+    if (this.native) {
+      if (debug) console.log('[rill:reconciler] opCounts', JSON.stringify(opCounts));
+      this.native.commit(sendToHost, this.version, ++this.batchId);
+      return;
+    }
+
     // 避免刷屏/卡顿：默认不输出详细 ops（仅 debug 模式）
     if (debug) {
       try {
@@ -83,10 +190,22 @@ export class OperationCollector {
     sendToHost(batch);
   }
 
+  /**
+   * Give up the native arena (when the root is unmounted), sending what it
+   * still holds; later operations are collected in JS
+   */
+  release(sendToHost: SendToHost): void {
+    if (!this.native) return;
+    if (this.native.pending() > 0) this.flush(sendToHost);
+    this.native = null;
+    const g = globalThis as Record<string, unknown>;
+    if (g.__rillOpArenaOwner === this) g.__rillOpArenaOwner = undefined;
+  }
+
   /**
    * Get pending operation count
    */
   get pendingCount(): number {
-    return this.operations.length;
+    return this.native ? this.native.pending() : this.operations.length;
   }
 }
@@ -155,6 +155,7 @@ export function unmount(sendToHost?: SendToHost): void {
   const instance = reconcilerMap.get(sendToHost);
   if (instance) {
     instance.reconciler.updateContainer(null, instance.root, null, () => {});
+    instance.collector.release(sendToHost);
     // DO NOT clear the global callback registry here, as it's shared
     // instance.callbackRegistry.clear();
     reconcilerMap.delete(sendToHost);
@@ -165,8 +166,9 @@ export function unmount(sendToHost?: SendToHost): void {
  * Unmount all guest instances
  */
 export function unmountAll(): void {
-  reconcilerMap.forEach((instance) => {
+  reconcilerMap.forEach((instance, sendToHost) => {
     instance.reconciler.updateContainer(null, instance.root, null, () => {});
+    instance.collector.release(sendToHost);
     instance.callbackRegistry.clear();
   });
   reconcilerMap.clear();
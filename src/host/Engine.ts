@@ -20,7 +20,13 @@ declare global {
 import type { RuntimeCollector } from '../devtools/index';
 import { createRuntimeCollector } from '../devtools/index';
 import { GUEST_BUNDLE_CODE } from '../guest/build/bundle';
-import type { JSEngineContext, JSEngineProvider, JSEngineRuntime } from '../sandbox';
+import type {
+  BundleStream,
+  GuestTrace,
+  JSEngineContext,
+  JSEngineProvider,
+  JSEngineRuntime,
+} from '../sandbox';
 import type { RillHooksState, RillReconcilerGlobal } from '../sandbox/globals';
 import type {
   HostMessage as BridgeHostMessage,
@@ -89,6 +95,10 @@ export type {
 // Global engine counter for debugging
 let engineIdCounter = 0;
 
+function isBundleURL(source: string): boolean {
+  return source.startsWith('http://') || source.startsWith('https://');
+}
+
 export class Engine implements IEngine {
   private runtime: JSEngineRuntime | null = null;
   private context: JSEngineContext | null = null;
@@ -111,16 +121,23 @@ export class Engine implements IEngine {
     requireWhitelist: ReadonlySet<string>;
     onMetric?: (name: string, value: number, extra?: Record<string, unknown>) => void;
     receiverMaxBatchSize: number;
+    receiverTreeStore?: EngineOptions['receiverTreeStore'];
+    hostEventPolicies?: EngineOptions['hostEventPolicies'];
+    freezeStyles: boolean;
   };
   private destroyed = false;
   private loaded = false;
   private errorCount = 0;
   private lastErrorAt: number | null = null;
   private _timeoutTimer?: ReturnType<typeof setTimeout>;
+  // When the bundle fetch started (engine.fetchBundle covers headers and body)
+  private fetchStartedAt = 0;
 
   // Pause state
   private _isPaused = false;
   private _eventQueue: Array<{ eventName: string; payload?: unknown }> = [];
+  private _hostEventFlushScheduled = false;
+  private _hostEventsPending = false;
 
   // Unique engine ID (UUID-like format)
   public readonly id: string;
@@ -178,6 +195,9 @@ export class Engine implements IEngine {
       requireWhitelist: new Set(options.requireWhitelist ?? Array.from(defaultWhitelist)),
       onMetric: options.onMetric,
       receiverMaxBatchSize: options.receiverMaxBatchSize ?? 5000,
+      receiverTreeStore: options.receiverTreeStore,
+      hostEventPolicies: options.hostEventPolicies,
+      freezeStyles: options.freezeStyles ?? false,
     };
 
     this.registry = new ComponentRegistry();
@@ -300,10 +320,26 @@ export class Engine implements IEngine {
     this.config = initialProps ?? {};
 
     try {
-      // Get bundle code
-      const code = await this.resolveSource(source);
+      // Get bundle code. A bundle URL is fetched up to its headers here; its
+      // body is read after the sandbox is set up, streamed into it when the
+      // provider compiles while the bundle downloads
+      const response = isBundleURL(source) ? await this.fetchBundle(source) : null;
+      let code = response ? null : await this.resolveSource(source);
 
-      if (this.options.debug) {
+      // Initialize sandbox
+      await this.initializeRuntime();
+
+      const stream = response ? this.createBundleStream(response, source) : null;
+      let buffer: ArrayBuffer | null = null;
+      if (response && stream) {
+        await this.streamBundle(response, stream);
+      } else if (response && this.canEvalBuffer(response)) {
+        buffer = await this.readBundleBuffer(response);
+      } else if (response) {
+        code = await this.readBundle(response);
+      }
+
+      if (this.options.debug && code !== null) {
         this.options.logger.log(`[rill:${this.id}] Bundle loaded, length:`, code.length);
         this.options.logger.log(`[rill:${this.id}] Bundle preview:`, code.substring(0, 200));
         this.options.logger.log(
@@ -312,9 +348,12 @@ export class Engine implements IEngine {
         );
         this.options.logger.log(`[rill:${this.id}] Has Auto-render:`, code.includes('Auto-render'));
       }
-
-      // Initialize sandbox and execute
-      await this.initializeRuntime();
+      const execute = (): Promise<void> =>
+        stream
+          ? this.finishBundleStream(stream)
+          : buffer
+            ? this.executeBundleBuffer(buffer, source)
+            : this.executeBundle(code ?? '');
 
       // Update DevTools sandbox status
       this._devtools?.updateSandboxStatus({ state: 'running' });
@@ -357,7 +396,7 @@ export class Engine implements IEngine {
         });
 
         try {
-          await Promise.race([this.executeBundle(code), timeoutPromise]);
+          await Promise.race([execute(), timeoutPromise]);
         } finally {
           // Clean up timer if execution completed normally
           if (this._timeoutTimer) {
@@ -367,7 +406,7 @@ export class Engine implements IEngine {
         }
       } else {
         // No timeout protection available
-        await this.executeBundle(code);
+        await execute();
       }
 
       this.loaded = true;
@@ -395,25 +434,97 @@ export class Engine implements IEngine {
    */
   private async resolveSource(source: string): Promise<string> {
     const start = Date.now();
-    if (source.startsWith('http://') || source.startsWith('https://')) {
-      const s1 = Date.now();
-      const response = await fetch(source);
-      if (!response.ok) {
-        this.options.onMetric?.('engine.fetchBundle', Date.now() - s1, { status: response.status });
-        throw new Error(`Failed to fetch bundle: ${response.status}`);
-      }
-      const text = await response.text();
-      this.options.onMetric?.('engine.fetchBundle', Date.now() - s1, {
-        status: 200,
-        size: text.length,
-      });
-      this.options.onMetric?.('engine.resolveSource', Date.now() - start);
-      return text;
+    if (isBundleURL(source)) {
+      return this.readBundle(await this.fetchBundle(source));
     }
     this.options.onMetric?.('engine.resolveSource', Date.now() - start);
     return source;
   }
 
+  /**
+   * Fetch a bundle URL up to the response headers
+   */
+  private async fetchBundle(url: string): Promise<Response> {
+    const start = Date.now();
+    const response = await fetch(url);
+    if (!response.ok) {
+      this.options.onMetric?.('engine.fetchBundle', Date.now() - start, { status: response.status });
+      throw new Error(`Failed to fetch bundle: ${response.status}`);
+    }
+    this.fetchStartedAt = start;
+    return response;
+  }
+
+  /**
+   * Read a fetched bundle's body as text
+   */
+  private async readBundle(response: Response): Promise<string> {
+    const text = await response.text();
+    const dur = Date.now() - this.fetchStartedAt;
+    this.options.onMetric?.('engine.fetchBundle', dur, { status: 200, size: text.length });
+    this.options.onMetric?.('engine.resolveSource', dur);
+    return text;
+  }
+
+  /**
+   * Whether a fetched bundle can be handed to the provider as bytes, without
+   * decoding it into a string first
+   */
+  private canEvalBuffer(response: Response): boolean {
+    return !!this.context?.evalBuffer && typeof response.arrayBuffer === 'function';
+  }
+
+  /**
+   * Read a fetched bundle's body as bytes
+   */
+  private async readBundleBuffer(response: Response): Promise<ArrayBuffer> {
+    const buffer = await response.arrayBuffer();
+    const dur = Date.now() - this.fetchStartedAt;
+    this.options.onMetric?.('engine.fetchBundle', dur, { status: 200, size: buffer.byteLength });
+    this.options.onMetric?.('engine.resolveSource', dur);
+    return buffer;
+  }
+
+  /**
+   * Open a bundle stream for a fetched bundle, if the provider compiles while
+   * downloading and the body can be read in chunks
+   */
+  private createBundleStream(response: Response, url: string): BundleStream | null {
+    if (!this.context?.createBundleStream || typeof response.body?.getReader !== 'function') {
+      return null;
+    }
+    const length = Number(response.headers?.get('content-length'));
+    return this.context.createBundleStream(url, length > 0 ? length : undefined);
+  }
+
+  /**
+   * Download a fetched bundle's body into a bundle stream, which compiles it
+   * off the JS thread as the chunks arrive
+   */
+  private async streamBundle(response: Response, stream: BundleStream): Promise<void> {
+    const reader = (response.body as ReadableStream<Uint8Array>).getReader();
+    let size = 0;
+    try {
+      for (;;) {
+        const { done, value } = await reader.read();
+        if (done) break;
+        size += value.byteLength;
+        // Whole buffers are passed as they are; views are copied out
+        stream.append(
+          value.byteOffset === 0 && value.byteLength === value.buffer.byteLength
+            ? (value.buffer as ArrayBuffer)
+            : (value.slice().buffer as ArrayBuffer)
+        );
+      }
+    } catch (error) {
+      stream.cancel();
+      throw error;
+    }
+    const dur = Date.now() - this.fetchStartedAt;
+    this.options.onMetric?.('engine.fetchBundle', dur, { status: 200, size, streamed: true });
+    this.options.onMetric?.('engine.resolveSource', dur);
+  }
+
   /**
    * Initialize QuickJS runtime using the provided QuickJS provider
    */
@@ -429,6 +540,15 @@ export class Engine implements IEngine {
     this.runtime = await this.options.provider.createRuntime();
     if (debug) logger.log(`[rill:${this.id}] initializeRuntime: runtime created`);
     this.context = this.runtime.createContext();
+    if (this.options.hostEventPolicies && this.context.setHostEventPolicy) {
+      for (const [eventName, policy] of Object.entries(this.options.hostEventPolicies)) {
+        this.context.setHostEventPolicy(eventName, policy);
+      }
+    }
+    if (this.options.freezeStyles) {
+      // Read by StyleSheet.create() in the guest SDK
+      this.context.setGlobal('__rill_freeze_styles', true);
+    }
     if (debug) {
       logger.log(`[rill:${this.id}] initializeRuntime: context created, creating BridgeV2...`);
     }
@@ -836,8 +956,13 @@ export class Engine implements IEngine {
     this.sendToHostFn = sendToHost;
 
     // Inject __sendToHost for Guest code
-    // Bridge.sendToHost handles all serialization via TypeRules
-    this.context.setGlobal('__sendToHost', sendToHost);
+    // Bridge.sendToHost handles all serialization via TypeRules.
+    // Providers with native coalescing drop redundant ops before conversion.
+    if (this.context.setOperationSink) {
+      this.context.setOperationSink('__sendToHost', sendToHost as (batch: unknown) => void);
+    } else {
+      this.context.setGlobal('__sendToHost', sendToHost);
+    }
 
     // __sendOperation: Send a single operation directly to Host (bypasses batching)
     // Used by Remote Ref for immediate REF_CALL delivery
@@ -930,17 +1055,7 @@ export class Engine implements IEngine {
       }
 
       // Record guest event via DiagnosticsCollector
-      const payloadBytes =
-        payload === undefined
-          ? 0
-          : (() => {
-              try {
-                return JSON.stringify(payload).length;
-              } catch {
-                return undefined;
-              }
-            })();
-      this.diagnostics.recordGuestEvent(eventName, payloadBytes);
+      this.diagnostics.recordGuestEvent(eventName, this.estimatePayloadBytes(payload));
 
       // Special convention: Guest reports its sleep state (used with HOST_VISIBILITY)
       if (eventName === 'GUEST_SLEEP_STATE' && payload && typeof payload === 'object') {
@@ -1052,6 +1167,27 @@ export class Engine implements IEngine {
     }
   }
 
+  /**
+   * Execute a streamed bundle: wait for the rest of its compile and run it
+   */
+  private async finishBundleStream(stream: BundleStream): Promise<void> {
+    const start = Date.now();
+    try {
+      stream.finish();
+    } catch (error) {
+      this.options.logger.error('[rill] Bundle execution error:', error);
+      const err = error instanceof Error ? error : new Error(String(error));
+      throw new ExecutionError(err.message);
+    }
+    const stats = stream.getStats();
+    this.options.onMetric?.('engine.executeBundle', Date.now() - start, {
+      size: stats.bytes,
+      streamed: stats.streamed,
+      compileMs: stats.compileMs,
+      waitMs: stats.waitMs,
+    });
+  }
+
   /**
    * Execute bundle code in sandbox
    */
@@ -1072,6 +1208,26 @@ export class Engine implements IEngine {
     }
   }
 
+  /**
+   * Execute a fetched bundle from its bytes, named by its URL in stack traces
+   */
+  private async executeBundleBuffer(buffer: ArrayBuffer, sourceURL: string): Promise<void> {
+    const start = Date.now();
+    if (!this.context?.evalBuffer) {
+      throw new Error('[rill] Context not initialized');
+    }
+
+    try {
+      this.context.evalBuffer(buffer, sourceURL);
+      const dur = Date.now() - start;
+      this.options.onMetric?.('engine.executeBundle', dur, { size: buffer.byteLength });
+    } catch (error) {
+      this.options.logger.error('[rill] Bundle execution error:', error);
+      const err = error instanceof Error ? error : new Error(String(error));
+      throw new ExecutionError(err.message);
+    }
+  }
+
   /**
    * Send message to sandbox
    *
@@ -1080,6 +1236,9 @@ export class Engine implements IEngine {
   async sendToSandbox(message: HostMessage): Promise<void> {
     if (this.destroyed || !this.bridge) return;
 
+    // Keep host -> guest order: queued host events were sent earlier
+    if (this._hostEventsPending) this.flushHostEvents();
+
     const start = Date.now();
     await this.bridge.sendToGuest(message);
     const duration = Date.now() - start;
@@ -1156,6 +1315,15 @@ export class Engine implements IEngine {
    */
   // Reason: Event payload can be any serializable type
   sendEvent(eventName: string, payload?: unknown): void {
+    // With a native host event queue, every event is queued while paused so
+    // the ones with a coalescing policy keep coalescing in order with the
+    // rest; resume() flushes them
+    if (this._isPaused && this.hasHostEventQueue()) {
+      this.recordHostEvent(eventName, payload);
+      this.queueHostEvent(eventName, payload);
+      return;
+    }
+
     // If paused, queue the event for later
     if (this._isPaused) {
       this._eventQueue.push({ eventName, payload });
@@ -1174,22 +1342,15 @@ export class Engine implements IEngine {
    * Internal method to actually send an event
    */
   private _sendEventInternal(eventName: string, payload?: unknown): void {
-    // Record host event via DiagnosticsCollector
-    const payloadBytes =
-      payload === undefined
-        ? 0
-        : (() => {
-            try {
-              return JSON.stringify(payload).length;
-            } catch {
-              return undefined;
-            }
-          })();
-    this.diagnostics.recordHostEvent(eventName, payloadBytes);
+    this.recordHostEvent(eventName, payload);
 
-    // Record to DevTools
-    this._devtools?.recordHostEvent(eventName, payload);
+    if (this.usesHostEventQueue(eventName)) {
+      this.queueHostEvent(eventName, payload);
+      this.scheduleHostEventFlush();
+      return;
+    }
 
+    // sendToSandbox() delivers queued events first
     void this.sendToSandbox({
       type: 'HOST_EVENT',
       eventName,
@@ -1197,6 +1358,86 @@ export class Engine implements IEngine {
     });
   }
 
+  /**
+   * Record a host event for diagnostics and DevTools
+   */
+  private recordHostEvent(eventName: string, payload?: unknown): void {
+    // Record host event via DiagnosticsCollector
+    this.diagnostics.recordHostEvent(eventName, this.estimatePayloadBytes(payload));
+
+    // Record to DevTools
+    this._devtools?.recordHostEvent(eventName, payload);
+  }
+
+  /**
+   * Whether host events can be coalesced in the provider's native queue
+   */
+  private hasHostEventQueue(): boolean {
+    return (
+      this.options.hostEventPolicies !== undefined &&
+      typeof this.context?.queueHostEvent === 'function' &&
+      typeof this.context.flushHostEvents === 'function'
+    );
+  }
+
+  /**
+   * Whether an event goes through the provider's native host event queue
+   */
+  private usesHostEventQueue(eventName: string): boolean {
+    return this.options.hostEventPolicies?.[eventName] !== undefined && this.hasHostEventQueue();
+  }
+
+  /**
+   * Queue a host event natively, its payload encoded by the Bridge as for
+   * sendToSandbox()
+   */
+  private queueHostEvent(eventName: string, payload?: unknown): void {
+    const value = (payload ?? null) as BridgeValue;
+    this.context!.queueHostEvent!(eventName, this.bridge ? this.bridge.toGuestValue(value) : value);
+    this._hostEventsPending = true;
+  }
+
+  /**
+   * Flush the native host event queue once the current task is done, so a
+   * burst of events is coalesced and delivered in one call
+   */
+  private scheduleHostEventFlush(): void {
+    if (this._hostEventFlushScheduled) return;
+    this._hostEventFlushScheduled = true;
+    queueMicrotask(() => {
+      this._hostEventFlushScheduled = false;
+      if (this._hostEventsPending) this.flushHostEvents();
+    });
+  }
+
+  private flushHostEvents(): void {
+    if (this.destroyed || this._isPaused || !this.context?.flushHostEvents) return;
+
+    this._hostEventsPending = false;
+    const start = Date.now();
+    try {
+      const delivered = this.context.flushHostEvents('__handleHostEvent');
+      this.options.onMetric?.('bridge.flushHostEvents', Date.now() - start, { delivered });
+    } catch (e) {
+      this.options.logger.error(`[rill:${this.id}] flushHostEvents error:`, e);
+    }
+  }
+
+  /**
+   * Approximate serialized size of an event payload for diagnostics.
+   * Uses the provider's native estimator when available (free for payloads the
+   * guest just sent), otherwise JSON.stringify. Returns undefined if unserializable.
+   */
+  private estimatePayloadBytes(payload: unknown): number | undefined {
+    if (payload === undefined) return 0;
+    try {
+      if (this.context?.estimateSize) return this.context.estimateSize(payload).bytes;
+      return JSON.stringify(payload).length;
+    } catch {
+      return undefined;
+    }
+  }
+
   /**
    * Update configuration
    */
@@ -1222,6 +1463,7 @@ export class Engine implements IEngine {
       {
         onMetric: this.options.onMetric,
         maxBatchSize: this.options.receiverMaxBatchSize,
+        treeStore: this.options.receiverTreeStore,
         // Use Bridge's releaseCallback for proper Host/Guest routing
         releaseCallback: (fnId) => this.bridge?.releaseCallback(fnId),
       }
@@ -1302,7 +1544,9 @@ export class Engine implements IEngine {
     // Resume all timers (continue from remaining time)
     this.timerManager.resume();
 
-    // Flush queued events
+    // Flush queued events, the natively queued ones first (only one of the
+    // two queues is used while paused)
+    if (this._hostEventsPending) this.flushHostEvents();
     const queuedEvents = this._eventQueue.splice(0);
     if (queuedEvents.length > 0 && this.options.debug) {
       this.options.logger.log(`[rill:${this.id}] Flushing ${queuedEvents.length} queued events`);
@@ -1545,6 +1789,14 @@ export class Engine implements IEngine {
 
   getDiagnostics(): EngineDiagnostics {
     // Delegate to DiagnosticsCollector
-    return this.diagnostics.getDiagnostics(this.receiver, () => this.getResourceStats());
+    return this.diagnostics.getDiagnostics(
+      this.receiver,
+      () => this.getResourceStats(),
+      () => this.context?.getBoundaryStats?.() ?? null
+    );
+  }
+
+  drainGuestTrace(maxEntries?: number): GuestTrace | null {
+    return this.context?.drainTrace?.(maxEntries) ?? null;
   }
 }
@@ -5,6 +5,7 @@
  * Create a new Engine for each isolated execution context needed.
  */
 
+import type { BoundaryStats, GuestTrace } from '../sandbox';
 import type { Receiver, ReceiverStats } from './receiver';
 import type { ComponentMap, ComponentRegistry } from './registry';
 import type { BridgeValueObject, OperationBatch } from './types';
@@ -198,6 +199,11 @@ export interface EngineDiagnostics {
     sleeping: boolean | null;
     sleepingAt: number | null;
   };
+  /**
+   * Values, bytes and call latency across the sandbox boundary, null when
+   * the provider does not report them
+   */
+  boundary: BoundaryStats | null;
 }
 
 /**
@@ -298,6 +304,13 @@ export interface IEngine {
    */
   getDiagnostics(): EngineDiagnostics;
 
+  /**
+   * Take the guest's performance.mark/measure and console.time entries
+   * recorded since the last drain; null when the provider does not record
+   * them
+   */
+  drainGuestTrace(maxEntries?: number): GuestTrace | null;
+
   /**
    * Set maximum number of listeners per event before warning
    * @param n - Maximum listener count (default: 10)
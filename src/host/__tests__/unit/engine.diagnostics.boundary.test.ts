@@ -0,0 +1,84 @@
+import { describe, expect, it } from 'bun:test';
+import { Engine } from '../../engine';
+import type {
+  BoundaryStats,
+  JSEngineContext,
+  JSEngineProvider,
+  JSEngineRuntime,
+} from '../../../sandbox';
+import { createMockJSEngineProvider } from '../test-utils';
+
+const latency = (count: number) => ({
+  count,
+  totalMs: count,
+  p50Ms: 1,
+  p90Ms: 1,
+  p99Ms: 1,
+  maxMs: 1,
+});
+
+const direction = (crossings: number) => ({
+  crossings,
+  values: crossings,
+  objects: 0,
+  strings: 0,
+  bytes: 0,
+  functions: 0,
+  conversion: latency(crossings),
+});
+
+// Mock provider whose contexts report boundary stats like the native module
+function createBoundaryProvider() {
+  const base = createMockJSEngineProvider();
+  let calls = 0;
+  const provider: JSEngineProvider = {
+    createRuntime() {
+      const runtime = base.createRuntime() as JSEngineRuntime;
+      return {
+        ...runtime,
+        createContext(): JSEngineContext {
+          const ctx = runtime.createContext();
+          return {
+            ...ctx,
+            getBoundaryStats: (): BoundaryStats => {
+              calls++;
+              return {
+                toGuest: direction(3),
+                toHost: direction(2),
+                functionsReleased: 0,
+                hostCalls: latency(2),
+                guestCalls: latency(0),
+              };
+            },
+          };
+        },
+      };
+    },
+  };
+  return { provider, getCalls: () => calls };
+}
+
+describe('Engine diagnostics - boundary', () => {
+  it('reports the context boundary stats', async () => {
+    const { provider, getCalls } = createBoundaryProvider();
+    const engine = new Engine({ provider, debug: false });
+    await engine.loadBundle('globalThis.__ok = 1;');
+
+    const d = engine.getDiagnostics();
+    expect(getCalls()).toBe(1);
+    expect(d.boundary?.toGuest.crossings).toBe(3);
+    expect(d.boundary?.hostCalls.count).toBe(2);
+
+    engine.destroy();
+  });
+
+  it('is null when the provider does not report boundary stats', async () => {
+    const engine = new Engine({ provider: createMockJSEngineProvider(), debug: false });
+    expect(engine.getDiagnostics().boundary).toBeNull();
+
+    await engine.loadBundle('globalThis.__ok = 1;');
+    expect(engine.getDiagnostics().boundary).toBeNull();
+
+    engine.destroy();
+  });
+});
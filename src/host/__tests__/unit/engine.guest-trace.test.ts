@@ -0,0 +1,70 @@
+import { describe, expect, it } from 'bun:test';
+import { Engine } from '../../engine';
+import type {
+  GuestTrace,
+  JSEngineContext,
+  JSEngineProvider,
+  JSEngineRuntime,
+} from '../../../sandbox';
+import { createMockJSEngineProvider } from '../test-utils';
+
+// Mock provider whose contexts hand out a recorded trace once, like the native module
+function createTraceProvider() {
+  const base = createMockJSEngineProvider();
+  const requested: Array<number | undefined> = [];
+  let pending: GuestTrace = {
+    names: ['render'],
+    name: [0, 0],
+    kind: [0, 1],
+    startTime: [1.5, 1.5],
+    duration: [0, 2.25],
+  };
+  const provider: JSEngineProvider = {
+    createRuntime() {
+      const runtime = base.createRuntime() as JSEngineRuntime;
+      return {
+        ...runtime,
+        createContext(): JSEngineContext {
+          const ctx = runtime.createContext();
+          return {
+            ...ctx,
+            drainTrace: (maxEntries?: number): GuestTrace => {
+              requested.push(maxEntries);
+              const trace = pending;
+              pending = { names: [], name: [], kind: [], startTime: [], duration: [] };
+              return trace;
+            },
+          };
+        },
+      };
+    },
+  };
+  return { provider, requested };
+}
+
+describe('Engine guest trace', () => {
+  it('drains the context trace buffer', async () => {
+    const { provider, requested } = createTraceProvider();
+    const engine = new Engine({ provider, debug: false });
+    await engine.loadBundle('globalThis.__ok = 1;');
+
+    const trace = engine.drainGuestTrace(100);
+    expect(requested).toEqual([100]);
+    expect(trace?.names).toEqual(['render']);
+    expect(trace?.kind).toEqual([0, 1]);
+    expect(trace?.duration[1]).toBe(2.25);
+    expect(engine.drainGuestTrace()?.name).toEqual([]);
+
+    engine.destroy();
+  });
+
+  it('is null when the provider does not record a trace', async () => {
+    const engine = new Engine({ provider: createMockJSEngineProvider(), debug: false });
+    expect(engine.drainGuestTrace()).toBeNull();
+
+    await engine.loadBundle('globalThis.__ok = 1;');
+    expect(engine.drainGuestTrace()).toBeNull();
+
+    engine.destroy();
+  });
+});
@@ -0,0 +1,180 @@
+import { describe, expect, it } from 'bun:test';
+import { Engine } from '../../engine';
+import type {
+  HostEventPolicy,
+  JSEngineContext,
+  JSEngineProvider,
+  JSEngineRuntime,
+} from '../../../sandbox';
+import { createMockJSEngineProvider } from '../test-utils';
+
+// Mock provider whose contexts queue host events like the native queue
+// (latest-wins only) and record how they were flushed
+function createQueueingProvider() {
+  const base = createMockJSEngineProvider();
+  const flushes: number[] = [];
+  const queued: string[] = [];
+  const policies: Record<string, HostEventPolicy> = {};
+  const provider: JSEngineProvider = {
+    createRuntime() {
+      const runtime = base.createRuntime() as JSEngineRuntime;
+      return {
+        ...runtime,
+        createContext(): JSEngineContext {
+          const ctx = runtime.createContext();
+          let pending: Array<[string, unknown]> = [];
+          return {
+            ...ctx,
+            setHostEventPolicy: (name, policy) => {
+              policies[name] = policy;
+            },
+            queueHostEvent: (name, payload) => {
+              queued.push(name);
+              if (policies[name] === 'latest') pending = pending.filter(([n]) => n !== name);
+              pending.push([name, payload]);
+              return pending.length;
+            },
+            flushHostEvents: (handler) => {
+              const fn = ctx.getGlobal(handler) as (name: string, payload: unknown) => void;
+              const events = pending;
+              pending = [];
+              for (const [name, payload] of events) fn(name, payload);
+              flushes.push(events.length);
+              return events.length;
+            },
+          };
+        },
+      };
+    },
+  };
+  return { provider, flushes, queued, policies };
+}
+
+const BUNDLE = `
+  globalThis.__SEEN = [];
+  globalThis.__useHostEvent('scroll', (p) => globalThis.__SEEN.push('scroll:' + p.y));
+  globalThis.__useHostEvent('press', (p) => globalThis.__SEEN.push('press:' + p.id));
+`;
+
+const tick = () => new Promise((resolve) => setTimeout(resolve, 20));
+
+describe('Engine host event queue', () => {
+  it('coalesces events with a policy and flushes them once per tick', async () => {
+    const { provider, flushes, queued, policies } = createQueueingProvider();
+    const engine = new Engine({ provider, hostEventPolicies: { scroll: 'latest' } });
+    await engine.loadBundle(BUNDLE);
+    expect(policies).toEqual({ scroll: 'latest' });
+
+    engine.sendEvent('scroll', { y: 1 });
+    engine.sendEvent('scroll', { y: 2 });
+    engine.sendEvent('scroll', { y: 3 });
+    engine.sendEvent('press', { id: 1 });
+    await tick();
+
+    expect(queued).toEqual(['scroll', 'scroll', 'scroll']);
+    expect(flushes).toEqual([1]);
+    expect(engine.context?.getGlobal('__SEEN')).toEqual(['scroll:3', 'press:1']);
+    expect(engine.getDiagnostics().host.lastEventName).toBe('press');
+
+    engine.destroy();
+  });
+
+  it('keeps events with and without a policy in order', async () => {
+    const { provider, flushes } = createQueueingProvider();
+    const engine = new Engine({ provider, hostEventPolicies: { scroll: 'latest' } });
+    await engine.loadBundle(BUNDLE);
+
+    engine.sendEvent('scroll', { y: 1 });
+    engine.sendEvent('press', { id: 1 });
+    engine.sendEvent('scroll', { y: 2 });
+    engine.sendEvent('scroll', { y: 3 });
+    engine.sendEvent('press', { id: 2 });
+    engine.sendEvent('scroll', { y: 4 });
+    await tick();
+    expect(engine.context?.getGlobal('__SEEN')).toEqual([
+      'scroll:1',
+      'press:1',
+      'scroll:3',
+      'press:2',
+      'scroll:4',
+    ]);
+    expect(flushes).toEqual([1, 1, 1]);
+
+    engine.pause();
+    engine.sendEvent('scroll', { y: 5 });
+    engine.sendEvent('press', { id: 3 });
+    engine.sendEvent('scroll', { y: 6 });
+    engine.sendEvent('press', { id: 4 });
+    engine.resume();
+    await tick();
+    expect((engine.context?.getGlobal('__SEEN') as string[]).slice(5)).toEqual([
+      'press:3',
+      'scroll:6',
+      'press:4',
+    ]);
+
+    engine.destroy();
+  });
+
+  it('encodes queued payloads like sent ones', async () => {
+    const { provider } = createQueueingProvider();
+    const engine = new Engine({ provider, hostEventPolicies: { scroll: 'latest' } });
+    await engine.loadBundle(`
+      globalThis.__PAYLOADS = [];
+      globalThis.__useHostEvent('scroll', (p) => globalThis.__PAYLOADS.push(p));
+      globalThis.__useHostEvent('press', (p) => globalThis.__PAYLOADS.push(p));
+    `);
+
+    const onScroll = () => 'scrolled';
+    const onPress = () => 'pressed';
+    engine.sendEvent('scroll', { y: 1, at: new Date(0), cb: onScroll });
+    engine.sendEvent('press', { id: 1, at: new Date(0), cb: onPress });
+    engine.sendEvent('scroll');
+    await tick();
+
+    const [scroll, press, empty] = engine.context?.getGlobal('__PAYLOADS') as Array<
+      Record<string, unknown> | null
+    >;
+    expect(scroll!.cb === onScroll).toBe(press!.cb === onPress);
+    expect(typeof scroll!.cb).toBe(typeof press!.cb);
+    expect(scroll!.at instanceof Date).toBe(press!.at instanceof Date);
+    expect(empty).toBe(null);
+
+    engine.destroy();
+  });
+
+  it('keeps coalescing while paused and flushes on resume', async () => {
+    const { provider, flushes } = createQueueingProvider();
+    const engine = new Engine({ provider, hostEventPolicies: { scroll: 'latest' } });
+    await engine.loadBundle(BUNDLE);
+
+    engine.pause();
+    engine.sendEvent('scroll', { y: 1 });
+    engine.sendEvent('scroll', { y: 2 });
+    await tick();
+    expect(flushes).toEqual([]);
+
+    engine.resume();
+    await tick();
+    expect(flushes).toEqual([1]);
+    expect(engine.context?.getGlobal('__SEEN')).toEqual(['scroll:2']);
+
+    engine.destroy();
+  });
+
+  it('sends events one by one without policies', async () => {
+    const { provider, flushes, queued } = createQueueingProvider();
+    const engine = new Engine({ provider });
+    await engine.loadBundle(BUNDLE);
+
+    engine.sendEvent('scroll', { y: 1 });
+    engine.sendEvent('scroll', { y: 2 });
+    await tick();
+
+    expect(queued).toEqual([]);
+    expect(flushes).toEqual([]);
+    expect(engine.context?.getGlobal('__SEEN')).toEqual(['scroll:1', 'scroll:2']);
+
+    engine.destroy();
+  });
+});
@@ -5,6 +5,7 @@
 import { afterEach, beforeEach, describe, expect, it, mock } from 'bun:test';
 import React from 'react';
 import { Engine } from '../../engine';
+import type { JSEngineContext, JSEngineProvider, JSEngineRuntime } from '../../../sandbox';
 import { createMockJSEngineProvider } from '../test-utils';
 
 // Mock components
@@ -95,6 +96,117 @@ describe('Engine', () => {
       expect(engine.isLoaded).toBe(true);
     });
 
+    it('should stream a fetched bundle into providers that compile while downloading', async () => {
+      // The mock stream collects the chunks and evaluates them on finish
+      const appended: number[] = [];
+      const base = createMockJSEngineProvider();
+      const provider: JSEngineProvider = {
+        createRuntime() {
+          const runtime = base.createRuntime() as JSEngineRuntime;
+          return {
+            ...runtime,
+            createContext(): JSEngineContext {
+              const ctx = runtime.createContext();
+              return {
+                ...ctx,
+                createBundleStream: () => {
+                  let source = '';
+                  return {
+                    append: (chunk) => {
+                      const bytes = new Uint8Array(chunk as ArrayBuffer);
+                      appended.push(bytes.length);
+                      source += new TextDecoder().decode(bytes);
+                    },
+                    finish: () => ctx.eval(source),
+                    cancel: () => {},
+                    getStats: () => ({
+                      bytes: source.length,
+                      chunks: appended.length,
+                      compileMs: 0,
+                      waitMs: 0,
+                      streamed: true,
+                    }),
+                  };
+                },
+              };
+            },
+          };
+        },
+      };
+      const chunks = ['globalThis.__STREAMED = ', '"yes";'].map((text) => new TextEncoder().encode(text));
+      mockFetch.mockResolvedValueOnce({
+        ok: true,
+        status: 200,
+        headers: new Headers(),
+        body: new ReadableStream<Uint8Array>({
+          start(controller) {
+            for (const chunk of chunks) controller.enqueue(chunk);
+            controller.close();
+          },
+        }),
+        text: () => Promise.reject(new Error('body was streamed')),
+      });
+      const metrics: Array<[string, Record<string, unknown> | undefined]> = [];
+      const streaming = new Engine({
+        quickjs: provider,
+        onMetric: (name, _value, extra) => metrics.push([name, extra]),
+      });
+
+      await streaming.loadBundle('https://example.com/guest.js');
+
+      expect(streaming.isLoaded).toBe(true);
+      expect(appended).toEqual([24, 6]);
+      expect(metrics.find(([name]) => name === 'engine.executeBundle')?.[1]).toMatchObject({
+        streamed: true,
+      });
+      streaming.destroy();
+    });
+
+    it('should hand a fetched bundle to providers that evaluate buffers as bytes', async () => {
+      const evaluated: Array<[number, string | undefined]> = [];
+      const base = createMockJSEngineProvider();
+      const provider: JSEngineProvider = {
+        createRuntime() {
+          const runtime = base.createRuntime() as JSEngineRuntime;
+          return {
+            ...runtime,
+            createContext(): JSEngineContext {
+              const ctx = runtime.createContext();
+              return {
+                ...ctx,
+                evalBuffer: (source, sourceURL) => {
+                  evaluated.push([source.byteLength, sourceURL]);
+                  return ctx.eval(new TextDecoder().decode(new Uint8Array(source)));
+                },
+              };
+            },
+          };
+        },
+      };
+      const bytes = new TextEncoder().encode('globalThis.__FROM_BUFFER = "yes";\n');
+      mockFetch.mockResolvedValueOnce({
+        ok: true,
+        status: 200,
+        headers: new Headers(),
+        arrayBuffer: () => Promise.resolve(bytes.buffer),
+        text: () => Promise.reject(new Error('body was read as bytes')),
+      });
+      const metrics: Array<[string, Record<string, unknown> | undefined]> = [];
+      const buffered = new Engine({
+        quickjs: provider,
+        onMetric: (name, _value, extra) => metrics.push([name, extra]),
+      });
+
+      await buffered.loadBundle('https://example.com/guest.js');
+
+      expect(buffered.isLoaded).toBe(true);
+      expect(evaluated).toEqual([[bytes.byteLength, 'https://example.com/guest.js']]);
+      expect(metrics.find(([name]) => name === 'engine.executeBundle')?.[1]).toMatchObject({
+        size: bytes.byteLength,
+      });
+      buffered.destroy();
+    });
+
     it('should accept code string directly', async () => {
       const bundleCode = `console.log('Direct code');`;
 
@@ -115,6 +227,16 @@ describe('Engine', () => {
       expect(engine.isLoaded).toBe(true);
     });
 
+    it('should only opt guests into frozen styles with freezeStyles', async () => {
+      await engine.loadBundle('globalThis.__FREEZE = globalThis.__rill_freeze_styles === true;');
+      expect(engine.context?.getGlobal('__FREEZE')).toBe(false);
+
+      const frozen = new Engine({ quickjs: createMockJSEngineProvider(), freezeStyles: true });
+      await frozen.loadBundle('globalThis.__FREEZE = globalThis.__rill_freeze_styles === true;');
+      expect(frozen.context?.getGlobal('__FREEZE')).toBe(true);
+      frozen.destroy();
+    });
+
     it('should throw error when fetching fails', async () => {
       mockFetch.mockResolvedValueOnce({
         ok: false,
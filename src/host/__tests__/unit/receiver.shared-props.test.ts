@@ -0,0 +1,43 @@
+import { describe, expect, it } from 'bun:test';
+import { Receiver } from '../../receiver';
+import { ComponentRegistry } from '../../registry';
+
+function makeReceiver() {
+  const registry = new ComponentRegistry();
+  return new Receiver(
+    // biome-ignore lint/suspicious/noExplicitAny: Test helper uses minimal registry
+    registry as any,
+    () => {},
+    () => {},
+    { debug: false }
+  );
+}
+
+// The QuickJS conversion memo hands out one host copy per frozen guest
+// object, so several operations (and nodes) can share a props object
+describe('Receiver - shared props', () => {
+  it('should not mutate props shared through the conversion memo', () => {
+    const r = makeReceiver();
+    const shared = Object.freeze({ text: 'a', color: 'red', testID: 'row' });
+
+    const stats = r.applyBatch({
+      version: 1,
+      batchId: 1,
+      operations: [
+        { op: 'CREATE', id: 1, type: '__TEXT__', props: shared },
+        { op: 'CREATE', id: 2, type: '__TEXT__', props: shared },
+        { op: 'APPEND', parentId: 0, childId: 1 },
+        { op: 'APPEND', parentId: 0, childId: 2 },
+        { op: 'TEXT', id: 1, text: 'b' },
+        { op: 'UPDATE', id: 2, props: shared, removedProps: ['testID'] },
+      ],
+      // biome-ignore lint/suspicious/noExplicitAny: Test batch with dynamic structure
+    } as any);
+
+    expect(stats.failed).toBe(0);
+    const node = (id: number) => r.getNodes().find((n) => n.id === id)!;
+    expect(node(1).props).toEqual({ text: 'b', color: 'red', testID: 'row' });
+    expect(node(2).props).toEqual({ text: 'a', color: 'red' });
+    expect(shared).toEqual({ text: 'a', color: 'red', testID: 'row' });
+  });
+});
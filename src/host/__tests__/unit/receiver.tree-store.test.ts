@@ -0,0 +1,194 @@
+import { describe, expect, it, spyOn } from 'bun:test';
+import { Receiver } from '../../receiver';
+import type { ReceiverTreeStore, TreeStoreBatchResult } from '../../receiver';
+import { ComponentRegistry } from '../../registry';
+
+function makeStore(results: Array<TreeStoreBatchResult | Error>, children: Record<number, number[]>) {
+  const calls: Array<{ ops: string[]; count?: number }> = [];
+  let cleared = 0;
+  const store: ReceiverTreeStore = {
+    applyBatch(operations, count) {
+      calls.push({ ops: (operations as Array<{ op: string }>).map((o) => o.op), count });
+      const result = results.shift()!;
+      if (result instanceof Error) throw result;
+      return result;
+    },
+    getChildren: (id) => children[id] ?? [],
+    clear: () => {
+      cleared++;
+    },
+  };
+  return { store, calls, cleared: () => cleared };
+}
+
+function makeReceiver(
+  treeStore: ReceiverTreeStore,
+  released: string[],
+  maxBatchSize?: number,
+  onMetric?: (name: string, value: number) => void
+) {
+  const registry = new ComponentRegistry();
+  return new Receiver(
+    // biome-ignore lint/suspicious/noExplicitAny: Test helper uses minimal registry
+    registry as any,
+    () => {},
+    () => {},
+    { treeStore, maxBatchSize, onMetric, releaseCallback: (fnId) => released.push(fnId) }
+  );
+}
+
+const emptyResult = (): TreeStoreBatchResult => ({
+  dirty: [],
+  childrenChanged: [],
+  deleted: [],
+  applied: 0,
+  ignored: 0,
+});
+
+describe('Receiver - tree store', () => {
+  it('delegates structure operations and copies back changed child lists', () => {
+    const { store, calls } = makeStore(
+      [{ ...emptyResult(), dirty: [0, 1, 2], childrenChanged: [0, 1], applied: 2 }],
+      { 0: [1], 1: [2] }
+    );
+    const r = makeReceiver(store, []);
+    const stats = r.applyBatch({
+      version: 1,
+      batchId: 1,
+      operations: [
+        { op: 'CREATE', id: 1, type: 'View', props: {} },
+        { op: 'CREATE', id: 2, type: 'Text', props: {} },
+        { op: 'APPEND', id: 2, parentId: 1, childId: 2 },
+        { op: 'APPEND', id: 1, parentId: 0, childId: 1 },
+      ],
+      // biome-ignore lint/suspicious/noExplicitAny: Test batch with dynamic structure
+    } as any);
+
+    expect(stats.applied).toBe(4);
+    expect(calls).toEqual([{ ops: ['CREATE', 'CREATE', 'APPEND', 'APPEND'], count: 4 }]);
+    expect(r.getNodes().find((n) => n.id === 1)?.children).toEqual([2]);
+    expect(r.getStats().rootChildrenCount).toBe(1);
+    expect(r.getLastDirtyNodeIds()).toEqual([0, 1, 2]);
+  });
+
+  it('releases nodes the store deleted', () => {
+    const { store } = makeStore(
+      [
+        { ...emptyResult(), childrenChanged: [0], applied: 1 },
+        { ...emptyResult(), childrenChanged: [0], deleted: [1, 2], applied: 1 },
+      ],
+      { 0: [] }
+    );
+    const released: string[] = [];
+    const r = makeReceiver(store, released);
+    const fnIds = new Set(['fn_1']);
+    r.applyBatch({
+      version: 1,
+      batchId: 1,
+      operations: [
+        { op: 'CREATE', id: 1, type: 'View', props: {} },
+        { op: 'CREATE', id: 2, type: 'View', props: {}, _fnIds: fnIds },
+        { op: 'APPEND', id: 1, parentId: 0, childId: 1 },
+      ],
+      // biome-ignore lint/suspicious/noExplicitAny: Test batch with dynamic structure
+    } as any);
+    r.applyBatch({
+      version: 1,
+      batchId: 2,
+      operations: [{ op: 'DELETE', id: 1 }],
+      // biome-ignore lint/suspicious/noExplicitAny: Test batch with dynamic structure
+    } as any);
+
+    expect(r.nodeCount).toBe(0);
+    expect(released).toEqual(['fn_1']);
+  });
+
+  it('passes the processed operation count when the batch is truncated', () => {
+    const { store, calls, cleared } = makeStore([emptyResult()], {});
+    const r = makeReceiver(store, [], 2);
+    const stats = r.applyBatch({
+      version: 1,
+      batchId: 1,
+      operations: [
+        { op: 'CREATE', id: 1, type: 'View', props: {} },
+        { op: 'CREATE', id: 2, type: 'View', props: {} },
+        { op: 'APPEND', id: 1, parentId: 0, childId: 1 },
+      ],
+      // biome-ignore lint/suspicious/noExplicitAny: Test batch with dynamic structure
+    } as any);
+
+    expect(stats.skipped).toBe(1);
+    expect(calls[0]?.count).toBe(2);
+    r.clear();
+    expect(cleared()).toBe(1);
+  });
+
+  it('counts structure operations from the store result', () => {
+    const { store } = makeStore([{ ...emptyResult(), applied: 1, ignored: 2 }], {});
+    const r = makeReceiver(store, []);
+    const stats = r.applyBatch({
+      version: 1,
+      batchId: 1,
+      operations: [
+        { op: 'CREATE', id: 1, type: 'View', props: {} },
+        { op: 'APPEND', id: 1, parentId: 0, childId: 1 },
+        { op: 'APPEND', id: 9, parentId: 8, childId: 9 },
+        { op: 'REMOVE', id: 9, parentId: 8, childId: 9 },
+      ],
+      // biome-ignore lint/suspicious/noExplicitAny: Test batch with dynamic structure
+    } as any);
+
+    expect(stats.applied).toBe(2);
+    expect(stats.failed).toBe(2);
+  });
+
+  it('applies structure operations in JS after the store fails', () => {
+    const { store, calls, cleared } = makeStore(
+      [{ ...emptyResult(), childrenChanged: [0, 1], applied: 2 }, new Error('store failed')],
+      { 0: [1], 1: [2] }
+    );
+    const metrics: string[] = [];
+    const r = makeReceiver(store, [], undefined, (name) => metrics.push(name));
+    r.applyBatch({
+      version: 1,
+      batchId: 1,
+      operations: [
+        { op: 'CREATE', id: 1, type: 'View', props: {} },
+        { op: 'CREATE', id: 2, type: 'View', props: {} },
+        { op: 'APPEND', id: 2, parentId: 1, childId: 2 },
+        { op: 'APPEND', id: 1, parentId: 0, childId: 1 },
+      ],
+      // biome-ignore lint/suspicious/noExplicitAny: Test batch with dynamic structure
+    } as any);
+
+    const warnSpy = spyOn(console, 'warn').mockImplementation(() => {});
+    const stats = r.applyBatch({
+      version: 1,
+      batchId: 2,
+      operations: [
+        { op: 'CREATE', id: 3, type: 'View', props: {} },
+        { op: 'APPEND', id: 3, parentId: 1, childId: 3 },
+        { op: 'APPEND', id: 2, parentId: 1, childId: 2 },
+        { op: 'REMOVE', id: 2, parentId: 1, childId: 2 },
+      ],
+      // biome-ignore lint/suspicious/noExplicitAny: Test batch with dynamic structure
+    } as any);
+    warnSpy.mockRestore();
+
+    expect(stats.applied).toBe(4);
+    expect(stats.failed).toBe(0);
+    expect(cleared()).toBe(1);
+    expect(metrics).toContain('receiver.treeStoreFailed');
+    expect(r.getNodes().find((n) => n.id === 1)?.children).toEqual([3]);
+    expect(r.getLastDirtyNodeIds()).toEqual([]);
+
+    r.applyBatch({
+      version: 1,
+      batchId: 3,
+      operations: [{ op: 'APPEND', id: 2, parentId: 1, childId: 2 }],
+      // biome-ignore lint/suspicious/noExplicitAny: Test batch with dynamic structure
+    } as any);
+    expect(calls.length).toBe(2);
+    expect(r.getNodes().find((n) => n.id === 1)?.children).toEqual([3, 2]);
+  });
+});
@@ -4,6 +4,7 @@
  * Tracks performance metrics, activity timeline, and resource usage
  */
 
+import type { BoundaryStats } from '../../sandbox';
 import type {
   EngineActivityTimeline,
   EngineActivityTimelinePoint,
@@ -173,7 +174,8 @@ export class DiagnosticsCollector {
    */
   getDiagnostics(
     receiver: Receiver | null,
-    getResourceStats: () => { timers: number; nodes: number; callbacks: number }
+    getResourceStats: () => { timers: number; nodes: number; callbacks: number },
+    getBoundaryStats?: () => BoundaryStats | null
   ): EngineDiagnostics {
     const now = Date.now();
     const cutoff = now - this.activityWindowMs;
@@ -227,6 +229,7 @@ export class DiagnosticsCollector {
         sleeping: this.guestSleeping,
         sleepingAt: this.guestSleepingAt,
       },
+      boundary: getBoundaryStats?.() ?? null,
     };
   }
 
@@ -3,7 +3,8 @@
  */
 
 import type { RuntimeCollectorConfig } from '../../devtools/runtime';
-import type { JSEngineProvider } from '../../sandbox';
+import type { HostEventPolicy, JSEngineProvider } from '../../sandbox';
+import type { ReceiverTreeStore } from '../receiver/types';
 
 /**
  * Engine configuration options
@@ -73,6 +74,31 @@ export interface EngineOptions {
    */
   receiverMaxBatchSize?: number;
 
+  /**
+   * Native tree store used by the Receiver for structure operations,
+   * e.g. `getQuickJSModule()?.createTreeStore()`. Owned by the caller and
+   * cleared with the Receiver.
+   */
+  receiverTreeStore?: ReceiverTreeStore;
+
+  /**
+   * Coalescing policies for high-frequency host events, by event name,
+   * e.g. `{ scroll: 'latest', pan: 'accumulate' }`. With a provider that
+   * queues host events natively, these events are queued, coalesced while
+   * the guest is busy or the engine is paused, and delivered together once
+   * per tick. Other events (and all events with other providers) are sent
+   * one by one after the queued ones, so events arrive in the order sent.
+   */
+  hostEventPolicies?: Record<string, HostEventPolicy>;
+
+  /**
+   * Deep-freeze the styles guest code passes to `StyleSheet.create()` so a
+   * sandbox with a conversion memo (QuickJS) converts them once instead of
+   * on every render. Guest code can no longer modify those style objects.
+   * @default false
+   */
+  freezeStyles?: boolean;
+
   /**
    * Diagnostics parameters (for Host-side Task Manager/Resource Monitor)
    */
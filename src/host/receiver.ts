@@ -11,6 +11,7 @@ import {
   type ReceiverCallbackRegistry,
   type ReceiverOptions,
   type ReceiverStats,
+  type ReceiverTreeStore,
   type SendToSandbox,
   safeQueueMicrotask,
 } from './receiver/types';
@@ -33,7 +34,9 @@ export type {
   ReceiverAttributionWorstKind,
   ReceiverOptions,
   ReceiverStats,
+  ReceiverTreeStore,
   SendToSandbox,
+  TreeStoreBatchResult,
 } from './receiver/types';
 
 /**
@@ -57,6 +60,9 @@ export class Receiver {
   private registry: ComponentRegistry;
   private callbackRegistry?: ReceiverCallbackRegistry;
   private releaseCallback?: (fnId: string) => void;
+  // Native structure (optional): children arrays are copied back after each batch
+  private treeStore?: ReceiverTreeStore;
+  private lastDirtyNodeIds: number[] = [];
   private sendToSandbox: SendToSandbox;
   private onUpdate: () => void;
   private updateScheduled = false;
@@ -82,6 +88,15 @@ export class Receiver {
     [];
   private static readonly DEBUG_APPEND_TRACK_LIMIT = 1000;
 
+  // Operations executed by the tree store instead of the JS handlers
+  private static readonly TREE_STORE_OPS: ReadonlySet<OperationType> = new Set<OperationType>([
+    'APPEND',
+    'INSERT',
+    'REMOVE',
+    'REORDER',
+    'DELETE',
+  ]);
+
   // 操作处理器映射表 - 类型驱动自动分发
   private readonly operationHandlers: Record<
     OperationType,
@@ -103,6 +118,7 @@ export class Receiver {
     this.registry = registry;
     this.callbackRegistry = options?.callbackRegistry;
     this.releaseCallback = options?.releaseCallback;
+    this.treeStore = options?.treeStore;
     this.sendToSandbox = sendToSandbox;
     this.onUpdate = onUpdate;
     this.opts = {
@@ -151,6 +167,9 @@ export class Receiver {
     const start = Date.now();
     const nodesBefore = this.nodeMap.size;
     const limit = this.opts.maxBatchSize;
+    const treeStore = this.treeStore;
+    const delegated: Operation[] = [];
+    let processed = batch.operations.length;
     let applied = 0;
     let skipped = 0;
     let failed = 0;
@@ -204,7 +223,7 @@ export class Receiver {
         .map(([type, ops]) => ({ type, ops }));
 
     for (let i = 0; i < batch.operations.length; i++) {
-      if (applied >= limit) {
+      if (applied + delegated.length >= limit) {
         // Record skipped op distribution and attribution (for backpressure diagnosis)
         for (let j = i; j < batch.operations.length; j++) {
           const op = batch.operations[j];
@@ -213,14 +232,20 @@ export class Receiver {
           for (const t of getTouchedTypes(op)) incMap(skippedNodeTypeCounts, t);
         }
         skipped += batch.operations.length - i;
+        processed = i;
         break;
       }
       const op = batch.operations[i];
       if (!op) continue;
       try {
         const touchedTypes = getTouchedTypes(op);
-        this.applyOperation(op);
-        applied++;
+        if (treeStore && Receiver.TREE_STORE_OPS.has(op.op)) {
+          // Counted from the store's result
+          delegated.push(op);
+        } else {
+          this.applyOperation(op);
+          applied++;
+        }
         incRecord(opCounts, op.op);
         for (const t of touchedTypes) incMap(nodeTypeCounts, t);
       } catch (_e) {
@@ -228,6 +253,22 @@ export class Receiver {
         // continue applying remaining operations
       }
     }
+    if (treeStore) {
+      const result = this.applyTreeStore(treeStore, batch.operations, processed);
+      if (result) {
+        applied += result.applied;
+        failed += result.ignored;
+      } else {
+        for (const op of delegated) {
+          try {
+            this.applyOperation(op);
+            applied++;
+          } catch (_e) {
+            failed++;
+          }
+        }
+      }
+    }
     this.opts.onMetric?.('receiver.applyBatch', Date.now() - start, {
       applied,
       skipped,
@@ -279,6 +320,76 @@ export class Receiver {
     return applyStats;
   }
 
+  /**
+   * Run the structure operations of a batch in the tree store, then drop the
+   * deleted nodes and copy back the child lists of the parents it changed.
+   * Returns undefined if the store failed and was detached.
+   */
+  private applyTreeStore(
+    treeStore: ReceiverTreeStore,
+    operations: readonly Operation[],
+    count: number
+  ): TreeStoreBatchResult | undefined {
+    let result: TreeStoreBatchResult;
+    try {
+      result = treeStore.applyBatch(operations, count);
+    } catch (e) {
+      console.warn('[rill] Tree store applyBatch failed, applying structure operations in JS:', e);
+      this.opts.onMetric?.('receiver.treeStoreFailed', 1);
+      this.detachTreeStore(treeStore);
+      return undefined;
+    }
+
+    for (const id of result.deleted) {
+      this.releaseNode(id);
+    }
+    for (const id of result.childrenChanged) {
+      if (id === 0) {
+        this.rootChildren = treeStore.getChildren(0);
+      } else {
+        const node = this.nodeMap.get(id);
+        if (node) node.children = treeStore.getChildren(id);
+      }
+    }
+    this.lastDirtyNodeIds = result.dirty;
+    return result;
+  }
+
+  /**
+   * Stop using a tree store that may have applied only part of a batch. The JS
+   * child lists still hold the state before the batch, so the indexes the JS
+   * handlers use are rebuilt from them and the batch is replayed in JS.
+   */
+  private detachTreeStore(treeStore: ReceiverTreeStore): void {
+    this.treeStore = undefined;
+    this.lastDirtyNodeIds = [];
+    try {
+      treeStore.clear();
+    } catch {
+      // The store is no longer used
+    }
+    this.rootChildrenSet = new Set(this.rootChildren);
+    this.nodeChildrenSet.clear();
+    this.parentByChildId.clear();
+    for (const childId of this.rootChildren) {
+      this.parentByChildId.set(childId, 0);
+    }
+    for (const [id, node] of this.nodeMap) {
+      this.nodeChildrenSet.set(id, new Set(node.children));
+      for (const childId of node.children) {
+        this.parentByChildId.set(childId, id);
+      }
+    }
+  }
+
+  /**
+   * Node ids created, updated or re-parented by the last batch (0 is the root).
+   * Only tracked when a tree store is configured; empty otherwise.
+   */
+  getLastDirtyNodeIds(): readonly number[] {
+    return this.lastDirtyNodeIds;
+  }
+
   /**
    * Schedule update (debounced)
    */
@@ -556,6 +667,16 @@ export class Receiver {
       this.deleteNodeRecursive(childId);
     }
 
+    this.releaseNode(id);
+  }
+
+  /**
+   * Release a node's callbacks and ref and drop it (children are not visited)
+   */
+  private releaseNode(id: number): void {
+    const node = this.nodeMap.get(id);
+    if (!node) return;
+
     // Release function references for this node
     if (node.registeredFnIds) {
       for (const fnId of node.registeredFnIds) {
@@ -618,7 +739,8 @@ export class Receiver {
   private handleText(op: Extract<Operation, { op: 'TEXT' }>): void {
     const node = this.nodeMap.get(op.id);
     if (node) {
-      node.props.text = op.text;
+      // Props may be a host copy shared with other nodes (conversion memo)
+      node.props = { ...node.props, text: op.text };
     }
   }
 
@@ -812,6 +934,8 @@ export class Receiver {
    * Clear all nodes
    */
   clear(): void {
+    this.treeStore?.clear();
+    this.lastDirtyNodeIds = [];
     this.nodeMap.clear();
     this.rootChildren = [];
     this.rootChildrenSet.clear();
@@ -55,6 +55,32 @@ export type SendToSandbox = (message: HostMessage) => void | Promise<void>;
  */
 export type ReceiverCallbackRegistry = Pick<CallbackRegistry, 'release'>;
 
+/**
+ * Result of NodeTreeStore.applyBatch()
+ */
+export interface TreeStoreBatchResult {
+  /** Created/updated nodes and parents whose children changed (0 is the root) */
+  dirty: number[];
+  /** Parents whose child list changed (0 is the root) */
+  childrenChanged: number[];
+  /** Nodes deleted by this batch (including descendants) and not re-created */
+  deleted: number[];
+  /** Structure operations applied */
+  applied: number;
+  /** Structure operations on unknown nodes, or that would create a cycle */
+  ignored: number;
+}
+
+/**
+ * Native node tree (e.g. `__QuickJSSandboxJSI.createTreeStore()`) that runs
+ * the structure operations (APPEND/INSERT/REMOVE/REORDER/DELETE) for the Receiver
+ */
+export interface ReceiverTreeStore {
+  applyBatch(operations: readonly unknown[], count?: number): TreeStoreBatchResult;
+  getChildren(id: number): number[];
+  clear(): void;
+}
+
 // ============================================
 // Options
 // ============================================
@@ -88,6 +114,13 @@ export interface ReceiverOptions {
    * @default 200
    */
   attributionMaxSamples?: number;
+  /**
+   * Native tree store for structure operations. When set, the Receiver keeps
+   * props in JS and copies child lists back only for the parents a batch changed.
+   * Structure operations the store ignores are counted as failed. If the store
+   * throws, the Receiver drops it and applies structure operations in JS.
+   */
+  treeStore?: ReceiverTreeStore;
 }
 
 // ============================================
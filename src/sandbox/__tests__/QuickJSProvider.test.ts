@@ -5,6 +5,10 @@ const mockContext = {
   eval: mock((code: string) => `result: ${code}`),
   setGlobal: mock((_name: string, _value: unknown) => {}),
   getGlobal: mock((name: string) => `global:${name}`),
+  estimateSize: mock((_value: unknown) => ({ bytes: 7, objects: 1, strings: 1 })),
+  setOperationSink: mock((_name: string, _fn: (batch: unknown) => void) => {}),
+  openMessageRing: mock((_name: string, _capacityBytes?: number) => {}),
+  drainMessages: mock((_maxMessages?: number): unknown[] => [{ type: 'a' }]),
   dispose: mock(() => {}),
 };
 
@@ -32,6 +36,10 @@ describe('QuickJSProvider', () => {
     mockContext.eval.mockClear();
     mockContext.setGlobal.mockClear();
     mockContext.getGlobal.mockClear();
+    mockContext.estimateSize.mockClear();
+    mockContext.setOperationSink.mockClear();
+    mockContext.openMessageRing.mockClear();
+    mockContext.drainMessages.mockClear();
     mockContext.dispose.mockClear();
     mockRuntime.createContext.mockClear();
     mockRuntime.dispose.mockClear();
@@ -72,6 +80,16 @@ describe('QuickJSProvider', () => {
       expect(mockModule.createRuntime).toHaveBeenCalledWith(undefined);
     });
 
+    it('should pass conversionMemoSize option', () => {
+      const provider = new QuickJSProvider({ timeout: 3000, conversionMemoSize: 0 });
+      provider.createRuntime();
+
+      expect(mockModule.createRuntime).toHaveBeenCalledWith({
+        timeout: 3000,
+        conversionMemoSize: 0,
+      });
+    });
+
     it('should return runtime with createContext and dispose', () => {
       const provider = new QuickJSProvider();
       const runtime = provider.createRuntime();
@@ -114,6 +132,42 @@ describe('QuickJSProvider', () => {
       expect(result).toBe('global:myVar');
     });
 
+    it('should call native estimateSize', () => {
+      const provider = new QuickJSProvider();
+      const runtime = provider.createRuntime();
+      const context = runtime.createContext();
+      const payload = { a: 'x' };
+
+      const result = context.estimateSize?.(payload);
+
+      expect(mockContext.estimateSize).toHaveBeenCalledWith(payload);
+      expect(result).toEqual({ bytes: 7, objects: 1, strings: 1 });
+    });
+
+    it('should call native setOperationSink', () => {
+      const provider = new QuickJSProvider();
+      const runtime = provider.createRuntime();
+      const context = runtime.createContext();
+      const sink = () => {};
+
+      context.setOperationSink?.('__sendToHost', sink);
+
+      expect(mockContext.setOperationSink).toHaveBeenCalledWith('__sendToHost', sink);
+    });
+
+    it('should call native message ring methods', () => {
+      const provider = new QuickJSProvider();
+      const runtime = provider.createRuntime();
+      const context = runtime.createContext();
+
+      context.openMessageRing?.('__post', 4096);
+      const messages = context.drainMessages?.(10);
+
+      expect(mockContext.openMessageRing).toHaveBeenCalledWith('__post', 4096);
+      expect(mockContext.drainMessages).toHaveBeenCalledWith(10);
+      expect(messages).toEqual([{ type: 'a' }]);
+    });
+
     it('should call native dispose on context', () => {
       const provider = new QuickJSProvider();
       const runtime = provider.createRuntime();
@@ -0,0 +1,96 @@
+import { describe, expect, it } from 'bun:test';
+import {
+  WASMValueTag,
+  WASMValueWriter,
+  decodeWASMValue,
+} from '../providers/QuickJSWASMValueCodec';
+
+// Stands in for WASM linear memory: a growable heap with the input buffer at
+// a fixed offset, replaced (like HEAPU8) whenever it grows
+function createMemory() {
+  const memory = {
+    heap: new Uint8Array(64),
+    base: 16,
+    grows: 0,
+  };
+  const writer = new WASMValueWriter({
+    heap: () => memory.heap,
+    reserve: (size) => {
+      if (memory.base + size + 1 > memory.heap.length) {
+        const heap = new Uint8Array((memory.base + size + 1) * 2);
+        heap.set(memory.heap);
+        memory.heap = heap;
+        memory.grows++;
+      }
+      return memory.base;
+    },
+  });
+  const roundTrip = (value: unknown): unknown => {
+    writer.reset().writeValue(value);
+    return decodeWASMValue(memory.heap, memory.base, writer.length);
+  };
+  return { memory, writer, roundTrip };
+}
+
+describe('QuickJSWASMValueCodec', () => {
+  it('should round-trip scalars and strings', () => {
+    const { roundTrip } = createMemory();
+    const values = [1, -2, 2 ** 31, 1.5, 'a', 'héllo €😀', true, false, null, undefined];
+    expect(roundTrip(values)).toEqual(values);
+    expect(Object.is(roundTrip(-0), -0)).toBe(true);
+    expect(roundTrip(Number.NaN)).toBeNaN();
+  });
+
+  it('should encode integers as int32 and others as float64', () => {
+    const { memory, writer } = createMemory();
+    writer.reset().writeValue(7);
+    expect(memory.heap[memory.base]).toBe(WASMValueTag.INT32);
+    expect(writer.length).toBe(5);
+    writer.reset().writeValue(0.1);
+    expect(memory.heap[memory.base]).toBe(WASMValueTag.FLOAT64);
+    expect(writer.length).toBe(9);
+  });
+
+  it('should handle long strings and a growing heap', () => {
+    const { memory, roundTrip } = createMemory();
+    const text = `${'x'.repeat(200)}${'é'.repeat(100)}`;
+    expect(roundTrip(text)).toBe(text);
+
+    const rows = Array.from({ length: 1000 }, (_, i) => ({ id: i, title: `Row ${i}`, price: i * 1.25 }));
+    expect(roundTrip(rows)).toEqual(rows);
+    expect(memory.grows).toBeGreaterThan(0);
+  });
+
+  it('should encode ArrayBuffers as bytes and use toJSON', () => {
+    const { roundTrip } = createMemory();
+    const result = roundTrip({ b: new Uint8Array([1, 2, 3]).buffer, d: new Date(0) }) as {
+      b: ArrayBuffer;
+      d: string;
+    };
+    expect(result.b).toBeInstanceOf(ArrayBuffer);
+    expect([...new Uint8Array(result.b)]).toEqual([1, 2, 3]);
+    expect(result.d).toBe('1970-01-01T00:00:00.000Z');
+  });
+
+  it('should keep __proto__ as a data property', () => {
+    const { roundTrip } = createMemory();
+    const result = roundTrip(JSON.parse('{"__proto__": {"x": 1}}')) as Record<string, unknown>;
+    expect(Object.getPrototypeOf(result)).toBe(Object.prototype);
+    expect(Object.keys(result)).toEqual(['__proto__']);
+  });
+
+  it('should reject cycles', () => {
+    const { roundTrip } = createMemory();
+    const cyclic: Record<string, unknown> = {};
+    cyclic.self = cyclic;
+    expect(() => roundTrip(cyclic)).toThrow(RangeError);
+  });
+
+  it('should throw guest errors and reject malformed input', () => {
+    const heap = Uint8Array.from([WASMValueTag.ERROR, 3, 98, 97, 100]);
+    expect(() => decodeWASMValue(heap, 0, heap.length)).toThrow('bad');
+
+    const truncated = Uint8Array.from([WASMValueTag.ARRAY, 0xff, 0xff, 0xff, 0x0f]);
+    expect(() => decodeWASMValue(truncated, 0, truncated.length)).toThrow(SyntaxError);
+  });
+});
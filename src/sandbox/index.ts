@@ -30,10 +30,23 @@ export {
 // Provider exports
 export { VMProvider } from './providers/VMProvider';
 export type {
+  BoundaryDirectionStats,
+  BoundaryStats,
+  BundleStream,
+  BundleStreamStats,
+  CoalescingStats,
+  ConversionStats,
+  GuestTrace,
+  HostEventPolicy,
+  HostEventStats,
   JSEngineContext,
   JSEngineProvider,
   JSEngineRuntime,
   JSEngineRuntimeOptions,
+  LatencyStats,
+  MessageRingStats,
+  SizeEstimate,
+  TraceStats,
 } from './types/provider';
 // Type and enum exports
 export { SandboxType } from './types/provider';
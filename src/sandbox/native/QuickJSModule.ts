@@ -7,21 +7,251 @@
 declare global {
   var __QuickJSSandboxJSI:
     | {
-        createRuntime(options?: { timeout?: number }): QuickJSRuntimeNative;
+        createRuntime(options?: QuickJSRuntimeOptions): QuickJSRuntimeNative;
+        /** Approximate JSON.stringify() size of a host value */
+        estimateSize(value: unknown): QuickJSSizeEstimate;
+        /** Native node tree for the Receiver (see ReceiverOptions.treeStore) */
+        createTreeStore(): QuickJSTreeStoreNative;
+        /** Bootstrap scripts embedded as precompiled bytecode (empty without) */
+        getBootstrapScripts(): QuickJSBootstrapScript[];
         isAvailable(): boolean;
       }
     | undefined;
 }
 
+interface QuickJSRuntimeOptions {
+  timeout?: number;
+  /** Max compiled RegExp programs cached per runtime (shared by its contexts). 0 disables. */
+  regexpCacheSize?: number;
+  /** Frozen guest objects whose host copies each context keeps for reuse. 0 disables. */
+  conversionMemoSize?: number;
+  /** Instantiate Date, Map/Set and typed arrays on first use in each context. */
+  lazyIntrinsics?: boolean;
+}
+
+interface QuickJSSizeEstimate {
+  /** UTF-8 bytes of the JSON text (escapes and non-integer digits approximated) */
+  bytes: number;
+  /** Objects and arrays */
+  objects: number;
+  /** String values */
+  strings: number;
+}
+
+interface QuickJSBootstrapScript {
+  /** 'console', 'guest-bundle' or 'devtools-shim' */
+  name: string;
+  bytecodeBytes: number;
+  /** UTF-8 bytes of the source the bytecode replaces */
+  sourceBytes: number;
+  /** Times the bytecode was evaluated instead of the source, process-wide */
+  uses: number;
+}
+
+interface QuickJSFunctionProfileEntry {
+  name: string;
+  /** Source file and first line of guest functions */
+  file?: string;
+  line?: number;
+  /** Built-in or host function */
+  native: boolean;
+  calls: number;
+  selfMs: number;
+  /** Time including callees, counting recursive calls once */
+  inclusiveMs: number;
+}
+
+interface QuickJSCoalescingStats {
+  batches: number;
+  opsIn: number;
+  opsOut: number;
+  coalesceMs: number;
+  conversionMs: number;
+  /** Conversion time the eliminated operations would have cost (extrapolated) */
+  estimatedSavedMs: number;
+}
+
+interface QuickJSConversionStats {
+  /** Objects and arrays served from the conversion memo */
+  hits: number;
+  misses: number;
+  entries: number;
+  evictions: number;
+  capacity: number;
+}
+
+interface QuickJSMessageRingStats {
+  capacity: number;
+  usedBytes: number;
+  highWaterBytes: number;
+  written: number;
+  drained: number;
+  /** Posts refused for lack of space */
+  rejected: number;
+}
+
+interface QuickJSHostEventStats {
+  queued: number;
+  coalesced: number;
+  delivered: number;
+  pending: number;
+  maxPending: number;
+  flushes: number;
+  avgWaitMs: number;
+  maxWaitMs: number;
+}
+
+interface QuickJSLatencyStats {
+  count: number;
+  totalMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+interface QuickJSBoundaryDirectionStats {
+  /** Top-level values converted (arguments, return values, globals) */
+  crossings: number;
+  /** Values converted, nested ones included */
+  values: number;
+  objects: number;
+  strings: number;
+  /** UTF-8 bytes of the converted strings */
+  bytes: number;
+  functions: number;
+  /** Conversion time per crossing */
+  conversion: QuickJSLatencyStats;
+}
+
+interface QuickJSBoundaryStats {
+  toGuest: QuickJSBoundaryDirectionStats;
+  toHost: QuickJSBoundaryDirectionStats;
+  /** Host function wrappers collected by the guest */
+  functionsReleased: number;
+  /** Guest -> host callbacks, including argument and result conversion */
+  hostCalls: QuickJSLatencyStats;
+  /** Host -> guest function calls, likewise */
+  guestCalls: QuickJSLatencyStats;
+}
+
+interface QuickJSGuestTrace {
+  /** Names used by the drained entries */
+  names: string[];
+  /** Per entry, from here on: index into `names` */
+  name: number[];
+  /** 0 = mark, 1 = measure (including ended console timers) */
+  kind: number[];
+  /** ms since the context was created */
+  startTime: number[];
+  duration: number[];
+}
+
+interface QuickJSTraceStats {
+  recorded: number;
+  /** Recorded while `capacity` entries were pending */
+  dropped: number;
+  drained: number;
+  pending: number;
+  capacity: number;
+  /** Distinct mark, measure and timer names */
+  names: number;
+  /** Wall-clock time (ms since the epoch) of startTime 0 */
+  timeOrigin: number;
+}
+
+interface QuickJSTreeStoreBatchResult {
+  /** Created/updated nodes and parents whose children changed (0 is the root) */
+  dirty: number[];
+  childrenChanged: number[];
+  /** Deleted by the batch (with descendants) and not re-created */
+  deleted: number[];
+  /** Structure operations applied (CREATE/UPDATE/TEXT only mark nodes dirty) */
+  applied: number;
+  /** Structure operations on unknown nodes, or that would create a cycle */
+  ignored: number;
+}
+
+interface QuickJSTreeStoreNative {
+  /** Run the structure operations among the first `count` operations */
+  applyBatch(operations: readonly unknown[], count?: number): QuickJSTreeStoreBatchResult;
+  getChildren(id: number): number[];
+  getParent(id: number): number | undefined;
+  has(id: number): boolean;
+  readonly size: number;
+  clear(): void;
+}
+
+interface QuickJSBundleStreamStats {
+  bytes: number;
+  chunks: number;
+  /** Worker parse and compile time, not counting waits for input */
+  compileMs: number;
+  /** Time finish() waited for the worker */
+  waitMs: number;
+  /** False when the bundle was evaluated from source */
+  streamed: boolean;
+}
+
+interface QuickJSBundleStreamNative {
+  append(chunk: string | ArrayBuffer): void;
+  /** Wait for the worker and evaluate the bundle; returns its completion value */
+  finish(): unknown;
+  cancel(): void;
+  getStats(): QuickJSBundleStreamStats;
+}
+
 interface QuickJSContextNative {
-  eval(code: string): unknown;
+  eval(code: string, sourceURL?: string): unknown;
+  /** Evaluate UTF-8 source from the buffer, parsed in place if it ends in '\0' (never modified) */
+  evalBuffer(source: ArrayBuffer, sourceURL?: string): unknown;
+  /** Evaluate a file mapped from disk; sourceURL defaults to the path */
+  evalFile(path: string, sourceURL?: string): unknown;
+  /** Compile a bundle on a worker thread while its chunks are appended */
+  createBundleStream(sourceURL?: string, expectedBytes?: number): QuickJSBundleStreamNative;
   setGlobal(name: string, value: unknown): void;
   getGlobal(name: string): unknown;
+  /** Like the module's estimateSize, but free for arguments of the guest call in progress */
+  estimateSize(value: unknown): QuickJSSizeEstimate;
+  /** setGlobal for an operation-batch handler; batches are coalesced natively before conversion */
+  setOperationSink(name: string, fn: (batch: unknown) => void): void;
+  getCoalescingStats(): QuickJSCoalescingStats;
+  getConversionStats(): QuickJSConversionStats;
+  /** Install `name(message): boolean`, posting JSON-encoded messages to a lock-free ring */
+  openMessageRing(name: string, capacityBytes?: number): void;
+  /** Decode and release the posted messages, oldest first */
+  drainMessages(maxMessages?: number): unknown[];
+  getMessageRingStats(): QuickJSMessageRingStats;
+  setHostEventPolicy(eventName: string, policy: 'all' | 'latest' | 'accumulate'): void;
+  /** Queue natively, coalesced per the event's policy; returns the pending count */
+  queueHostEvent(eventName: string, payload: unknown): number;
+  /** Call the guest global `handler(eventName, payload)` for each queued event */
+  flushHostEvents(handler: string, maxEvents?: number): number;
+  getHostEventStats(): QuickJSHostEventStats;
+  /** Boundary traffic and call latency since creation or the last reset */
+  getBoundaryStats(): QuickJSBoundaryStats;
+  resetBoundaryStats(): void;
+  /** Take the guest's performance marks/measures and console timers, oldest first */
+  drainTrace(maxEntries?: number): QuickJSGuestTrace;
+  getTraceStats(): QuickJSTraceStats;
   dispose(): void;
 }
 
 interface QuickJSRuntimeNative {
   createContext(): QuickJSContextNative;
+  /** QuickJS memory usage and runtime cache counters (e.g. regexp_cache_hits) */
+  getHeapInfo(): Record<string, number>;
+  /**
+   * Opcode histogram and most frequent opcode pairs as text; only populated
+   * when the library is built with QUICKJS_OPCODE_STATS
+   */
+  dumpOpcodeStats(maxPairs?: number): string;
+  resetOpcodeStats(): void;
+  /** Record calls and self/inclusive time of every guest, native and host function */
+  setFunctionProfiling(enabled: boolean): void;
+  resetFunctionProfile(): void;
+  /** Profiled functions since the last reset, by self time */
+  getFunctionProfile(maxFunctions?: number): QuickJSFunctionProfileEntry[];
   dispose(): void;
 }
 
@@ -53,4 +283,24 @@ export function getQuickJSModule() {
 }
 
 // Re-export types
-export type { QuickJSContextNative, QuickJSRuntimeNative };
+export type {
+  QuickJSBootstrapScript,
+  QuickJSBoundaryDirectionStats,
+  QuickJSBoundaryStats,
+  QuickJSBundleStreamNative,
+  QuickJSBundleStreamStats,
+  QuickJSCoalescingStats,
+  QuickJSContextNative,
+  QuickJSConversionStats,
+  QuickJSFunctionProfileEntry,
+  QuickJSGuestTrace,
+  QuickJSHostEventStats,
+  QuickJSLatencyStats,
+  QuickJSMessageRingStats,
+  QuickJSRuntimeNative,
+  QuickJSRuntimeOptions,
+  QuickJSSizeEstimate,
+  QuickJSTraceStats,
+  QuickJSTreeStoreBatchResult,
+  QuickJSTreeStoreNative,
+};
@@ -10,9 +10,13 @@
  *
  * Output:
  *   quickjs_sandbox.{js,wasm} → copied to rill/src/sandbox/wasm/
+ *
+ * Builds from before the handle API (one global runtime and context per
+ * module) are still accepted, one context at a time.
  */
 
 import type { JSEngineContext, JSEngineProvider, JSEngineRuntime } from '../types/provider';
+import { WASMValueWriter, decodeWASMValue } from './QuickJSWASMValueCodec';
 
 /**
  * Type definitions for the WASM module C API
@@ -34,13 +38,44 @@ interface QuickJSWASMModule {
   _free: (ptr: number) => void;
   HEAPU8: Uint8Array;
 
-  // QuickJS C API bindings
+  // QuickJS C API bindings (rt / ctx are runtime and context handles)
+  _qjs_runtime_new: () => number;
+  _qjs_runtime_free: (rt: number) => void;
+  _qjs_context_new: (rt: number) => number;
+  _qjs_context_free: (ctx: number) => void;
+  _qjs_eval: (ctx: number, codePtr: number) => number;
+  _qjs_eval_void: (ctx: number, codePtr: number) => number;
+  _qjs_set_global_json: (ctx: number, namePtr: number, valuePtr: number) => number;
+  _qjs_get_global_json: (ctx: number, namePtr: number) => number;
+  _qjs_set_host_callback: (ctx: number, fnPtr: number) => void;
+  _qjs_install_host_functions: (ctx: number) => void;
+  _qjs_set_timer_callback: (ctx: number, fnPtr: number) => void;
+  _qjs_install_timer_functions: (ctx: number) => void;
+  _qjs_fire_timer: (ctx: number, timerId: number) => void;
+  _qjs_install_console: (ctx: number) => void;
+  _qjs_execute_pending_jobs: (rt: number) => number;
+  _qjs_free_string: (ptr: number) => void;
+  _qjs_get_memory_usage: (rt: number) => number;
+
+  // Binary values (QuickJSWASMValueCodec); values go as JSON without them
+  _qjs_input_buffer?: (ctx: number, size: number) => number;
+  _qjs_result_buffer?: (ctx: number) => number;
+  _qjs_eval_value?: (ctx: number, codeLength: number) => number;
+  _qjs_set_global_value?: (ctx: number, namePtr: number, length: number) => number;
+  _qjs_get_global_value?: (ctx: number, namePtr: number) => number;
+}
+
+/**
+ * C API of builds without runtime / context handles
+ */
+interface LegacyQuickJSWASMModule {
+  cwrap: QuickJSWASMModule['cwrap'];
+  addFunction: QuickJSWASMModule['addFunction'];
+  removeFunction: QuickJSWASMModule['removeFunction'];
+  UTF8ToString: QuickJSWASMModule['UTF8ToString'];
+
   _qjs_init: () => number;
   _qjs_destroy: () => void;
-  _qjs_eval: (codePtr: number) => number;
-  _qjs_eval_void: (codePtr: number) => number;
-  _qjs_set_global_json: (namePtr: number, valuePtr: number) => number;
-  _qjs_get_global_json: (namePtr: number) => number;
   _qjs_set_host_callback: (fnPtr: number) => void;
   _qjs_install_host_functions: () => void;
   _qjs_set_timer_callback: (fnPtr: number) => void;
@@ -49,13 +84,43 @@ interface QuickJSWASMModule {
   _qjs_install_console: () => void;
   _qjs_execute_pending_jobs: () => number;
   _qjs_free_string: (ptr: number) => void;
-  _qjs_get_memory_usage: () => number;
+}
+
+type AnyQuickJSWASMModule = QuickJSWASMModule | LegacyQuickJSWASMModule;
+
+/**
+ * Value transfer of one context
+ */
+interface ContextValues {
+  eval(code: string): unknown;
+  setGlobal(name: string, value: unknown): boolean;
+  getGlobal(name: string): unknown;
+}
+
+function hasHandles(module: AnyQuickJSWASMModule): module is QuickJSWASMModule {
+  return typeof (module as Partial<QuickJSWASMModule>)._qjs_runtime_new === 'function';
+}
+
+type BinaryValueModule = QuickJSWASMModule &
+  Required<
+    Pick<
+      QuickJSWASMModule,
+      | '_qjs_input_buffer'
+      | '_qjs_result_buffer'
+      | '_qjs_eval_value'
+      | '_qjs_set_global_value'
+      | '_qjs_get_global_value'
+    >
+  >;
+
+function hasBinaryValues(module: QuickJSWASMModule): module is BinaryValueModule {
+  return typeof module._qjs_eval_value === 'function';
 }
 
 /**
  * Factory function exported by Emscripten
  */
-type QuickJSWASMFactory = () => Promise<QuickJSWASMModule>;
+type QuickJSWASMFactory = () => Promise<AnyQuickJSWASMModule>;
 
 /**
  * Provider options
@@ -91,8 +156,10 @@ export interface QuickJSNativeWASMProviderOptions {
  */
 export class QuickJSNativeWASMProvider implements JSEngineProvider {
   private options: Required<QuickJSNativeWASMProviderOptions>;
-  private wasmModule: QuickJSWASMModule | null = null;
-  private loadPromise: Promise<QuickJSWASMModule> | null = null;
+  private wasmModule: AnyQuickJSWASMModule | null = null;
+  private loadPromise: Promise<AnyQuickJSWASMModule> | null = null;
+  // A legacy module has a single context
+  private legacyContextOpen = false;
 
   constructor(options: QuickJSNativeWASMProviderOptions = {}) {
     this.options = {
@@ -105,19 +172,48 @@ export class QuickJSNativeWASMProvider implements JSEngineProvider {
 
   async createRuntime(): Promise<JSEngineRuntime> {
     const module = await this.loadWASM();
+    if (!hasHandles(module)) {
+      return this.createLegacyRuntime(module);
+    }
+
+    // One QuickJS runtime (heap, GC, job queue) per JSEngineRuntime; the
+    // compiled module is shared by every runtime and context
+    const rt = module._qjs_runtime_new();
+    if (!rt) {
+      throw new Error('[QuickJSWASM] Failed to create runtime');
+    }
+    const contexts = new Set<() => void>();
+    let runtimeDisposed = false;
+
+    const evalVoid = module.cwrap('qjs_eval_void', 'number', ['number', 'string']) as (
+      ctx: number,
+      code: string
+    ) => number;
+    const valuesOf = hasBinaryValues(module)
+      ? this.binaryValues(module)
+      : this.jsonValues(module);
 
     return {
       createContext: (): JSEngineContext => {
-        // Initialize QuickJS
-        const initResult = module._qjs_init();
-        if (initResult !== 0) {
-          throw new Error(`[QuickJSWASM] Failed to initialize: ${initResult}`);
+        const ctx = module._qjs_context_new(rt);
+        if (!ctx) {
+          throw new Error('[QuickJSWASM] Failed to create context');
         }
 
         // Track pending timers for cleanup
         const pendingTimers = new Map<number, ReturnType<typeof setTimeout>>();
+        const values = valuesOf(ctx);
+        const evalValue = (code: string): unknown => {
+          const result = values.eval(code);
+
+          // Process any microtasks
+          module._qjs_execute_pending_jobs(rt);
+
+          return result;
+        };
         let hostCallbackPtr = 0;
         let timerCallbackPtr = 0;
+        let disposed = false;
 
         // Install host callback for communication
         const hostCallback = (eventPtr: number, dataPtr: number) => {
@@ -137,9 +233,9 @@ export class QuickJSNativeWASMProvider implements JSEngineProvider {
         };
 
         hostCallbackPtr = module.addFunction(hostCallback, 'vii');
-        module._qjs_set_host_callback(hostCallbackPtr);
-        module._qjs_install_host_functions();
-        module._qjs_install_console();
+        module._qjs_set_host_callback(ctx, hostCallbackPtr);
+        module._qjs_install_host_functions(ctx);
+        module._qjs_install_console(ctx);
 
         // Install timer support
         const timerCallback = (encodedValue: number) => {
@@ -152,19 +248,205 @@ export class QuickJSNativeWASMProvider implements JSEngineProvider {
 
           const handle = setTimeout(() => {
             pendingTimers.delete(timerId);
-            module._qjs_fire_timer(timerId);
+            module._qjs_fire_timer(ctx, timerId);
             // Process any promises that might have resolved
-            module._qjs_execute_pending_jobs();
+            module._qjs_execute_pending_jobs(rt);
           }, delay);
 
           pendingTimers.set(timerId, handle);
         };
 
         timerCallbackPtr = module.addFunction(timerCallback, 'vi');
+        module._qjs_set_timer_callback(ctx, timerCallbackPtr);
+        module._qjs_install_timer_functions(ctx);
+
+        const dispose = (): void => {
+          if (disposed) {
+            return;
+          }
+          disposed = true;
+          contexts.delete(dispose);
+
+          // Clear pending timers
+          for (const handle of pendingTimers.values()) {
+            clearTimeout(handle);
+          }
+          pendingTimers.clear();
+
+          // Destroy QuickJS context before its callbacks go away
+          module._qjs_context_free(ctx);
+
+          // Remove function pointers
+          if (hostCallbackPtr) {
+            module.removeFunction(hostCallbackPtr);
+          }
+          if (timerCallbackPtr) {
+            module.removeFunction(timerCallbackPtr);
+          }
+        };
+        contexts.add(dispose);
+
+        return {
+          eval: (code: string): unknown => evalValue(code),
+
+          evalAsync: async (code: string): Promise<unknown> => evalValue(code),
+
+          setGlobal: (name: string, value: unknown): void => {
+            // Handle functions specially
+            if (typeof value === 'function') {
+              // Create a wrapper in the sandbox
+              const fnId = `__host_fn_${name}_${Date.now()}`;
+              const wrapperCode = `
+                globalThis["${name}"] = function(...args) {
+                  globalThis.__sendToHost("CALL_HOST_FN", { fnId: "${fnId}", args: args });
+                };
+              `;
+              evalVoid(ctx, wrapperCode);
+              return;
+            }
+
+            if (!values.setGlobal(name, value)) {
+              throw new Error(`[QuickJSWASM] Failed to set global ${name}`);
+            }
+          },
+
+          getGlobal: (name: string): unknown => values.getGlobal(name),
+
+          dispose,
+        };
+      },
+
+      dispose: (): void => {
+        if (runtimeDisposed) {
+          return;
+        }
+        runtimeDisposed = true;
+        // Contexts first, so their timers and callbacks are released too
+        for (const disposeContext of [...contexts]) {
+          disposeContext();
+        }
+        module._qjs_runtime_free(rt);
+      },
+    };
+  }
+
+  /**
+   * Values and code through the context's input / result buffers; the
+   * global names are short, so cwrap converts them
+   */
+  private binaryValues(module: BinaryValueModule): (ctx: number) => ContextValues {
+    const setGlobalValue = module.cwrap('qjs_set_global_value', 'number', [
+      'number',
+      'string',
+      'number',
+    ]) as (ctx: number, name: string, length: number) => number;
+    const getGlobalValue = module.cwrap('qjs_get_global_value', 'number', [
+      'number',
+      'string',
+    ]) as (ctx: number, name: string) => number;
+
+    return (ctx) => {
+      const writer = new WASMValueWriter({
+        heap: () => module.HEAPU8,
+        reserve: (size) => module._qjs_input_buffer(ctx, size),
+      });
+      const readResult = (length: number): unknown => {
+        if (length < 0) {
+          throw new Error('[QuickJSWASM] Failed to transfer value');
+        }
+        return decodeWASMValue(module.HEAPU8, module._qjs_result_buffer(ctx), length);
+      };
+
+      return {
+        eval: (code) => {
+          writer.reset().writeText(code);
+          return readResult(module._qjs_eval_value(ctx, writer.length));
+        },
+        setGlobal: (name, value) => {
+          writer.reset().writeValue(value);
+          return setGlobalValue(ctx, name, writer.length) === 0;
+        },
+        getGlobal: (name) => readResult(getGlobalValue(ctx, name)),
+      };
+    };
+  }
+
+  /**
+   * Values as JSON strings, for builds without the binary value ABI
+   */
+  private jsonValues(module: QuickJSWASMModule): (ctx: number) => ContextValues {
+    const evalCode = module.cwrap('qjs_eval', 'number', ['number', 'string']) as (
+      ctx: number,
+      code: string
+    ) => number;
+    const setGlobalJson = module.cwrap('qjs_set_global_json', 'number', [
+      'number',
+      'string',
+      'string',
+    ]) as (ctx: number, name: string, json: string) => number;
+    const getGlobalJson = module.cwrap('qjs_get_global_json', 'number', ['number', 'string']) as (
+      ctx: number,
+      name: string
+    ) => number;
+    const takeResult = (ptr: number): unknown => {
+      const json = module.UTF8ToString(ptr);
+      module._qjs_free_string(ptr);
+      return this.parseResult(json);
+    };
+
+    return (ctx) => ({
+      eval: (code) => takeResult(evalCode(ctx, code)),
+      setGlobal: (name, value) => setGlobalJson(ctx, name, JSON.stringify(value)) === 0,
+      getGlobal: (name) => takeResult(getGlobalJson(ctx, name)),
+    });
+  }
+
+  /**
+   * Runtime over a module without handles: its one QuickJS context is
+   * created by qjs_init() and destroyed by qjs_destroy()
+   */
+  private createLegacyRuntime(module: LegacyQuickJSWASMModule): JSEngineRuntime {
+    return {
+      createContext: (): JSEngineContext => {
+        if (this.legacyContextOpen) {
+          throw new Error(
+            '[QuickJSWASM] This WASM build supports one context at a time; rebuild it with build-wasm.sh'
+          );
+        }
+        const initResult = module._qjs_init();
+        if (initResult !== 0) {
+          throw new Error(`[QuickJSWASM] Failed to initialize: ${initResult}`);
+        }
+        this.legacyContextOpen = true;
+
+        // Track pending timers for cleanup
+        const pendingTimers = new Map<number, ReturnType<typeof setTimeout>>();
+        let disposed = false;
+
+        const hostCallbackPtr = module.addFunction((eventPtr: number, dataPtr: number) => {
+          if (this.options.debug) {
+            const event = module.UTF8ToString(eventPtr);
+            console.log(`[QuickJSWASM] Host callback: ${event}`, module.UTF8ToString(dataPtr));
+          }
+        }, 'vii');
+        module._qjs_set_host_callback(hostCallbackPtr);
+        module._qjs_install_host_functions();
+        module._qjs_install_console();
+
+        const timerCallbackPtr = module.addFunction((encodedValue: number) => {
+          const timerId = encodedValue >> 16;
+          const delay = encodedValue & 0xffff;
+          const handle = setTimeout(() => {
+            pendingTimers.delete(timerId);
+            module._qjs_fire_timer(timerId);
+            module._qjs_execute_pending_jobs();
+          }, delay);
+          pendingTimers.set(timerId, handle);
+        }, 'vi');
         module._qjs_set_timer_callback(timerCallbackPtr);
         module._qjs_install_timer_functions();
 
-        // Use cwrap for string operations since HEAPU8 is not exported
+        // Strings go through cwrap: these builds do not export HEAPU8
         const evalCode = module.cwrap('qjs_eval', 'number', ['string']) as (code: string) => number;
         const evalVoid = module.cwrap('qjs_eval_void', 'number', ['string']) as (
           code: string
@@ -176,79 +458,61 @@ export class QuickJSNativeWASMProvider implements JSEngineProvider {
         const getGlobalJson = module.cwrap('qjs_get_global_json', 'number', ['string']) as (
           name: string
         ) => number;
-        const freeString = module._qjs_free_string.bind(module);
+        const takeString = (ptr: number): string => {
+          const result = module.UTF8ToString(ptr);
+          module._qjs_free_string(ptr);
+          return result;
+        };
+        const evalJson = (code: string): unknown => {
+          const result = takeString(evalCode(code));
+          // Process any microtasks
+          module._qjs_execute_pending_jobs();
+          return this.parseResult(result);
+        };
 
         return {
-          eval: (code: string): unknown => {
-            const resultPtr = evalCode(code);
-            const result = module.UTF8ToString(resultPtr);
-            freeString(resultPtr);
+          eval: (code: string): unknown => evalJson(code),
 
-            // Process any microtasks
-            module._qjs_execute_pending_jobs();
-
-            return this.parseResult(result);
-          },
-
-          evalAsync: async (code: string): Promise<unknown> => {
-            const resultPtr = evalCode(code);
-            const result = module.UTF8ToString(resultPtr);
-            freeString(resultPtr);
-
-            // Process microtasks
-            module._qjs_execute_pending_jobs();
-
-            return this.parseResult(result);
-          },
+          evalAsync: async (code: string): Promise<unknown> => evalJson(code),
 
           setGlobal: (name: string, value: unknown): void => {
-            // Handle functions specially
             if (typeof value === 'function') {
-              // Create a wrapper in the sandbox
               const fnId = `__host_fn_${name}_${Date.now()}`;
-              const wrapperCode = `
+              evalVoid(`
                 globalThis["${name}"] = function(...args) {
                   globalThis.__sendToHost("CALL_HOST_FN", { fnId: "${fnId}", args: args });
                 };
-              `;
-              evalVoid(wrapperCode);
+              `);
               return;
             }
-
-            const valueJson = JSON.stringify(value);
-            setGlobalJson(name, valueJson);
+            if (setGlobalJson(name, JSON.stringify(value)) !== 0) {
+              throw new Error(`[QuickJSWASM] Failed to set global ${name}`);
+            }
           },
 
-          getGlobal: (name: string): unknown => {
-            const resultPtr = getGlobalJson(name);
-            const result = module.UTF8ToString(resultPtr);
-            freeString(resultPtr);
-            return this.parseResult(result);
-          },
+          getGlobal: (name: string): unknown => this.parseResult(takeString(getGlobalJson(name))),
 
           dispose: (): void => {
-            // Clear pending timers
+            if (disposed) {
+              return;
+            }
+            disposed = true;
             for (const handle of pendingTimers.values()) {
               clearTimeout(handle);
             }
             pendingTimers.clear();
 
-            // Remove function pointers
-            if (hostCallbackPtr) {
-              module.removeFunction(hostCallbackPtr);
-            }
-            if (timerCallbackPtr) {
-              module.removeFunction(timerCallbackPtr);
-            }
-
-            // Destroy QuickJS context
+            // Destroy QuickJS context before its callbacks go away
             module._qjs_destroy();
+            module.removeFunction(hostCallbackPtr);
+            module.removeFunction(timerCallbackPtr);
+            this.legacyContextOpen = false;
           },
         };
       },
 
       dispose: (): void => {
-        // WASM module can be reused across runtimes
+        // The module's context is owned by createContext()
       },
     };
   }
@@ -256,7 +520,7 @@ export class QuickJSNativeWASMProvider implements JSEngineProvider {
   /**
    * Load WASM module (cached)
    */
-  private async loadWASM(): Promise<QuickJSWASMModule> {
+  private async loadWASM(): Promise<AnyQuickJSWASMModule> {
     if (this.wasmModule) {
       return this.wasmModule;
     }
@@ -277,7 +541,7 @@ export class QuickJSNativeWASMProvider implements JSEngineProvider {
   /**
    * Default WASM factory
    */
-  private async defaultWASMFactory(): Promise<QuickJSWASMModule> {
+  private async defaultWASMFactory(): Promise<AnyQuickJSWASMModule> {
     // Dynamic import the Emscripten-generated loader
     const createQuickJSSandbox = (await import(
       /* webpackIgnore: true */
@@ -288,36 +552,22 @@ export class QuickJSNativeWASMProvider implements JSEngineProvider {
   }
 
   /**
-   * Parse eval result from JSON string
+   * Parse a JSON result of the C API ({"error": ...} on exceptions)
    */
   private parseResult(json: string): unknown {
     if (json === 'undefined') {
       return undefined;
     }
-    if (json === 'null') {
-      return null;
-    }
-
-    // Check for error response
-    if (json.startsWith('{') && json.includes('"error"')) {
-      try {
-        const parsed = JSON.parse(json);
-        if (parsed.error) {
-          throw new Error(parsed.error);
-        }
-      } catch (e) {
-        if (e instanceof Error && e.message !== 'Unexpected token') {
-          throw e;
-        }
-        // Not an error object, continue parsing
-      }
-    }
-
+    let parsed: unknown;
     try {
-      return JSON.parse(json);
+      parsed = JSON.parse(json);
     } catch {
       return json;
     }
+    if (parsed && typeof parsed === 'object' && 'error' in parsed) {
+      throw new Error(String((parsed as { error: unknown }).error));
+    }
+    return parsed;
   }
 
   /**
@@ -9,11 +9,32 @@ import {
   getQuickJSModule,
   isQuickJSAvailable,
   type QuickJSContextNative,
+  type QuickJSRuntimeOptions,
 } from '../native/QuickJSModule';
-import type { JSEngineContext, JSEngineProvider, JSEngineRuntime } from '../types/provider';
+import type {
+  BoundaryStats,
+  BundleStream,
+  CoalescingStats,
+  ConversionStats,
+  GuestTrace,
+  HostEventPolicy,
+  HostEventStats,
+  JSEngineContext,
+  JSEngineProvider,
+  JSEngineRuntime,
+  MessageRingStats,
+  SizeEstimate,
+  TraceStats,
+} from '../types/provider';
 
 export interface QuickJSProviderOptions {
   timeout?: number | undefined;
+  /** Compiled RegExp cache size shared by all contexts of a runtime (0 disables) */
+  regexpCacheSize?: number | undefined;
+  /** Frozen guest objects whose host copies each context reuses (0 disables) */
+  conversionMemoSize?: number | undefined;
+  /** Create contexts whose Date, Map/Set and typed array built-ins are built on first use */
+  lazyIntrinsics?: boolean | undefined;
 }
 
 /**
@@ -32,8 +53,19 @@ export class QuickJSProvider implements JSEngineProvider {
       throw new Error('[QuickJSProvider] QuickJS native module not available');
     }
 
-    const runtimeOptions =
-      this.options.timeout !== undefined ? { timeout: this.options.timeout } : undefined;
+    let runtimeOptions: QuickJSRuntimeOptions | undefined;
+    if (this.options.timeout !== undefined) {
+      runtimeOptions = { timeout: this.options.timeout };
+    }
+    if (this.options.regexpCacheSize !== undefined) {
+      runtimeOptions = { ...runtimeOptions, regexpCacheSize: this.options.regexpCacheSize };
+    }
+    if (this.options.conversionMemoSize !== undefined) {
+      runtimeOptions = { ...runtimeOptions, conversionMemoSize: this.options.conversionMemoSize };
+    }
+    if (this.options.lazyIntrinsics !== undefined) {
+      runtimeOptions = { ...runtimeOptions, lazyIntrinsics: this.options.lazyIntrinsics };
+    }
     const rt = mod.createRuntime(runtimeOptions);
 
     return {
@@ -42,8 +74,32 @@ export class QuickJSProvider implements JSEngineProvider {
 
         return {
           eval: (code: string): unknown => ctx.eval(code),
+          evalBuffer: (source: ArrayBuffer, sourceURL?: string): unknown =>
+            ctx.evalBuffer(source, sourceURL),
+          createBundleStream: (sourceURL?: string, expectedBytes?: number): BundleStream =>
+            ctx.createBundleStream(sourceURL, expectedBytes),
           setGlobal: (name: string, value: unknown): void => ctx.setGlobal(name, value),
           getGlobal: (name: string): unknown => ctx.getGlobal(name),
+          estimateSize: (value: unknown): SizeEstimate => ctx.estimateSize(value),
+          setOperationSink: (name: string, handler: (batch: unknown) => void): void =>
+            ctx.setOperationSink(name, handler),
+          getCoalescingStats: (): CoalescingStats => ctx.getCoalescingStats(),
+          getConversionStats: (): ConversionStats => ctx.getConversionStats(),
+          openMessageRing: (name: string, capacityBytes?: number): void =>
+            ctx.openMessageRing(name, capacityBytes),
+          drainMessages: (maxMessages?: number): unknown[] => ctx.drainMessages(maxMessages),
+          getMessageRingStats: (): MessageRingStats => ctx.getMessageRingStats(),
+          setHostEventPolicy: (eventName: string, policy: HostEventPolicy): void =>
+            ctx.setHostEventPolicy(eventName, policy),
+          queueHostEvent: (eventName: string, payload: unknown): number =>
+            ctx.queueHostEvent(eventName, payload),
+          flushHostEvents: (handler: string, maxEvents?: number): number =>
+            ctx.flushHostEvents(handler, maxEvents),
+          getHostEventStats: (): HostEventStats => ctx.getHostEventStats(),
+          getBoundaryStats: (): BoundaryStats => ctx.getBoundaryStats(),
+          resetBoundaryStats: (): void => ctx.resetBoundaryStats(),
+          drainTrace: (maxEntries?: number): GuestTrace => ctx.drainTrace(maxEntries),
+          getTraceStats: (): TraceStats => ctx.getTraceStats(),
           dispose: (): void => ctx.dispose(),
         };
       },
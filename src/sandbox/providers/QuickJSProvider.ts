@@ -7,6 +7,9 @@ import type { JSEngineProvider } from '../types/provider';
 
 export interface QuickJSProviderOptions {
   timeout?: number | undefined;
+  regexpCacheSize?: number | undefined;
+  conversionMemoSize?: number | undefined;
+  lazyIntrinsics?: boolean | undefined;
 }
 
 export class QuickJSProvider implements JSEngineProvider {
@@ -0,0 +1,375 @@
+/**
+ * QuickJSWASMValueCodec - binary values for the QuickJS WASM bindings
+ *
+ * Host-side half of the encoding in native/quickjs/src/wasm_value.h: values
+ * are written straight into the context's input buffer in linear memory
+ * and read back from its result buffer, without JSON text or a string copy
+ * through the Emscripten heap helpers.
+ *
+ * A value is a one byte tag and its payload; numbers are little endian,
+ * lengths and counts are unsigned LEB128 (uvar).
+ */
+
+export const WASMValueTag = {
+  UNDEFINED: 0,
+  NULL: 1,
+  FALSE: 2,
+  TRUE: 3,
+  INT32: 4,
+  FLOAT64: 5,
+  STRING: 6,
+  ARRAY: 7,
+  OBJECT: 8,
+  BYTES: 9,
+  ERROR: 10,
+} as const;
+
+/** Same limit as WASM_VALUE_MAX_DEPTH */
+const MAX_DEPTH = 256;
+
+/** Strings up to this length are tried as ASCII before TextEncoder/TextDecoder */
+const SHORT_STRING = 32;
+
+const textEncoder = new TextEncoder();
+const textDecoder = new TextDecoder();
+
+/**
+ * Linear memory access for the writer
+ */
+export interface WASMValueMemory {
+  /** Current view of linear memory (replaced when memory grows) */
+  heap(): Uint8Array;
+  /**
+   * Make the input buffer hold at least `size` bytes, keeping its contents
+   * Returns the buffer address (it can move), 0 on failure
+   */
+  reserve(size: number): number;
+}
+
+function uvarSize(value: number): number {
+  let size = 1;
+  while (value >= 0x80) {
+    value = Math.floor(value / 128);
+    size++;
+  }
+  return size;
+}
+
+/**
+ * Encodes values into the input buffer
+ *
+ * The buffer grows by doubling; `length` is the number of bytes written.
+ */
+export class WASMValueWriter {
+  private base = 0;
+  private capacity = 0;
+  private heap: Uint8Array = new Uint8Array(0);
+  private view: DataView = new DataView(new ArrayBuffer(0));
+  length = 0;
+
+  constructor(private readonly memory: WASMValueMemory) {}
+
+  /** Start a new value in the input buffer */
+  reset(): this {
+    this.length = 0;
+    this.capacity = 0;
+    this.ensure(256);
+    return this;
+  }
+
+  /** Write raw UTF-8 text (code for qjs_eval_value) */
+  writeText(text: string): void {
+    this.ensure(text.length * 3);
+    this.length += this.encodeUTF8(text, this.length);
+  }
+
+  writeValue(value: unknown, depth = 0): void {
+    if (depth > MAX_DEPTH) {
+      throw new RangeError('value is nested too deeply (cyclic?)');
+    }
+
+    switch (typeof value) {
+      case 'undefined':
+        this.writeTag(WASMValueTag.UNDEFINED);
+        return;
+      case 'boolean':
+        this.writeTag(value ? WASMValueTag.TRUE : WASMValueTag.FALSE);
+        return;
+      case 'number':
+        this.writeNumber(value);
+        return;
+      case 'string':
+        this.writeString(WASMValueTag.STRING, value);
+        return;
+      case 'bigint':
+        throw new TypeError('BigInt values cannot be sent to the guest');
+      case 'object':
+        break;
+      default:
+        // Functions and symbols have no data form
+        this.writeTag(WASMValueTag.UNDEFINED);
+        return;
+    }
+
+    if (value === null) {
+      this.writeTag(WASMValueTag.NULL);
+      return;
+    }
+    if (value instanceof ArrayBuffer) {
+      const bytes = new Uint8Array(value);
+      this.ensure(6 + bytes.length);
+      this.writeTag(WASMValueTag.BYTES);
+      this.writeUvar(bytes.length);
+      this.heap.set(bytes, this.base + this.length);
+      this.length += bytes.length;
+      return;
+    }
+
+    const toJSON = (value as { toJSON?: unknown }).toJSON;
+    if (typeof toJSON === 'function') {
+      this.writeValue(toJSON.call(value), depth + 1);
+      return;
+    }
+
+    if (Array.isArray(value)) {
+      this.ensure(6);
+      this.writeTag(WASMValueTag.ARRAY);
+      this.writeUvar(value.length);
+      for (let i = 0; i < value.length; i++) {
+        this.writeValue(value[i], depth + 1);
+      }
+      return;
+    }
+
+    const keys = Object.keys(value);
+    this.ensure(6);
+    this.writeTag(WASMValueTag.OBJECT);
+    this.writeUvar(keys.length);
+    for (const key of keys) {
+      this.writeString(null, key);
+      this.writeValue((value as Record<string, unknown>)[key], depth + 1);
+    }
+  }
+
+  private writeTag(tag: number): void {
+    this.ensure(1);
+    this.heap[this.base + this.length++] = tag;
+  }
+
+  private writeNumber(value: number): void {
+    this.ensure(9);
+    if ((value | 0) === value && !Object.is(value, -0)) {
+      this.heap[this.base + this.length] = WASMValueTag.INT32;
+      this.view.setInt32(this.base + this.length + 1, value, true);
+      this.length += 5;
+    } else {
+      this.heap[this.base + this.length] = WASMValueTag.FLOAT64;
+      this.view.setFloat64(this.base + this.length + 1, value, true);
+      this.length += 9;
+    }
+  }
+
+  /** A string with its uvar length, preceded by `tag` unless it is null (keys) */
+  private writeString(tag: number | null, text: string): void {
+    const maxBytes = text.length * 3;
+    this.ensure(6 + maxBytes);
+    if (tag !== null) {
+      this.heap[this.base + this.length++] = tag;
+    }
+
+    // Encode after room for the longest length prefix, then close the gap
+    const prefix = uvarSize(maxBytes);
+    const start = this.length;
+    const written = this.encodeUTF8(text, start + prefix);
+    const actualPrefix = uvarSize(written);
+    if (actualPrefix !== prefix) {
+      const from = this.base + start + prefix;
+      this.heap.copyWithin(this.base + start + actualPrefix, from, from + written);
+    }
+    this.writeUvar(written);
+    this.length += written;
+  }
+
+  /** UTF-8 encode at an offset in the buffer (room must be ensured), returns the byte count */
+  private encodeUTF8(text: string, offset: number): number {
+    const at = this.base + offset;
+    if (text.length <= SHORT_STRING) {
+      let i = 0;
+      for (; i < text.length; i++) {
+        const code = text.charCodeAt(i);
+        if (code >= 0x80) {
+          break;
+        }
+        this.heap[at + i] = code;
+      }
+      if (i === text.length) {
+        return i;
+      }
+    }
+    return textEncoder.encodeInto(text, this.heap.subarray(at)).written ?? 0;
+  }
+
+  private writeUvar(value: number): void {
+    let at = this.base + this.length;
+    while (value >= 0x80) {
+      this.heap[at++] = (value & 0x7f) | 0x80;
+      value = Math.floor(value / 128);
+    }
+    this.heap[at++] = value;
+    this.length = at - this.base;
+  }
+
+  private ensure(bytes: number): void {
+    const needed = this.length + bytes;
+    if (needed <= this.capacity) {
+      return;
+    }
+    const capacity = Math.max(needed, this.capacity * 2);
+    const base = this.memory.reserve(capacity);
+    if (!base) {
+      throw new RangeError(`[QuickJSWASM] Cannot reserve ${capacity} bytes for a value`);
+    }
+    this.base = base;
+    this.capacity = capacity;
+    // Reserving can grow linear memory, which replaces the views
+    this.heap = this.memory.heap();
+    this.view = new DataView(this.heap.buffer, this.heap.byteOffset, this.heap.byteLength);
+  }
+}
+
+/**
+ * Decode a `length` byte value at `ptr`; an ERROR value is thrown as an Error
+ */
+export function decodeWASMValue(heap: Uint8Array, ptr: number, length: number): unknown {
+  const reader = new WASMValueReader(heap, ptr, length);
+  if (heap[ptr] === WASMValueTag.ERROR && length > 0) {
+    reader.pos++;
+    throw new Error(reader.readString());
+  }
+  const value = reader.readValue();
+  if (reader.pos !== reader.end) {
+    throw new SyntaxError('[QuickJSWASM] malformed binary value');
+  }
+  return value;
+}
+
+class WASMValueReader {
+  pos: number;
+  readonly end: number;
+  private readonly view: DataView;
+
+  constructor(
+    private readonly heap: Uint8Array,
+    ptr: number,
+    length: number
+  ) {
+    this.pos = ptr;
+    this.end = ptr + length;
+    this.view = new DataView(heap.buffer, heap.byteOffset, heap.byteLength);
+  }
+
+  readValue(): unknown {
+    this.need(1);
+    const tag = this.heap[this.pos++];
+    switch (tag) {
+      case WASMValueTag.UNDEFINED:
+        return undefined;
+      case WASMValueTag.NULL:
+        return null;
+      case WASMValueTag.FALSE:
+        return false;
+      case WASMValueTag.TRUE:
+        return true;
+      case WASMValueTag.INT32: {
+        this.need(4);
+        const value = this.view.getInt32(this.pos, true);
+        this.pos += 4;
+        return value;
+      }
+      case WASMValueTag.FLOAT64: {
+        this.need(8);
+        const value = this.view.getFloat64(this.pos, true);
+        this.pos += 8;
+        return value;
+      }
+      case WASMValueTag.STRING:
+        return this.readString();
+      case WASMValueTag.ARRAY: {
+        const count = this.readUvar();
+        const array = new Array(count);
+        for (let i = 0; i < count; i++) {
+          array[i] = this.readValue();
+        }
+        return array;
+      }
+      case WASMValueTag.OBJECT: {
+        const count = this.readUvar();
+        const object: Record<string, unknown> = {};
+        for (let i = 0; i < count; i++) {
+          const key = this.readString();
+          // Define rather than assign, so "__proto__" stays a data property
+          Object.defineProperty(object, key, {
+            value: this.readValue(),
+            writable: true,
+            enumerable: true,
+            configurable: true,
+          });
+        }
+        return object;
+      }
+      case WASMValueTag.BYTES: {
+        const length = this.readUvar();
+        this.need(length);
+        const bytes = this.heap.slice(this.pos, this.pos + length);
+        this.pos += length;
+        return bytes.buffer;
+      }
+      default:
+        throw new SyntaxError('[QuickJSWASM] malformed binary value');
+    }
+  }
+
+  readString(): string {
+    const length = this.readUvar();
+    this.need(length);
+    const start = this.pos;
+    this.pos += length;
+    if (length <= SHORT_STRING) {
+      let text = '';
+      for (let i = start; i < this.pos; i++) {
+        const code = this.heap[i];
+        if (code >= 0x80) {
+          return textDecoder.decode(this.heap.subarray(start, this.pos));
+        }
+        text += String.fromCharCode(code);
+      }
+      return text;
+    }
+    return textDecoder.decode(this.heap.subarray(start, this.pos));
+  }
+
+  private readUvar(): number {
+    let value = 0;
+    let scale = 1;
+    for (let i = 0; i < 5; i++) {
+      this.need(1);
+      const byte = this.heap[this.pos++];
+      value += (byte & 0x7f) * scale;
+      if (byte < 0x80) {
+        // A count can never exceed the bytes left to hold its entries
+        if (value > this.end - this.pos) {
+          break;
+        }
+        return value;
+      }
+      scale *= 128;
+    }
+    throw new SyntaxError('[QuickJSWASM] malformed binary value');
+  }
+
+  private need(bytes: number): void {
+    if (this.end - this.pos < bytes) {
+      throw new SyntaxError('[QuickJSWASM] malformed binary value');
+    }
+  }
+}
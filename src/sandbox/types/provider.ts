@@ -75,6 +75,26 @@ export interface JSEngineContext {
    */
   evalBytecode?: (bytecode: ArrayBuffer) => unknown;
 
+  /**
+   * Synchronously evaluates UTF-8 source held in an ArrayBuffer (optional).
+   * Providers may parse it in place from the buffer's memory, skipping the
+   * string the bundle would otherwise be decoded into. The buffer is not
+   * modified.
+   * @param source The UTF-8 encoded JavaScript source.
+   * @param sourceURL Name for stack traces.
+   * @returns The result of the last executed expression.
+   */
+  evalBuffer?: (source: ArrayBuffer, sourceURL?: string) => unknown;
+
+  /**
+   * Starts evaluating a bundle that is still downloading (optional).
+   * The provider compiles appended chunks off the JS thread as they arrive,
+   * so finish() only has to compile the tail and run it.
+   * @param sourceURL Name for stack traces.
+   * @param expectedBytes Bundle size if known (e.g. Content-Length).
+   */
+  createBundleStream?: (sourceURL?: string, expectedBytes?: number) => BundleStream;
+
   /**
    * Sets a global variable in the sandbox's global scope synchronously.
    *
@@ -99,6 +119,112 @@ export interface JSEngineContext {
    */
   dispose: () => void;
 
+  /**
+   * Estimates the serialized (JSON) size of a value without stringifying it (optional).
+   * Providers that convert guest values natively can answer from counts recorded
+   * during conversion, making this nearly free for payloads the guest just sent.
+   * @param value The value to measure.
+   * @returns Approximate UTF-8 byte length and object/string counts.
+   * @throws Error for cyclic values, like JSON.stringify.
+   */
+  estimateSize?: (value: unknown) => SizeEstimate;
+
+  /**
+   * Installs a guest -> host operation batch handler as a global (optional).
+   * Behaves like setGlobal, but the provider may coalesce each batch's
+   * operations (merged UPDATEs, superseded REORDER/INSERT, CREATE+DELETE
+   * pairs) before it crosses the boundary. Operation order is preserved.
+   * @param name The name of the global variable.
+   * @param handler Receives `{ ...batch, operations }`.
+   */
+  setOperationSink?: (name: string, handler: (batch: unknown) => void) => void;
+
+  /**
+   * Counters for batches passed through setOperationSink (optional).
+   */
+  getCoalescingStats?: () => CoalescingStats;
+
+  /**
+   * Counters for the guest -> host conversion memo (optional).
+   * Providers may convert immutable (deep-frozen) guest objects once and
+   * reuse the host copy while it stays in a bounded memo. That copy is
+   * shared between calls and not frozen: copy it before changing it.
+   */
+  getConversionStats?: () => ConversionStats;
+
+  /**
+   * Opens a guest -> host message ring and installs its post function as a
+   * global (optional). `name(message)` JSON-encodes the message into a
+   * bounded per-context buffer and returns false when it is full, without
+   * calling into the host. Can be opened once per context.
+   * @param name The name of the global variable.
+   * @param capacityBytes Ring size (rounded up to a power of two).
+   */
+  openMessageRing?: (name: string, capacityBytes?: number) => void;
+
+  /**
+   * Takes the messages posted to the ring since the last drain, oldest
+   * first (optional). Meant to be called once per frame.
+   * @param maxMessages Leave the rest for the next drain.
+   */
+  drainMessages?: (maxMessages?: number) => unknown[];
+
+  /**
+   * Counters for the message ring (optional). All zero before it is opened.
+   */
+  getMessageRingStats?: () => MessageRingStats;
+
+  /**
+   * Sets how queued host events with this name are coalesced (optional).
+   * 'latest' keeps only the newest pending event, 'accumulate' sums the
+   * numeric properties of pending object payloads, 'all' keeps every event.
+   */
+  setHostEventPolicy?: (eventName: string, policy: HostEventPolicy) => void;
+
+  /**
+   * Queues a host -> guest event natively until the next flushHostEvents (optional).
+   * @returns The number of pending events after coalescing.
+   */
+  queueHostEvent?: (eventName: string, payload: unknown) => number;
+
+  /**
+   * Delivers the queued events, oldest first, by calling the guest global
+   * `handler(eventName, payload)` once per event, all within this call (optional).
+   * @param handler Name of the guest function.
+   * @param maxEvents Leave the rest queued.
+   * @returns The number of events delivered.
+   * @throws The first error thrown by the handler, after delivering the rest.
+   */
+  flushHostEvents?: (handler: string, maxEvents?: number) => number;
+
+  /**
+   * Counters for the host event queue (optional).
+   */
+  getHostEventStats?: () => HostEventStats;
+
+  /**
+   * Traffic and latency across the host boundary of this context (optional).
+   * Totals since the context was created or the last resetBoundaryStats.
+   */
+  getBoundaryStats?: () => BoundaryStats;
+
+  /**
+   * Clears the getBoundaryStats counters and histograms (optional).
+   */
+  resetBoundaryStats?: () => void;
+
+  /**
+   * Takes the entries the guest recorded with performance.mark/measure and
+   * console.time/timeEnd since the last drain, oldest first (optional).
+   * @param maxEntries Leave the rest for the next drain.
+   */
+  drainTrace?: (maxEntries?: number) => GuestTrace;
+
+  /**
+   * Counters for the guest trace buffer (optional).
+   */
+  getTraceStats?: () => TraceStats;
+
   /**
    * Binary transfer capabilities (optional).
    * When available, enables zero-copy transfer of binary data.
@@ -107,6 +233,194 @@ export interface JSEngineContext {
   binary?: BinaryTransferCapabilities;
 }
 
+/**
+ * A bundle evaluated while it downloads, as returned by JSEngineContext.createBundleStream.
+ */
+export interface BundleStream {
+  /** Append the next chunk of source (UTF-8 bytes or text) */
+  append(chunk: string | ArrayBuffer): void;
+  /** End of the source: evaluate it and return the completion value, like eval */
+  finish(): unknown;
+  /** Abandon the bundle (e.g. a failed download) */
+  cancel(): void;
+  getStats(): BundleStreamStats;
+}
+
+/**
+ * Bundle stream counters, as returned by BundleStream.getStats.
+ */
+export interface BundleStreamStats {
+  bytes: number;
+  chunks: number;
+  /** Off-thread parse and compile time, not counting waits for input */
+  compileMs: number;
+  /** Time finish() waited for the compile */
+  waitMs: number;
+  /** False when the bundle was evaluated from source (too large or failed to compile) */
+  streamed: boolean;
+}
+
+/**
+ * Approximate serialized size of a value, as returned by JSEngineContext.estimateSize.
+ */
+export interface SizeEstimate {
+  /** Approximate UTF-8 length of JSON.stringify(value) */
+  bytes: number;
+  /** Number of objects and arrays */
+  objects: number;
+  /** Number of string values */
+  strings: number;
+}
+
+/**
+ * Operation coalescing counters, as returned by JSEngineContext.getCoalescingStats.
+ */
+export interface CoalescingStats {
+  batches: number;
+  /** Operations sent by the guest */
+  opsIn: number;
+  /** Operations delivered to the host after coalescing */
+  opsOut: number;
+  /** Time spent coalescing */
+  coalesceMs: number;
+  /** Time spent converting the coalesced batches */
+  conversionMs: number;
+  /** Extrapolated conversion time of the eliminated operations */
+  estimatedSavedMs: number;
+}
+
+/**
+ * Conversion memo counters, as returned by JSEngineContext.getConversionStats.
+ */
+export interface ConversionStats {
+  /** Objects and arrays served from the memo */
+  hits: number;
+  /** Objects and arrays converted */
+  misses: number;
+  /** Memoized host objects */
+  entries: number;
+  evictions: number;
+  /** Maximum number of entries (0 disables the memo) */
+  capacity: number;
+}
+
+/**
+ * Message ring counters, as returned by JSEngineContext.getMessageRingStats.
+ */
+export interface MessageRingStats {
+  /** Ring size in bytes */
+  capacity: number;
+  /** Bytes waiting to be drained */
+  usedBytes: number;
+  /** Largest usedBytes seen */
+  highWaterBytes: number;
+  /** Messages accepted */
+  written: number;
+  drained: number;
+  /** Posts refused because the ring was full or the message too large */
+  rejected: number;
+}
+
+/**
+ * Coalescing policy for queued host events, see JSEngineContext.setHostEventPolicy.
+ */
+export type HostEventPolicy = 'all' | 'latest' | 'accumulate';
+
+/**
+ * Host event queue counters, as returned by JSEngineContext.getHostEventStats.
+ */
+export interface HostEventStats {
+  queued: number;
+  /** Events folded into a newer pending event */
+  coalesced: number;
+  delivered: number;
+  pending: number;
+  maxPending: number;
+  flushes: number;
+  /** Time from queueing to delivery (the oldest event folded in, for coalesced ones) */
+  avgWaitMs: number;
+  maxWaitMs: number;
+}
+
+/**
+ * Latency percentiles of boundary calls or conversions, see BoundaryStats.
+ * Percentiles are bucket upper bounds, within 12.5% of the recorded values.
+ */
+export interface LatencyStats {
+  count: number;
+  totalMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+/**
+ * Values converted in one direction across the host boundary.
+ */
+export interface BoundaryDirectionStats {
+  /** Top-level values converted (call arguments, return values, globals) */
+  crossings: number;
+  /** Values converted, including the nested ones */
+  values: number;
+  /** Objects and arrays */
+  objects: number;
+  strings: number;
+  /** UTF-8 bytes of the converted strings */
+  bytes: number;
+  /** Functions wrapped for the other side */
+  functions: number;
+  /** Time converting each crossing */
+  conversion: LatencyStats;
+}
+
+/**
+ * Host boundary counters, as returned by JSEngineContext.getBoundaryStats.
+ */
+export interface BoundaryStats {
+  toGuest: BoundaryDirectionStats;
+  toHost: BoundaryDirectionStats;
+  /** Host function wrappers collected by the guest */
+  functionsReleased: number;
+  /** Guest -> host callbacks, including argument and result conversion */
+  hostCalls: LatencyStats;
+  /** Host -> guest function calls, including conversion */
+  guestCalls: LatencyStats;
+}
+
+/**
+ * Guest User Timing entries, as returned by JSEngineContext.drainTrace.
+ * Parallel arrays: entry i is named names[name[i]].
+ */
+export interface GuestTrace {
+  /** Names used by the drained entries, each listed once */
+  names: string[];
+  /** Index into names, per entry */
+  name: number[];
+  /** 0 = mark, 1 = measure (including ended console timers) */
+  kind: number[];
+  /** ms since the context was created, see TraceStats.timeOrigin */
+  startTime: number[];
+  /** 0 for marks */
+  duration: number[];
+}
+
+/**
+ * Guest trace buffer counters, as returned by JSEngineContext.getTraceStats.
+ */
+export interface TraceStats {
+  recorded: number;
+  /** Entries recorded while the buffer or its name table was full */
+  dropped: number;
+  drained: number;
+  pending: number;
+  capacity: number;
+  /** Names held by pending entries, marks and running timers */
+  names: number;
+  /** Wall-clock time (ms since the epoch) of startTime 0 */
+  timeOrigin: number;
+}
+
 /**
  * Binary transfer capabilities for zero-copy data transfer.
  * Optional extension for providers that support efficient binary transfer (e.g., WASM).
@@ -1,5 +1,8 @@
 /**
  * Type declarations for QuickJS WASM module
+ *
+ * These match the checked-in quickjs_sandbox.js, built before the handle
+ * API of src/wasm_bindings.c; update them when it is regenerated.
  */
 
 interface QuickJSWASMModule {
@@ -113,6 +113,27 @@ function getComponents(): Record<ComponentName, string> {
   return result;
 }
 
+/**
+ * Deep-freeze style definitions when the host opted in (Engine option
+ * `freezeStyles`, seen as `__rill_freeze_styles`) and the QuickJS sandbox
+ * memoizes frozen values (`__rill_conversion_memo`): the boundary then
+ * converts them once and reuses the host copy on every render. Otherwise
+ * styles stay mutable.
+ */
+function freezeStyles<T extends object>(value: T): T {
+  const g = globalThis as Record<string, unknown>;
+  if (g.__rill_freeze_styles !== true || g.__rill_conversion_memo !== true) return value;
+  return deepFreeze(value);
+}
+
+function deepFreeze<T extends object>(value: T): T {
+  for (const key of Object.keys(value)) {
+    const v = (value as Record<string, unknown>)[key];
+    if (typeof v === 'object' && v !== null && !Object.isFrozen(v)) deepFreeze(v);
+  }
+  return Object.freeze(value);
+}
+
 /**
  * Get APIs - either stubs (sandbox) or real (react-native)
  *
@@ -127,7 +148,10 @@ function getAPIs() {
   // Sandbox stubs
   const stubs = {
     // Pure JS
-    StyleSheet: { create: <T extends object>(styles: T): T => styles, flatten: (s: unknown) => s },
+    StyleSheet: {
+      create: <T extends object>(styles: T): T => freezeStyles(styles),
+      flatten: (s: unknown) => s,
+    },
     Easing: {
       linear: (t: number) => t,
       ease: (t: number) => t,
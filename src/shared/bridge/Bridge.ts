@@ -319,6 +319,14 @@ export class Bridge {
     }
   }
 
+  /**
+   * Host → Guest value for paths that bypass sendToGuest() (e.g. a native
+   * host event queue): encoded and decoded as a HOST_EVENT payload would be
+   */
+  toGuestValue(value: BridgeValue): BridgeValue {
+    return this.decode(this.encode(value));
+  }
+
   /**
    * Host → Guest
    * 发送宿主消息，内部自动编码